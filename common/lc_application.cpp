@@ -3,6 +3,7 @@
 #include "lc_application.h"
 #include "lc_colors.h"
 #include "lc_library.h"
+#include "pieceinf.h"
 #include "lc_profile.h"
 #include "system.h"
 #include "opengl.h"
@@ -11,6 +12,10 @@
 #include "lc_mainwindow.h"
 #include "lc_shortcuts.h"
 #include "view.h"
+#include "preview.h"
+#include "lc_qheadlesscontext.h"
+#include "lc_simd.h"
+#include "lc_occlusion.h"
 
 lcApplication* g_App;
 
@@ -27,6 +32,14 @@ void lcPreferences::LoadDefaults()
 	mDrawGridLines = lcGetProfileInt(LC_PROFILE_GRID_LINES);
 	mGridLineSpacing = lcGetProfileInt(LC_PROFILE_GRID_LINE_SPACING);
 	mGridLineColor = lcGetProfileInt(LC_PROFILE_GRID_LINE_COLOR);
+	mCompactMeshes = lcGetProfileInt(LC_PROFILE_COMPACT_MESHES);
+	mIDBufferPicking = lcGetProfileInt(LC_PROFILE_ID_BUFFER_PICKING);
+	mStaticBatching = lcGetProfileInt(LC_PROFILE_STATIC_BATCHING);
+	mShaderRendering = lcGetProfileInt(LC_PROFILE_SHADER_RENDERING);
+	mBlendedTransparency = lcGetProfileInt(LC_PROFILE_BLENDED_TRANSPARENCY);
+	mOcclusionCulling = lcGetProfileInt(LC_PROFILE_OCCLUSION_CULLING);
+	mAdaptiveQuality = lcGetProfileInt(LC_PROFILE_ADAPTIVE_QUALITY);
+	mShowFrameStats = lcGetProfileInt(LC_PROFILE_SHOW_FRAME_STATS);
 }
 
 void lcPreferences::SaveDefaults()
@@ -42,6 +55,14 @@ void lcPreferences::SaveDefaults()
 	lcSetProfileInt(LC_PROFILE_GRID_LINES, mDrawGridLines);
 	lcSetProfileInt(LC_PROFILE_GRID_LINE_SPACING, mGridLineSpacing);
 	lcSetProfileInt(LC_PROFILE_GRID_LINE_COLOR, mGridLineColor);
+	lcSetProfileInt(LC_PROFILE_COMPACT_MESHES, mCompactMeshes);
+	lcSetProfileInt(LC_PROFILE_ID_BUFFER_PICKING, mIDBufferPicking);
+	lcSetProfileInt(LC_PROFILE_STATIC_BATCHING, mStaticBatching);
+	lcSetProfileInt(LC_PROFILE_SHADER_RENDERING, mShaderRendering);
+	lcSetProfileInt(LC_PROFILE_BLENDED_TRANSPARENCY, mBlendedTransparency);
+	lcSetProfileInt(LC_PROFILE_OCCLUSION_CULLING, mOcclusionCulling);
+	lcSetProfileInt(LC_PROFILE_ADAPTIVE_QUALITY, mAdaptiveQuality);
+	lcSetProfileInt(LC_PROFILE_SHOW_FRAME_STATS, mShowFrameStats);
 }
 
 lcApplication::lcApplication()
@@ -49,14 +70,24 @@ lcApplication::lcApplication()
 	mProject = NULL;
 	mLibrary = NULL;
 	mClipboard = NULL;
+	mHeadlessContext = NULL;
+	mVertexCacheStats = false;
+	mExitCode = 1;
 
 	mPreferences.LoadDefaults();
+
+	mStartupTimer.start();
 }
 
 lcApplication::~lcApplication()
 {
     delete mProject;
+
+    if (mLibrary && mVertexCacheStats)
+        mLibrary->PrintVertexCacheStats();
+
     delete mLibrary;
+    delete mHeadlessContext;
 }
 
 void lcApplication::SetProject(Project* Project)
@@ -64,12 +95,15 @@ void lcApplication::SetProject(Project* Project)
 	delete mProject;
 	mProject = Project;
 
-	const lcArray<View*>& Views = gMainWindow->GetViews();
-	for (int ViewIdx = 0; ViewIdx < Views.GetSize(); ViewIdx++)
+	if (gMainWindow)
 	{
-		View* View = Views[ViewIdx];
-		View->ClearCameras();
-		View->SetModel(lcGetActiveModel());
+		const lcArray<View*>& Views = gMainWindow->GetViews();
+		for (int ViewIdx = 0; ViewIdx < Views.GetSize(); ViewIdx++)
+		{
+			View* View = Views[ViewIdx];
+			View->ClearCameras();
+			View->SetModel(lcGetActiveModel());
+		}
 	}
 
 	Project->SetActiveModel(0);
@@ -204,6 +238,13 @@ bool lcApplication::Initialize(int argc, char* argv[], const char* LibraryInstal
 	bool SaveImage = false;
 	bool SaveWavefront = false;
 	bool Save3DS = false;
+	bool SaveGLTF = false;
+	bool GLTFInstancing = false;
+	bool SavePOVRay = false;
+	bool Headless = false;
+	bool Poster = false;
+	bool SimdBenchmark = false;
+	bool OcclusionTest = false;
 //	bool ImageHighlight = false;
 	int ImageWidth = lcGetProfileInt(LC_PROFILE_IMAGE_WIDTH);
 	int ImageHeight = lcGetProfileInt(LC_PROFILE_IMAGE_HEIGHT);
@@ -213,6 +254,12 @@ bool lcApplication::Initialize(int argc, char* argv[], const char* LibraryInstal
 	char* ProjectName = NULL;
 	char* SaveWavefrontName = NULL;
 	char* Save3DSName = NULL;
+	char* SaveGLTFName = NULL;
+	char* SavePOVRayName = NULL;
+	char* LGEOPath = NULL;
+	char* FrameStatsName = NULL;
+	char* CameraName = NULL;
+	char* BatchName = NULL;
 
 	// Parse the command line arguments.
 	for (int i = 1; i < argc; i++)
@@ -277,6 +324,70 @@ bool lcApplication::Initialize(int argc, char* argv[], const char* LibraryInstal
 					Save3DSName = argv[i];
 				}
 			}
+			else if ((strcmp(Param, "-gltf") == 0) || (strcmp(Param, "--export-gltf") == 0))
+			{
+				SaveGLTF = true;
+
+				if ((argc > (i+1)) && (argv[i+1][0] != '-'))
+				{
+					i++;
+					SaveGLTFName = argv[i];
+				}
+			}
+			else if (strcmp(Param, "--gltf-instancing") == 0)
+			{
+				GLTFInstancing = true;
+			}
+			else if ((strcmp(Param, "-pov") == 0) || (strcmp(Param, "--export-povray") == 0))
+			{
+				SavePOVRay = true;
+
+				if ((argc > (i+1)) && (argv[i+1][0] != '-'))
+				{
+					i++;
+					SavePOVRayName = argv[i];
+				}
+			}
+			else if (strcmp(Param, "--lgeo-path") == 0)
+			{
+				ParseStringArgument(&i, argc, argv, &LGEOPath);
+			}
+			else if (strcmp(Param, "--vertex-cache-stats") == 0)
+			{
+				mVertexCacheStats = true;
+			}
+			else if (strcmp(Param, "--compact-meshes") == 0)
+			{
+				mPreferences.mCompactMeshes = true;
+			}
+			else if (strcmp(Param, "--simd-benchmark") == 0)
+			{
+				SimdBenchmark = true;
+			}
+			else if (strcmp(Param, "--occlusion-test") == 0)
+			{
+				OcclusionTest = true;
+			}
+			else if (strcmp(Param, "--frame-stats") == 0)
+			{
+				ParseStringArgument(&i, argc, argv, &FrameStatsName);
+			}
+			else if (strcmp(Param, "--camera") == 0)
+			{
+				ParseStringArgument(&i, argc, argv, &CameraName);
+			}
+			else if (strcmp(Param, "--batch") == 0)
+			{
+				ParseStringArgument(&i, argc, argv, &BatchName);
+			}
+			else if (strcmp(Param, "--headless") == 0)
+			{
+				Headless = true;
+			}
+			else if (strcmp(Param, "--poster") == 0)
+			{
+				Poster = true;
+			}
 			else if ((strcmp(Param, "-v") == 0) || (strcmp(Param, "--version") == 0))
 			{
 				printf("LeoCAD Version " LC_VERSION_TEXT "\n");
@@ -294,9 +405,22 @@ bool lcApplication::Initialize(int argc, char* argv[], const char* LibraryInstal
 				printf("  -h, --height <height>: Sets the picture height.\n");
 				printf("  -f, --from <time>: Sets the first frame or step to save pictures.\n");
 				printf("  -t, --to <time>: Sets the last frame or step to save pictures.\n");
+				printf("  --camera <name>: Saves pictures from a camera of the model or a viewpoint like front or top.\n");
+				printf("  --poster: Saves pictures of any size as PNG files drawn in tiles, keeping little of them in memory.\n");
 //				printf("  --highlight: Highlight pieces in the steps they appear.\n");
 				printf("  -wf, --export-wavefront <outfile.obj>: Exports the model to Wavefront format.\n");
 				printf("  -3ds, --export-3ds <outfile.3ds>: Exports the model to 3DS format.\n");
+				printf("  -gltf, --export-gltf <outfile.glb>: Exports the model to binary glTF format.\n");
+				printf("  --gltf-instancing: Places copies of a part with the EXT_mesh_gpu_instancing glTF extension.\n");
+				printf("  -pov, --export-povray <outfile.pov>: Exports the model to POV-Ray format, seen from --camera.\n");
+				printf("  --lgeo-path <path>: Uses the LGEO parts in path for the POV-Ray export.\n");
+				printf("  --frame-stats <outfile.csv>: Logs the statistics of each frame drawn.\n");
+				printf("  --compact-meshes: Keeps the pieces in less memory with 16 bit positions, exports still use full precision.\n");
+				printf("  --vertex-cache-stats: Prints how well the vertex cache optimization of the loaded pieces worked.\n");
+				printf("  --simd-benchmark: Times the scalar and SIMD triangle tests on the pieces of the model.\n");
+				printf("  --occlusion-test: Checks that the occlusion culling buffer hides a box behind another one.\n");
+				printf("  --headless: Saves pictures and exports without creating any windows.\n");
+				printf("  --batch <jobs.json>: Saves the pictures and exports listed in a file, loading the library once.\n");
 				printf("  \n");
 
 				return false;
@@ -310,12 +434,40 @@ bool lcApplication::Initialize(int argc, char* argv[], const char* LibraryInstal
 		}
 	}
 
-	gMainWindow = new lcMainWindow();
+	if (FrameStatsName && !mFrameStatsLog.Open(FrameStatsName))
+		fprintf(stderr, "ERROR: Cannot open '%s' to log frame statistics.\n", FrameStatsName);
+
+	// The occlusion buffer is drawn on the CPU so the test needs neither a window nor the library.
+	if (OcclusionTest)
+	{
+		mExitCode = lcOcclusionTest() ? 0 : 1;
+		return false;
+	}
+
+	if (Headless)
+	{
+		if (!SaveImage && !SaveWavefront && !Save3DS && !SaveGLTF && !SavePOVRay && !SimdBenchmark && !BatchName)
+		{
+			fprintf(stderr, "ERROR: Nothing to do without a window, use --image or an export option.\n");
+			return false;
+		}
+
+		mHeadlessContext = new lcHeadlessContext();
+
+		if (!mHeadlessContext->Create())
+		{
+			fprintf(stderr, "ERROR: Cannot create an OpenGL context without a window.\n");
+			return false;
+		}
+	}
+	else
+		gMainWindow = new lcMainWindow();
+
 	lcLoadDefaultKeyboardShortcuts();
 
 	if (!LoadPiecesLibrary(LibPath, LibraryInstallPath, LDrawPath, LibraryCachePath))
 	{
-		if (SaveImage || SaveWavefront || Save3DS)
+		if (SaveImage || SaveWavefront || Save3DS || SaveGLTF || SavePOVRay || SimdBenchmark || BatchName)
 		{
 			fprintf(stderr, "ERROR: Cannot load pieces library.");
 			return false;
@@ -329,126 +481,548 @@ bool lcApplication::Initialize(int argc, char* argv[], const char* LibraryInstal
 			                         "Please visit http://www.leocad.org for information on how to download and install a library."));
 	}
 
-	gMainWindow->CreateWidgets();
+	if (gMainWindow)
+		gMainWindow->CreateWidgets();
 
 	// Create a new project.
 	Project* NewProject = new Project();
 	SetProject(NewProject);
 
-	// Load project.
-	if (ProjectName && gMainWindow->OpenProject(ProjectName))
+	if (BatchName)
 	{
-		if (SaveImage)
+		mExitCode = RunBatch(BatchName) ? 0 : 1;
+
+		if (mVertexCacheStats)
+			mLibrary->PrintVertexCacheStats();
+
+		return false;
+	}
+
+	if (ProjectName)
+	{
+		lcCommandLineJob Job;
+
+		Job.ProjectName = ProjectName;
+		Job.SaveImage = SaveImage;
+		Job.SaveWavefront = SaveWavefront;
+		Job.Save3DS = Save3DS;
+		Job.SaveGLTF = SaveGLTF;
+		Job.GLTFInstancing = GLTFInstancing;
+		Job.SavePOVRay = SavePOVRay;
+		Job.ImageName = ImageName;
+		Job.WavefrontName = SaveWavefrontName;
+		Job.Save3DSName = Save3DSName;
+		Job.GLTFName = SaveGLTFName;
+		Job.POVRayName = SavePOVRayName;
+		Job.LGEOPath = LGEOPath;
+		Job.CameraName = CameraName;
+		Job.ImageWidth = ImageWidth;
+		Job.ImageHeight = ImageHeight;
+		Job.ImageStart = ImageStart;
+		Job.ImageEnd = ImageEnd;
+		Job.Poster = Poster;
+
+		mExitCode = RunCommandLineJob(Job) ? 0 : 1;
+	}
+
+	if (SimdBenchmark)
+	{
+		lcArray<lcMesh*> Meshes;
+
+		for (int PieceIdx = 0; PieceIdx < mLibrary->mPieces.GetSize(); PieceIdx++)
 		{
-			QString FileName;
+			lcMesh* Mesh = mLibrary->mPieces[PieceIdx]->GetMesh();
 
-			if (ImageName)
-				FileName = ImageName;
-			else
-				FileName = ProjectName;
+			if (Mesh)
+				Meshes.Add(Mesh);
+		}
 
-			QString Extension = QFileInfo(FileName).suffix().toLower();
+		if (Meshes.IsEmpty())
+		{
+			fprintf(stderr, "ERROR: No pieces to test, --simd-benchmark needs a model.\n");
+			mExitCode = 1;
+		}
+		else
+			lcSimdBenchmark(Meshes, 64);
+	}
 
-			if (Extension.isEmpty())
-			{
-				FileName += lcGetProfileString(LC_PROFILE_IMAGE_EXTENSION);
-			}
-			else if (Extension != "bmp" && Extension != "jpg" && Extension != "jpeg" && Extension != "png")
-			{
+	if (SaveImage || SaveWavefront || Save3DS || SaveGLTF || SavePOVRay || SimdBenchmark)
+	{
+		if (mVertexCacheStats)
+			mLibrary->PrintVertexCacheStats();
+
+		return false;
+	}
+
+	return true;
+}
+
+// Returns the camera of the model named by the job, otherwise a viewpoint camera that looks at the whole model when
+// there's no window or the name is a viewpoint, otherwise the camera of the active view.
+lcCamera* lcApplication::GetCommandLineCamera(const lcCommandLineJob& Job, lcCamera& ViewpointCamera)
+{
+	lcModel* Model = lcGetActiveModel();
+
+	if (!Job.CameraName.isEmpty())
+	{
+		const lcArray<lcCamera*>& Cameras = Model->GetCameras();
+
+		for (int CameraIdx = 0; CameraIdx < Cameras.GetSize(); CameraIdx++)
+			if (Job.CameraName == Cameras[CameraIdx]->GetName())
+				return Cameras[CameraIdx];
+	}
+
+	if (!mHeadlessContext && Job.CameraName.isEmpty())
+		return gMainWindow->GetActiveView()->mCamera;
+
+	const char* ViewpointNames[] = { "front", "back", "top", "bottom", "left", "right", "home" };
+	lcViewpoint Viewpoint = LC_VIEWPOINT_HOME;
+
+	if (!Job.CameraName.isEmpty())
+	{
+		int ViewpointIdx;
+
+		for (ViewpointIdx = 0; ViewpointIdx < (int)(sizeof(ViewpointNames) / sizeof(ViewpointNames[0])); ViewpointIdx++)
+			if (Job.CameraName.compare(QLatin1String(ViewpointNames[ViewpointIdx]), Qt::CaseInsensitive) == 0)
+				break;
+
+		if (ViewpointIdx < (int)(sizeof(ViewpointNames) / sizeof(ViewpointNames[0])))
+			Viewpoint = (lcViewpoint)ViewpointIdx;
+		else
+			fprintf(stderr, "WARNING: Cannot find camera '%s', using the home viewpoint.\n", Job.CameraName.toLocal8Bit().data());
+	}
+
+	ViewpointCamera.SetViewpoint(Viewpoint);
+	Model->ZoomExtents(&ViewpointCamera, (float)Job.ImageWidth / (float)Job.ImageHeight);
+
+	return &ViewpointCamera;
+}
+
+bool lcApplication::RunCommandLineJob(lcCommandLineJob& Job)
+{
+	QElapsedTimer Timer;
+	Timer.start();
+
+	Job.LoadTime = 0.0f;
+	Job.ImageTime = 0.0f;
+	Job.ExportTime = 0.0f;
+
+	bool ProjectLoaded = false;
+	bool Success = true;
+
+	if (gMainWindow)
+		ProjectLoaded = gMainWindow->OpenProject(Job.ProjectName);
+	else
+	{
+		// Check the file first because there's no window to show errors from Project::Load().
+		Project* NewProject = new Project();
+		ProjectLoaded = QFileInfo(Job.ProjectName).isReadable() && NewProject->Load(Job.ProjectName);
+
+		if (ProjectLoaded)
+			SetProject(NewProject);
+		else
+			delete NewProject;
+	}
+
+	Job.LoadTime = Timer.nsecsElapsed() / 1000000.0f;
+
+	if (!ProjectLoaded)
+	{
+		fprintf(stderr, "ERROR: Cannot load '%s'.\n", Job.ProjectName.toLocal8Bit().data());
+		return false;
+	}
+
+	if (Job.SaveImage)
+	{
+		Timer.start();
+
+		QString FileName;
+
+		if (!Job.ImageName.isEmpty())
+			FileName = Job.ImageName;
+		else
+			FileName = Job.ProjectName;
+
+		QString Extension = QFileInfo(FileName).suffix().toLower();
+
+		if (Job.Poster)
+		{
+			if (!Extension.isEmpty())
 				FileName = FileName.left(FileName.length() - Extension.length() - 1);
-				FileName += lcGetProfileString(LC_PROFILE_IMAGE_EXTENSION);
-			}
 
-			if (ImageEnd < ImageStart)
-				ImageEnd = ImageStart;
-			else if (ImageStart > ImageEnd)
-				ImageStart = ImageEnd;
+			FileName += QLatin1String(".png");
+		}
+		else if (Extension.isEmpty())
+		{
+			FileName += lcGetProfileString(LC_PROFILE_IMAGE_EXTENSION);
+		}
+		else if (Extension != "bmp" && Extension != "jpg" && Extension != "jpeg" && Extension != "png")
+		{
+			FileName = FileName.left(FileName.length() - Extension.length() - 1);
+			FileName += lcGetProfileString(LC_PROFILE_IMAGE_EXTENSION);
+		}
+
+		lcStep ImageStart = Job.ImageStart;
+		lcStep ImageEnd = Job.ImageEnd;
 
-			if ((ImageStart == 0) && (ImageEnd == 0))
+		if (ImageEnd < ImageStart)
+			ImageEnd = ImageStart;
+		else if (ImageStart > ImageEnd)
+			ImageStart = ImageEnd;
+
+		if ((ImageStart == 0) && (ImageEnd == 0))
+		{
+			ImageStart = ImageEnd = mProject->GetActiveModel()->GetCurrentStep();
+		}
+		else if ((ImageStart == 0) && (ImageEnd != 0))
+		{
+			ImageStart = ImageEnd;
+		}
+		else if ((ImageStart != 0) && (ImageEnd == 0))
+		{
+			ImageEnd = ImageStart;
+		}
+
+		lcStep LastStep = mProject->GetActiveModel()->GetLastStep();
+
+		if (ImageStart > LastStep)
+			ImageStart = LastStep;
+
+		if (ImageEnd > LastStep)
+			ImageEnd = LastStep;
+
+		QString Frame;
+
+		if (ImageStart != ImageEnd)
+		{
+			QString Extension = QFileInfo(FileName).suffix();
+			Frame = FileName.left(FileName.length() - Extension.length() - 1) + QLatin1String("%1.") + Extension;
+		}
+		else
+			Frame = FileName;
+
+		lcModel* Model = lcGetActiveModel();
+		lcGLWidget* Widget = mHeadlessContext ? (lcGLWidget*)mHeadlessContext : (lcGLWidget*)gMainWindow->mPreviewWidget;
+		lcCamera ViewpointCamera(true);
+		lcCamera* Camera = GetCommandLineCamera(Job, ViewpointCamera);
+
+		if (Job.Poster)
+		{
+			for (lcStep Step = ImageStart; Step <= ImageEnd; Step++)
 			{
-				ImageStart = ImageEnd = mProject->GetActiveModel()->GetCurrentStep();
+				QString StepFileName = (ImageStart != ImageEnd) ? Frame.arg(Step, 2, 10, QLatin1Char('0')) : Frame;
+
+				if (!Model->SavePosterImage(Widget, Camera, StepFileName, Job.ImageWidth, Job.ImageHeight, Step))
+				{
+					fprintf(stderr, "ERROR: Cannot create '%s'.\n", StepFileName.toLocal8Bit().data());
+					Success = false;
+					break;
+				}
 			}
-			else if ((ImageStart == 0) && (ImageEnd != 0))
+		}
+		else
+		{
+			// The first image is saved by itself to report how long it took to get it after starting.
+			QString FirstFileName = (ImageStart != ImageEnd) ? Frame.arg(ImageStart, 2, 10, QLatin1Char('0')) : Frame;
+
+			if (Model->SaveStepImages(Widget, Camera, FirstFileName, false, Job.ImageWidth, Job.ImageHeight, ImageStart, ImageStart))
 			{
-				ImageStart = ImageEnd;
+				if (mStartupTimer.isValid())
+				{
+					printf("First image saved %.1f ms after startup.\n", mStartupTimer.nsecsElapsed() / 1000000.0);
+					mStartupTimer.invalidate();
+				}
+
+				if (ImageStart != ImageEnd && !Model->SaveStepImages(Widget, Camera, Frame, true, Job.ImageWidth, Job.ImageHeight, ImageStart + 1, ImageEnd))
+				{
+					fprintf(stderr, "ERROR: Cannot create images.\n");
+					Success = false;
+				}
 			}
-			else if ((ImageStart != 0) && (ImageEnd == 0))
+			else
 			{
-				ImageEnd = ImageStart;
+				fprintf(stderr, "ERROR: Cannot create images.\n");
+				Success = false;
 			}
+		}
 
-			if (ImageStart > 255)
-				ImageStart = 255;
+		Job.ImageTime = Timer.nsecsElapsed() / 1000000.0f;
+	}
 
-			if (ImageEnd > 255)
-				ImageEnd = 255;
+	Timer.start();
 
-			QString Frame;
+	if (Job.SaveWavefront)
+	{
+		QString FileName;
 
-			if (ImageStart != ImageEnd)
-			{
-				QString Extension = QFileInfo(FileName).suffix();
-				Frame = FileName.left(FileName.length() - Extension.length() - 1) + QLatin1String("%1.") + Extension;
-			}
-			else
-				Frame = FileName;
+		if (!Job.WavefrontName.isEmpty())
+			FileName = Job.WavefrontName;
+		else
+			FileName = Job.ProjectName;
+
+		QString Extension = QFileInfo(FileName).suffix().toLower();
+
+		if (Extension.isEmpty())
+		{
+			FileName += ".obj";
+		}
+		else if (Extension != "obj")
+		{
+			FileName = FileName.left(FileName.length() - Extension.length() - 1);
+			FileName += ".obj";
+		}
 
-			lcGetActiveModel()->SaveStepImages(Frame, ImageWidth, ImageHeight, ImageStart, ImageEnd);
+		if (!mProject->ExportWavefront(FileName))
+			Success = false;
+	}
+
+	if (Job.Save3DS)
+	{
+		QString FileName;
+
+		if (!Job.Save3DSName.isEmpty())
+			FileName = Job.Save3DSName;
+		else
+			FileName = Job.ProjectName;
+
+		QString Extension = QFileInfo(FileName).suffix().toLower();
+
+		if (Extension.isEmpty())
+		{
+			FileName += ".3ds";
+		}
+		else if (Extension != "3ds")
+		{
+			FileName = FileName.left(FileName.length() - Extension.length() - 1);
+			FileName += ".3ds";
 		}
 
-		if (SaveWavefront)
+		if (!mProject->Export3DStudio(FileName))
+			Success = false;
+	}
+
+	if (Job.SaveGLTF)
+	{
+		QString FileName;
+
+		if (!Job.GLTFName.isEmpty())
+			FileName = Job.GLTFName;
+		else
+			FileName = Job.ProjectName;
+
+		QString Extension = QFileInfo(FileName).suffix().toLower();
+
+		if (Extension.isEmpty())
 		{
-			QString FileName;
+			FileName += ".glb";
+		}
+		else if (Extension != "glb")
+		{
+			FileName = FileName.left(FileName.length() - Extension.length() - 1);
+			FileName += ".glb";
+		}
 
-			if (SaveWavefrontName)
-				FileName = SaveWavefrontName;
-			else
-				FileName = ProjectName;
+		if (!mProject->ExportGLTF(FileName, Job.GLTFInstancing))
+			Success = false;
+	}
 
-			QString Extension = QFileInfo(FileName).suffix().toLower();
+	if (Job.SavePOVRay)
+	{
+		QString FileName;
 
-			if (Extension.isEmpty())
-			{
-				FileName += ".obj";
-			}
-			else if (Extension != "obj")
-			{
-				FileName = FileName.left(FileName.length() - Extension.length() - 1);
-				FileName += ".obj";
-			}
+		if (!Job.POVRayName.isEmpty())
+			FileName = Job.POVRayName;
+		else
+			FileName = Job.ProjectName;
+
+		QString Extension = QFileInfo(FileName).suffix().toLower();
 
-			mProject->ExportWavefront(FileName);
+		if (Extension.isEmpty())
+		{
+			FileName += ".pov";
+		}
+		else if (Extension != "pov")
+		{
+			FileName = FileName.left(FileName.length() - Extension.length() - 1);
+			FileName += ".pov";
 		}
 
-		if (Save3DS)
+		lcCamera ViewpointCamera(true);
+		lcCamera* Camera = GetCommandLineCamera(Job, ViewpointCamera);
+
+		if (!mProject->ExportPOVRay(FileName, Job.LGEOPath, Camera))
+			Success = false;
+	}
+
+	Job.ExportTime = Timer.nsecsElapsed() / 1000000.0f;
+
+	return Success;
+}
+
+// Runs every job even when some fail, returns false if the file can't be read or any job or the report failed.
+bool lcApplication::RunBatch(const char* FileName)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+	QFile File(FileName);
+
+	if (!File.open(QIODevice::ReadOnly))
+	{
+		fprintf(stderr, "ERROR: Cannot open '%s'.\n", FileName);
+		return false;
+	}
+
+	QJsonParseError Error;
+	QJsonDocument Document = QJsonDocument::fromJson(File.readAll(), &Error);
+
+	if (Document.isNull())
+	{
+		fprintf(stderr, "ERROR: Cannot read '%s': %s.\n", FileName, Error.errorString().toLocal8Bit().data());
+		return false;
+	}
+
+	// The file is either an array of jobs or an object with a "jobs" array and the name of a CSV "report" to write.
+	QJsonObject Root = Document.object();
+	QJsonArray JobArray = Document.isArray() ? Document.array() : Root["jobs"].toArray();
+	QString ReportName = Root["report"].toString();
+	QDir BatchDir = QFileInfo(FileName).absoluteDir();
+	lcArray<lcCommandLineJob> Jobs;
+	int NumFailed = 0;
+
+	for (int JobIdx = 0; JobIdx < JobArray.size(); JobIdx++)
+	{
+		QJsonObject JobObject = JobArray[JobIdx].toObject();
+		QString ModelName = JobObject["model"].toString();
+
+		if (ModelName.isEmpty())
 		{
-			QString FileName;
+			fprintf(stderr, "ERROR: Skipping job %d without a model.\n", JobIdx + 1);
+			NumFailed++;
+			continue;
+		}
 
-			if (Save3DSName)
-				FileName = Save3DSName;
-			else
-				FileName = ProjectName;
+		lcCommandLineJob Job;
+
+		Job.ProjectName = BatchDir.absoluteFilePath(ModelName);
+		Job.SaveImage = false;
+		Job.SaveWavefront = false;
+		Job.Save3DS = false;
+		Job.SaveGLTF = false;
+		Job.GLTFInstancing = JobObject["instancing"].toBool(false);
+		Job.SavePOVRay = false;
+		Job.LGEOPath = JobObject["lgeo"].toString();
+		Job.CameraName = JobObject["camera"].toString();
+		Job.ImageWidth = JobObject["width"].toInt(lcGetProfileInt(LC_PROFILE_IMAGE_WIDTH));
+		Job.ImageHeight = JobObject["height"].toInt(lcGetProfileInt(LC_PROFILE_IMAGE_HEIGHT));
+		Job.ImageStart = JobObject["from"].toInt(0);
+		Job.ImageEnd = JobObject["to"].toInt(0);
+		Job.Poster = JobObject["poster"].toBool(false);
+
+		// The format defaults to the extension of the output, anything other than a model export is a picture.
+		QString OutputName = JobObject["output"].toString();
+		QString Format = JobObject["format"].toString(QFileInfo(OutputName).suffix()).toLower();
+
+		if (!OutputName.isEmpty())
+			OutputName = BatchDir.absoluteFilePath(OutputName);
+
+		if (Format == "obj" || Format == "wavefront")
+		{
+			Job.SaveWavefront = true;
+			Job.WavefrontName = OutputName;
+		}
+		else if (Format == "3ds")
+		{
+			Job.Save3DS = true;
+			Job.Save3DSName = OutputName;
+		}
+		else if (Format == "glb" || Format == "gltf")
+		{
+			Job.SaveGLTF = true;
+			Job.GLTFName = OutputName;
+		}
+		else if (Format == "pov" || Format == "povray")
+		{
+			Job.SavePOVRay = true;
+			Job.POVRayName = OutputName;
+		}
+		else
+		{
+			Job.SaveImage = true;
+			Job.ImageName = OutputName;
+		}
 
-			QString Extension = QFileInfo(FileName).suffix().toLower();
+		Jobs.Add(Job);
+	}
 
-			if (Extension.isEmpty())
-			{
-				FileName += ".3ds";
-			}
-			else if (Extension != "3ds")
+	QElapsedTimer BatchTimer;
+	BatchTimer.start();
+
+	// Keep the pieces used by each job loaded so their meshes and textures are shared with the jobs that follow.
+	lcArray<PieceInfo*> LoadedPieces;
+
+	for (int JobIdx = 0; JobIdx < Jobs.GetSize(); JobIdx++)
+	{
+		lcCommandLineJob& Job = Jobs[JobIdx];
+
+		printf("Job %d of %d: %s\n", JobIdx + 1, Jobs.GetSize(), Job.ProjectName.toLocal8Bit().data());
+
+		if (!RunCommandLineJob(Job))
+			NumFailed++;
+
+		for (int PieceIdx = 0; PieceIdx < mLibrary->mPieces.GetSize(); PieceIdx++)
+		{
+			PieceInfo* Info = mLibrary->mPieces[PieceIdx];
+
+			if (Info->IsLoaded() && !Info->IsTemporary() && LoadedPieces.FindIndex(Info) == -1)
 			{
-				FileName = FileName.left(FileName.length() - Extension.length() - 1);
-				FileName += ".3ds";
+				Info->AddRef();
+				LoadedPieces.Add(Info);
 			}
-
-			mProject->Export3DStudio(FileName);
 		}
 	}
 
-	if (SaveImage || SaveWavefront || Save3DS)
+	float BatchTime = BatchTimer.nsecsElapsed() / 1000000.0f;
+
+	SetProject(new Project());
+
+	for (int PieceIdx = 0; PieceIdx < LoadedPieces.GetSize(); PieceIdx++)
+		LoadedPieces[PieceIdx]->Release();
+
+	printf("\n     Load (ms)  Images (ms)  Export (ms)  Model\n");
+
+	for (int JobIdx = 0; JobIdx < Jobs.GetSize(); JobIdx++)
+	{
+		const lcCommandLineJob& Job = Jobs[JobIdx];
+		printf("%3d  %9.1f  %11.1f  %11.1f  %s\n", JobIdx + 1, Job.LoadTime, Job.ImageTime, Job.ExportTime, Job.ProjectName.toLocal8Bit().data());
+	}
+
+	printf("%d jobs in %.1f ms, %d failed.\n", Jobs.GetSize(), BatchTime, NumFailed);
+
+	if (ReportName.isEmpty())
+		return NumFailed == 0;
+
+	QFile ReportFile(BatchDir.absoluteFilePath(ReportName));
+
+	if (!ReportFile.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		fprintf(stderr, "ERROR: Cannot write '%s'.\n", ReportName.toLocal8Bit().data());
 		return false;
+	}
 
-	return true;
+	QTextStream Stream(&ReportFile);
+
+	Stream << "Job,Model,Load (ms),Images (ms),Export (ms)\n";
+
+	for (int JobIdx = 0; JobIdx < Jobs.GetSize(); JobIdx++)
+	{
+		const lcCommandLineJob& Job = Jobs[JobIdx];
+		Stream << JobIdx + 1 << ",\"" << Job.ProjectName << "\"," << Job.LoadTime << "," << Job.ImageTime << "," << Job.ExportTime << "\n";
+	}
+
+	return NumFailed == 0;
+#else
+	fprintf(stderr, "ERROR: Batch files need LeoCAD to be built with Qt 5, cannot read '%s'.\n", FileName);
+	return false;
+#endif
 }
 
 void lcApplication::Shutdown()
@@ -484,7 +1058,7 @@ void lcApplication::ShowPreferencesDialog()
 	if (!gMainWindow->DoDialog(LC_DIALOG_PREFERENCES, &Options))
 		return;
 
-	bool LibraryChanged = Options.LibraryPath != lcGetProfileString(LC_PROFILE_PARTS_LIBRARY);
+	bool LibraryChanged = Options.LibraryPath != lcGetProfileString(LC_PROFILE_PARTS_LIBRARY) || Options.Preferences.mCompactMeshes != mPreferences.mCompactMeshes;
 	bool AAChanged = CurrentAASamples != Options.AASamples;
 
 	mPreferences = Options.Preferences;
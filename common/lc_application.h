@@ -2,6 +2,8 @@
 #define _LC_APPLICATION_H_
 
 #include "lc_array.h"
+#include "lc_framestats.h"
+#include "object.h"
 #include "str.h"
 
 #ifndef LIBPATH_DEFAULT
@@ -10,6 +12,7 @@
 
 class Project;
 class lcPiecesLibrary;
+class lcHeadlessContext;
 
 enum lcLightingMode
 {
@@ -35,6 +38,42 @@ public:
 	int mGridLineSpacing;
 	lcuint32 mGridLineColor;
 	bool mFixedAxes;
+	bool mCompactMeshes;
+	bool mIDBufferPicking;
+	bool mStaticBatching;
+	bool mShaderRendering;
+	bool mBlendedTransparency;
+	bool mOcclusionCulling;
+	bool mAdaptiveQuality;
+	bool mShowFrameStats;
+};
+
+// Pictures and exports to save from a project, given on the command line or in a batch file. The times are filled by
+// lcApplication::RunCommandLineJob() in milliseconds.
+struct lcCommandLineJob
+{
+	QString ProjectName;
+	bool SaveImage;
+	bool SaveWavefront;
+	bool Save3DS;
+	bool SaveGLTF;
+	bool GLTFInstancing;
+	bool SavePOVRay;
+	QString ImageName;
+	QString WavefrontName;
+	QString Save3DSName;
+	QString GLTFName;
+	QString POVRayName;
+	QString LGEOPath;
+	QString CameraName;
+	int ImageWidth;
+	int ImageHeight;
+	lcStep ImageStart;
+	lcStep ImageEnd;
+	bool Poster;
+	float LoadTime;
+	float ImageTime;
+	float ExportTime;
 };
 
 class lcApplication
@@ -59,9 +98,18 @@ public:
 	Project* mProject;
 	lcPiecesLibrary* mLibrary;
 	lcPreferences mPreferences;
+	lcFrameStatsLog mFrameStatsLog;
 	QByteArray mClipboard;
+	int mExitCode; // Returned from main() when Initialize() returns false, 0 only if the command line jobs all worked.
 
 protected:
+	QElapsedTimer mStartupTimer;
+	lcHeadlessContext* mHeadlessContext;
+	bool mVertexCacheStats;
+
+	lcCamera* GetCommandLineCamera(const lcCommandLineJob& Job, lcCamera& ViewpointCamera);
+	bool RunCommandLineJob(lcCommandLineJob& Job);
+	bool RunBatch(const char* FileName);
 	void ParseIntegerArgument(int* CurArg, int argc, char* argv[], int* Value);
 	void ParseStringArgument(int* CurArg, int argc, char* argv[], char** Value);
 };
@@ -225,4 +225,59 @@ protected:
 	int mGrow;
 };
 
+// Stable least significant byte first radix sort of items with a 64 bit SortKey, Temp is used as scratch space.
+template<typename T>
+void lcRadixSort(lcArray<T>& Items, lcArray<T>& Temp)
+{
+	int NumItems = Items.GetSize();
+
+	if (NumItems < 2)
+		return;
+
+	Temp.SetSize(NumItems);
+
+	int Histograms[8][256];
+	memset(Histograms, 0, sizeof(Histograms));
+
+	for (int ItemIdx = 0; ItemIdx < NumItems; ItemIdx++)
+	{
+		lcuint64 SortKey = Items[ItemIdx].SortKey;
+
+		for (int Pass = 0; Pass < 8; Pass++)
+			Histograms[Pass][(SortKey >> (Pass * 8)) & 0xff]++;
+	}
+
+	T* Source = &Items[0];
+	T* Dest = &Temp[0];
+
+	for (int Pass = 0; Pass < 8; Pass++)
+	{
+		int* Histogram = Histograms[Pass];
+		int Shift = Pass * 8;
+
+		// Skip bytes that are the same for all keys.
+		if (Histogram[(Source[0].SortKey >> Shift) & 0xff] == NumItems)
+			continue;
+
+		int Offsets[256];
+		int Offset = 0;
+
+		for (int Bucket = 0; Bucket < 256; Bucket++)
+		{
+			Offsets[Bucket] = Offset;
+			Offset += Histogram[Bucket];
+		}
+
+		for (int ItemIdx = 0; ItemIdx < NumItems; ItemIdx++)
+			Dest[Offsets[(Source[ItemIdx].SortKey >> Shift) & 0xff]++] = Source[ItemIdx];
+
+		T* Swap = Source;
+		Source = Dest;
+		Dest = Swap;
+	}
+
+	if (Source != &Items[0])
+		memcpy(&Items[0], Source, NumItems * sizeof(T));
+}
+
 #endif // _LC_ARRAY_H_
@@ -0,0 +1,385 @@
+#include "lc_global.h"
+#include "lc_bvh.h"
+#include "lc_file.h"
+#include <float.h>
+
+struct lcBVHSortKey
+{
+	float Key;
+	int Item;
+};
+
+static int lcBVHSortKeyCompare(const void* Elem1, const void* Elem2)
+{
+	const lcBVHSortKey* Key1 = (const lcBVHSortKey*)Elem1;
+	const lcBVHSortKey* Key2 = (const lcBVHSortKey*)Elem2;
+
+	if (Key1->Key < Key2->Key)
+		return -1;
+
+	if (Key1->Key > Key2->Key)
+		return 1;
+
+	return Key1->Item - Key2->Item;
+}
+
+static int lcBVHItemCompare(const void* Elem1, const void* Elem2)
+{
+	return *(const int*)Elem1 - *(const int*)Elem2;
+}
+
+static int lcBVHRayHitCompare(const void* Elem1, const void* Elem2)
+{
+	const lcBVHRayHit* Hit1 = (const lcBVHRayHit*)Elem1;
+	const lcBVHRayHit* Hit2 = (const lcBVHRayHit*)Elem2;
+
+	if (Hit1->Distance < Hit2->Distance)
+		return -1;
+
+	if (Hit1->Distance > Hit2->Distance)
+		return 1;
+
+	return Hit1->Item - Hit2->Item;
+}
+
+// Slab test that returns the distance along the ray where it enters the box, the ray starts at Start and has no end.
+static inline bool lcBVHRayBoxIntersect(const lcVector3& Min, const lcVector3& Max, const lcVector3& Start, const lcVector3& InverseDirection, float& EnterT)
+{
+	float NearT = 0.0f;
+	float FarT = FLT_MAX;
+
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		if (InverseDirection[Axis] == FLT_MAX)
+		{
+			if (Start[Axis] < Min[Axis] || Start[Axis] > Max[Axis])
+				return false;
+
+			continue;
+		}
+
+		float t1 = (Min[Axis] - Start[Axis]) * InverseDirection[Axis];
+		float t2 = (Max[Axis] - Start[Axis]) * InverseDirection[Axis];
+
+		if (t1 > t2)
+		{
+			float Tmp = t1;
+			t1 = t2;
+			t2 = Tmp;
+		}
+
+		if (t1 > NearT)
+			NearT = t1;
+
+		if (t2 < FarT)
+			FarT = t2;
+
+		if (NearT > FarT)
+			return false;
+	}
+
+	EnterT = NearT;
+	return true;
+}
+
+lcBVH::lcBVH()
+	: mNodes(0, 1024), mItems(0, 1024)
+{
+}
+
+lcBVH::~lcBVH()
+{
+}
+
+void lcBVH::Build(const lcArray<lcBVHBounds>& ItemBounds)
+{
+	int NumItems = ItemBounds.GetSize();
+
+	mNodes.RemoveAll();
+	mItemBounds = ItemBounds;
+	mItems.SetSize(NumItems);
+
+	for (int ItemIdx = 0; ItemIdx < NumItems; ItemIdx++)
+		mItems[ItemIdx] = ItemIdx;
+
+	if (NumItems)
+		BuildNode(ItemBounds, 0, NumItems);
+}
+
+int lcBVH::BuildNode(const lcArray<lcBVHBounds>& ItemBounds, int FirstItem, int NumItems)
+{
+	int NodeIndex = mNodes.GetSize();
+	lcBVHNode& Node = mNodes.Add();
+
+	lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	lcVector3 CenterMin(FLT_MAX, FLT_MAX, FLT_MAX), CenterMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (int ItemIdx = FirstItem; ItemIdx < FirstItem + NumItems; ItemIdx++)
+	{
+		const lcBVHBounds& Bounds = ItemBounds[mItems[ItemIdx]];
+		lcVector3 Center = (Bounds.Min + Bounds.Max) * 0.5f;
+
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			Min[Axis] = lcMin(Min[Axis], Bounds.Min[Axis]);
+			Max[Axis] = lcMax(Max[Axis], Bounds.Max[Axis]);
+			CenterMin[Axis] = lcMin(CenterMin[Axis], Center[Axis]);
+			CenterMax[Axis] = lcMax(CenterMax[Axis], Center[Axis]);
+		}
+	}
+
+	Node.Min = Min;
+	Node.Max = Max;
+	Node.RightChild = -1;
+	Node.FirstItem = FirstItem;
+	Node.NumItems = NumItems;
+
+	if (NumItems <= LC_BVH_MAX_LEAF_ITEMS)
+		return NodeIndex;
+
+	// Split at the median of the item centers along the longest axis.
+	lcVector3 CenterSize = CenterMax - CenterMin;
+	int SplitAxis = 0;
+
+	if (CenterSize[1] > CenterSize[SplitAxis])
+		SplitAxis = 1;
+
+	if (CenterSize[2] > CenterSize[SplitAxis])
+		SplitAxis = 2;
+
+	lcBVHSortKey* Keys = (lcBVHSortKey*)malloc(NumItems * sizeof(lcBVHSortKey));
+
+	for (int ItemIdx = 0; ItemIdx < NumItems; ItemIdx++)
+	{
+		int Item = mItems[FirstItem + ItemIdx];
+		const lcBVHBounds& Bounds = ItemBounds[Item];
+
+		Keys[ItemIdx].Key = Bounds.Min[SplitAxis] + Bounds.Max[SplitAxis];
+		Keys[ItemIdx].Item = Item;
+	}
+
+	qsort(Keys, NumItems, sizeof(lcBVHSortKey), lcBVHSortKeyCompare);
+
+	for (int ItemIdx = 0; ItemIdx < NumItems; ItemIdx++)
+		mItems[FirstItem + ItemIdx] = Keys[ItemIdx].Item;
+
+	free(Keys);
+
+	int NumLeftItems = NumItems / 2;
+
+	mNodes[NodeIndex].NumItems = 0;
+	BuildNode(ItemBounds, FirstItem, NumLeftItems);
+	int RightChild = BuildNode(ItemBounds, FirstItem + NumLeftItems, NumItems - NumLeftItems);
+	mNodes[NodeIndex].RightChild = RightChild;
+
+	return NodeIndex;
+}
+
+void lcBVH::Refit(const lcArray<lcBVHBounds>& ItemBounds)
+{
+	mItemBounds = ItemBounds;
+
+	// Children are always stored after their parent so walking the nodes backwards updates them bottom up.
+	for (int NodeIdx = mNodes.GetSize() - 1; NodeIdx >= 0; NodeIdx--)
+	{
+		lcBVHNode& Node = mNodes[NodeIdx];
+
+		if (Node.NumItems)
+		{
+			lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+			for (int ItemIdx = Node.FirstItem; ItemIdx < Node.FirstItem + Node.NumItems; ItemIdx++)
+			{
+				const lcBVHBounds& Bounds = ItemBounds[mItems[ItemIdx]];
+
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					Min[Axis] = lcMin(Min[Axis], Bounds.Min[Axis]);
+					Max[Axis] = lcMax(Max[Axis], Bounds.Max[Axis]);
+				}
+			}
+
+			Node.Min = Min;
+			Node.Max = Max;
+		}
+		else
+		{
+			const lcBVHNode& Left = mNodes[NodeIdx + 1];
+			const lcBVHNode& Right = mNodes[Node.RightChild];
+
+			for (int Axis = 0; Axis < 3; Axis++)
+			{
+				Node.Min[Axis] = lcMin(Left.Min[Axis], Right.Min[Axis]);
+				Node.Max[Axis] = lcMax(Left.Max[Axis], Right.Max[Axis]);
+			}
+		}
+	}
+}
+
+void lcBVH::RayTest(const lcVector3& Start, const lcVector3& End, float MaxDistance, lcArray<lcBVHRayHit>& Hits) const
+{
+	Hits.RemoveAll();
+
+	if (mNodes.IsEmpty())
+		return;
+
+	lcVector3 Direction = End - Start;
+	float Length = lcLength(Direction);
+
+	if (Length == 0.0f)
+		return;
+
+	Direction /= Length;
+
+	lcVector3 InverseDirection;
+
+	for (int Axis = 0; Axis < 3; Axis++)
+		InverseDirection[Axis] = (Direction[Axis] != 0.0f) ? 1.0f / Direction[Axis] : FLT_MAX;
+
+	int Stack[64];
+	int StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while (StackSize)
+	{
+		int NodeIndex = Stack[--StackSize];
+		const lcBVHNode& Node = mNodes[NodeIndex];
+		float Distance;
+
+		if (!lcBVHRayBoxIntersect(Node.Min, Node.Max, Start, InverseDirection, Distance) || Distance > MaxDistance)
+			continue;
+
+		if (!Node.NumItems)
+		{
+			Stack[StackSize++] = Node.RightChild;
+			Stack[StackSize++] = NodeIndex + 1;
+			continue;
+		}
+
+		for (int ItemIdx = Node.FirstItem; ItemIdx < Node.FirstItem + Node.NumItems; ItemIdx++)
+		{
+			int Item = mItems[ItemIdx];
+			const lcBVHBounds& Bounds = mItemBounds[Item];
+
+			if (!lcBVHRayBoxIntersect(Bounds.Min, Bounds.Max, Start, InverseDirection, Distance) || Distance > MaxDistance)
+				continue;
+
+			lcBVHRayHit& Hit = Hits.Add();
+			Hit.Item = Item;
+			Hit.Distance = Distance;
+		}
+	}
+
+	if (Hits.GetSize() > 1)
+		qsort(&Hits[0], Hits.GetSize(), sizeof(lcBVHRayHit), lcBVHRayHitCompare);
+}
+
+void lcBVH::BoxTest(const lcVector4 Planes[6], lcArray<int>& Items) const
+{
+	Items.RemoveAll();
+
+	if (mNodes.IsEmpty())
+		return;
+
+	lcMatrix44 Identity = lcMatrix44Identity();
+	int Stack[64];
+	int StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while (StackSize)
+	{
+		int NodeIndex = Stack[--StackSize];
+		const lcBVHNode& Node = mNodes[NodeIndex];
+
+		if (!lcBoundingBoxIntersectsFrustum(Node.Min, Node.Max, Identity, Planes))
+			continue;
+
+		if (!Node.NumItems)
+		{
+			Stack[StackSize++] = Node.RightChild;
+			Stack[StackSize++] = NodeIndex + 1;
+			continue;
+		}
+
+		for (int ItemIdx = Node.FirstItem; ItemIdx < Node.FirstItem + Node.NumItems; ItemIdx++)
+		{
+			int Item = mItems[ItemIdx];
+			const lcBVHBounds& Bounds = mItemBounds[Item];
+
+			if (lcBoundingBoxIntersectsFrustum(Bounds.Min, Bounds.Max, Identity, Planes))
+				Items.Add(Item);
+		}
+	}
+
+	if (Items.GetSize() > 1)
+		qsort(&Items[0], Items.GetSize(), sizeof(int), lcBVHItemCompare);
+}
+
+bool lcBVH::FileLoad(lcFile& File)
+{
+	lcuint32 NumNodes, NumItems;
+
+	mNodes.RemoveAll();
+	mItemBounds.RemoveAll();
+	mItems.RemoveAll();
+
+	if (!File.ReadU32(&NumNodes, 1) || !File.ReadU32(&NumItems, 1))
+		return false;
+
+	mNodes.SetSize(NumNodes);
+
+	for (lcuint32 NodeIdx = 0; NodeIdx < NumNodes; NodeIdx++)
+	{
+		lcBVHNode& Node = mNodes[NodeIdx];
+		lcint32 Values[3];
+
+		if (File.ReadFloats(Node.Min, 3) != 3 || File.ReadFloats(Node.Max, 3) != 3 || File.ReadS32(Values, 3) != 3)
+			return false;
+
+		Node.RightChild = Values[0];
+		Node.FirstItem = Values[1];
+		Node.NumItems = Values[2];
+	}
+
+	mItemBounds.SetSize(NumItems);
+	mItems.SetSize(NumItems);
+
+	for (lcuint32 ItemIdx = 0; ItemIdx < NumItems; ItemIdx++)
+	{
+		lcBVHBounds& Bounds = mItemBounds[ItemIdx];
+		lcint32 Item;
+
+		if (File.ReadFloats(Bounds.Min, 3) != 3 || File.ReadFloats(Bounds.Max, 3) != 3 || !File.ReadS32(&Item, 1))
+			return false;
+
+		mItems[ItemIdx] = Item;
+	}
+
+	return true;
+}
+
+void lcBVH::FileSave(lcFile& File) const
+{
+	File.WriteU32(mNodes.GetSize());
+	File.WriteU32(mItems.GetSize());
+
+	for (int NodeIdx = 0; NodeIdx < mNodes.GetSize(); NodeIdx++)
+	{
+		const lcBVHNode& Node = mNodes[NodeIdx];
+
+		File.WriteFloats(Node.Min, 3);
+		File.WriteFloats(Node.Max, 3);
+		File.WriteS32(Node.RightChild);
+		File.WriteS32(Node.FirstItem);
+		File.WriteS32(Node.NumItems);
+	}
+
+	for (int ItemIdx = 0; ItemIdx < mItems.GetSize(); ItemIdx++)
+	{
+		const lcBVHBounds& Bounds = mItemBounds[ItemIdx];
+
+		File.WriteFloats(Bounds.Min, 3);
+		File.WriteFloats(Bounds.Max, 3);
+		File.WriteS32(mItems[ItemIdx]);
+	}
+}
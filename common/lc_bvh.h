@@ -0,0 +1,63 @@
+#ifndef _LC_BVH_H_
+#define _LC_BVH_H_
+
+#include "lc_array.h"
+#include "lc_math.h"
+
+#define LC_BVH_MAX_LEAF_ITEMS 4
+
+struct lcBVHBounds
+{
+	lcVector3 Min;
+	lcVector3 Max;
+};
+
+struct lcBVHNode
+{
+	lcVector3 Min;
+	lcVector3 Max;
+	int RightChild;
+	int FirstItem;
+	int NumItems;
+};
+
+struct lcBVHRayHit
+{
+	int Item;
+	float Distance;
+};
+
+// Bounding volume hierarchy over a list of axis aligned boxes, items are referenced by their index in the list.
+// Nodes are stored in depth first order, the left child of a node always follows its parent.
+class lcBVH
+{
+public:
+	lcBVH();
+	~lcBVH();
+
+	int GetNumItems() const
+	{
+		return mItems.GetSize();
+	}
+
+	void Build(const lcArray<lcBVHBounds>& ItemBounds);
+	void Refit(const lcArray<lcBVHBounds>& ItemBounds);
+
+	// Returns the items whose bounds are hit by the ray closer than MaxDistance, sorted by distance from the start of the ray.
+	void RayTest(const lcVector3& Start, const lcVector3& End, float MaxDistance, lcArray<lcBVHRayHit>& Hits) const;
+
+	// Returns the items whose bounds are not completely outside one of the planes, sorted by index.
+	void BoxTest(const lcVector4 Planes[6], lcArray<int>& Items) const;
+
+	bool FileLoad(lcFile& File);
+	void FileSave(lcFile& File) const;
+
+protected:
+	int BuildNode(const lcArray<lcBVHBounds>& ItemBounds, int FirstItem, int NumItems);
+
+	lcArray<lcBVHNode> mNodes;
+	lcArray<lcBVHBounds> mItemBounds;
+	lcArray<int> mItems;
+};
+
+#endif // _LC_BVH_H_
@@ -74,6 +74,13 @@ lcCommand gCommands[LC_NUM_COMMANDS] =
 		QT_TRANSLATE_NOOP("Status", "Export a list of parts used in comma delimited file format"),
 		QT_TRANSLATE_NOOP("Shortcut", "")
 	},
+	// LC_FILE_EXPORT_GLTF
+	{
+		"File.Export.GLTF",
+		QT_TRANSLATE_NOOP("Menu", "&glTF..."),
+		QT_TRANSLATE_NOOP("Status", "Export the project in binary glTF format"),
+		QT_TRANSLATE_NOOP("Shortcut", "")
+	},
 	// LC_FILE_EXPORT_POVRAY
 	{
 		"File.Export.POVRay",
@@ -13,6 +13,7 @@ enum lcCommandId
 	LC_FILE_EXPORT_HTML,
 	LC_FILE_EXPORT_BRICKLINK,
 	LC_FILE_EXPORT_CSV,
+	LC_FILE_EXPORT_GLTF,
 	LC_FILE_EXPORT_POVRAY,
 	LC_FILE_EXPORT_WAVEFRONT,
 	LC_FILE_PRINT,
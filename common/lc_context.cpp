@@ -3,52 +3,577 @@
 #include "lc_mesh.h"
 #include "lc_texture.h"
 #include "lc_colors.h"
+#include "pieceinf.h"
+#include "piece.h"
+#include "lc_staticbatch.h"
+#include "lc_occlusion.h"
+#include "lc_imagewriter.h"
 #include "lc_mainwindow.h"
 
-static int lcOpaqueRenderMeshCompare(const void* Elem1, const void* Elem2)
+lcScene::lcScene()
+	: mOpaqueMeshes(0, 1024), mTranslucentMeshes(0, 1024), mInterfaceObjects(0, 1024)
 {
-	lcRenderMesh* Mesh1 = (lcRenderMesh*)Elem1;
-	lcRenderMesh* Mesh2 = (lcRenderMesh*)Elem2;
+	mCurrentPiece = NULL;
+	mUpdateTime = 0.0f;
+	mSortTranslucentMeshes = true;
+	mDrawEdgeLines = true;
+	mStepOrder = false;
+	mModel = NULL;
+	mViewCamera = NULL;
+	mDrawInterface = false;
+	mFirstStep = 1;
+	mRevision = 0;
+	mStaticBatcher = NULL;
+	mOcclusionBuffer = NULL;
+	mNumPieceOpaqueMeshes = 0;
+	mNumPieces = 0;
+}
 
-	if (Mesh1->Mesh < Mesh2->Mesh)
-		return -1;
+void lcScene::Begin(const lcMatrix44& ViewMatrix, const lcMatrix44& ProjectionMatrix)
+{
+	mViewMatrix = ViewMatrix;
+	mProjectionMatrix = ProjectionMatrix;
+	lcGetFrustumPlanes(ViewMatrix, ProjectionMatrix, mFrustumPlanes);
+	mNumCulledPieces = 0;
+	mNumCulledModels = 0;
+	mNumOccludedPieces = 0;
+
+	mOpaqueMeshes.RemoveAll();
+	mTranslucentMeshes.RemoveAll();
+	mInterfaceObjects.RemoveAll();
+	mPieces.RemoveAll();
+	mSubModelPieces.RemoveAll();
+	mCurrentPiece = NULL;
+	mModel = NULL;
+	mViewCamera = NULL;
+}
+
+void lcScene::End()
+{
+	QElapsedTimer Timer;
+	Timer.start();
+
+	mNumPieceOpaqueMeshes = mOpaqueMeshes.GetSize();
+	mNumPieces = mPieces.GetSize();
+
+	if (mStaticBatcher)
+		mStaticBatcher->Update(*this);
+
+	ApplyStaticBatches();
+	SortOpaqueSections();
+	UpdateVisibility();
+	SortTranslucentMeshes();
 
-	if (Mesh1->Mesh > Mesh2->Mesh)
-		return 1;
+	mUpdateTime = Timer.nsecsElapsed() / 1000000.0f;
+}
+
+// The scene is rebuilt the next time it's updated so a batcher is never applied to a scene it didn't see.
+void lcScene::SetStaticBatcher(lcStaticBatcher* StaticBatcher)
+{
+	mStaticBatcher = StaticBatcher;
+	mModel = NULL;
+}
+
+// Removes the meshes added by the batcher last time and adds the batches that are ready now.
+void lcScene::ApplyStaticBatches()
+{
+	mOpaqueMeshes.SetSize(mNumPieceOpaqueMeshes);
+	mPieces.SetSize(mNumPieces);
+
+	mOpaqueMeshBatched.SetSize(mNumPieceOpaqueMeshes);
+
+	if (mNumPieceOpaqueMeshes)
+		memset(&mOpaqueMeshBatched[0], 0, mNumPieceOpaqueMeshes * sizeof(bool));
 
-	return 0;
+	if (mStaticBatcher)
+		mStaticBatcher->Apply(*this);
 }
 
-static int lcTranslucentRenderMeshCompare(const void* Elem1, const void* Elem2)
+void lcScene::BeginPiece(lcPiece* Piece, const PieceInfo* Info, const lcMatrix44& WorldMatrix, bool Static)
 {
-	lcRenderMesh* Mesh1 = (lcRenderMesh*)Elem1;
-	lcRenderMesh* Mesh2 = (lcRenderMesh*)Elem2;
+	lcScenePiece& ScenePiece = mPieces.Add();
+
+	ScenePiece.WorldMatrix = WorldMatrix;
+	ScenePiece.Min = lcVector3(Info->m_fDimensions[3], Info->m_fDimensions[4], Info->m_fDimensions[5]);
+	ScenePiece.Max = lcVector3(Info->m_fDimensions[0], Info->m_fDimensions[1], Info->m_fDimensions[2]);
+	ScenePiece.Model = (Info->mFlags & LC_PIECE_MODEL) != 0;
+	ScenePiece.Static = Static;
+	ScenePiece.Step = Piece->GetStepShow();
+	ScenePiece.FirstOpaqueMesh = mOpaqueMeshes.GetSize();
+	ScenePiece.FirstTranslucentMesh = mTranslucentMeshes.GetSize();
+	ScenePiece.FirstSubModelPiece = mSubModelPieces.GetSize();
+
+	mCurrentPiece = Piece;
+}
+
+void lcScene::EndPiece()
+{
+	lcScenePiece& ScenePiece = mPieces[mPieces.GetSize() - 1];
+
+	ScenePiece.NumOpaqueMeshes = mOpaqueMeshes.GetSize() - ScenePiece.FirstOpaqueMesh;
+	ScenePiece.NumTranslucentMeshes = mTranslucentMeshes.GetSize() - ScenePiece.FirstTranslucentMesh;
+	ScenePiece.NumSubModelPieces = mSubModelPieces.GetSize() - ScenePiece.FirstSubModelPiece;
 
-	if (Mesh1->Distance < Mesh2->Distance)
+	mCurrentPiece = NULL;
+}
+
+int lcScene::BeginSubModelPiece(const PieceInfo* Info, const lcMatrix44& WorldMatrix)
+{
+	if (!mCurrentPiece)
 		return -1;
 
-	if (Mesh1->Distance > Mesh2->Distance)
-		return 1;
+	lcSceneSubModelPiece& SubModelPiece = mSubModelPieces.Add();
+
+	SubModelPiece.WorldMatrix = WorldMatrix;
+	SubModelPiece.Min = lcVector3(Info->m_fDimensions[3], Info->m_fDimensions[4], Info->m_fDimensions[5]);
+	SubModelPiece.Max = lcVector3(Info->m_fDimensions[0], Info->m_fDimensions[1], Info->m_fDimensions[2]);
+	SubModelPiece.Model = (Info->mFlags & LC_PIECE_MODEL) != 0;
+	SubModelPiece.FirstOpaqueMesh = mOpaqueMeshes.GetSize();
+	SubModelPiece.FirstTranslucentMesh = mTranslucentMeshes.GetSize();
 
-	return 0;
+	return mSubModelPieces.GetSize() - 1;
 }
 
-lcScene::lcScene()
-	: mOpaqueMeshes(0, 1024), mTranslucentMeshes(0, 1024), mInterfaceObjects(0, 1024)
+void lcScene::EndSubModelPiece(int SubModelPieceIndex)
 {
+	if (SubModelPieceIndex == -1)
+		return;
+
+	lcSceneSubModelPiece& SubModelPiece = mSubModelPieces[SubModelPieceIndex];
+
+	SubModelPiece.NumSubModelPieces = mSubModelPieces.GetSize() - SubModelPieceIndex - 1;
+	SubModelPiece.NumOpaqueMeshes = mOpaqueMeshes.GetSize() - SubModelPiece.FirstOpaqueMesh;
+	SubModelPiece.NumTranslucentMeshes = mTranslucentMeshes.GetSize() - SubModelPiece.FirstTranslucentMesh;
 }
 
-void lcScene::Begin(const lcMatrix44& ViewMatrix)
+void lcScene::SetView(const lcMatrix44& ViewMatrix, const lcMatrix44& ProjectionMatrix)
 {
-	mOpaqueMeshes.RemoveAll();
-	mTranslucentMeshes.RemoveAll();
-	mInterfaceObjects.RemoveAll();
+	QElapsedTimer Timer;
+	Timer.start();
+
+	mViewMatrix = ViewMatrix;
+	mProjectionMatrix = ProjectionMatrix;
+	lcGetFrustumPlanes(ViewMatrix, ProjectionMatrix, mFrustumPlanes);
+
+	if (mStaticBatcher && mStaticBatcher->BuildPendingBatches(*this))
+	{
+		ApplyStaticBatches();
+		SortOpaqueSections();
+	}
+
+	UpdateVisibility();
+	SortTranslucentMeshes();
+
+	mUpdateTime = Timer.nsecsElapsed() / 1000000.0f;
 }
 
-void lcScene::End()
+// Meshes added outside of BeginPiece() and EndPiece() are never culled.
+void lcScene::UpdateVisibility()
+{
+	int NumOpaqueMeshes = mOpaqueMeshes.GetSize();
+	int NumTranslucentMeshes = mTranslucentMeshes.GetSize();
+
+	mOpaqueMeshVisible.SetSize(NumOpaqueMeshes);
+	mTranslucentMeshVisible.SetSize(NumTranslucentMeshes);
+
+	if (NumOpaqueMeshes)
+		memset(&mOpaqueMeshVisible[0], 1, NumOpaqueMeshes * sizeof(bool));
+
+	if (NumTranslucentMeshes)
+		memset(&mTranslucentMeshVisible[0], 1, NumTranslucentMeshes * sizeof(bool));
+
+	mNumCulledPieces = 0;
+	mNumCulledModels = 0;
+	mNumOccludedPieces = 0;
+	mOcclusionItems.RemoveAll();
+
+	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
+	{
+		const lcScenePiece& ScenePiece = mPieces[PieceIdx];
+
+		if (lcBoundingBoxIntersectsFrustum(ScenePiece.Min, ScenePiece.Max, ScenePiece.WorldMatrix, mFrustumPlanes))
+		{
+			if (mOcclusionBuffer)
+			{
+				lcOcclusionSortItem& OcclusionItem = mOcclusionItems.Add();
+				OcclusionItem.PieceIndex = PieceIdx;
+			}
+
+			UpdateSubModelVisibility(ScenePiece.FirstSubModelPiece, ScenePiece.FirstSubModelPiece + ScenePiece.NumSubModelPieces);
+			continue;
+		}
+
+		if (ScenePiece.Model)
+			mNumCulledModels++;
+		else
+			mNumCulledPieces++;
+
+		if (ScenePiece.NumOpaqueMeshes)
+			memset(&mOpaqueMeshVisible[ScenePiece.FirstOpaqueMesh], 0, ScenePiece.NumOpaqueMeshes * sizeof(bool));
+
+		if (ScenePiece.NumTranslucentMeshes)
+			memset(&mTranslucentMeshVisible[ScenePiece.FirstTranslucentMesh], 0, ScenePiece.NumTranslucentMeshes * sizeof(bool));
+	}
+
+	if (mOcclusionBuffer)
+		UpdateOcclusion();
+}
+
+// Hides the pieces of a visible submodel instance that are outside the frustum, a nested submodel is hidden as a whole.
+void lcScene::UpdateSubModelVisibility(int FirstSubModelPiece, int LastSubModelPiece)
+{
+	for (int SubModelPieceIdx = FirstSubModelPiece; SubModelPieceIdx < LastSubModelPiece; SubModelPieceIdx++)
+	{
+		const lcSceneSubModelPiece& SubModelPiece = mSubModelPieces[SubModelPieceIdx];
+
+		if (lcBoundingBoxIntersectsFrustum(SubModelPiece.Min, SubModelPiece.Max, SubModelPiece.WorldMatrix, mFrustumPlanes))
+			continue;
+
+		if (SubModelPiece.Model)
+			mNumCulledModels++;
+		else
+			mNumCulledPieces++;
+
+		if (SubModelPiece.NumOpaqueMeshes)
+			memset(&mOpaqueMeshVisible[SubModelPiece.FirstOpaqueMesh], 0, SubModelPiece.NumOpaqueMeshes * sizeof(bool));
+
+		if (SubModelPiece.NumTranslucentMeshes)
+			memset(&mTranslucentMeshVisible[SubModelPiece.FirstTranslucentMesh], 0, SubModelPiece.NumTranslucentMeshes * sizeof(bool));
+
+		SubModelPieceIdx += SubModelPiece.NumSubModelPieces;
+	}
+}
+
+// Occluders are the visible pieces with the largest bounds relative to their distance, ties keep the scene order so the
+// result is always the same for the same scene and camera. Submodels as a whole are only tested, never drawn as occluders.
+void lcScene::UpdateOcclusion()
+{
+	for (int ItemIdx = 0; ItemIdx < mOcclusionItems.GetSize(); ItemIdx++)
+	{
+		lcOcclusionSortItem& OcclusionItem = mOcclusionItems[ItemIdx];
+		const lcScenePiece& ScenePiece = mPieces[OcclusionItem.PieceIndex];
+		float Radius = lcLength(ScenePiece.Max - ScenePiece.Min) * 0.5f;
+		float Distance = -lcMul31(lcMul31((ScenePiece.Min + ScenePiece.Max) * 0.5f, ScenePiece.WorldMatrix), mViewMatrix).z;
+		float Size = Distance > Radius ? Radius / Distance : 0.0f;
+
+		if (!ScenePiece.Model && ScenePiece.NumOpaqueMeshes && Size >= LC_OCCLUSION_MIN_OCCLUDER_SIZE)
+		{
+			lcuint32 Bits;
+			memcpy(&Bits, &Size, sizeof(Bits));
+			OcclusionItem.SortKey = (lcuint32)~Bits;
+		}
+		else
+			OcclusionItem.SortKey = (lcuint64)1 << 32;
+	}
+
+	lcRadixSort(mOcclusionItems, mOcclusionSortTemp);
+
+	mOcclusionBuffer->Clear(lcMul(mViewMatrix, mProjectionMatrix));
+	int NumOccluders = 0;
+
+	while (NumOccluders < mOcclusionItems.GetSize() && NumOccluders < LC_OCCLUSION_MAX_OCCLUDERS && !mOcclusionBuffer->IsFull())
+	{
+		const lcOcclusionSortItem& OcclusionItem = mOcclusionItems[NumOccluders];
+
+		if (OcclusionItem.SortKey > 0xffffffff)
+			break;
+
+		const lcScenePiece& ScenePiece = mPieces[OcclusionItem.PieceIndex];
+
+		for (int MeshIdx = ScenePiece.FirstOpaqueMesh; MeshIdx < ScenePiece.FirstOpaqueMesh + ScenePiece.NumOpaqueMeshes; MeshIdx++)
+		{
+			const lcRenderMesh& RenderMesh = mOpaqueMeshes[MeshIdx];
+			mOcclusionBuffer->DrawMesh(RenderMesh.Mesh, RenderMesh.WorldMatrix, RenderMesh.ColorIndex);
+		}
+
+		NumOccluders++;
+	}
+
+	if (!NumOccluders)
+		return;
+
+	mOcclusionBuffer->UpdateHierarchy();
+
+	for (int ItemIdx = NumOccluders; ItemIdx < mOcclusionItems.GetSize(); ItemIdx++)
+	{
+		const lcScenePiece& ScenePiece = mPieces[mOcclusionItems[ItemIdx].PieceIndex];
+
+		if (mOcclusionBuffer->IsBoxVisible(ScenePiece.Min, ScenePiece.Max, ScenePiece.WorldMatrix))
+			continue;
+
+		mNumOccludedPieces++;
+
+		if (ScenePiece.NumOpaqueMeshes)
+			memset(&mOpaqueMeshVisible[ScenePiece.FirstOpaqueMesh], 0, ScenePiece.NumOpaqueMeshes * sizeof(bool));
+
+		if (ScenePiece.NumTranslucentMeshes)
+			memset(&mTranslucentMeshVisible[ScenePiece.FirstTranslucentMesh], 0, ScenePiece.NumTranslucentMeshes * sizeof(bool));
+	}
+}
+
+// Key layout from the most significant bit: 12 bits texture, 1 bit lines, 24 bits mesh, 14 bits section, 11 bits color,
+// 2 bits focused and selected. Truncated fields only make the sort less effective since the draw loop compares the real state.
+void lcScene::SortOpaqueSections()
+{
+	mOpaqueSections.RemoveAll();
+
+	for (int MeshIdx = 0; MeshIdx < mOpaqueMeshes.GetSize(); MeshIdx++)
+	{
+		if (MeshIdx < mNumPieceOpaqueMeshes && mOpaqueMeshBatched[MeshIdx])
+			continue;
+
+		const lcRenderMesh& RenderMesh = mOpaqueMeshes[MeshIdx];
+		lcMesh* Mesh = RenderMesh.Mesh;
+		lcuint64 MeshKey = (lcuint64)(((uintptr_t)Mesh >> 4) & 0xffffff) << 27;
+		lcuint64 StateKey = RenderMesh.Focused ? 2 : (RenderMesh.Selected ? 1 : 0);
+
+		for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
+		{
+			lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+			int ColorIndex = Section->ColorIndex;
+			bool Lines = Section->PrimitiveType != GL_TRIANGLES;
+
+			if (!Lines)
+			{
+				if (ColorIndex == gDefaultColor)
+					ColorIndex = RenderMesh.ColorIndex;
+
+				if (lcIsColorTranslucent(ColorIndex))
+					continue;
+			}
+			else if (ColorIndex == gEdgeColor)
+				ColorIndex = RenderMesh.ColorIndex;
+
+			lcuint64 TextureKey = Section->Texture ? (Section->Texture->mTexture & 0xfff) : 0;
+
+			lcRenderSection& RenderSection = mOpaqueSections.Add();
+			RenderSection.SortKey = (TextureKey << 52) | ((lcuint64)Lines << 51) | MeshKey | ((lcuint64)(SectionIdx & 0x3fff) << 13) | ((lcuint64)(ColorIndex & 0x7ff) << 2) | StateKey;
+			RenderSection.RenderMeshIndex = MeshIdx;
+			RenderSection.SectionIndex = SectionIdx;
+		}
+	}
+
+	lcRadixSort(mOpaqueSections, mSortSections);
+
+	if (!mStepOrder || mPieces.IsEmpty())
+		return;
+
+	// The radix sort is stable so sorting again by step keeps the order within each step. Drawing the pieces added in a
+	// step over the image of the previous step then resolves depth ties the same way as drawing the whole scene.
+	mOpaqueMeshSteps.SetSize(mOpaqueMeshes.GetSize());
+
+	if (!mOpaqueMeshSteps.IsEmpty())
+		memset(&mOpaqueMeshSteps[0], 0, mOpaqueMeshSteps.GetSize() * sizeof(lcStep));
+
+	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
+	{
+		const lcScenePiece& ScenePiece = mPieces[PieceIdx];
+
+		for (int MeshIdx = 0; MeshIdx < ScenePiece.NumOpaqueMeshes; MeshIdx++)
+			mOpaqueMeshSteps[ScenePiece.FirstOpaqueMesh + MeshIdx] = ScenePiece.Step;
+	}
+
+	for (int SectionIdx = 0; SectionIdx < mOpaqueSections.GetSize(); SectionIdx++)
+		mOpaqueSections[SectionIdx].SortKey = mOpaqueMeshSteps[mOpaqueSections[SectionIdx].RenderMeshIndex];
+
+	lcRadixSort(mOpaqueSections, mSortSections);
+}
+
+// Translucent meshes are drawn back to front, the distance is mapped to an unsigned integer that sorts in the same order.
+void lcScene::SortTranslucentMeshes()
+{
+	mTranslucentSortItems.RemoveAll();
+
+	if (!mSortTranslucentMeshes)
+	{
+		mTranslucentOrder.RemoveAll();
+
+		for (int MeshIdx = 0; MeshIdx < mTranslucentMeshes.GetSize(); MeshIdx++)
+			if (mTranslucentMeshVisible[MeshIdx])
+				mTranslucentOrder.Add(MeshIdx);
+
+		return;
+	}
+
+	for (int MeshIdx = 0; MeshIdx < mTranslucentMeshes.GetSize(); MeshIdx++)
+	{
+		if (!mTranslucentMeshVisible[MeshIdx])
+			continue;
+
+		lcRenderMesh& RenderMesh = mTranslucentMeshes[MeshIdx];
+		lcVector3 Position = lcMul31(RenderMesh.WorldMatrix[3], mViewMatrix);
+		RenderMesh.Distance = Position[2];
+
+		lcuint32 Bits;
+		memcpy(&Bits, &RenderMesh.Distance, sizeof(Bits));
+
+		lcTranslucentSortItem& SortItem = mTranslucentSortItems.Add();
+		SortItem.SortKey = (Bits & 0x80000000) ? (lcuint32)~Bits : (Bits | 0x80000000);
+		SortItem.RenderMeshIndex = MeshIdx;
+	}
+
+	lcRadixSort(mTranslucentSortItems, mTranslucentSortTemp);
+
+	int NumSortItems = mTranslucentSortItems.GetSize();
+	mTranslucentOrder.SetSize(NumSortItems);
+
+	for (int SortIdx = 0; SortIdx < NumSortItems; SortIdx++)
+		mTranslucentOrder[SortIdx] = mTranslucentSortItems[SortIdx].RenderMeshIndex;
+}
+
+// The shaders are compiled after a version line and the defines of each program.
+static const char* lcMeshVertexShader =
+	"layout(std140) uniform lcFrame\n"
+	"{\n"
+	"	mat4 ViewMatrix;\n"
+	"	mat4 ProjectionMatrix;\n"
+	"	vec4 AmbientColor;\n"
+	"	vec4 FogColor;\n"
+	"};\n"
+	"uniform mat4 MeshMatrix;\n"
+	"uniform mat4 TextureMatrix;\n"
+	"in vec3 VertexPosition;\n"
+	"in vec2 VertexTexCoord;\n"
+	"in mat4 InstanceWorldMatrix;\n"
+	"in vec4 InstanceColor;\n"
+	"out vec4 PixelColor;\n"
+	"out vec2 PixelTexCoord;\n"
+	"out float PixelDistance;\n"
+	"void main()\n"
+	"{\n"
+	"	mat4 WorldViewMatrix = ViewMatrix * InstanceWorldMatrix;\n"
+	"	vec4 Position = WorldViewMatrix * (MeshMatrix * vec4(VertexPosition, 1.0));\n"
+	"	PixelColor = InstanceColor;\n"
+	"	if (AmbientColor.w != 0.0)\n"
+	"		PixelColor.rgb = min(InstanceColor.rgb * AmbientColor.rgb, vec3(1.0));\n"
+	"	PixelTexCoord = (TextureMatrix * vec4(VertexTexCoord, 0.0, 1.0)).xy;\n"
+	"	PixelDistance = abs(Position.z);\n"
+	"	gl_Position = ProjectionMatrix * Position;\n"
+	"}\n";
+
+static const char* lcMeshFragmentShader =
+	"layout(std140) uniform lcFrame\n"
+	"{\n"
+	"	mat4 ViewMatrix;\n"
+	"	mat4 ProjectionMatrix;\n"
+	"	vec4 AmbientColor;\n"
+	"	vec4 FogColor;\n"
+	"};\n"
+	"uniform sampler2D Texture;\n"
+	"uniform int Textured;\n"
+	"in vec4 PixelColor;\n"
+	"in vec2 PixelTexCoord;\n"
+	"in float PixelDistance;\n"
+	"#ifdef LC_BLENDED\n"
+	"layout(location = 0) out vec4 FragmentColor;\n"
+	"layout(location = 1) out vec4 FragmentWeight;\n"
+	"#else\n"
+	"out vec4 FragmentColor;\n"
+	"#endif\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 Color = PixelColor;\n"
+	"	if (Textured != 0)\n"
+	"	{\n"
+	"		vec4 TexelColor = texture(Texture, PixelTexCoord);\n"
+	"		Color.rgb = mix(Color.rgb, TexelColor.rgb, TexelColor.a);\n"
+	"	}\n"
+	"	if (FogColor.w > 0.0)\n"
+	"		Color.rgb = mix(FogColor.rgb, Color.rgb, clamp(exp(-FogColor.w * PixelDistance), 0.0, 1.0));\n"
+	"#ifdef LC_BLENDED\n"
+	"	float Weight = Color.a * clamp(0.03 / (0.00001 + pow(PixelDistance / 5000.0, 4.0)), 0.01, 3000.0);\n"
+	"	FragmentColor = vec4(Color.rgb * Color.a * Weight, Color.a);\n"
+	"	FragmentWeight = vec4(Color.a * Weight);\n"
+	"#else\n"
+	"	FragmentColor = Color;\n"
+	"#endif\n"
+	"}\n";
+
+// Draws a triangle that covers the viewport and resolves the blended translucent layers over the opaque meshes.
+static const char* lcBlendedCompositeVertexShader =
+	"void main()\n"
+	"{\n"
+	"	vec2 Position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(Position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* lcBlendedCompositeFragmentShader =
+	"uniform sampler2D ColorTexture;\n"
+	"uniform sampler2D WeightTexture;\n"
+	"out vec4 FragmentColor;\n"
+	"void main()\n"
+	"{\n"
+	"	ivec2 Texel = ivec2(gl_FragCoord.xy);\n"
+	"	vec4 Color = texelFetch(ColorTexture, Texel, 0);\n"
+	"	if (Color.a >= 1.0)\n"
+	"		discard;\n"
+	"	float Weight = texelFetch(WeightTexture, Texel, 0).r;\n"
+	"	FragmentColor = vec4(Color.rgb / max(Weight, 0.00001), 1.0 - Color.a);\n"
+	"}\n";
+
+static GLuint lcCreateShaderProgram(const char* Defines, const char* VertexShader, const char* FragmentShader, bool MeshAttributes)
 {
-	qsort(&mOpaqueMeshes[0], mOpaqueMeshes.GetSize(), sizeof(mOpaqueMeshes[0]), lcOpaqueRenderMeshCompare);
-	qsort(&mTranslucentMeshes[0], mTranslucentMeshes.GetSize(), sizeof(mTranslucentMeshes[0]), lcTranslucentRenderMeshCompare);
+	const char* Sources[2] = { VertexShader, FragmentShader };
+	const GLenum Types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint Shaders[2];
+	bool Compiled = true;
+
+	for (int ShaderIdx = 0; ShaderIdx < 2; ShaderIdx++)
+	{
+		const char* ShaderSources[3] = { "#version 330 core\n", Defines, Sources[ShaderIdx] };
+		GLuint Shader = glCreateShader(Types[ShaderIdx]);
+		glShaderSource(Shader, 3, ShaderSources, NULL);
+		glCompileShader(Shader);
+
+		GLint Status;
+		glGetShaderiv(Shader, GL_COMPILE_STATUS, &Status);
+
+		if (!Status)
+		{
+			char InfoLog[1024];
+			glGetShaderInfoLog(Shader, sizeof(InfoLog), NULL, InfoLog);
+			qDebug("Error compiling shader: %s", InfoLog);
+			Compiled = false;
+		}
+
+		Shaders[ShaderIdx] = Shader;
+	}
+
+	GLuint Program = glCreateProgram();
+	glAttachShader(Program, Shaders[0]);
+	glAttachShader(Program, Shaders[1]);
+	glDeleteShader(Shaders[0]);
+	glDeleteShader(Shaders[1]);
+
+	if (!Compiled)
+	{
+		glDeleteProgram(Program);
+		return 0;
+	}
+
+	if (MeshAttributes)
+	{
+		glBindAttribLocation(Program, 0, "VertexPosition");
+		glBindAttribLocation(Program, 1, "VertexTexCoord");
+		glBindAttribLocation(Program, 2, "InstanceWorldMatrix");
+		glBindAttribLocation(Program, 6, "InstanceColor");
+	}
+
+	glLinkProgram(Program);
+
+	GLint Status;
+	glGetProgramiv(Program, GL_LINK_STATUS, &Status);
+
+	if (!Status)
+	{
+		char InfoLog[1024];
+		glGetProgramInfoLog(Program, sizeof(InfoLog), NULL, InfoLog);
+		qDebug("Error linking shader: %s", InfoLog);
+		glDeleteProgram(Program);
+		return 0;
+	}
+
+	return Program;
 }
 
 lcContext::lcContext()
@@ -63,13 +588,60 @@ lcContext::lcContext()
 	mColorEnabled = false;
 
 	mTexture = NULL;
+	mTextureMatrixMesh = NULL;
 	mLineWidth = 1.0f;
 	mMatrixMode = GL_MODELVIEW;
 
+	memset(&mFrameStats, 0, sizeof(mFrameStats));
+	mFrameStats.GpuTime = -1.0f;
+	memset(mGpuTimerQueries, 0, sizeof(mGpuTimerQueries));
+	mNumGpuTimerFrames = 0;
+
 	mFramebufferObject = 0;
 	mFramebufferTexture = 0;
 	mDepthRenderbufferObject = 0;
 
+	mPickFramebuffer = 0;
+	mPickColorRenderbuffer = 0;
+	mPickDepthRenderbuffer = 0;
+	mPickWidth = 0;
+	mPickHeight = 0;
+	mPickPreviousFramebuffer = 0;
+	memset(mPickPreviousViewport, 0, sizeof(mPickPreviousViewport));
+	mPickPreviousProjection = lcMatrix44Identity();
+	memset(mPickPreviousClearColor, 0, sizeof(mPickPreviousClearColor));
+
+	mReadbackBuffers[0] = 0;
+	mReadbackBuffers[1] = 0;
+	mReadbackIndex = 0;
+	mReadbackWidth = 0;
+	mReadbackHeight = 0;
+	mImageWriter = NULL;
+
+	mProjectionMatrix = lcMatrix44Identity();
+	mMeshAmbientColor = lcVector4(0.0f, 0.0f, 0.0f, 0.0f);
+	mMeshFogColor = lcVector4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	memset(mMeshPrograms, 0, sizeof(mMeshPrograms));
+	mMeshVertexArray = 0;
+	mMeshFrameBuffer = 0;
+	mMeshInstanceBuffer = 0;
+	mMeshInstanceBufferSize = 0;
+	mMeshShaderFailed = false;
+	mMeshFrameValid = false;
+
+	mBlendedFramebuffer = 0;
+	mBlendedColorTexture = 0;
+	mBlendedWeightTexture = 0;
+	mBlendedDepthRenderbuffer = 0;
+	mBlendedCompositeProgram = 0;
+	mBlendedCompositeVertexArray = 0;
+	mBlendedPreviousFramebuffer = 0;
+	mBlendedDepthFormat = 0;
+	mBlendedWidth = 0;
+	mBlendedHeight = 0;
+	mBlendedFailed = false;
+
     mViewportX = 0;
     mViewportY = 0;
     mViewportWidth = 1;
@@ -78,6 +650,20 @@ lcContext::lcContext()
 
 lcContext::~lcContext()
 {
+	DestroyMeshShader();
+	DestroyBlendedFramebuffer();
+	DestroyPickFramebuffer();
+
+	if (mBlendedCompositeProgram)
+	{
+		glDeleteProgram(mBlendedCompositeProgram);
+		glDeleteVertexArrays(1, &mBlendedCompositeVertexArray);
+	}
+
+	if (mGpuTimerQueries[0])
+		glDeleteQueries(LC_GPU_TIMER_QUERIES, mGpuTimerQueries);
+
+	delete mImageWriter;
 }
 
 void lcContext::SetDefaultState()
@@ -113,11 +699,22 @@ void lcContext::SetDefaultState()
 	glDisable(GL_TEXTURE_2D);
 	mTexture = NULL;
 
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	mTextureMatrixMesh = NULL;
+
 	glLineWidth(1.0f);
 	mLineWidth = 1.0f;
 
 	glMatrixMode(GL_MODELVIEW);
 	mMatrixMode = GL_MODELVIEW;
+
+	float GpuTime = mFrameStats.GpuTime;
+	memset(&mFrameStats, 0, sizeof(mFrameStats));
+	mFrameStats.GpuTime = GpuTime;
+
+	mMeshAmbientColor = lcVector4(0.0f, 0.0f, 0.0f, 0.0f);
+	mMeshFogColor = lcVector4(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
 void lcContext::SetViewport(int x, int y, int Width, int Height)
@@ -142,6 +739,7 @@ void lcContext::SetWorldViewMatrix(const lcMatrix44& WorldViewMatrix)
 	}
 
 	glLoadMatrixf(WorldViewMatrix);
+	mFrameStats.NumMatrixLoads++;
 }
 
 void lcContext::SetProjectionMatrix(const lcMatrix44& ProjectionMatrix)
@@ -153,6 +751,28 @@ void lcContext::SetProjectionMatrix(const lcMatrix44& ProjectionMatrix)
 	}
 
 	glLoadMatrixf(ProjectionMatrix);
+	mProjectionMatrix = ProjectionMatrix;
+	mFrameStats.NumMatrixLoads++;
+}
+
+void lcContext::SetTextureMatrix(lcMesh* Mesh)
+{
+	if (Mesh == mTextureMatrixMesh)
+		return;
+
+	if (mMatrixMode != GL_TEXTURE)
+	{
+		glMatrixMode(GL_TEXTURE);
+		mMatrixMode = GL_TEXTURE;
+	}
+
+	if (Mesh)
+		glLoadMatrixf(Mesh->GetTextureMatrix());
+	else
+		glLoadIdentity();
+
+	mTextureMatrixMesh = Mesh;
+	mFrameStats.NumMatrixLoads++;
 }
 
 void lcContext::SetLineWidth(float LineWidth)
@@ -164,6 +784,16 @@ void lcContext::SetLineWidth(float LineWidth)
 	mLineWidth = LineWidth;
 }
 
+void lcContext::SetMeshLighting(bool Lighting, const lcVector3& AmbientColor)
+{
+	mMeshAmbientColor = lcVector4(AmbientColor, Lighting ? 1.0f : 0.0f);
+}
+
+void lcContext::SetMeshFog(bool Fog, float Density, const lcVector3& FogColor)
+{
+	mMeshFogColor = lcVector4(FogColor, Fog ? Density : 0.0f);
+}
+
 bool lcContext::BeginRenderToTexture(int Width, int Height)
 {
 	if (GL_SupportsFramebufferObjectARB)
@@ -230,6 +860,76 @@ bool lcContext::BeginRenderToTexture(int Width, int Height)
 	return false;
 }
 
+bool lcContext::BeginPickFramebuffer(int Width, int Height)
+{
+	if (!GL_SupportsFramebufferObjectARB)
+		return false;
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mPickPreviousFramebuffer);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, mPickPreviousClearColor);
+	mPickPreviousViewport[0] = mViewportX;
+	mPickPreviousViewport[1] = mViewportY;
+	mPickPreviousViewport[2] = mViewportWidth;
+	mPickPreviousViewport[3] = mViewportHeight;
+	mPickPreviousProjection = mProjectionMatrix;
+
+	if (!mPickFramebuffer || Width > mPickWidth || Height > mPickHeight)
+	{
+		DestroyPickFramebuffer();
+
+		mPickWidth = lcMax(Width, mPickWidth);
+		mPickHeight = lcMax(Height, mPickHeight);
+
+		glGenFramebuffers(1, &mPickFramebuffer);
+		glGenRenderbuffers(1, &mPickColorRenderbuffer);
+		glGenRenderbuffers(1, &mPickDepthRenderbuffer);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, mPickFramebuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, mPickColorRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, mPickWidth, mPickHeight);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mPickColorRenderbuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, mPickDepthRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mPickWidth, mPickHeight);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mPickDepthRenderbuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			DestroyPickFramebuffer();
+			glBindFramebuffer(GL_FRAMEBUFFER, mPickPreviousFramebuffer);
+			return false;
+		}
+	}
+	else
+		glBindFramebuffer(GL_FRAMEBUFFER, mPickFramebuffer);
+
+	return true;
+}
+
+void lcContext::EndPickFramebuffer()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mPickPreviousFramebuffer);
+	glClearColor(mPickPreviousClearColor[0], mPickPreviousClearColor[1], mPickPreviousClearColor[2], mPickPreviousClearColor[3]);
+	SetViewport(mPickPreviousViewport[0], mPickPreviousViewport[1], mPickPreviousViewport[2], mPickPreviousViewport[3]);
+	SetProjectionMatrix(mPickPreviousProjection);
+}
+
+void lcContext::DestroyPickFramebuffer()
+{
+	if (!mPickFramebuffer)
+		return;
+
+	glDeleteFramebuffers(1, &mPickFramebuffer);
+	mPickFramebuffer = 0;
+	glDeleteRenderbuffers(1, &mPickColorRenderbuffer);
+	mPickColorRenderbuffer = 0;
+	glDeleteRenderbuffers(1, &mPickDepthRenderbuffer);
+	mPickDepthRenderbuffer = 0;
+}
+
 void lcContext::EndRenderToTexture()
 {
 	if (GL_SupportsFramebufferObjectARB)
@@ -300,36 +1000,136 @@ bool lcContext::SaveRenderToTextureImage(const QString& FileName, int Width, int
 	return Result;
 }
 
-void lcContext::ClearVertexBuffer()
+void lcContext::QueueRenderToTextureImage(const QString& FileName, int Width, int Height)
 {
-	mVertexBufferPointer = NULL;
-	mVertexBufferOffset = (char*)~0;
+	if (!mImageWriter)
+		mImageWriter = new lcImageWriter();
 
-	if (mVertexBufferObject)
+	if (!GL_SupportsPixelBufferObject)
 	{
-		glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
-		mVertexBufferObject = 0;
+		QImage Image(Width, Height, QImage::Format_ARGB32);
+		glReadPixels(0, 0, Width, Height, GL_BGRA, GL_UNSIGNED_BYTE, Image.bits());
+		mImageWriter->Write(FileName, Image.mirrored());
+		return;
 	}
 
-	if (mTexCoordEnabled)
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-	if (mColorEnabled)
-		glDisableClientState(GL_COLOR_ARRAY);
-}
-
-void lcContext::SetVertexBuffer(const lcVertexBuffer* VertexBuffer)
-{
-	if (GL_HasVertexBufferObject())
+	if (!mReadbackBuffers[0] || mReadbackWidth != Width || mReadbackHeight != Height)
 	{
-		GLuint VertexBufferObject = VertexBuffer->mBuffer;
-		mVertexBufferPointer = NULL;
+		ReadRenderToTextureImage(1 - mReadbackIndex);
 
-		if (VertexBufferObject != mVertexBufferObject)
+		if (!mReadbackBuffers[0])
+			glGenBuffers(2, mReadbackBuffers);
+
+		for (int BufferIdx = 0; BufferIdx < 2; BufferIdx++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, mReadbackBuffers[BufferIdx]);
+			glBufferData(GL_PIXEL_PACK_BUFFER_ARB, Width * Height * 4, NULL, GL_STREAM_READ_ARB);
+		}
+
+		mReadbackWidth = Width;
+		mReadbackHeight = Height;
+	}
+
+	int BufferIndex = mReadbackIndex;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, mReadbackBuffers[BufferIndex]);
+	glReadPixels(0, 0, Width, Height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+	mReadbackFileNames[BufferIndex] = FileName;
+	mReadbackIndex = 1 - BufferIndex;
+
+	// The previous image was read before this one was drawn so it's usually ready by now.
+	ReadRenderToTextureImage(mReadbackIndex);
+}
+
+void lcContext::ReadRenderToTextureImage(int BufferIndex)
+{
+	if (mReadbackFileNames[BufferIndex].isEmpty())
+		return;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, mReadbackBuffers[BufferIndex]);
+	const lcuint8* Pixels = (const lcuint8*)glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+
+	if (Pixels)
+	{
+		QImage Image(mReadbackWidth, mReadbackHeight, QImage::Format_ARGB32);
+		int Stride = mReadbackWidth * 4;
+
+		for (int y = 0; y < mReadbackHeight; y++)
+			memcpy(Image.scanLine(mReadbackHeight - y - 1), Pixels + y * Stride, Stride);
+
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+		mImageWriter->Write(mReadbackFileNames[BufferIndex], Image);
+	}
+	else
+		mImageWriter->AddError(mReadbackFileNames[BufferIndex], tr("Error reading the image from the graphics card."));
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+	mReadbackFileNames[BufferIndex].clear();
+}
+
+bool lcContext::FinishRenderToTextureImages()
+{
+	if (!mImageWriter)
+		return true;
+
+	if (mReadbackBuffers[0])
+	{
+		ReadRenderToTextureImage(1 - mReadbackIndex);
+
+		glDeleteBuffers(2, mReadbackBuffers);
+		mReadbackBuffers[0] = 0;
+		mReadbackBuffers[1] = 0;
+		mReadbackIndex = 0;
+		mReadbackWidth = 0;
+		mReadbackHeight = 0;
+	}
+
+	QString ErrorMessage;
+
+	if (mImageWriter->Finish(&ErrorMessage))
+		return true;
+
+	if (gMainWindow)
+		QMessageBox::information(gMainWindow, tr("Error"), ErrorMessage);
+	else
+		fprintf(stderr, "%s\n", ErrorMessage.toLocal8Bit().constData());
+
+	return false;
+}
+
+void lcContext::ClearVertexBuffer()
+{
+	mVertexBufferPointer = NULL;
+	mVertexBufferOffset = (char*)~0;
+
+	if (mVertexBufferObject)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+		mVertexBufferObject = 0;
+	}
+
+	if (mTexCoordEnabled)
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	if (mColorEnabled)
+		glDisableClientState(GL_COLOR_ARRAY);
+}
+
+void lcContext::SetVertexBuffer(const lcVertexBuffer* VertexBuffer)
+{
+	if (GL_HasVertexBufferObject())
+	{
+		GLuint VertexBufferObject = VertexBuffer->mBuffer;
+		mVertexBufferPointer = NULL;
+
+		if (VertexBufferObject != mVertexBufferObject)
 		{
 			glBindBuffer(GL_ARRAY_BUFFER_ARB, VertexBufferObject);
 			mVertexBufferObject = VertexBufferObject;
 			mVertexBufferOffset = (char*)~0;
+			mFrameStats.NumBufferBinds++;
 		}
 	}
 	else
@@ -409,12 +1209,14 @@ void lcContext::BindMesh(lcMesh* Mesh)
 			glBindBuffer(GL_ARRAY_BUFFER_ARB, VertexBufferObject);
 			mVertexBufferObject = VertexBufferObject;
 			mVertexBufferOffset = (char*)~0;
+			mFrameStats.NumBufferBinds++;
 		}
 
 		if (IndexBufferObject != mIndexBufferObject)
 		{
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, IndexBufferObject);
 			mIndexBufferObject = IndexBufferObject;
+			mFrameStats.NumBufferBinds++;
 		}
 	}
 	else
@@ -434,6 +1236,8 @@ void lcContext::UnbindMesh()
 		mTexture = NULL;
 	}
 
+	SetTextureMatrix(NULL);
+
 	if (GL_HasVertexBufferObject())
 	{
 		glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
@@ -452,11 +1256,11 @@ void lcContext::UnbindMesh()
 void lcContext::DrawPrimitives(GLenum Mode, GLint First, GLsizei Count)
 {
 	glDrawArrays(Mode, First, Count);
+	mFrameStats.NumDrawCalls++;
 }
 
 void lcContext::DrawMeshSection(lcMesh* Mesh, lcMeshSection* Section)
 {
-	char* BufferOffset = mVertexBufferPointer;
 	lcTexture* Texture = Section->Texture;
 
 	if (!Texture)
@@ -471,11 +1275,12 @@ void lcContext::DrawMeshSection(lcMesh* Mesh, lcMeshSection* Section)
 	}
 	else
 	{
-		BufferOffset += Mesh->mNumVertices * sizeof(lcVertex);
+		SetTextureMatrix(Mesh->mQuantized ? Mesh : NULL);
 
 		if (Texture != mTexture)
 		{
 			glBindTexture(GL_TEXTURE_2D, Texture->mTexture);
+			mFrameStats.NumTextureBinds++;
 
 			if (!mTexture)
 			{
@@ -488,98 +1293,601 @@ void lcContext::DrawMeshSection(lcMesh* Mesh, lcMeshSection* Section)
 		}
 	}
 
-	if (mVertexBufferOffset != BufferOffset)
+	SetMeshVertexPointer(Mesh, Texture != NULL);
+
+	glDrawElements(Section->PrimitiveType, Section->NumIndices, Mesh->mIndexType, mIndexBufferPointer + Section->IndexOffset);
+	AddSectionStats(Section, 1);
+}
+
+void lcContext::AddSectionStats(const lcMeshSection* Section, int NumInstances)
+{
+	mFrameStats.NumDrawCalls++;
+	mFrameStats.NumSections += NumInstances;
+
+	if (Section->PrimitiveType == GL_TRIANGLES)
+		mFrameStats.NumTriangles += Section->NumIndices / 3 * NumInstances;
+	else
+		mFrameStats.NumLines += Section->NumIndices / 2 * NumInstances;
+}
+
+void lcContext::BeginGpuTimer()
+{
+	if (!GL_SupportsTimerQuery)
+		return;
+
+	if (!mGpuTimerQueries[0])
+		glGenQueries(LC_GPU_TIMER_QUERIES, mGpuTimerQueries);
+
+	// The oldest query still in flight was started LC_GPU_TIMER_QUERIES - 1 frames ago.
+	if (mNumGpuTimerFrames >= LC_GPU_TIMER_QUERIES - 1)
 	{
-		if (!Texture)
-			glVertexPointer(3, GL_FLOAT, 0, BufferOffset);
+		GLuint Query = mGpuTimerQueries[(mNumGpuTimerFrames + 1) % LC_GPU_TIMER_QUERIES];
+		GLint Available = 0;
+
+		glGetQueryObjectiv(Query, GL_QUERY_RESULT_AVAILABLE, &Available);
+
+		if (Available)
+		{
+			lcuint64 Time = 0;
+			glGetQueryObjectui64v(Query, GL_QUERY_RESULT, &Time);
+			mFrameStats.GpuTime = Time / 1000000.0f;
+		}
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, mGpuTimerQueries[mNumGpuTimerFrames % LC_GPU_TIMER_QUERIES]);
+}
+
+void lcContext::EndGpuTimer()
+{
+	if (!GL_SupportsTimerQuery)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	mNumGpuTimerFrames++;
+}
+
+void lcContext::SetMeshVertexPointer(lcMesh* Mesh, bool Textured)
+{
+	char* BufferOffset = mVertexBufferPointer;
+
+	if (Textured)
+		BufferOffset += Mesh->GetTexturedVertexOffset();
+
+	if (mVertexBufferOffset == BufferOffset)
+		return;
+
+	if (Mesh->mQuantized)
+	{
+		if (!Textured)
+			glVertexPointer(3, GL_SHORT, sizeof(lcVertexQuantized), BufferOffset);
 		else
 		{
-			glVertexPointer(3, GL_FLOAT, sizeof(lcVertexTextured), BufferOffset);
-			glTexCoordPointer(2, GL_FLOAT, sizeof(lcVertexTextured), BufferOffset + sizeof(lcVector3));
+			glVertexPointer(3, GL_SHORT, sizeof(lcVertexTexturedQuantized), BufferOffset);
+			glTexCoordPointer(2, GL_SHORT, sizeof(lcVertexTexturedQuantized), BufferOffset + offsetof(lcVertexTexturedQuantized, TexCoord));
 		}
+	}
+	else if (!Textured)
+		glVertexPointer(3, GL_FLOAT, 0, BufferOffset);
+	else
+	{
+		glVertexPointer(3, GL_FLOAT, sizeof(lcVertexTextured), BufferOffset);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(lcVertexTextured), BufferOffset + sizeof(lcVector3));
+	}
 
-		mVertexBufferOffset = BufferOffset;
+	mVertexBufferOffset = BufferOffset;
+}
+
+// Returns true if meshes should be drawn with the shader, creates it the first time.
+bool lcContext::BeginMeshShader()
+{
+	if (!lcGetPreferences().mShaderRendering || !GL_HasCoreShaders() || mMeshShaderFailed)
+		return false;
+
+	if (!mMeshPrograms[LC_MESH_PROGRAM_DEFAULT].Program && !CreateMeshShader())
+	{
+		mMeshShaderFailed = true;
+		return false;
 	}
 
-	glDrawElements(Section->PrimitiveType, Section->NumIndices, Mesh->mIndexType, mIndexBufferPointer + Section->IndexOffset);
+	if (mTexture)
+	{
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisable(GL_TEXTURE_2D);
+		mTexture = NULL;
+	}
+
+	mMeshInstances.RemoveAll();
+	mMeshDraws.RemoveAll();
+
+	return true;
 }
 
-void lcContext::DrawOpaqueMeshes(const lcMatrix44& ViewMatrix, const lcArray<lcRenderMesh>& OpaqueMeshes)
+bool lcContext::CreateMeshShader()
 {
-	bool DrawLines = lcGetPreferences().mDrawEdgeLines;
+	const char* Defines[LC_NUM_MESH_PROGRAMS] = { "", "#define LC_BLENDED\n" };
 
-	for (int MeshIdx = 0; MeshIdx < OpaqueMeshes.GetSize(); MeshIdx++)
+	for (int ProgramIdx = 0; ProgramIdx < LC_NUM_MESH_PROGRAMS; ProgramIdx++)
 	{
-		lcRenderMesh& RenderMesh = OpaqueMeshes[MeshIdx];
-		lcMesh* Mesh = RenderMesh.Mesh;
+		GLuint Program = lcCreateShaderProgram(Defines[ProgramIdx], lcMeshVertexShader, lcMeshFragmentShader, true);
 
-		BindMesh(Mesh);
-		SetWorldViewMatrix(lcMul(RenderMesh.WorldMatrix, ViewMatrix));
+		if (!Program)
+		{
+			DestroyMeshShader();
+			return false;
+		}
 
-		for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
+		glUseProgram(Program);
+		glUniform1i(glGetUniformLocation(Program, "Texture"), 0);
+		glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "lcFrame"), 0);
+		glUseProgram(0);
+
+		lcMeshProgram& MeshProgram = mMeshPrograms[ProgramIdx];
+		MeshProgram.Program = Program;
+		MeshProgram.MeshMatrixLocation = glGetUniformLocation(Program, "MeshMatrix");
+		MeshProgram.TextureMatrixLocation = glGetUniformLocation(Program, "TextureMatrix");
+		MeshProgram.TexturedLocation = glGetUniformLocation(Program, "Textured");
+	}
+
+	glGenBuffers(1, &mMeshFrameBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, mMeshFrameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(lcMeshShaderFrame), NULL, GL_DYNAMIC_DRAW_ARB);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	mMeshFrameValid = false;
+
+	glGenBuffers(1, &mMeshInstanceBuffer);
+	mMeshInstanceBufferSize = 0;
+
+	// The instance attributes are pointed at the instance buffer before each draw, only their layout is set here.
+	glGenVertexArrays(1, &mMeshVertexArray);
+	glBindVertexArray(mMeshVertexArray);
+	glEnableVertexAttribArray(0);
+
+	for (int AttribIdx = 2; AttribIdx <= 6; AttribIdx++)
+	{
+		glEnableVertexAttribArray(AttribIdx);
+		glVertexAttribDivisor(AttribIdx, 1);
+	}
+
+	glBindVertexArray(0);
+
+	return true;
+}
+
+void lcContext::DestroyMeshShader()
+{
+	for (int ProgramIdx = 0; ProgramIdx < LC_NUM_MESH_PROGRAMS; ProgramIdx++)
+	{
+		if (mMeshPrograms[ProgramIdx].Program)
+			glDeleteProgram(mMeshPrograms[ProgramIdx].Program);
+
+		mMeshPrograms[ProgramIdx].Program = 0;
+	}
+
+	if (mMeshVertexArray)
+	{
+		glDeleteVertexArrays(1, &mMeshVertexArray);
+		glDeleteBuffers(1, &mMeshFrameBuffer);
+		glDeleteBuffers(1, &mMeshInstanceBuffer);
+		mMeshVertexArray = 0;
+		mMeshFrameBuffer = 0;
+		mMeshInstanceBuffer = 0;
+	}
+}
+
+// Sections come in draw order, consecutive instances of the same mesh section are merged into one draw.
+void lcContext::AddMeshShaderInstance(lcMesh* Mesh, lcMeshSection* Section, const lcMatrix44& WorldMatrix, const lcVector4& Color)
+{
+	int NumDraws = mMeshDraws.GetSize();
+
+	if (NumDraws && mMeshDraws[NumDraws - 1].Mesh == Mesh && mMeshDraws[NumDraws - 1].Section == Section)
+		mMeshDraws[NumDraws - 1].NumInstances++;
+	else
+	{
+		lcMeshShaderDraw& Draw = mMeshDraws.Add();
+		Draw.Mesh = Mesh;
+		Draw.Section = Section;
+		Draw.FirstInstance = mMeshInstances.GetSize();
+		Draw.NumInstances = 1;
+	}
+
+	lcMeshShaderInstance& Instance = mMeshInstances.Add();
+	Instance.WorldMatrix = WorldMatrix;
+	Instance.Color = Color;
+}
+
+void lcContext::DrawMeshShaderInstances(const lcMatrix44& ViewMatrix, lcMeshProgramType ProgramType)
+{
+	if (mMeshDraws.IsEmpty())
+		return;
+
+	const lcMeshProgram& MeshProgram = mMeshPrograms[ProgramType];
+
+	lcMeshShaderFrame Frame;
+	Frame.ViewMatrix = ViewMatrix;
+	Frame.ProjectionMatrix = mProjectionMatrix;
+	Frame.AmbientColor = mMeshAmbientColor;
+	Frame.FogColor = mMeshFogColor;
+
+	if (!mMeshFrameValid || memcmp(&Frame, &mMeshFrame, sizeof(Frame)))
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, mMeshFrameBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame), &Frame);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		mMeshFrame = Frame;
+		mMeshFrameValid = true;
+	}
+
+	glUseProgram(MeshProgram.Program);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, mMeshFrameBuffer);
+	glBindVertexArray(mMeshVertexArray);
+
+	// Orphan the instance buffer so the driver doesn't wait for the previous draws still using it.
+	int InstanceDataSize = mMeshInstances.GetSize() * sizeof(lcMeshShaderInstance);
+	glBindBuffer(GL_ARRAY_BUFFER_ARB, mMeshInstanceBuffer);
+	mMeshInstanceBufferSize = lcMax(mMeshInstanceBufferSize, InstanceDataSize);
+	glBufferData(GL_ARRAY_BUFFER_ARB, mMeshInstanceBufferSize, NULL, GL_STREAM_DRAW_ARB);
+	glBufferSubData(GL_ARRAY_BUFFER_ARB, 0, InstanceDataSize, &mMeshInstances[0]);
+
+	lcMesh* CurrentMesh = NULL;
+	lcTexture* CurrentTexture = NULL;
+	int CurrentTextured = -1;
+
+	for (int DrawIdx = 0; DrawIdx < mMeshDraws.GetSize(); DrawIdx++)
+	{
+		const lcMeshShaderDraw& Draw = mMeshDraws[DrawIdx];
+		lcMesh* Mesh = Draw.Mesh;
+		lcMeshSection* Section = Draw.Section;
+		lcTexture* Texture = Section->Texture;
+		char* InstanceOffset = (char*)NULL + Draw.FirstInstance * sizeof(lcMeshShaderInstance);
+
+		glBindBuffer(GL_ARRAY_BUFFER_ARB, mMeshInstanceBuffer);
+
+		for (int Column = 0; Column < 4; Column++)
+			glVertexAttribPointer(2 + Column, 4, GL_FLOAT, GL_FALSE, sizeof(lcMeshShaderInstance), InstanceOffset + Column * sizeof(lcVector4));
+
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(lcMeshShaderInstance), InstanceOffset + offsetof(lcMeshShaderInstance, Color));
+
+		glBindBuffer(GL_ARRAY_BUFFER_ARB, Mesh->mVertexBuffer.mBuffer);
+		mFrameStats.NumBufferBinds += 2;
+
+		if (Mesh != CurrentMesh)
 		{
-			lcMeshSection* Section = &Mesh->mSections[SectionIdx];
-			int ColorIndex = Section->ColorIndex;
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, Mesh->mIndexBuffer.mBuffer);
+			glUniformMatrix4fv(MeshProgram.MeshMatrixLocation, 1, GL_FALSE, Mesh->mQuantized ? Mesh->GetDequantizeMatrix() : lcMatrix44Identity());
+			glUniformMatrix4fv(MeshProgram.TextureMatrixLocation, 1, GL_FALSE, Mesh->mQuantized ? Mesh->GetTextureMatrix() : lcMatrix44Identity());
+			CurrentMesh = Mesh;
+			mFrameStats.NumBufferBinds++;
+			mFrameStats.NumMatrixLoads += 2;
+		}
 
-			if (Section->PrimitiveType == GL_TRIANGLES)
-			{
-				if (ColorIndex == gDefaultColor)
-					ColorIndex = RenderMesh.ColorIndex;
+		char* VertexOffset = (char*)NULL;
+		GLenum PositionType = Mesh->mQuantized ? GL_SHORT : GL_FLOAT;
 
-				if (lcIsColorTranslucent(ColorIndex))
-					continue;
+		if (!Texture)
+		{
+			glVertexAttribPointer(0, 3, PositionType, GL_FALSE, Mesh->GetVertexSize(), VertexOffset);
+			glDisableVertexAttribArray(1);
+		}
+		else
+		{
+			int TexCoordOffset = Mesh->mQuantized ? offsetof(lcVertexTexturedQuantized, TexCoord) : offsetof(lcVertexTextured, TexCoord);
 
-				if (RenderMesh.Focused)
-				{
-					float* Color = gColorList[ColorIndex].Value;
-					glColor4fv(lcVector4(Color[0] * 0.5f + 0.4000f * 0.5f, Color[1] * 0.5f + 0.2980f * 0.5f, Color[2] * 0.5f + 0.8980f * 0.5f, Color[3]));
-				}
-				else if (RenderMesh.Selected)
-				{
-					float* Color = gColorList[ColorIndex].Value;
-					glColor4fv(lcVector4(Color[0] * 0.5f + 0.8980f * 0.5f, Color[1] * 0.5f + 0.2980f * 0.5f, Color[2] * 0.5f + 0.4000f * 0.5f, Color[3]));
-				}
-				else
-					lcSetColor(ColorIndex);
+			VertexOffset += Mesh->GetTexturedVertexOffset();
+			glVertexAttribPointer(0, 3, PositionType, GL_FALSE, Mesh->GetTexturedVertexSize(), VertexOffset);
+			glVertexAttribPointer(1, 2, PositionType, GL_FALSE, Mesh->GetTexturedVertexSize(), VertexOffset + TexCoordOffset);
+			glEnableVertexAttribArray(1);
+
+			if (Texture != CurrentTexture)
+			{
+				glBindTexture(GL_TEXTURE_2D, Texture->mTexture);
+				CurrentTexture = Texture;
+				mFrameStats.NumTextureBinds++;
 			}
+		}
+
+		if ((Texture != NULL) != CurrentTextured)
+		{
+			glUniform1i(MeshProgram.TexturedLocation, Texture != NULL);
+			CurrentTextured = Texture != NULL;
+		}
+
+		glDrawElementsInstanced(Section->PrimitiveType, Section->NumIndices, Mesh->mIndexType, (char*)NULL + Section->IndexOffset, Draw.NumInstances);
+		AddSectionStats(Section, Draw.NumInstances);
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+	mVertexBufferObject = 0;
+	mVertexBufferOffset = (char*)~0;
+
+	mMeshInstances.RemoveAll();
+	mMeshDraws.RemoveAll();
+}
+
+bool lcContext::UseBlendedTransparency() const
+{
+	const lcPreferences& Preferences = lcGetPreferences();
+
+	return Preferences.mShaderRendering && Preferences.mBlendedTransparency && GL_HasBlendedTransparency() && !mMeshShaderFailed && !mBlendedFailed;
+}
+
+// Translucent meshes are drawn to a framebuffer with a copy of the opaque depth, the first target adds the weighted colors
+// and multiplies the transparency of each layer, the second adds the weights. Neither depends on the order meshes are drawn.
+bool lcContext::BeginBlendedTransparency()
+{
+	if (!mBlendedCompositeProgram)
+	{
+		mBlendedCompositeProgram = lcCreateShaderProgram("", lcBlendedCompositeVertexShader, lcBlendedCompositeFragmentShader, false);
+
+		if (!mBlendedCompositeProgram)
+		{
+			mBlendedFailed = true;
+			return false;
+		}
+
+		glUseProgram(mBlendedCompositeProgram);
+		glUniform1i(glGetUniformLocation(mBlendedCompositeProgram, "ColorTexture"), 0);
+		glUniform1i(glGetUniformLocation(mBlendedCompositeProgram, "WeightTexture"), 1);
+		glUseProgram(0);
+
+		glGenVertexArrays(1, &mBlendedCompositeVertexArray);
+	}
+
+	GLint DepthBits = 0, StencilBits = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mBlendedPreviousFramebuffer);
+	glGetIntegerv(GL_DEPTH_BITS, &DepthBits);
+	glGetIntegerv(GL_STENCIL_BITS, &StencilBits);
+
+	// Depth can only be blitted between buffers of the same format.
+	GLenum DepthFormat = StencilBits ? GL_DEPTH24_STENCIL8 : (DepthBits == 16 ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT24);
+	int Width = mViewportX + mViewportWidth;
+	int Height = mViewportY + mViewportHeight;
+
+	if (!mBlendedFramebuffer || Width != mBlendedWidth || Height != mBlendedHeight || DepthFormat != mBlendedDepthFormat)
+	{
+		if (!CreateBlendedFramebuffer(Width, Height, DepthFormat))
+		{
+			DestroyBlendedFramebuffer();
+			glBindFramebuffer(GL_FRAMEBUFFER, mBlendedPreviousFramebuffer);
+			mBlendedFailed = true;
+			return false;
+		}
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mBlendedPreviousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mBlendedFramebuffer);
+	glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, mBlendedFramebuffer);
+
+	GLfloat ClearColor[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, ClearColor);
+
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glDrawBuffer(GL_COLOR_ATTACHMENT1);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glClearColor(ClearColor[0], ClearColor[1], ClearColor[2], ClearColor[3]);
+
+	const GLenum DrawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, DrawBuffers);
+	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+
+	return true;
+}
+
+void lcContext::EndBlendedTransparency()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mBlendedPreviousFramebuffer);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(mBlendedCompositeProgram);
+	glBindVertexArray(mBlendedCompositeVertexArray);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, mBlendedWeightTexture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mBlendedColorTexture);
+
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	mFrameStats.NumDrawCalls++;
+	mFrameStats.NumTextureBinds += 2;
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glEnable(GL_DEPTH_TEST);
+}
+
+bool lcContext::CreateBlendedFramebuffer(int Width, int Height, GLenum DepthFormat)
+{
+	DestroyBlendedFramebuffer();
+
+	glGenFramebuffers(1, &mBlendedFramebuffer);
+	glGenTextures(1, &mBlendedColorTexture);
+	glGenTextures(1, &mBlendedWeightTexture);
+	glGenRenderbuffers(1, &mBlendedDepthRenderbuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mBlendedFramebuffer);
+
+	glBindTexture(GL_TEXTURE_2D, mBlendedColorTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, Width, Height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mBlendedColorTexture, 0);
+
+	glBindTexture(GL_TEXTURE_2D, mBlendedWeightTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, Width, Height, 0, GL_RED, GL_HALF_FLOAT, NULL);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mBlendedWeightTexture, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, mBlendedDepthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, DepthFormat, Width, Height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, DepthFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mBlendedDepthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	mBlendedWidth = Width;
+	mBlendedHeight = Height;
+	mBlendedDepthFormat = DepthFormat;
+
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void lcContext::DestroyBlendedFramebuffer()
+{
+	if (!mBlendedFramebuffer)
+		return;
+
+	glDeleteFramebuffers(1, &mBlendedFramebuffer);
+	mBlendedFramebuffer = 0;
+	glDeleteTextures(1, &mBlendedColorTexture);
+	mBlendedColorTexture = 0;
+	glDeleteTextures(1, &mBlendedWeightTexture);
+	mBlendedWeightTexture = 0;
+	glDeleteRenderbuffers(1, &mBlendedDepthRenderbuffer);
+	mBlendedDepthRenderbuffer = 0;
+}
+
+void lcContext::DrawOpaqueMeshes(const lcScene& Scene)
+{
+	QElapsedTimer Timer;
+	Timer.start();
+
+	bool DrawLines = Scene.mDrawEdgeLines && lcGetPreferences().mDrawEdgeLines;
+	const lcMatrix44& ViewMatrix = Scene.mViewMatrix;
+	const lcArray<lcRenderMesh>& OpaqueMeshes = Scene.mOpaqueMeshes;
+	const lcArray<lcRenderSection>& OpaqueSections = Scene.mOpaqueSections;
+	bool UseMeshShader = BeginMeshShader();
+
+	// Sections are sorted so instances of the same mesh section follow each other, only send the state that changes between them.
+	lcMesh* CurrentMesh = NULL;
+	int CurrentRenderMesh = -1;
+	lcVector4 CurrentColor(-1.0f, -1.0f, -1.0f, -1.0f);
+
+	for (int SectionIdx = 0; SectionIdx < OpaqueSections.GetSize(); SectionIdx++)
+	{
+		const lcRenderSection& RenderSection = OpaqueSections[SectionIdx];
+
+		if (!Scene.mOpaqueMeshVisible[RenderSection.RenderMeshIndex])
+			continue;
+
+		lcRenderMesh& RenderMesh = OpaqueMeshes[RenderSection.RenderMeshIndex];
+		lcMesh* Mesh = RenderMesh.Mesh;
+		lcMeshSection* Section = &Mesh->mSections[RenderSection.SectionIndex];
+		int ColorIndex = Section->ColorIndex;
+		lcVector4 Color;
+
+		if (Section->PrimitiveType == GL_TRIANGLES)
+		{
+			if (ColorIndex == gDefaultColor)
+				ColorIndex = RenderMesh.ColorIndex;
+
+			float* Value = gColorList[ColorIndex].Value;
+
+			if (RenderMesh.Focused)
+				Color = lcVector4(Value[0] * 0.5f + 0.4000f * 0.5f, Value[1] * 0.5f + 0.2980f * 0.5f, Value[2] * 0.5f + 0.8980f * 0.5f, Value[3]);
+			else if (RenderMesh.Selected)
+				Color = lcVector4(Value[0] * 0.5f + 0.8980f * 0.5f, Value[1] * 0.5f + 0.2980f * 0.5f, Value[2] * 0.5f + 0.4000f * 0.5f, Value[3]);
 			else
+				Color = lcVector4(Value[0], Value[1], Value[2], Value[3]);
+		}
+		else
+		{
+			if (RenderMesh.Focused)
+				Color = lcVector4(0.4000f, 0.2980f, 0.8980f, 1.0000f);
+			else if (RenderMesh.Selected)
+				Color = lcVector4(0.8980f, 0.2980f, 0.4000f, 1.0000f);
+			else if (DrawLines)
 			{
-				if (RenderMesh.Focused)
-					lcSetColorFocused();
-				else if (RenderMesh.Selected)
-					lcSetColorSelected();
-				else if (DrawLines)
-				{
-					if (ColorIndex == gEdgeColor)
-						lcSetEdgeColor(RenderMesh.ColorIndex);
-					else
-						lcSetColor(ColorIndex);
-				}
-				else
-					continue;
+				float* Value = (ColorIndex == gEdgeColor) ? gColorList[RenderMesh.ColorIndex].Edge : gColorList[ColorIndex].Value;
+				Color = lcVector4(Value[0], Value[1], Value[2], Value[3]);
 			}
+			else
+				continue;
+		}
 
-			DrawMeshSection(Mesh, Section);
+		if (UseMeshShader)
+		{
+			AddMeshShaderInstance(Mesh, Section, RenderMesh.WorldMatrix, Color);
+			continue;
 		}
+
+		if (Mesh != CurrentMesh)
+		{
+			BindMesh(Mesh);
+			CurrentMesh = Mesh;
+		}
+
+		if (RenderSection.RenderMeshIndex != CurrentRenderMesh)
+		{
+			if (Mesh->mQuantized)
+				SetWorldViewMatrix(lcMul(Mesh->GetDequantizeMatrix(), lcMul(RenderMesh.WorldMatrix, ViewMatrix)));
+			else
+				SetWorldViewMatrix(lcMul(RenderMesh.WorldMatrix, ViewMatrix));
+
+			CurrentRenderMesh = RenderSection.RenderMeshIndex;
+		}
+
+		if (memcmp(&Color, &CurrentColor, sizeof(Color)))
+		{
+			glColor4fv(Color);
+			CurrentColor = Color;
+		}
+
+		DrawMeshSection(Mesh, Section);
 	}
+
+	if (UseMeshShader)
+		DrawMeshShaderInstances(ViewMatrix, LC_MESH_PROGRAM_DEFAULT);
+
+	mFrameStats.OpaqueTime += Timer.nsecsElapsed() / 1000000.0f;
 }
 
-void lcContext::DrawTranslucentMeshes(const lcMatrix44& ViewMatrix, const lcArray<lcRenderMesh>& TranslucentMeshes)
+void lcContext::DrawTranslucentMeshes(const lcScene& Scene)
 {
-	if (TranslucentMeshes.IsEmpty())
+	const lcMatrix44& ViewMatrix = Scene.mViewMatrix;
+	const lcArray<lcRenderMesh>& TranslucentMeshes = Scene.mTranslucentMeshes;
+	const lcArray<int>& TranslucentOrder = Scene.mTranslucentOrder;
+
+	if (TranslucentOrder.IsEmpty())
 		return;
 
+	QElapsedTimer Timer;
+	Timer.start();
+
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_BLEND);
 	glDepthMask(GL_FALSE);
 
-	for (int MeshIdx = 0; MeshIdx < TranslucentMeshes.GetSize(); MeshIdx++)
+	bool UseMeshShader = BeginMeshShader();
+
+	for (int OrderIdx = 0; OrderIdx < TranslucentOrder.GetSize(); OrderIdx++)
 	{
-		lcRenderMesh& RenderMesh = TranslucentMeshes[MeshIdx];
+		lcRenderMesh& RenderMesh = TranslucentMeshes[TranslucentOrder[OrderIdx]];
 		lcMesh* Mesh = RenderMesh.Mesh;
 
-		BindMesh(Mesh);
-		SetWorldViewMatrix(lcMul(RenderMesh.WorldMatrix, ViewMatrix));
+		if (!UseMeshShader)
+		{
+			BindMesh(Mesh);
+
+			if (Mesh->mQuantized)
+				SetWorldViewMatrix(lcMul(Mesh->GetDequantizeMatrix(), lcMul(RenderMesh.WorldMatrix, ViewMatrix)));
+			else
+				SetWorldViewMatrix(lcMul(RenderMesh.WorldMatrix, ViewMatrix));
+		}
 
 		for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
 		{
@@ -595,25 +1903,87 @@ void lcContext::DrawTranslucentMeshes(const lcMatrix44& ViewMatrix, const lcArra
 			if (!lcIsColorTranslucent(ColorIndex))
 				continue;
 
+			float* Value = gColorList[ColorIndex].Value;
+			lcVector4 Color;
+
 			if (RenderMesh.Focused)
-			{
-				float* Color = gColorList[ColorIndex].Value;
-				glColor4fv(lcVector4(Color[0] * 0.5f + 0.4000f * 0.5f, Color[1] * 0.5f + 0.2980f * 0.5f, Color[2] * 0.5f + 0.8980f * 0.5f, Color[3]));
-			}
+				Color = lcVector4(Value[0] * 0.5f + 0.4000f * 0.5f, Value[1] * 0.5f + 0.2980f * 0.5f, Value[2] * 0.5f + 0.8980f * 0.5f, Value[3]);
 			else if (RenderMesh.Selected)
+				Color = lcVector4(Value[0] * 0.5f + 0.8980f * 0.5f, Value[1] * 0.5f + 0.2980f * 0.5f, Value[2] * 0.5f + 0.4000f * 0.5f, Value[3]);
+			else
+				Color = lcVector4(Value[0], Value[1], Value[2], Value[3]);
+
+			if (UseMeshShader)
 			{
-				float* Color = gColorList[ColorIndex].Value;
-				glColor4fv(lcVector4(Color[0] * 0.5f + 0.8980f * 0.5f, Color[1] * 0.5f + 0.2980f * 0.5f, Color[2] * 0.5f + 0.4000f * 0.5f, Color[3]));
+				AddMeshShaderInstance(Mesh, Section, RenderMesh.WorldMatrix, Color);
+				continue;
 			}
-			else
-				lcSetColor(ColorIndex);
 
+			glColor4fv(Color);
 			DrawMeshSection(Mesh, Section);
 		}
 	}
 
+	if (UseMeshShader)
+	{
+		if (UseBlendedTransparency() && BeginBlendedTransparency())
+		{
+			DrawMeshShaderInstances(ViewMatrix, LC_MESH_PROGRAM_BLENDED);
+			EndBlendedTransparency();
+		}
+		else
+			DrawMeshShaderInstances(ViewMatrix, LC_MESH_PROGRAM_DEFAULT);
+	}
+
 	glDepthMask(GL_TRUE);
 	glDisable(GL_BLEND);
+
+	mFrameStats.TranslucentTime += Timer.nsecsElapsed() / 1000000.0f;
+}
+
+void lcContext::DrawPickMeshes(const lcScene& Scene, bool Translucent, lcuint32 FirstId)
+{
+	const lcMatrix44& ViewMatrix = Scene.mViewMatrix;
+	const lcArray<lcRenderMesh>& RenderMeshes = Translucent ? Scene.mTranslucentMeshes : Scene.mOpaqueMeshes;
+	const lcArray<bool>& RenderMeshVisible = Translucent ? Scene.mTranslucentMeshVisible : Scene.mOpaqueMeshVisible;
+
+	for (int MeshIdx = 0; MeshIdx < RenderMeshes.GetSize(); MeshIdx++)
+	{
+		if (!RenderMeshVisible[MeshIdx])
+			continue;
+
+		lcRenderMesh& RenderMesh = RenderMeshes[MeshIdx];
+		lcMesh* Mesh = RenderMesh.Mesh;
+		lcuint32 Id = FirstId + MeshIdx;
+
+		BindMesh(Mesh);
+
+		if (Mesh->mQuantized)
+			SetWorldViewMatrix(lcMul(Mesh->GetDequantizeMatrix(), lcMul(RenderMesh.WorldMatrix, ViewMatrix)));
+		else
+			SetWorldViewMatrix(lcMul(RenderMesh.WorldMatrix, ViewMatrix));
+
+		glColor4ub(Id & 0xff, (Id >> 8) & 0xff, (Id >> 16) & 0xff, (Id >> 24) & 0xff);
+
+		for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
+		{
+			lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+			int ColorIndex = Section->ColorIndex;
+
+			if (Section->PrimitiveType != GL_TRIANGLES)
+				continue;
+
+			if (ColorIndex == gDefaultColor)
+				ColorIndex = RenderMesh.ColorIndex;
+
+			if (lcIsColorTranslucent(ColorIndex) != Translucent)
+				continue;
+
+			// Textures are never enabled here so the color written is always the mesh id.
+			SetMeshVertexPointer(Mesh, Section->Texture != NULL);
+			glDrawElements(Section->PrimitiveType, Section->NumIndices, Mesh->mIndexType, mIndexBufferPointer + Section->IndexOffset);
+		}
+	}
 }
 
 void lcContext::DrawInterfaceObjects(const lcMatrix44& ViewMatrix, const lcArray<lcObject*>& InterfaceObjects)
@@ -3,19 +3,186 @@
 
 #include "lc_array.h"
 #include "lc_math.h"
+#include "lc_framestats.h"
+#include "object.h"
+
+#define LC_GPU_TIMER_QUERIES 4
+
+class lcImageWriter;
+
+// Opaque mesh section referenced by a key that sorts sections sharing the same texture, mesh and color next to each other.
+struct lcRenderSection
+{
+	lcuint64 SortKey;
+	int RenderMeshIndex;
+	int SectionIndex;
+};
+
+struct lcTranslucentSortItem
+{
+	lcuint64 SortKey;
+	int RenderMeshIndex;
+};
+
+// Piece that passed the frustum test, sorted by how much of the screen it covers to pick the occluders.
+struct lcOcclusionSortItem
+{
+	lcuint64 SortKey;
+	int PieceIndex;
+};
+
+// Top level piece of a scene and the range of render meshes it added, used to cull them together.
+struct lcScenePiece
+{
+	lcMatrix44 WorldMatrix;
+	lcVector3 Min;
+	lcVector3 Max;
+	bool Model;
+	bool Static;
+	lcStep Step;
+	int FirstOpaqueMesh;
+	int NumOpaqueMeshes;
+	int FirstTranslucentMesh;
+	int NumTranslucentMeshes;
+	int FirstSubModelPiece;
+	int NumSubModelPieces;
+};
+
+// Piece inside a submodel instance, culled by itself when the top level piece is visible.
+struct lcSceneSubModelPiece
+{
+	lcMatrix44 WorldMatrix;
+	lcVector3 Min;
+	lcVector3 Max;
+	bool Model;
+	int NumSubModelPieces; // Pieces of a nested submodel that follow this one and are skipped when it's culled.
+	int FirstOpaqueMesh;
+	int NumOpaqueMeshes;
+	int FirstTranslucentMesh;
+	int NumTranslucentMeshes;
+};
+
+// Values of the lcFrame uniform block of the mesh shader, laid out with the std140 rules.
+struct lcMeshShaderFrame
+{
+	lcMatrix44 ViewMatrix;
+	lcMatrix44 ProjectionMatrix;
+	lcVector4 AmbientColor;
+	lcVector4 FogColor;
+};
+
+// Per instance vertex attributes of the mesh shader.
+struct lcMeshShaderInstance
+{
+	lcMatrix44 WorldMatrix;
+	lcVector4 Color;
+};
+
+enum lcMeshProgramType
+{
+	LC_MESH_PROGRAM_DEFAULT,
+	LC_MESH_PROGRAM_BLENDED, // Writes weighted color and coverage for order independent transparency.
+	LC_NUM_MESH_PROGRAMS
+};
+
+struct lcMeshProgram
+{
+	GLuint Program;
+	GLint MeshMatrixLocation;
+	GLint TextureMatrixLocation;
+	GLint TexturedLocation;
+};
+
+// Instances of the same mesh section drawn with a single call.
+struct lcMeshShaderDraw
+{
+	lcMesh* Mesh;
+	lcMeshSection* Section;
+	int FirstInstance;
+	int NumInstances;
+};
 
 class lcScene
 {
 public:
 	lcScene();
 
-	void Begin(const lcMatrix44& ViewMatrix);
+	void Begin(const lcMatrix44& ViewMatrix, const lcMatrix44& ProjectionMatrix);
 	void End();
 
+	// Static pieces can have their opaque meshes merged by the static batcher.
+	void BeginPiece(lcPiece* Piece, const PieceInfo* Info, const lcMatrix44& WorldMatrix, bool Static);
+	void EndPiece();
+
+	// Called by submodels for each of their pieces, returns -1 and records nothing outside of BeginPiece() and EndPiece().
+	int BeginSubModelPiece(const PieceInfo* Info, const lcMatrix44& WorldMatrix);
+	void EndSubModelPiece(int SubModelPieceIndex);
+
+	// Culls and sorts the translucent meshes again for a new camera without rebuilding the scene.
+	void SetView(const lcMatrix44& ViewMatrix, const lcMatrix44& ProjectionMatrix);
+
+	lcStaticBatcher* GetStaticBatcher() const
+	{
+		return mStaticBatcher;
+	}
+
+	void SetStaticBatcher(lcStaticBatcher* StaticBatcher);
+
+	// Pieces hidden behind the largest pieces in front of them are culled when an occlusion buffer is set.
+	void SetOcclusionBuffer(lcOcclusionBuffer* OcclusionBuffer)
+	{
+		mOcclusionBuffer = OcclusionBuffer;
+	}
+
 	lcMatrix44 mViewMatrix;
+	lcMatrix44 mProjectionMatrix;
+	lcVector4 mFrustumPlanes[6];
+	float mUpdateTime; // Milliseconds spent in the last call to End() or SetView().
+	int mNumCulledPieces;
+	int mNumCulledModels;
+	int mNumOccludedPieces;
+	lcPiece* mCurrentPiece;
 	lcArray<lcRenderMesh> mOpaqueMeshes;
 	lcArray<lcRenderMesh> mTranslucentMeshes;
 	lcArray<lcObject*> mInterfaceObjects;
+	lcArray<lcRenderSection> mOpaqueSections;
+	lcArray<bool> mOpaqueMeshVisible;
+	lcArray<bool> mTranslucentMeshVisible;
+	lcArray<int> mTranslucentOrder;
+	bool mSortTranslucentMeshes; // Not needed when translucent meshes are blended without sorting.
+	bool mDrawEdgeLines; // Cleared to draw faster while the camera is moving.
+	bool mStepOrder; // Draws the opaque sections of each step after the ones of the previous steps.
+
+	// What the scene was built from, used by lcModel::UpdateScene() to know if it can be reused.
+	const lcModel* mModel;
+	const lcCamera* mViewCamera;
+	bool mDrawInterface;
+	lcStep mFirstStep;
+	lcuint32 mRevision;
+
+protected:
+	void ApplyStaticBatches();
+	void UpdateVisibility();
+	void UpdateSubModelVisibility(int FirstSubModelPiece, int LastSubModelPiece);
+	void UpdateOcclusion();
+	void SortOpaqueSections();
+	void SortTranslucentMeshes();
+
+	lcStaticBatcher* mStaticBatcher;
+	lcOcclusionBuffer* mOcclusionBuffer;
+	int mNumPieceOpaqueMeshes;
+	int mNumPieces;
+	lcArray<bool> mOpaqueMeshBatched;
+	lcArray<lcScenePiece> mPieces;
+	lcArray<lcSceneSubModelPiece> mSubModelPieces;
+	lcArray<lcRenderSection> mSortSections;
+	lcArray<lcStep> mOpaqueMeshSteps;
+	lcArray<lcTranslucentSortItem> mTranslucentSortItems;
+	lcArray<lcTranslucentSortItem> mTranslucentSortTemp;
+	lcArray<lcOcclusionSortItem> mOcclusionItems;
+	lcArray<lcOcclusionSortItem> mOcclusionSortTemp;
+
+	friend class lcStaticBatcher;
 };
 
 class lcContext
@@ -34,18 +201,47 @@ public:
 		return mViewportHeight;
 	}
 
+	// Counters of the frame being drawn, the caller fills the scene times.
+	lcFrameStats& GetFrameStats()
+	{
+		return mFrameStats;
+	}
+
+	// Measures the GPU time of the draws in between, the result is read a few frames later to avoid waiting for it.
+	void BeginGpuTimer();
+	void EndGpuTimer();
+
 	void SetDefaultState();
 
 	void SetViewport(int x, int y, int Width, int Height);
 	void SetWorldViewMatrix(const lcMatrix44& WorldViewMatrix);
 	void SetProjectionMatrix(const lcMatrix44& ProjectionMatrix);
+	void SetTextureMatrix(lcMesh* Mesh);
 //	void SetColor(const lcVector4& Color);
 	void SetLineWidth(float LineWidth);
 
+	// Translucent meshes are blended with weights that don't depend on their order instead of being sorted back to front.
+	bool UseBlendedTransparency() const;
+
+	// Lighting and fog of the mesh shader, the fixed function state is still set by the caller.
+	void SetMeshLighting(bool Lighting, const lcVector3& AmbientColor);
+	void SetMeshFog(bool Fog, float Density, const lcVector3& FogColor);
+
 	bool BeginRenderToTexture(int Width, int Height);
 	void EndRenderToTexture();
 	bool SaveRenderToTextureImage(const QString& FileName, int Width, int Height);
 
+	// Starts reading the image drawn to the texture without waiting for the GPU, it's copied out of a pixel buffer object
+	// after the next image is queued and saved on a worker thread. FinishRenderToTextureImages() must be called before
+	// EndRenderToTexture() and returns false if any image couldn't be written.
+	void QueueRenderToTextureImage(const QString& FileName, int Width, int Height);
+	bool FinishRenderToTextureImages();
+
+	// Binds the buffer used to find the objects under the mouse, it's kept between picks and only reallocated when it
+	// needs to grow. EndPickFramebuffer() restores the framebuffer, viewport, projection and clear color in use before.
+	bool BeginPickFramebuffer(int Width, int Height);
+	void EndPickFramebuffer();
+
 	void ClearVertexBuffer();
 	void SetVertexBuffer(const lcVertexBuffer* VertexBuffer);
 	void SetVertexBufferPointer(const void* VertexBuffer);
@@ -55,11 +251,28 @@ public:
 	void BindMesh(lcMesh* Mesh);
 	void UnbindMesh();
 	void DrawMeshSection(lcMesh* Mesh, lcMeshSection* Section);
-	void DrawOpaqueMeshes(const lcMatrix44& ViewMatrix, const lcArray<lcRenderMesh>& OpaqueMeshes);
-	void DrawTranslucentMeshes(const lcMatrix44& ViewMatrix, const lcArray<lcRenderMesh>& TranslucentMeshes);
+	void SetMeshVertexPointer(lcMesh* Mesh, bool Textured);
+	void DrawOpaqueMeshes(const lcScene& Scene);
+	void DrawTranslucentMeshes(const lcScene& Scene);
 	void DrawInterfaceObjects(const lcMatrix44& ViewMatrix, const lcArray<lcObject*>& InterfaceObjects);
 
+	// Draws each visible render mesh of the scene with a flat color that encodes FirstId plus its index, used to find the objects under the mouse.
+	void DrawPickMeshes(const lcScene& Scene, bool Translucent, lcuint32 FirstId);
+
 protected:
+	void AddSectionStats(const lcMeshSection* Section, int NumInstances);
+	bool BeginMeshShader();
+	bool CreateMeshShader();
+	void DestroyMeshShader();
+	void AddMeshShaderInstance(lcMesh* Mesh, lcMeshSection* Section, const lcMatrix44& WorldMatrix, const lcVector4& Color);
+	void DrawMeshShaderInstances(const lcMatrix44& ViewMatrix, lcMeshProgramType ProgramType);
+	bool BeginBlendedTransparency();
+	void EndBlendedTransparency();
+	bool CreateBlendedFramebuffer(int Width, int Height, GLenum DepthFormat);
+	void DestroyBlendedFramebuffer();
+	void DestroyPickFramebuffer();
+	void ReadRenderToTextureImage(int BufferIndex);
+
 	GLuint mVertexBufferObject;
 	GLuint mIndexBufferObject;
 	char* mVertexBufferPointer;
@@ -70,8 +283,12 @@ protected:
 	bool mColorEnabled;
 
 	lcTexture* mTexture;
+	lcMesh* mTextureMatrixMesh;
 	float mLineWidth;
 	int mMatrixMode;
+	lcFrameStats mFrameStats;
+	GLuint mGpuTimerQueries[LC_GPU_TIMER_QUERIES];
+	int mNumGpuTimerFrames;
 
 	int mViewportX;
 	int mViewportY;
@@ -82,6 +299,50 @@ protected:
 	GLuint mFramebufferTexture;
 	GLuint mDepthRenderbufferObject;
 
+	GLuint mPickFramebuffer;
+	GLuint mPickColorRenderbuffer;
+	GLuint mPickDepthRenderbuffer;
+	int mPickWidth;
+	int mPickHeight;
+	GLint mPickPreviousFramebuffer;
+	int mPickPreviousViewport[4];
+	lcMatrix44 mPickPreviousProjection;
+	GLfloat mPickPreviousClearColor[4];
+
+	GLuint mReadbackBuffers[2];
+	QString mReadbackFileNames[2];
+	int mReadbackIndex;
+	int mReadbackWidth;
+	int mReadbackHeight;
+	lcImageWriter* mImageWriter;
+
+	lcMatrix44 mProjectionMatrix;
+	lcVector4 mMeshAmbientColor;
+	lcVector4 mMeshFogColor;
+
+	lcMeshProgram mMeshPrograms[LC_NUM_MESH_PROGRAMS];
+	GLuint mMeshVertexArray;
+	GLuint mMeshFrameBuffer;
+	GLuint mMeshInstanceBuffer;
+	int mMeshInstanceBufferSize;
+	bool mMeshShaderFailed;
+	bool mMeshFrameValid;
+	lcMeshShaderFrame mMeshFrame;
+	lcArray<lcMeshShaderInstance> mMeshInstances;
+	lcArray<lcMeshShaderDraw> mMeshDraws;
+
+	GLuint mBlendedFramebuffer;
+	GLuint mBlendedColorTexture;
+	GLuint mBlendedWeightTexture;
+	GLuint mBlendedDepthRenderbuffer;
+	GLuint mBlendedCompositeProgram;
+	GLuint mBlendedCompositeVertexArray;
+	GLint mBlendedPreviousFramebuffer;
+	GLenum mBlendedDepthFormat;
+	int mBlendedWidth;
+	int mBlendedHeight;
+	bool mBlendedFailed;
+
 	Q_DECLARE_TR_FUNCTIONS(lcContext);
 };
 
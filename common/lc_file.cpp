@@ -277,3 +277,118 @@ void lcDiskFile::CopyFrom(lcMemFile& Source)
 	Seek(0, SEEK_SET);
 	WriteBuffer(Source.mBuffer, Length);
 }
+
+// =============================================================================
+// Number formatting
+
+int lcFormatInteger(char* Buffer, lcint64 Value, int MinDigits)
+{
+	char Digits[32];
+	int NumDigits = 0;
+	char* Dest = Buffer;
+	lcuint64 Magnitude = Value < 0 ? 0 - (lcuint64)Value : (lcuint64)Value;
+
+	do
+	{
+		Digits[NumDigits++] = '0' + (char)(Magnitude % 10);
+		Magnitude /= 10;
+	}
+	while (Magnitude);
+
+	if (Value < 0)
+		*Dest++ = '-';
+
+	for (int Pad = NumDigits; Pad < MinDigits; Pad++)
+		*Dest++ = '0';
+
+	while (NumDigits)
+		*Dest++ = Digits[--NumDigits];
+
+	return (int)(Dest - Buffer);
+}
+
+// Rounds the exact value of the float with integer math. Values that the C library could round differently, exact ties
+// and numbers too large for 64 bits, are left to sprintf() and only the decimal point of the current locale is replaced.
+int lcFormatFloat(char* Buffer, float Value, int Decimals)
+{
+	static const lcuint64 Powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+	union
+	{
+		float Float;
+		lcuint32 Bits;
+	} Number;
+
+	Number.Float = Value;
+
+	bool Negative = (Number.Bits & 0x80000000) != 0;
+	int Exponent = (Number.Bits >> 23) & 0xff;
+	lcuint64 Mantissa = Number.Bits & 0x7fffff;
+	bool Exact = Decimals >= 0 && Decimals <= 6 && Exponent != 0xff;
+	lcuint64 Scaled = 0;
+
+	if (Exact)
+	{
+		if (Exponent)
+			Mantissa |= 0x800000;
+		else
+			Exponent = 1;
+
+		// Value = Mantissa * 2^Shift, Scaled is Value * 10^Decimals rounded to the nearest integer.
+		int Shift = Exponent - 150;
+		lcuint64 Product = Mantissa * Powers[Decimals];
+
+		if (Shift >= 0)
+		{
+			if (Shift < 20)
+				Scaled = Product << Shift;
+			else
+				Exact = false;
+		}
+		else if (Shift > -64)
+		{
+			lcuint64 Remainder = Product & ((1ULL << -Shift) - 1);
+			lcuint64 Half = 1ULL << (-Shift - 1);
+
+			Scaled = Product >> -Shift;
+
+			if (Remainder > Half)
+				Scaled++;
+			else if (Remainder == Half)
+				Exact = false;
+		}
+	}
+
+	if (!Exact)
+	{
+		char Text[512];
+		int Length = snprintf(Text, sizeof(Text), "%.*f", Decimals, Value);
+		char* Dest = Buffer;
+		bool Finite = Value == Value && Value - Value == 0.0f;
+
+		for (int Char = 0; Char < Length && Char < (int)sizeof(Text) - 1; Char++)
+		{
+			if (!Finite || Text[Char] == '-' || (Text[Char] >= '0' && Text[Char] <= '9'))
+				*Dest++ = Text[Char];
+			else if (Dest == Buffer || Dest[-1] != '.')
+				*Dest++ = '.';
+		}
+
+		return (int)(Dest - Buffer);
+	}
+
+	char* Dest = Buffer;
+
+	if (Negative)
+		*Dest++ = '-';
+
+	Dest += lcFormatInteger(Dest, (lcint64)(Scaled / Powers[Decimals]));
+
+	if (Decimals)
+	{
+		*Dest++ = '.';
+		Dest += lcFormatInteger(Dest, (lcint64)(Scaled % Powers[Decimals]), Decimals);
+	}
+
+	return (int)(Dest - Buffer);
+}
@@ -491,4 +491,9 @@ public:
 	FILE* mFile;
 };
 
+// Locale independent replacements for sprintf("%.*d") and sprintf("%.*f") used by the exporters, the text is the same as
+// the C library writes in the "C" locale. They don't add a terminating zero and return the number of characters written.
+int lcFormatInteger(char* Buffer, lcint64 Value, int MinDigits = 1);
+int lcFormatFloat(char* Buffer, float Value, int Decimals);
+
 #endif // _FILE_H_
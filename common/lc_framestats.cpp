@@ -0,0 +1,52 @@
+#include "lc_global.h"
+#include "lc_framestats.h"
+#include <stdio.h>
+
+lcFrameStatsLog::lcFrameStatsLog()
+{
+	mFile = NULL;
+	mNumFrames = 0;
+}
+
+lcFrameStatsLog::~lcFrameStatsLog()
+{
+	Close();
+}
+
+bool lcFrameStatsLog::Open(const char* FileName)
+{
+	Close();
+
+	mFile = fopen(FileName, "wt");
+
+	if (!mFile)
+		return false;
+
+	fprintf(mFile, "Frame,Time (ms),Width,Height,Draw Calls,Sections,Triangles,Lines,Texture Binds,Buffer Binds,Matrix Loads,Scene (ms),Scene End (ms),Opaque (ms),Translucent (ms),GPU (ms)\n");
+
+	mNumFrames = 0;
+	mTimer.start();
+
+	return true;
+}
+
+void lcFrameStatsLog::Close()
+{
+	if (!mFile)
+		return;
+
+	fclose(mFile);
+	mFile = NULL;
+}
+
+void lcFrameStatsLog::Write(const lcFrameStats& Stats, int Width, int Height)
+{
+	if (!mFile)
+		return;
+
+	fprintf(mFile, "%d,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n", mNumFrames, mTimer.nsecsElapsed() / 1000000.0, Width, Height,
+	        Stats.NumDrawCalls, Stats.NumSections, Stats.NumTriangles, Stats.NumLines, Stats.NumTextureBinds, Stats.NumBufferBinds, Stats.NumMatrixLoads,
+	        Stats.SceneTime, Stats.SceneEndTime, Stats.OpaqueTime, Stats.TranslucentTime, Stats.GpuTime);
+
+	mNumFrames++;
+}
@@ -0,0 +1,43 @@
+#ifndef _LC_FRAMESTATS_H_
+#define _LC_FRAMESTATS_H_
+
+// Work done to draw a frame, counted by lcContext and reset by lcContext::SetDefaultState(). Times are in milliseconds.
+struct lcFrameStats
+{
+	int NumDrawCalls;
+	int NumSections;
+	int NumTriangles;
+	int NumLines;
+	int NumTextureBinds;
+	int NumBufferBinds;
+	int NumMatrixLoads;
+	float SceneTime;
+	float SceneEndTime;
+	float OpaqueTime;
+	float TranslucentTime;
+	float GpuTime; // Result of a timer query from a previous frame, negative if not available.
+};
+
+// Appends the statistics of each frame drawn to a CSV file.
+class lcFrameStatsLog
+{
+public:
+	lcFrameStatsLog();
+	~lcFrameStatsLog();
+
+	bool Open(const char* FileName);
+	void Close();
+	void Write(const lcFrameStats& Stats, int Width, int Height);
+
+	bool IsOpen() const
+	{
+		return mFile != NULL;
+	}
+
+protected:
+	FILE* mFile;
+	int mNumFrames;
+	QElapsedTimer mTimer;
+};
+
+#endif // _LC_FRAMESTATS_H_
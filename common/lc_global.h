@@ -60,13 +60,18 @@ class lcMatrix33;
 class lcMatrix44;
 
 class lcContext;
+class lcGLWidget;
 class lcVertexBuffer;
 class lcIndexBuffer;
 class lcMesh;
+class lcBVH;
+struct lcTrianglePacket;
 struct lcMeshSection;
 struct lcRenderMesh;
 class lcTexture;
 class lcScene;
+class lcStaticBatcher;
+class lcOcclusionBuffer;
 
 class lcFile;
 class lcMemFile;
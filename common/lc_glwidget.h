@@ -57,7 +57,7 @@ public:
 			delete mContext;
 	}
 
-	void* GetExtensionAddress(const char* FunctionName);
+	virtual void* GetExtensionAddress(const char* FunctionName);
 	void ShowPopupMenu();
 
 	void SetContext(lcContext* Context)
@@ -69,8 +69,9 @@ public:
 		mDeleteContext = false;
 	}
 
-	void MakeCurrent();
+	virtual void MakeCurrent();
 	void Redraw();
+	void RedrawDelayed(int Milliseconds);
 	void SetCursor(LC_CURSOR_TYPE Cursor);
 
 	virtual void OnDraw() { }
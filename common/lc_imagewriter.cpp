@@ -0,0 +1,74 @@
+#include "lc_global.h"
+#include "lc_imagewriter.h"
+
+#define LC_IMAGEWRITER_SLOTS_PER_THREAD 2
+
+class lcImageWriterTask : public QRunnable
+{
+public:
+	lcImageWriterTask(lcImageWriter* Writer, const QString& FileName, const QImage& Image)
+		: mWriter(Writer), mFileName(FileName), mImage(Image)
+	{
+	}
+
+	virtual void run()
+	{
+		QImageWriter Writer(mFileName);
+
+		if (!Writer.write(mImage))
+			mWriter->AddError(mFileName, Writer.errorString());
+
+		mImage = QImage();
+		mWriter->mFreeSlots.release();
+	}
+
+protected:
+	lcImageWriter* mWriter;
+	QString mFileName;
+	QImage mImage;
+};
+
+lcImageWriter::lcImageWriter()
+	: mFreeSlots(qMax(QThread::idealThreadCount(), 1) * LC_IMAGEWRITER_SLOTS_PER_THREAD)
+{
+	mNumErrors = 0;
+}
+
+lcImageWriter::~lcImageWriter()
+{
+	mThreadPool.waitForDone();
+}
+
+void lcImageWriter::Write(const QString& FileName, const QImage& Image)
+{
+	mFreeSlots.acquire();
+	mThreadPool.start(new lcImageWriterTask(this, FileName, Image));
+}
+
+void lcImageWriter::AddError(const QString& FileName, const QString& Error)
+{
+	QMutexLocker Lock(&mMutex);
+
+	if (!mNumErrors)
+		mErrorMessage = tr("Error writing to file '%1':\n%2").arg(FileName, Error);
+
+	mNumErrors++;
+}
+
+bool lcImageWriter::Finish(QString* ErrorMessage)
+{
+	mThreadPool.waitForDone();
+
+	QMutexLocker Lock(&mMutex);
+
+	if (!mNumErrors)
+		return true;
+
+	if (ErrorMessage)
+		*ErrorMessage = mErrorMessage;
+
+	mErrorMessage.clear();
+	mNumErrors = 0;
+
+	return false;
+}
@@ -0,0 +1,30 @@
+#ifndef _LC_IMAGEWRITER_H_
+#define _LC_IMAGEWRITER_H_
+
+// Encodes and saves images on worker threads so the next image can be drawn while the previous ones are compressed.
+// The number of images waiting to be saved is limited to keep memory use bounded when encoding is slower than drawing.
+class lcImageWriter
+{
+public:
+	lcImageWriter();
+	~lcImageWriter();
+
+	void Write(const QString& FileName, const QImage& Image);
+	void AddError(const QString& FileName, const QString& Error);
+
+	// Waits until all images are saved and returns false if any of them failed, ErrorMessage describes the first one.
+	bool Finish(QString* ErrorMessage);
+
+protected:
+	friend class lcImageWriterTask;
+
+	QThreadPool mThreadPool;
+	QSemaphore mFreeSlots;
+	QMutex mMutex;
+	QString mErrorMessage;
+	int mNumErrors;
+
+	Q_DECLARE_TR_FUNCTIONS(lcImageWriter);
+};
+
+#endif // _LC_IMAGEWRITER_H_
@@ -9,21 +9,72 @@
 #include "lc_application.h"
 #include "lc_mainwindow.h"
 #include "project.h"
+#include "lc_meshoptimizer.h"
+#include "lc_profile.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <ctype.h>
 #include <locale.h>
+#ifdef Q_OS_MAC
+#include <xlocale.h>
+#endif
 
-#define LC_LIBRARY_CACHE_VERSION   0x0104
+#define LC_LIBRARY_CACHE_VERSION   0x0108
 #define LC_LIBRARY_CACHE_ARCHIVE   0x0001
 #define LC_LIBRARY_CACHE_DIRECTORY 0x0002
 
+// Switches the calling thread to the C numeric locale while LDraw files are parsed, pieces can be read by several
+// threads so the global locale can't be changed.
+class lcNumericLocale
+{
+public:
+#ifdef Q_OS_WIN
+	lcNumericLocale()
+	{
+		mThreadLocale = _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+		const char* OldLocale = setlocale(LC_NUMERIC, NULL);
+		mOldLocale = OldLocale ? OldLocale : "C";
+		setlocale(LC_NUMERIC, "C");
+	}
+
+	~lcNumericLocale()
+	{
+		setlocale(LC_NUMERIC, mOldLocale.constData());
+		_configthreadlocale(mThreadLocale);
+	}
+
+protected:
+	int mThreadLocale;
+	QByteArray mOldLocale;
+#else
+	lcNumericLocale()
+	{
+		mLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+		mOldLocale = mLocale ? uselocale(mLocale) : (locale_t)0;
+	}
+
+	~lcNumericLocale()
+	{
+		if (!mLocale)
+			return;
+
+		uselocale(mOldLocale);
+		freelocale(mLocale);
+	}
+
+protected:
+	locale_t mLocale;
+	locale_t mOldLocale;
+#endif
+};
+
 lcPiecesLibrary::lcPiecesLibrary()
 {
 	mNumOfficialPieces = 0;
 	mLibraryPath[0] = 0;
 	mCacheFileName[0] = 0;
 	mCacheFileModifiedTime = 0;
+	memset(mArchiveCheckSum, 0, sizeof(mArchiveCheckSum));
 	mLibraryFileName[0] = 0;
 	mUnofficialFileName[0] = 0;
 	mZipFiles[LC_ZIPFILE_OFFICIAL] = NULL;
@@ -31,6 +82,10 @@ lcPiecesLibrary::lcPiecesLibrary()
 	mCacheFile = NULL;
 	mCacheFileName[0] = 0;
 	mSaveCache = false;
+	mCompactMeshes = false;
+	mVertexCacheTriangles = 0;
+	mVertexCacheMissesBefore = 0;
+	mVertexCacheMissesAfter = 0;
 }
 
 lcPiecesLibrary::~lcPiecesLibrary()
@@ -42,6 +97,17 @@ void lcPiecesLibrary::Unload()
 {
 	SaveCacheFile();
 
+	QMutexLocker Lock(&mLoadMutex);
+
+	qDeleteAll(mCompactMeshFiles);
+	mCompactMeshFiles.clear();
+	qDeleteAll(mPreloadedPieces);
+	mPreloadedPieces.clear();
+
+	mVertexCacheTriangles = 0;
+	mVertexCacheMissesBefore = 0;
+	mVertexCacheMissesAfter = 0;
+
 	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
 		delete mPieces[PieceIdx];
 	mPieces.RemoveAll();
@@ -59,10 +125,13 @@ void lcPiecesLibrary::Unload()
 	mZipFiles[LC_ZIPFILE_OFFICIAL] = NULL;
 	delete mZipFiles[LC_ZIPFILE_UNOFFICIAL];
 	mZipFiles[LC_ZIPFILE_UNOFFICIAL] = NULL;
+	memset(mArchiveCheckSum, 0, sizeof(mArchiveCheckSum));
 }
 
 void lcPiecesLibrary::RemoveTemporaryPieces()
 {
+	QMutexLocker Lock(&mLoadMutex);
+
 	for (int PieceIdx = mPieces.GetSize() - 1; PieceIdx >= 0; PieceIdx--)
 	{
 		PieceInfo* Info = mPieces[PieceIdx];
@@ -72,6 +141,7 @@ void lcPiecesLibrary::RemoveTemporaryPieces()
 
 		if (!Info->IsLoaded())
 		{
+			delete mPreloadedPieces.take(Info);
 			mPieces.RemoveIndex(PieceIdx);
 			delete Info;
 		}
@@ -80,6 +150,10 @@ void lcPiecesLibrary::RemoveTemporaryPieces()
 
 void lcPiecesLibrary::RemovePiece(PieceInfo* Info)
 {
+	QMutexLocker Lock(&mLoadMutex);
+
+	delete mCompactMeshFiles.take(Info);
+	delete mPreloadedPieces.take(Info);
 	mPieces.Remove(Info);
 	delete Info;
 }
@@ -104,6 +178,8 @@ PieceInfo* lcPiecesLibrary::FindPiece(const char* PieceName, Project* Project, b
 		PieceInfo* Info = new PieceInfo();
 
 		Info->CreatePlaceholder(PieceName);
+
+		QMutexLocker Lock(&mLoadMutex);
 		mPieces.Add(Info);
 
 		return Info;
@@ -125,6 +201,8 @@ bool lcPiecesLibrary::Load(const char* LibraryPath, const char* CachePath)
 {
 	Unload();
 
+	mCompactMeshes = lcGetPreferences().mCompactMeshes;
+
 	if (OpenArchive(LibraryPath, LC_ZIPFILE_OFFICIAL))
 	{
 		lcMemFile ColorFile;
@@ -327,6 +405,8 @@ void lcPiecesLibrary::ReadArchiveDescriptions(const char* OfficialFileName, cons
 			CheckSum[3] = (lcuint64)UnofficialStat.st_mtime;
 		}
 
+		memcpy(mArchiveCheckSum, CheckSum, sizeof(mArchiveCheckSum));
+
 		lcZipFile CacheFile;
 
 		if (CacheFile.OpenRead(mCacheFileName))
@@ -392,6 +472,23 @@ void lcPiecesLibrary::ReadArchiveDescriptions(const char* OfficialFileName, cons
 	}
 }
 
+QString lcPiecesLibrary::GetThumbnailCacheFileName(PieceInfo* Info, int ColorIndex, int Width, int Height) const
+{
+	lcuint64 Hash = 0;
+
+	for (int CheckSumIdx = 0; CheckSumIdx < 4; CheckSumIdx++)
+		Hash = Hash * 1099511628211ULL + mArchiveCheckSum[CheckSumIdx];
+
+	if (!mCacheFileName[0] || !Hash || Info->IsTemporary())
+		return QString();
+
+	QString CachePath = QFileInfo(QString::fromLocal8Bit(mCacheFileName)).absolutePath();
+	QString HashString = QString("%1").arg(Hash, 16, 16, QLatin1Char('0'));
+	QString Name = QString("%1-%2-%3x%4.png").arg(QString::fromLatin1(Info->m_strName), QString::number(lcGetColorCode(ColorIndex)), QString::number(Width), QString::number(Height));
+
+	return QString("%1/thumbnails/%2/%3").arg(CachePath, HashString, Name);
+}
+
 bool lcPiecesLibrary::OpenDirectory(const char* Path)
 {
 	char FileName[LC_MAXPATH];
@@ -631,6 +728,8 @@ bool lcPiecesLibrary::OpenCache()
 	if (stat(mCacheFileName, &CacheStat) != 0 || mCacheFileModifiedTime != (lcuint64)CacheStat.st_mtime)
 		return false;
 
+	QMutexLocker Lock(&mLoadMutex);
+
 	mCacheFile = new lcZipFile;
 
 	if (!mCacheFile->OpenRead(mCacheFileName))
@@ -646,8 +745,10 @@ bool lcPiecesLibrary::OpenCache()
 
 void lcPiecesLibrary::CloseCache()
 {
+	mLoadMutex.lock();
 	delete mCacheFile;
 	mCacheFile = NULL;
+	mLoadMutex.unlock();
 
 	SaveCacheFile();
 }
@@ -684,49 +785,30 @@ bool lcPiecesLibrary::LoadCacheIndex(lcZipFile& CacheFile)
 	return true;
 }
 
-bool lcPiecesLibrary::LoadCachePiece(PieceInfo* Info)
+bool lcPiecesLibrary::ReadCachePiece(PieceInfo* Info, lcMemFile& PieceFile)
 {
 	if ((Info->mFlags & LC_PIECE_CACHED) == 0)
 		return false;
 
 	if (mCacheFile)
-	{
-		lcMemFile PieceFile;
-
-		if (!mCacheFile->ExtractFile(Info->m_strName, PieceFile))
-			return false;
-
-		lcMesh* Mesh = new lcMesh;
-		Info->SetMesh(Mesh);
+		return mCacheFile->ExtractFile(Info->m_strName, PieceFile);
 
-		return Mesh->FileLoad(PieceFile);
-	}
-	else
-	{
-		struct stat CacheStat;
-
-		if (stat(mCacheFileName, &CacheStat) != 0 || mCacheFileModifiedTime != (lcuint64)CacheStat.st_mtime)
-			return false;
-
-		lcZipFile CacheFile;
-
-		if (!CacheFile.OpenRead(mCacheFileName))
-			return false;
+	struct stat CacheStat;
 
-		lcMemFile PieceFile;
+	if (stat(mCacheFileName, &CacheStat) != 0 || mCacheFileModifiedTime != (lcuint64)CacheStat.st_mtime)
+		return false;
 
-		if (!CacheFile.ExtractFile(Info->m_strName, PieceFile))
-			return false;
+	lcZipFile CacheFile;
 
-		lcMesh* Mesh = new lcMesh;
-		Info->SetMesh(Mesh);
+	if (!CacheFile.OpenRead(mCacheFileName))
+		return false;
 
-		return Mesh->FileLoad(PieceFile);
-	}
+	return CacheFile.ExtractFile(Info->m_strName, PieceFile);
 }
 
 void lcPiecesLibrary::SaveCacheFile()
 {
+	QMutexLocker Lock(&mLoadMutex);
 	struct stat CacheStat;
 	lcZipFile CacheFile;
 
@@ -784,8 +866,12 @@ void lcPiecesLibrary::SaveCacheFile()
 
 		bool Cached = (Info->mFlags & LC_PIECE_CACHED) != 0;
 		lcMesh* Mesh = Info->GetMesh();
+		lcMemFile* MeshFile = mCompactMeshFiles.value(Info);
+
+		if (Mesh && Mesh->mQuantized && !MeshFile)
+			Mesh = NULL;
 
-		if (Mesh)
+		if (Mesh || MeshFile)
 			Info->mFlags |= LC_PIECE_CACHED;
 
 		int Length = strlen(Info->m_strDescription);
@@ -797,7 +883,16 @@ void lcPiecesLibrary::SaveCacheFile()
 
 		NumPieces++;
 
-		if (Cached || !Mesh)
+		if (Cached)
+			continue;
+
+		if (MeshFile)
+		{
+			CacheFile.AddFile(Info->m_strName, *MeshFile);
+			continue;
+		}
+
+		if (!Mesh)
 			continue;
 
 		lcMemFile PieceFile;
@@ -813,6 +908,8 @@ void lcPiecesLibrary::SaveCacheFile()
 
 	CacheFile.AddFile("index", IndexFile);
 
+	qDeleteAll(mCompactMeshFiles);
+	mCompactMeshFiles.clear();
 	mSaveCache = false;
 }
 
@@ -849,26 +946,94 @@ int LibraryMeshSectionCompare(lcLibraryMeshSection* const& a, lcLibraryMeshSecti
 	return a->mColor > b->mColor ? -1 : 1;
 }
 
+bool lcPiecesLibrary::PreloadPiece(PieceInfo* Info)
+{
+	QMutexLocker Lock(&mLoadMutex);
+
+	if (mPreloadedPieces.contains(Info))
+		return true;
+
+	if (Info->mFlags & (LC_PIECE_MODEL | LC_PIECE_PLACEHOLDER))
+		return false;
+
+	lcLibraryPieceData* PieceData = new lcLibraryPieceData;
+
+	if (!ReadPiece(Info, *PieceData, true))
+	{
+		delete PieceData;
+		return false;
+	}
+
+	mPreloadedPieces.insert(Info, PieceData);
+
+	return true;
+}
+
 bool lcPiecesLibrary::LoadPiece(PieceInfo* Info)
 {
-	lcLibraryMeshData MeshData;
+	lcLibraryPieceData* PieceData;
+
+	mLoadMutex.lock();
+
+	PieceData = mPreloadedPieces.take(Info);
+
+	if (!PieceData)
+	{
+		PieceData = new lcLibraryPieceData;
+
+		if (!ReadPiece(Info, *PieceData, true))
+		{
+			mLoadMutex.unlock();
+			delete PieceData;
+			return false;
+		}
+	}
+
+	mLoadMutex.unlock();
+
+	bool Loaded = CreatePiece(Info, *PieceData);
+
+	// Parse the LDraw files if the cached mesh couldn't be loaded.
+	if (!Loaded && PieceData->Cached)
+	{
+		delete PieceData;
+		PieceData = new lcLibraryPieceData;
+
+		mLoadMutex.lock();
+		Loaded = ReadPiece(Info, *PieceData, false);
+		mLoadMutex.unlock();
+
+		if (Loaded)
+			Loaded = CreatePiece(Info, *PieceData);
+	}
+
+	delete PieceData;
+
+	return Loaded;
+}
+
+bool lcPiecesLibrary::ReadPiece(PieceInfo* Info, lcLibraryPieceData& PieceData, bool UseCache)
+{
 	lcArray<lcLibraryTextureMap> TextureStack;
 
+	PieceData.Cached = false;
+
 	if (Info->mZipFileType != LC_NUM_ZIPFILES && mZipFiles[Info->mZipFileType])
 	{
-		if (LoadCachePiece(Info))
+		if (UseCache && ReadCachePiece(Info, PieceData.CacheFile))
+		{
+			PieceData.Cached = true;
 			return true;
+		}
 
 		lcMemFile PieceFile;
 
 		if (!mZipFiles[Info->mZipFileType]->ExtractFile(Info->mZipFileIndex, PieceFile))
 			return false;
 
-		const char* OldLocale = setlocale(LC_NUMERIC, "C");
-		bool Ret = ReadMeshData(PieceFile, lcMatrix44Identity(), 16, TextureStack, MeshData);
-		setlocale(LC_NUMERIC, OldLocale);
+		lcNumericLocale NumericLocale;
 
-        if (!Ret)
+		if (!ReadMeshData(PieceFile, lcMatrix44Identity(), 16, TextureStack, PieceData.MeshData))
 			return false;
 	}
 	else
@@ -885,23 +1050,70 @@ bool lcPiecesLibrary::LoadPiece(PieceInfo* Info)
 		if (!PieceFile.Open(FileName, "rt"))
 			return false;
 
-		const char* OldLocale = setlocale(LC_NUMERIC, "C");
-		bool Ret = ReadMeshData(PieceFile, lcMatrix44Identity(), 16, TextureStack, MeshData);
-		setlocale(LC_NUMERIC, OldLocale);
+		lcNumericLocale NumericLocale;
 
-        if (!Ret)
+		if (!ReadMeshData(PieceFile, lcMatrix44Identity(), 16, TextureStack, PieceData.MeshData))
 			return false;
 	}
 
-	CreateMesh(Info, MeshData);
+	OptimizeMeshData(PieceData.MeshData);
 
-	if (mZipFiles[LC_ZIPFILE_OFFICIAL])
-		mSaveCache = true;
+	return true;
+}
+
+bool lcPiecesLibrary::CreatePiece(PieceInfo* Info, lcLibraryPieceData& PieceData)
+{
+	if (!PieceData.Cached)
+	{
+		CreateMesh(Info, PieceData.MeshData);
+
+		if (mZipFiles[LC_ZIPFILE_OFFICIAL])
+			mSaveCache = true;
+
+		return true;
+	}
+
+	lcMesh* Mesh = new lcMesh;
+
+	if (!Mesh->FileLoad(PieceData.CacheFile))
+	{
+		delete Mesh;
+		return false;
+	}
+
+	if (mCompactMeshes && !Mesh->mQuantized)
+	{
+		Mesh->Quantize();
+		Mesh->UpdateBuffers();
+	}
+
+	Info->SetMesh(Mesh);
 
 	return true;
 }
 
 void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
+{
+	lcMesh* Mesh = CreateFullPrecisionMesh(Info, MeshData);
+
+	if (mCompactMeshes)
+	{
+		if (mZipFiles[LC_ZIPFILE_OFFICIAL] && (Info->mFlags & LC_PIECE_MODEL) == 0)
+		{
+			lcMemFile* MeshFile = new lcMemFile();
+			Mesh->FileSave(*MeshFile);
+			delete mCompactMeshFiles.take(Info);
+			mCompactMeshFiles.insert(Info, MeshFile);
+		}
+
+		Mesh->Quantize();
+	}
+
+	Mesh->UpdateBuffers();
+	Info->SetMesh(Mesh);
+}
+
+lcMesh* lcPiecesLibrary::CreateFullPrecisionMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 {
 	lcMesh* Mesh = new lcMesh();
 
@@ -917,14 +1129,51 @@ void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 
 	MeshData.mSections.Sort(LibraryMeshSectionCompare);
 
-	Mesh->Create(MeshData.mSections.GetSize(), MeshData.mVertices.GetSize(), MeshData.mTexturedVertices.GetSize(), NumIndices);
+	int NumVertices = MeshData.mVertices.GetSize();
+	int NumTexturedVertices = MeshData.mTexturedVertices.GetSize();
+
+	lcArray<lcuint32> VertexRemap, TexturedVertexRemap;
+	VertexRemap.SetSize(NumVertices);
+	TexturedVertexRemap.SetSize(NumTexturedVertices);
+
+	for (int VertexIdx = 0; VertexIdx < NumVertices; VertexIdx++)
+		VertexRemap[VertexIdx] = LC_VERTEX_UNUSED;
+
+	for (int VertexIdx = 0; VertexIdx < NumTexturedVertices; VertexIdx++)
+		TexturedVertexRemap[VertexIdx] = LC_VERTEX_UNUSED;
+
+	// Store vertices in the order they are first used by the sections so they are fetched sequentially.
+	int NextVertex = 0, NextTexturedVertex = 0;
+
+	for (int SectionIdx = 0; SectionIdx < MeshData.mSections.GetSize(); SectionIdx++)
+	{
+		lcLibraryMeshSection* Section = MeshData.mSections[SectionIdx];
+
+		if (Section->mIndices.IsEmpty())
+			continue;
+
+		if (Section->mPrimitiveType == LC_MESH_TEXTURED_TRIANGLES || Section->mPrimitiveType == LC_MESH_TEXTURED_LINES)
+			NextTexturedVertex = lcOptimizeVertexOrder(&Section->mIndices[0], Section->mIndices.GetSize(), &TexturedVertexRemap[0], NextTexturedVertex);
+		else
+			NextVertex = lcOptimizeVertexOrder(&Section->mIndices[0], Section->mIndices.GetSize(), &VertexRemap[0], NextVertex);
+	}
+
+	for (int VertexIdx = 0; VertexIdx < NumVertices; VertexIdx++)
+		if (VertexRemap[VertexIdx] == LC_VERTEX_UNUSED)
+			VertexRemap[VertexIdx] = NextVertex++;
+
+	for (int VertexIdx = 0; VertexIdx < NumTexturedVertices; VertexIdx++)
+		if (TexturedVertexRemap[VertexIdx] == LC_VERTEX_UNUSED)
+			TexturedVertexRemap[VertexIdx] = NextTexturedVertex++;
+
+	Mesh->Create(MeshData.mSections.GetSize(), NumVertices, NumTexturedVertices, NumIndices);
 
 	lcVertex* DstVerts = (lcVertex*)Mesh->mVertexBuffer.mData;
 	lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-	for (int VertexIdx = 0; VertexIdx < MeshData.mVertices.GetSize(); VertexIdx++)
+	for (int VertexIdx = 0; VertexIdx < NumVertices; VertexIdx++)
 	{
-		lcVertex& DstVertex = *DstVerts++;
+		lcVertex& DstVertex = DstVerts[VertexRemap[VertexIdx]];
 
 		const lcVector3& SrcPosition = MeshData.mVertices[VertexIdx].Position;
 		lcVector3& DstPosition = DstVertex.Position;
@@ -939,11 +1188,11 @@ void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 		Max.z = lcMax(Max.z, DstPosition.z);
 	}
 
-	lcVertexTextured* DstTexturedVerts = (lcVertexTextured*)DstVerts;
+	lcVertexTextured* DstTexturedVerts = (lcVertexTextured*)(DstVerts + NumVertices);
 
-	for (int VertexIdx = 0; VertexIdx < MeshData.mTexturedVertices.GetSize(); VertexIdx++)
+	for (int VertexIdx = 0; VertexIdx < NumTexturedVertices; VertexIdx++)
 	{
-		lcVertexTextured& DstVertex = *DstTexturedVerts++;
+		lcVertexTextured& DstVertex = DstTexturedVerts[TexturedVertexRemap[VertexIdx]];
 		lcVertexTextured& SrcVertex = MeshData.mTexturedVertices[VertexIdx];
 
 		const lcVector3& SrcPosition = SrcVertex.Position;
@@ -973,6 +1222,8 @@ void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 	{
 		lcMeshSection& DstSection = Mesh->mSections[SectionIdx];
 		lcLibraryMeshSection* SrcSection = MeshData.mSections[SectionIdx];
+		bool Textured = (SrcSection->mPrimitiveType == LC_MESH_TEXTURED_TRIANGLES || SrcSection->mPrimitiveType == LC_MESH_TEXTURED_LINES);
+		const lcArray<lcuint32>& Remap = Textured ? TexturedVertexRemap : VertexRemap;
 
 		DstSection.ColorIndex = SrcSection->mColor;
 		DstSection.PrimitiveType = (SrcSection->mPrimitiveType == LC_MESH_TRIANGLES || SrcSection->mPrimitiveType == LC_MESH_TEXTURED_TRIANGLES) ? GL_TRIANGLES : GL_LINES;
@@ -989,7 +1240,7 @@ void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 			lcuint16* Index = (lcuint16*)Mesh->mIndexBuffer.mData + NumIndices;
 
 			for (int IndexIdx = 0; IndexIdx < DstSection.NumIndices; IndexIdx++)
-				*Index++ = SrcSection->mIndices[IndexIdx];
+				*Index++ = Remap[SrcSection->mIndices[IndexIdx]];
 		}
 		else
 		{
@@ -998,7 +1249,7 @@ void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 			lcuint32* Index = (lcuint32*)Mesh->mIndexBuffer.mData + NumIndices;
 
 			for (int IndexIdx = 0; IndexIdx < DstSection.NumIndices; IndexIdx++)
-				*Index++ = SrcSection->mIndices[IndexIdx];
+				*Index++ = Remap[SrcSection->mIndices[IndexIdx]];
 		}
 
 		if (DstSection.PrimitiveType == GL_TRIANGLES)
@@ -1019,8 +1270,95 @@ void lcPiecesLibrary::CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData)
 		NumIndices += DstSection.NumIndices;
 	}
 
-	Mesh->UpdateBuffers();
-	Info->SetMesh(Mesh);
+	// The BVH is built from full precision positions so it can be stored in the cache with the mesh.
+	Mesh->BuildTriangleBVH();
+
+	return Mesh;
+}
+
+lcMesh* lcPiecesLibrary::LoadFullPrecisionMesh(PieceInfo* Info)
+{
+	lcMesh* Mesh = Info->GetMesh();
+
+	if (!Mesh || !Mesh->mQuantized)
+		return NULL;
+
+	lcMemFile* MeshFile = mCompactMeshFiles.value(Info);
+	lcLibraryPieceData PieceData;
+
+	if (!MeshFile)
+	{
+		mLoadMutex.lock();
+		bool Read = ReadPiece(Info, PieceData, true);
+		mLoadMutex.unlock();
+
+		if (!Read)
+			return NULL;
+
+		if (!PieceData.Cached)
+		{
+			Mesh = CreateFullPrecisionMesh(Info, PieceData.MeshData);
+
+			// The textures stay referenced by the quantized mesh, the copy doesn't keep them like the meshes read from files.
+			for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
+				if (Mesh->mSections[SectionIdx].Texture)
+					Mesh->mSections[SectionIdx].Texture->Release();
+
+			return Mesh;
+		}
+
+		MeshFile = &PieceData.CacheFile;
+	}
+
+	MeshFile->Seek(0, SEEK_SET);
+	Mesh = new lcMesh();
+
+	if (!Mesh->FileLoad(*MeshFile) || Mesh->mQuantized)
+	{
+		delete Mesh;
+		return NULL;
+	}
+
+	return Mesh;
+}
+
+void lcPiecesLibrary::OptimizeMeshData(lcLibraryMeshData& MeshData)
+{
+	for (int SectionIdx = 0; SectionIdx < MeshData.mSections.GetSize(); SectionIdx++)
+	{
+		lcLibraryMeshSection* Section = MeshData.mSections[SectionIdx];
+		int NumVertices;
+
+		if (Section->mPrimitiveType == LC_MESH_TRIANGLES)
+			NumVertices = MeshData.mVertices.GetSize();
+		else if (Section->mPrimitiveType == LC_MESH_TEXTURED_TRIANGLES)
+			NumVertices = MeshData.mTexturedVertices.GetSize();
+		else
+			continue;
+
+		int NumIndices = Section->mIndices.GetSize();
+
+		if (!NumIndices)
+			continue;
+
+		lcuint32* Indices = &Section->mIndices[0];
+
+		mVertexCacheTriangles += NumIndices / 3;
+		mVertexCacheMissesBefore += lcGetVertexCacheMisses(Indices, NumIndices, NumVertices, LC_VERTEX_CACHE_FIFO_SIZE);
+
+		lcOptimizeTriangleOrder(Indices, NumIndices, NumVertices);
+
+		mVertexCacheMissesAfter += lcGetVertexCacheMisses(Indices, NumIndices, NumVertices, LC_VERTEX_CACHE_FIFO_SIZE);
+	}
+}
+
+void lcPiecesLibrary::PrintVertexCacheStats() const
+{
+	if (!mVertexCacheTriangles)
+		return;
+
+	printf("Vertex cache ACMR: %.3f before, %.3f after optimization (%llu triangles).\n", (double)mVertexCacheMissesBefore / mVertexCacheTriangles,
+	       (double)mVertexCacheMissesAfter / mVertexCacheTriangles, (unsigned long long)mVertexCacheTriangles);
 }
 
 bool lcPiecesLibrary::LoadTexture(lcTexture* Texture)
@@ -1036,9 +1374,13 @@ bool lcPiecesLibrary::LoadTexture(lcTexture* Texture)
 
 		sprintf(FileName, "ldraw/parts/textures/%s.png", Name);
 
-		if (!mZipFiles[LC_ZIPFILE_UNOFFICIAL] || !mZipFiles[LC_ZIPFILE_UNOFFICIAL]->ExtractFile(FileName, TextureFile))
-			if (!mZipFiles[LC_ZIPFILE_OFFICIAL]->ExtractFile(FileName, TextureFile))
-				return false;
+		{
+			QMutexLocker Lock(&mLoadMutex);
+
+			if (!mZipFiles[LC_ZIPFILE_UNOFFICIAL] || !mZipFiles[LC_ZIPFILE_UNOFFICIAL]->ExtractFile(FileName, TextureFile))
+				if (!mZipFiles[LC_ZIPFILE_OFFICIAL]->ExtractFile(FileName, TextureFile))
+					return false;
+		}
 
 		if (!Texture->Load(TextureFile))
 			return false;
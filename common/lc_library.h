@@ -4,6 +4,7 @@
 #include "lc_mesh.h"
 #include "lc_math.h"
 #include "lc_array.h"
+#include "lc_file.h"
 #include "str.h"
 
 class PieceInfo;
@@ -110,6 +111,14 @@ public:
 	lcLibraryMeshData mMeshData;
 };
 
+// Data read from the library for a piece, either its entry in the cache or the mesh parsed from its LDraw files.
+struct lcLibraryPieceData
+{
+	bool Cached;
+	lcMemFile CacheFile;
+	lcLibraryMeshData MeshData;
+};
+
 class lcPiecesLibrary
 {
 public:
@@ -125,12 +134,23 @@ public:
 	bool LoadPiece(PieceInfo* Info);
 	bool LoadBuiltinPieces();
 
+	// Reads the files of a piece so a later call to LoadPiece only has to create its mesh, can be called from any thread.
+	bool PreloadPiece(PieceInfo* Info);
+
+	// Reads the mesh of a piece again when it was quantized to save memory, returns NULL if it wasn't or can't be read.
+	// Exporters use the copy so files don't lose precision, the caller deletes it.
+	lcMesh* LoadFullPrecisionMesh(PieceInfo* Info);
+
 	lcTexture* FindTexture(const char* TextureName);
 	bool LoadTexture(lcTexture* Texture);
 
 	bool OpenCache();
 	void CloseCache();
 
+	// Returns where an image of a piece drawn with the given color and size is cached. Images are kept in a folder for
+	// each version of the library next to the library cache, the name is empty if the library isn't an archive.
+	QString GetThumbnailCacheFileName(PieceInfo* Info, int ColorIndex, int Width, int Height) const;
+
 	bool PieceInCategory(PieceInfo* Info, const String& CategoryKeywords) const;
 	void SearchPieces(const char* Keyword, lcArray<PieceInfo*>& Pieces) const;
 	void GetCategoryEntries(int CategoryIndex, bool GroupPieces, lcArray<PieceInfo*>& SinglePieces, lcArray<PieceInfo*>& GroupedPieces);
@@ -150,6 +170,11 @@ public:
 
 	bool ReadMeshData(lcFile& File, const lcMatrix44& CurrentTransform, lcuint32 CurrentColorCode, lcArray<lcLibraryTextureMap>& TextureStack, lcLibraryMeshData& MeshData);
 	void CreateMesh(PieceInfo* Info, lcLibraryMeshData& MeshData);
+	lcMesh* CreateFullPrecisionMesh(PieceInfo* Info, lcLibraryMeshData& MeshData);
+	void OptimizeMeshData(lcLibraryMeshData& MeshData);
+
+	// Prints the average cache miss ratio of the meshes optimized since the library was loaded.
+	void PrintVertexCacheStats() const;
 
 	lcArray<PieceInfo*> mPieces;
 	lcArray<lcLibraryPrimitive*> mPrimitives;
@@ -159,6 +184,9 @@ public:
 
 	char mLibraryPath[LC_MAXPATH];
 
+	// Held while the library files are read or the piece list is changed, pieces can be preloaded by worker threads.
+	QMutex mLoadMutex;
+
 protected:
 	bool OpenArchive(const char* FileName, lcZipFileType ZipFileType);
 	bool OpenArchive(lcFile* File, const char* FileName, lcZipFileType ZipFileType);
@@ -166,16 +194,30 @@ protected:
 	void ReadArchiveDescriptions(const char* OfficialFileName, const char* UnofficialFileName, const char* CachePath);
 
 	bool LoadCacheIndex(lcZipFile& CacheFile);
-	bool LoadCachePiece(PieceInfo* Info);
+	bool ReadCachePiece(PieceInfo* Info, lcMemFile& PieceFile);
 	void SaveCacheFile();
 
+	bool ReadPiece(PieceInfo* Info, lcLibraryPieceData& PieceData, bool UseCache);
+	bool CreatePiece(PieceInfo* Info, lcLibraryPieceData& PieceData);
+
 	int FindPrimitiveIndex(const char* Name) const;
 	bool LoadPrimitive(int PrimitiveIndex);
 
 	char mCacheFileName[LC_MAXPATH];
 	lcuint64 mCacheFileModifiedTime;
+	lcuint64 mArchiveCheckSum[4];
 	lcZipFile* mCacheFile;
 	bool mSaveCache;
+	bool mCompactMeshes;
+
+	// Full precision copies of the meshes quantized since the cache was saved, the cache never stores quantized meshes.
+	QHash<PieceInfo*, lcMemFile*> mCompactMeshFiles;
+
+	QHash<PieceInfo*, lcLibraryPieceData*> mPreloadedPieces;
+
+	lcuint64 mVertexCacheTriangles;
+	lcuint64 mVertexCacheMissesBefore;
+	lcuint64 mVertexCacheMissesAfter;
 
 	char mLibraryFileName[LC_MAXPATH];
 	char mUnofficialFileName[LC_MAXPATH];
@@ -251,6 +251,7 @@ void lcMainWindow::CreateMenus()
 	ExportMenu->addAction(mActions[LC_FILE_EXPORT_3DS]);
 	ExportMenu->addAction(mActions[LC_FILE_EXPORT_BRICKLINK]);
 	ExportMenu->addAction(mActions[LC_FILE_EXPORT_CSV]);
+	ExportMenu->addAction(mActions[LC_FILE_EXPORT_GLTF]);
 	ExportMenu->addAction(mActions[LC_FILE_EXPORT_HTML]);
 	ExportMenu->addAction(mActions[LC_FILE_EXPORT_POVRAY]);
 	ExportMenu->addAction(mActions[LC_FILE_EXPORT_WAVEFRONT]);
@@ -1837,6 +1838,10 @@ void lcMainWindow::HandleCommand(lcCommandId CommandId)
 		lcGetActiveProject()->ExportCSV();
 		break;
 
+	case LC_FILE_EXPORT_GLTF:
+		lcGetActiveProject()->ExportGLTF(QString(), false);
+		break;
+
 	case LC_FILE_EXPORT_POVRAY:
 		lcGetActiveProject()->ExportPOVRay();
 		break;
@@ -836,16 +836,8 @@ inline lcMatrix44 lcMatrix44LookAt(const lcVector3& Eye, const lcVector3& Target
 	return m;
 }
 
-inline lcMatrix44 lcMatrix44Perspective(float FoVy, float Aspect, float Near, float Far)
+inline lcMatrix44 lcMatrix44Frustum(float Left, float Right, float Bottom, float Top, float Near, float Far)
 {
-	float Left, Right, Bottom, Top;
-
-	Top = Near * (float)tan(FoVy * LC_PI / 360.0f);
-	Bottom = -Top;
-
-	Left = Bottom * Aspect;
-	Right = Top * Aspect;
-
 	if ((Near <= 0.0f) || (Far <= 0.0f) || (Near == Far) || (Left == Right) || (Top == Bottom))
 		return lcMatrix44Identity();
 
@@ -868,6 +860,14 @@ inline lcMatrix44 lcMatrix44Perspective(float FoVy, float Aspect, float Near, fl
 	return m;
 }
 
+inline lcMatrix44 lcMatrix44Perspective(float FoVy, float Aspect, float Near, float Far)
+{
+	float Top = Near * (float)tan(FoVy * LC_PI / 360.0f);
+	float Right = Top * Aspect;
+
+	return lcMatrix44Frustum(-Right, Right, -Top, Top, Near, Far);
+}
+
 inline lcMatrix44 lcMatrix44Ortho(float Left, float Right, float Bottom, float Top, float Near, float Far)
 {
 	lcMatrix44 m;
@@ -1453,56 +1453,6 @@ inline bool lcLinePlaneIntersection(lcVector3* Intersection, const lcVector3& St
 	return true;
 }
 
-inline bool lcLineTriangleMinIntersection(const lcVector3& p1, const lcVector3& p2, const lcVector3& p3, const lcVector3& Start, const lcVector3& End, float* MinDist, lcVector3* Intersection)
-{
-	// Calculate the polygon plane.
-	lcVector3 PlaneNormal = lcCross(p1 - p2, p3 - p2);
-	float PlaneD = -lcDot(PlaneNormal, p1);
-
-	// Check if the line is parallel to the plane.
-	lcVector3 Dir = End - Start;
-
-	float t1 = lcDot(PlaneNormal, Start) + PlaneD;
-	float t2 = lcDot(PlaneNormal, Dir);
-
-	if (t2 == 0)
-		return false;
-
-	float t = -(t1 / t2);
-
-	if (t < 0)
-		return false;
-
-	// Intersection of the plane and line segment.
-	*Intersection = Start - (t1 / t2) * Dir;
-
-	float Dist = lcLength(Start - *Intersection);
-
-	if (Dist > *MinDist)
-		return false;
-
-	// Check if we're inside the triangle.
-	lcVector3 pa1, pa2, pa3;
-	pa1 = lcNormalize(p1 - *Intersection);
-	pa2 = lcNormalize(p2 - *Intersection);
-	pa3 = lcNormalize(p3 - *Intersection);
-
-	float a1, a2, a3;
-	a1 = lcDot(pa1, pa2);
-	a2 = lcDot(pa2, pa3);
-	a3 = lcDot(pa3, pa1);
-
-	float total = (acosf(a1) + acosf(a2) + acosf(a3)) * LC_RTOD;
-
-	if (fabs(total - 360) <= 0.001f)
-	{
-		*MinDist = Dist;
-		return true;
-	}
-
-	return false;
-}
-
 // Sutherland-Hodgman method of clipping a polygon to a plane.
 inline void lcPolygonPlaneClip(lcVector3* InPoints, int NumInPoints, lcVector3* OutPoints, int* NumOutPoints, const lcVector4& Plane)
 {
@@ -1737,6 +1687,36 @@ float LinePointMinDistance(const Vector3& Point, const Vector3& Start, const Vec
 	return Length(Closest - Point);
 }
 */
+// Returns false if a box with the given local bounds and world matrix is completely outside one of the planes.
+inline bool lcBoundingBoxIntersectsFrustum(const lcVector3& Min, const lcVector3& Max, const lcMatrix44& WorldMatrix, const lcVector4 Planes[6])
+{
+	lcVector3 Center = lcMul31((Min + Max) * 0.5f, WorldMatrix);
+	lcVector3 LocalExtents = (Max - Min) * 0.5f;
+	lcVector3 Extents;
+
+	for (int Axis = 0; Axis < 3; Axis++)
+		Extents[Axis] = fabsf(WorldMatrix[0][Axis]) * LocalExtents[0] + fabsf(WorldMatrix[1][Axis]) * LocalExtents[1] + fabsf(WorldMatrix[2][Axis]) * LocalExtents[2];
+
+	// Compute all plane distances before testing them so the loop has no early exits.
+	float Distances[6];
+	float Radii[6];
+
+	for (int PlaneIdx = 0; PlaneIdx < 6; PlaneIdx++)
+	{
+		const lcVector4& Plane = Planes[PlaneIdx];
+
+		Distances[PlaneIdx] = Center[0] * Plane[0] + Center[1] * Plane[1] + Center[2] * Plane[2] + Plane[3];
+		Radii[PlaneIdx] = Extents[0] * fabsf(Plane[0]) + Extents[1] * fabsf(Plane[1]) + Extents[2] * fabsf(Plane[2]);
+	}
+
+	int Outside = 0;
+
+	for (int PlaneIdx = 0; PlaneIdx < 6; PlaneIdx++)
+		Outside |= Distances[PlaneIdx] > Radii[PlaneIdx];
+
+	return !Outside;
+}
+
 // Returns true if the axis aligned box intersects the volume defined by planes.
 inline bool lcBoundingBoxIntersectsVolume(const lcVector3& Min, const lcVector3& Max, const lcVector4 Planes[6])
 {
@@ -6,6 +6,10 @@
 #include "lc_math.h"
 #include "lc_application.h"
 #include "lc_library.h"
+#include "lc_bvh.h"
+#include "lc_simd.h"
+
+#define LC_MESH_BVH_TEXTURED 0x80000000
 
 lcMesh* gPlaceholderMesh;
 
@@ -16,21 +20,29 @@ lcMesh::lcMesh()
 	mNumVertices = 0;
 	mNumTexturedVertices = 0;
 	mIndexType = 0;
+	mQuantized = false;
+	mPositionOffset = lcVector3(0.0f, 0.0f, 0.0f);
+	mPositionScale = lcVector3(1.0f, 1.0f, 1.0f);
+	mTexCoordOffset = lcVector2(0.0f, 0.0f);
+	mTexCoordScale = lcVector2(1.0f, 1.0f);
+	mTriangleBVH = NULL;
 }
 
 lcMesh::~lcMesh()
 {
 	delete[] mSections;
+	delete mTriangleBVH;
 }
 
-void lcMesh::Create(int NumSections, int NumVertices, int NumTexturedVertices, int NumIndices)
+void lcMesh::Create(int NumSections, int NumVertices, int NumTexturedVertices, int NumIndices, bool Quantized)
 {
 	mSections = new lcMeshSection[NumSections];
 	mNumSections = NumSections;
 
 	mNumVertices = NumVertices;
 	mNumTexturedVertices = NumTexturedVertices;
-	mVertexBuffer.SetSize(NumVertices * sizeof(lcVertex) + NumTexturedVertices * sizeof(lcVertexTextured));
+	mQuantized = Quantized;
+	mVertexBuffer.SetSize(NumVertices * GetVertexSize() + NumTexturedVertices * GetTexturedVertexSize());
 
 	if (NumVertices < 0x10000 && NumTexturedVertices < 0x10000)
 	{
@@ -107,11 +119,130 @@ void lcMesh::CreateBox()
 	UpdateBuffers();
 }
 
+void lcMesh::Quantize()
+{
+	if (mQuantized || (!mNumVertices && !mNumTexturedVertices))
+		return;
+
+	lcVertex* Verts = (lcVertex*)mVertexBuffer.mData;
+	lcVertexTextured* TexturedVerts = (lcVertexTextured*)(Verts + mNumVertices);
+	lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	lcVector2 TexCoordMin(FLT_MAX, FLT_MAX), TexCoordMax(-FLT_MAX, -FLT_MAX);
+
+	for (int VertexIdx = 0; VertexIdx < mNumVertices; VertexIdx++)
+	{
+		const lcVector3& Position = Verts[VertexIdx].Position;
+
+		Min.x = lcMin(Min.x, Position.x);
+		Min.y = lcMin(Min.y, Position.y);
+		Min.z = lcMin(Min.z, Position.z);
+		Max.x = lcMax(Max.x, Position.x);
+		Max.y = lcMax(Max.y, Position.y);
+		Max.z = lcMax(Max.z, Position.z);
+	}
+
+	for (int VertexIdx = 0; VertexIdx < mNumTexturedVertices; VertexIdx++)
+	{
+		const lcVector3& Position = TexturedVerts[VertexIdx].Position;
+		const lcVector2& TexCoord = TexturedVerts[VertexIdx].TexCoord;
+
+		Min.x = lcMin(Min.x, Position.x);
+		Min.y = lcMin(Min.y, Position.y);
+		Min.z = lcMin(Min.z, Position.z);
+		Max.x = lcMax(Max.x, Position.x);
+		Max.y = lcMax(Max.y, Position.y);
+		Max.z = lcMax(Max.z, Position.z);
+
+		TexCoordMin.x = lcMin(TexCoordMin.x, TexCoord.x);
+		TexCoordMin.y = lcMin(TexCoordMin.y, TexCoord.y);
+		TexCoordMax.x = lcMax(TexCoordMax.x, TexCoord.x);
+		TexCoordMax.y = lcMax(TexCoordMax.y, TexCoord.y);
+	}
+
+	// Map the bounding box to [-32767, 32767] on each axis.
+	mPositionOffset = (Min + Max) * 0.5f;
+	mPositionScale = (Max - Min) * (0.5f / 32767.0f);
+
+	for (int Axis = 0; Axis < 3; Axis++)
+		if (mPositionScale[Axis] == 0.0f)
+			mPositionScale[Axis] = 1.0f;
+
+	if (mNumTexturedVertices)
+	{
+		mTexCoordOffset = lcVector2((TexCoordMin.x + TexCoordMax.x) * 0.5f, (TexCoordMin.y + TexCoordMax.y) * 0.5f);
+		mTexCoordScale = lcVector2((TexCoordMax.x - TexCoordMin.x) * (0.5f / 32767.0f), (TexCoordMax.y - TexCoordMin.y) * (0.5f / 32767.0f));
+
+		for (int Axis = 0; Axis < 2; Axis++)
+			if (mTexCoordScale[Axis] == 0.0f)
+				mTexCoordScale[Axis] = 1.0f;
+	}
+
+	void* FloatData = mVertexBuffer.mData;
+	mVertexBuffer.mData = NULL;
+	mQuantized = true;
+	mVertexBuffer.SetSize(mNumVertices * sizeof(lcVertexQuantized) + mNumTexturedVertices * sizeof(lcVertexTexturedQuantized));
+
+	lcVertexQuantized* DstVerts = (lcVertexQuantized*)mVertexBuffer.mData;
+
+	for (int VertexIdx = 0; VertexIdx < mNumVertices; VertexIdx++)
+	{
+		const lcVector3& Position = ((lcVertex*)FloatData)[VertexIdx].Position;
+		lcVertexQuantized& DstVertex = DstVerts[VertexIdx];
+
+		for (int Axis = 0; Axis < 3; Axis++)
+			DstVertex.Position[Axis] = (lcint16)lcClamp(floorf((Position[Axis] - mPositionOffset[Axis]) / mPositionScale[Axis] + 0.5f), -32767.0f, 32767.0f);
+		DstVertex.Padding = 0;
+	}
+
+	lcVertexTextured* SrcTexturedVerts = (lcVertexTextured*)((lcVertex*)FloatData + mNumVertices);
+	lcVertexTexturedQuantized* DstTexturedVerts = (lcVertexTexturedQuantized*)(DstVerts + mNumVertices);
+
+	for (int VertexIdx = 0; VertexIdx < mNumTexturedVertices; VertexIdx++)
+	{
+		const lcVertexTextured& SrcVertex = SrcTexturedVerts[VertexIdx];
+		lcVertexTexturedQuantized& DstVertex = DstTexturedVerts[VertexIdx];
+
+		for (int Axis = 0; Axis < 3; Axis++)
+			DstVertex.Position[Axis] = (lcint16)lcClamp(floorf((SrcVertex.Position[Axis] - mPositionOffset[Axis]) / mPositionScale[Axis] + 0.5f), -32767.0f, 32767.0f);
+		DstVertex.Padding = 0;
+
+		for (int Axis = 0; Axis < 2; Axis++)
+			DstVertex.TexCoord[Axis] = (lcint16)lcClamp(floorf((SrcVertex.TexCoord[Axis] - mTexCoordOffset[Axis]) / mTexCoordScale[Axis] + 0.5f), -32767.0f, 32767.0f);
+	}
+
+	free(FloatData);
+
+	// A BVH built from the full precision positions doesn't bound the quantized triangles, it's rebuilt in memory when needed.
+	delete mTriangleBVH;
+	mTriangleBVH = NULL;
+	mBVHTriangles.RemoveAll();
+}
+
 template<typename IndexType>
-bool lcMesh::MinIntersectDist(const lcVector3& Start, const lcVector3& End, float& MinDist, lcVector3& Intersection)
+void lcMesh::GetBVHTriangle(lcuint32 Triangle, lcVector3& v1, lcVector3& v2, lcVector3& v3) const
 {
-	float* Verts = (float*)mVertexBuffer.mData;
-	bool Hit = false;
+	IndexType* Indices = (IndexType*)mIndexBuffer.mData + (Triangle & ~LC_MESH_BVH_TEXTURED);
+
+	if (Triangle & LC_MESH_BVH_TEXTURED)
+	{
+		v1 = GetTexturedVertexPosition(Indices[0]);
+		v2 = GetTexturedVertexPosition(Indices[1]);
+		v3 = GetTexturedVertexPosition(Indices[2]);
+	}
+	else
+	{
+		v1 = GetVertexPosition(Indices[0]);
+		v2 = GetVertexPosition(Indices[1]);
+		v3 = GetVertexPosition(Indices[2]);
+	}
+}
+
+template<typename IndexType>
+void lcMesh::BuildTriangleBVH()
+{
+	lcArray<lcBVHBounds> TriangleBounds;
+
+	mBVHTriangles.RemoveAll();
 
 	for (int SectionIdx = 0; SectionIdx < mNumSections; SectionIdx++)
 	{
@@ -120,20 +251,92 @@ bool lcMesh::MinIntersectDist(const lcVector3& Start, const lcVector3& End, floa
 		if (Section->PrimitiveType != GL_TRIANGLES)
 			continue;
 
-		IndexType* Indices = (IndexType*)mIndexBuffer.mData + Section->IndexOffset / sizeof(IndexType);
+		lcuint32 FirstIndex = Section->IndexOffset / sizeof(IndexType);
+		lcuint32 Flags = Section->Texture ? LC_MESH_BVH_TEXTURED : 0;
 
 		for (int Idx = 0; Idx < Section->NumIndices; Idx += 3)
 		{
-			float* p1 = Verts + Indices[Idx + 0] * 3;
-			float* p2 = Verts + Indices[Idx + 1] * 3;
-			float* p3 = Verts + Indices[Idx + 2] * 3;
-			lcVector3 v1(p1[0], p1[1], p1[2]);
-			lcVector3 v2(p2[0], p2[1], p2[2]);
-			lcVector3 v3(p3[0], p3[1], p3[2]);
-
-			if (lcLineTriangleMinIntersection(v1, v2, v3, Start, End, &MinDist, &Intersection))
-				Hit = true;
+			lcuint32 Triangle = (FirstIndex + Idx) | Flags;
+			lcVector3 v1, v2, v3;
+
+			GetBVHTriangle<IndexType>(Triangle, v1, v2, v3);
+
+			lcBVHBounds& Bounds = TriangleBounds.Add();
+			Bounds.Min = lcVector3(lcMin(v1.x, lcMin(v2.x, v3.x)), lcMin(v1.y, lcMin(v2.y, v3.y)), lcMin(v1.z, lcMin(v2.z, v3.z)));
+			Bounds.Max = lcVector3(lcMax(v1.x, lcMax(v2.x, v3.x)), lcMax(v1.y, lcMax(v2.y, v3.y)), lcMax(v1.z, lcMax(v2.z, v3.z)));
+
+			mBVHTriangles.Add(Triangle);
+		}
+	}
+
+	mTriangleBVH = new lcBVH();
+	mTriangleBVH->Build(TriangleBounds);
+}
+
+void lcMesh::BuildTriangleBVH()
+{
+	if (mTriangleBVH)
+		return;
+
+	if (mIndexType == GL_UNSIGNED_SHORT)
+		BuildTriangleBVH<GLushort>();
+	else
+		BuildTriangleBVH<GLuint>();
+}
+
+template<typename IndexType>
+void lcMesh::AddTrianglePackets(lcArray<lcTrianglePacket>& Packets)
+{
+	for (int TriangleIdx = 0; TriangleIdx < mBVHTriangles.GetSize(); TriangleIdx += LC_TRIANGLE_PACKET_SIZE)
+	{
+		lcTrianglePacket& Packet = Packets.Add();
+		memset(&Packet, 0, sizeof(Packet));
+		Packet.NumTriangles = lcMin(mBVHTriangles.GetSize() - TriangleIdx, LC_TRIANGLE_PACKET_SIZE);
+
+		for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+		{
+			lcVector3 v1, v2, v3;
+			GetBVHTriangle<IndexType>(mBVHTriangles[TriangleIdx + Lane], v1, v2, v3);
+			lcTrianglePacketSet(Packet, Lane, v1, v2, v3);
+		}
+	}
+}
+
+// Adds the triangles of the mesh to the packets in the order of the BVH, the last packet may not be full.
+void lcMesh::AddTrianglePackets(lcArray<lcTrianglePacket>& Packets)
+{
+	BuildTriangleBVH();
+
+	if (mIndexType == GL_UNSIGNED_SHORT)
+		AddTrianglePackets<GLushort>(Packets);
+	else
+		AddTrianglePackets<GLuint>(Packets);
+}
+
+template<typename IndexType>
+bool lcMesh::MinIntersectDist(const lcVector3& Start, const lcVector3& End, float& MinDist, lcVector3& Intersection)
+{
+	lcArray<lcBVHRayHit> Hits;
+	lcTrianglePacket Packet;
+	bool Hit = false;
+
+	mTriangleBVH->RayTest(Start, End, MinDist, Hits);
+	memset(&Packet, 0, sizeof(Packet));
+
+	// Hits are sorted by the distance to their bounds so we can stop once a closer triangle has been found.
+	for (int HitIdx = 0; HitIdx < Hits.GetSize() && Hits[HitIdx].Distance <= MinDist; )
+	{
+		Packet.NumTriangles = 0;
+
+		while (HitIdx < Hits.GetSize() && Packet.NumTriangles < LC_TRIANGLE_PACKET_SIZE && Hits[HitIdx].Distance <= MinDist)
+		{
+			lcVector3 v1, v2, v3;
+			GetBVHTriangle<IndexType>(mBVHTriangles[Hits[HitIdx++].Item], v1, v2, v3);
+			lcTrianglePacketSet(Packet, Packet.NumTriangles++, v1, v2, v3);
 		}
+
+		if (lcRayTrianglePacketIntersect(Packet, Start, End, MinDist, Intersection) != -1)
+			Hit = true;
 	}
 
 	return Hit;
@@ -141,6 +344,8 @@ bool lcMesh::MinIntersectDist(const lcVector3& Start, const lcVector3& End, floa
 
 bool lcMesh::MinIntersectDist(const lcVector3& Start, const lcVector3& End, float& MinDist, lcVector3& Intersection)
 {
+	BuildTriangleBVH();
+
 	if (mIndexType == GL_UNSIGNED_SHORT)
 		return MinIntersectDist<GLushort>(Start, End, MinDist, Intersection);
 	else
@@ -150,20 +355,41 @@ bool lcMesh::MinIntersectDist(const lcVector3& Start, const lcVector3& End, floa
 template<typename IndexType>
 bool lcMesh::IntersectsPlanes(const lcVector4 Planes[6])
 {
-	float* Verts = (float*)mVertexBuffer.mData;
+	lcArray<int> Triangles;
+	lcTrianglePacket Packet;
 
-	for (int SectionIdx = 0; SectionIdx < mNumSections; SectionIdx++)
+	mTriangleBVH->BoxTest(Planes, Triangles);
+	memset(&Packet, 0, sizeof(Packet));
+
+	for (int FirstTriangle = 0; FirstTriangle < Triangles.GetSize(); FirstTriangle += LC_TRIANGLE_PACKET_SIZE)
 	{
-		lcMeshSection* Section = &mSections[SectionIdx];
+		Packet.NumTriangles = lcMin(Triangles.GetSize() - FirstTriangle, LC_TRIANGLE_PACKET_SIZE);
 
-		if (Section->PrimitiveType != GL_TRIANGLES)
-			continue;
+		for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+		{
+			lcVector3 v1, v2, v3;
+			GetBVHTriangle<IndexType>(mBVHTriangles[Triangles[FirstTriangle + Lane]], v1, v2, v3);
+			lcTrianglePacketSet(Packet, Lane, v1, v2, v3);
+		}
 
-		IndexType* Indices = (IndexType*)mIndexBuffer.mData + Section->IndexOffset / sizeof(IndexType);
+		int InsideMask, ClipMask;
+		lcTrianglePacketPlanesTest(Packet, Planes, InsideMask, ClipMask);
 
-		for (int Idx = 0; Idx < Section->NumIndices; Idx += 3)
-			if (lcTriangleIntersectsPlanes(&Verts[Indices[Idx]*3], &Verts[Indices[Idx+1]*3], &Verts[Indices[Idx+2]*3], Planes))
+		if (InsideMask)
+			return true;
+
+		// Only triangles that cross the planes without a vertex inside need to be clipped.
+		for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+		{
+			if ((ClipMask & (1 << Lane)) == 0)
+				continue;
+
+			lcVector3 v1, v2, v3;
+			GetBVHTriangle<IndexType>(mBVHTriangles[Triangles[FirstTriangle + Lane]], v1, v2, v3);
+
+			if (lcTriangleIntersectsPlanes(v1, v2, v3, Planes))
 				return true;
+		}
 	}
 
 	return false;
@@ -171,6 +397,8 @@ bool lcMesh::IntersectsPlanes(const lcVector4 Planes[6])
 
 bool lcMesh::IntersectsPlanes(const lcVector4 Planes[6])
 {
+	BuildTriangleBVH();
+
 	if (mIndexType == GL_UNSIGNED_SHORT)
 		return IntersectsPlanes<GLushort>(Planes);
 	else
@@ -185,8 +413,6 @@ void lcMesh::ExportPOVRay(lcFile& File, const char* MeshName, const char* ColorT
 	sprintf(Line, "#declare lc_%s = union {\n", MeshName);
 	File.WriteLine(Line);
 
-	float* Verts = (float*)mVertexBuffer.mData;
-
 	for (int SectionIdx = 0; SectionIdx < mNumSections; SectionIdx++)
 	{
 		lcMeshSection* Section = &mSections[SectionIdx];
@@ -200,11 +426,36 @@ void lcMesh::ExportPOVRay(lcFile& File, const char* MeshName, const char* ColorT
 
 		for (int Idx = 0; Idx < Section->NumIndices; Idx += 3)
 		{
-			sprintf(Line, "  triangle { <%.2f, %.2f, %.2f>, <%.2f, %.2f, %.2f>, <%.2f, %.2f, %.2f> }\n",
-				-Verts[Indices[Idx+0]*3+1] / 25.0f, -Verts[Indices[Idx+0]*3] / 25.0f, Verts[Indices[Idx+0]*3+2] / 25.0f,
-				-Verts[Indices[Idx+1]*3+1] / 25.0f, -Verts[Indices[Idx+1]*3] / 25.0f, Verts[Indices[Idx+1]*3+2] / 25.0f,
-				-Verts[Indices[Idx+2]*3+1] / 25.0f, -Verts[Indices[Idx+2]*3] / 25.0f, Verts[Indices[Idx+2]*3+2] / 25.0f);
-			File.WriteLine(Line);
+			char* Dest = Line;
+
+			memcpy(Dest, "  triangle { ", 13);
+			Dest += 13;
+
+			for (int Corner = 0; Corner < 3; Corner++)
+			{
+				lcVector3 v = Section->Texture ? GetTexturedVertexPosition(Indices[Idx + Corner]) : GetVertexPosition(Indices[Idx + Corner]);
+
+				if (Corner)
+				{
+					*Dest++ = ',';
+					*Dest++ = ' ';
+				}
+
+				*Dest++ = '<';
+				Dest += lcFormatFloat(Dest, -v[1] / 25.0f, 2);
+				*Dest++ = ',';
+				*Dest++ = ' ';
+				Dest += lcFormatFloat(Dest, -v[0] / 25.0f, 2);
+				*Dest++ = ',';
+				*Dest++ = ' ';
+				Dest += lcFormatFloat(Dest, v[2] / 25.0f, 2);
+				*Dest++ = '>';
+			}
+
+			memcpy(Dest, " }\n", 3);
+			Dest += 3;
+
+			File.WriteBuffer(Line, (long)(Dest - Line));
 		}
 
 		if (Section->ColorIndex != gDefaultColor)
@@ -229,6 +480,7 @@ template<typename IndexType>
 void lcMesh::ExportWavefrontIndices(lcFile& File, int DefaultColorIndex, int VertexOffset)
 {
 	char Line[1024];
+	int Length = 0;
 
 	for (int SectionIdx = 0; SectionIdx < mNumSections; SectionIdx++)
 	{
@@ -240,10 +492,10 @@ void lcMesh::ExportWavefrontIndices(lcFile& File, int DefaultColorIndex, int Ver
 		IndexType* Indices = (IndexType*)mIndexBuffer.mData + Section->IndexOffset / sizeof(IndexType);
 
 		if (Section->ColorIndex == gDefaultColor)
-			sprintf(Line, "usemtl %s\n", gColorList[DefaultColorIndex].SafeName);
+			Length = sprintf(Line, "usemtl %s\n", gColorList[DefaultColorIndex].SafeName);
 		else
-			sprintf(Line, "usemtl %s\n", gColorList[Section->ColorIndex].SafeName);
-		File.WriteLine(Line);
+			Length = sprintf(Line, "usemtl %s\n", gColorList[Section->ColorIndex].SafeName);
+		File.WriteBuffer(Line, Length);
 
 		for (int Idx = 0; Idx < Section->NumIndices; Idx += 3)
 		{
@@ -251,9 +503,24 @@ void lcMesh::ExportWavefrontIndices(lcFile& File, int DefaultColorIndex, int Ver
 			long int idx2 = Indices[Idx + 1] + VertexOffset;
 			long int idx3 = Indices[Idx + 2] + VertexOffset;
 
+			// Degenerate triangles write the previous line again, files have always been exported this way.
 			if (idx1 != idx2 && idx1 != idx3 && idx2 != idx3)
-				sprintf(Line, "f %ld %ld %ld\n", idx1, idx2, idx3);
-			File.WriteLine(Line);
+			{
+				char* Dest = Line;
+
+				*Dest++ = 'f';
+				*Dest++ = ' ';
+				Dest += lcFormatInteger(Dest, idx1);
+				*Dest++ = ' ';
+				Dest += lcFormatInteger(Dest, idx2);
+				*Dest++ = ' ';
+				Dest += lcFormatInteger(Dest, idx3);
+				*Dest++ = '\n';
+
+				Length = (int)(Dest - Line);
+			}
+
+			File.WriteBuffer(Line, Length);
 		}
 	}
 
@@ -276,10 +543,18 @@ bool lcMesh::FileLoad(lcFile& File)
 	lcuint32 NumVertices, NumTexturedVertices, NumIndices;
 	lcuint16 NumSections;
 
-	if (!File.ReadU16(&NumSections, 1) || !File.ReadU32(&NumVertices, 1) || !File.ReadU32(&NumTexturedVertices, 1) || !File.ReadU32(&NumIndices, 1))
+	lcuint8 Quantized;
+
+	if (!File.ReadU16(&NumSections, 1) || !File.ReadU32(&NumVertices, 1) || !File.ReadU32(&NumTexturedVertices, 1) || !File.ReadU32(&NumIndices, 1) || !File.ReadU8(&Quantized, 1))
 		return false;
 
-	Create(NumSections, NumVertices, NumTexturedVertices, NumIndices);
+	Create(NumSections, NumVertices, NumTexturedVertices, NumIndices, Quantized != 0);
+
+	if (mQuantized)
+	{
+		if (File.ReadFloats(mPositionOffset, 3) != 3 || File.ReadFloats(mPositionScale, 3) != 3 || File.ReadFloats(mTexCoordOffset, 2) != 2 || File.ReadFloats(mTexCoordScale, 2) != 2)
+			return false;
+	}
 
 	for (int SectionIdx = 0; SectionIdx < mNumSections; SectionIdx++)
 	{
@@ -315,12 +590,35 @@ bool lcMesh::FileLoad(lcFile& File)
 			Section.Texture = NULL;
 	}
 
-	File.ReadFloats((float*)mVertexBuffer.mData, 3 * mNumVertices + 5 * mNumTexturedVertices);
+	if (mQuantized)
+		File.ReadS16((lcint16*)mVertexBuffer.mData, mVertexBuffer.mSize / 2);
+	else
+		File.ReadFloats((float*)mVertexBuffer.mData, 3 * mNumVertices + 5 * mNumTexturedVertices);
+
 	if (mIndexType == GL_UNSIGNED_SHORT)
 		File.ReadU16((lcuint16*)mIndexBuffer.mData, mIndexBuffer.mSize / 2);
 	else
 		File.ReadU32((lcuint32*)mIndexBuffer.mData, mIndexBuffer.mSize / 4);
 
+	lcuint8 HasBVH;
+
+	if (!File.ReadU8(&HasBVH, 1))
+		return false;
+
+	if (HasBVH)
+	{
+		mTriangleBVH = new lcBVH();
+		lcuint32 NumTriangles;
+
+		if (!mTriangleBVH->FileLoad(File) || !File.ReadU32(&NumTriangles, 1))
+			return false;
+
+		mBVHTriangles.SetSize(NumTriangles);
+
+		if (NumTriangles && File.ReadU32(&mBVHTriangles[0], NumTriangles) != NumTriangles)
+			return false;
+	}
+
 	UpdateBuffers();
 
 	return true;
@@ -336,6 +634,15 @@ void lcMesh::FileSave(lcFile& File)
 	File.WriteU32(mNumVertices);
 	File.WriteU32(mNumTexturedVertices);
 	File.WriteU32(mIndexBuffer.mSize / (mIndexType == GL_UNSIGNED_SHORT ? 2 : 4));
+	File.WriteU8(mQuantized ? 1 : 0);
+
+	if (mQuantized)
+	{
+		File.WriteFloats(mPositionOffset, 3);
+		File.WriteFloats(mPositionScale, 3);
+		File.WriteFloats(mTexCoordOffset, 2);
+		File.WriteFloats(mTexCoordScale, 2);
+	}
 
 	for (int SectionIdx = 0; SectionIdx < mNumSections; SectionIdx++)
 	{
@@ -356,9 +663,24 @@ void lcMesh::FileSave(lcFile& File)
 			File.WriteU16(0);
 	}
 
-	File.WriteFloats((float*)mVertexBuffer.mData, 3 * mNumVertices + 5 * mNumTexturedVertices);
+	if (mQuantized)
+		File.WriteS16((lcint16*)mVertexBuffer.mData, mVertexBuffer.mSize / 2);
+	else
+		File.WriteFloats((float*)mVertexBuffer.mData, 3 * mNumVertices + 5 * mNumTexturedVertices);
+
 	if (mIndexType == GL_UNSIGNED_SHORT)
 		File.WriteU16((lcuint16*)mIndexBuffer.mData, mIndexBuffer.mSize / 2);
 	else
 		File.WriteU32((lcuint32*)mIndexBuffer.mData, mIndexBuffer.mSize / 4);
+
+	File.WriteU8(mTriangleBVH ? 1 : 0);
+
+	if (mTriangleBVH)
+	{
+		mTriangleBVH->FileSave(File);
+		File.WriteU32(mBVHTriangles.GetSize());
+
+		if (!mBVHTriangles.IsEmpty())
+			File.WriteU32(&mBVHTriangles[0], mBVHTriangles.GetSize());
+	}
 }
@@ -4,9 +4,10 @@
 #include <stdlib.h>
 #include "opengl.h"
 #include "lc_math.h"
+#include "lc_array.h"
 
 #define LC_MESH_FILE_ID      LC_FOURCC('M', 'E', 'S', 'H')
-#define LC_MESH_FILE_VERSION 0x0100
+#define LC_MESH_FILE_VERSION 0x0111
 
 struct lcVertex
 {
@@ -19,6 +20,20 @@ struct lcVertexTextured
 	lcVector2 TexCoord;
 };
 
+// Compact vertices store positions and texture coordinates as 16 bit values relative to the mesh bounds.
+struct lcVertexQuantized
+{
+	lcint16 Position[3];
+	lcint16 Padding;
+};
+
+struct lcVertexTexturedQuantized
+{
+	lcint16 Position[3];
+	lcint16 Padding;
+	lcint16 TexCoord[2];
+};
+
 class lcVertexBuffer
 {
 public:
@@ -127,8 +142,13 @@ public:
 	lcMesh();
 	~lcMesh();
 
-	void Create(int NumSections, int NumVertices, int NumTexturedVertices, int NumIndices);
+	void Create(int NumSections, int NumVertices, int NumTexturedVertices, int NumIndices, bool Quantized = false);
 	void CreateBox();
+	void Quantize();
+
+	template<typename IndexType>
+	void BuildTriangleBVH();
+	void BuildTriangleBVH();
 
 	bool FileLoad(lcFile& File);
 	void FileSave(lcFile& File);
@@ -149,12 +169,69 @@ public:
 	bool IntersectsPlanes(const lcVector4 Planes[6]);
 	bool IntersectsPlanes(const lcVector4 Planes[6]);
 
+	template<typename IndexType>
+	void GetBVHTriangle(lcuint32 Triangle, lcVector3& v1, lcVector3& v2, lcVector3& v3) const;
+
+	template<typename IndexType>
+	void AddTrianglePackets(lcArray<lcTrianglePacket>& Packets);
+	void AddTrianglePackets(lcArray<lcTrianglePacket>& Packets);
+
 	void UpdateBuffers()
 	{
 		mVertexBuffer.UpdateBuffer();
 		mIndexBuffer.UpdateBuffer();
 	}
 
+	int GetVertexSize() const
+	{
+		return mQuantized ? sizeof(lcVertexQuantized) : sizeof(lcVertex);
+	}
+
+	int GetTexturedVertexSize() const
+	{
+		return mQuantized ? sizeof(lcVertexTexturedQuantized) : sizeof(lcVertexTextured);
+	}
+
+	int GetTexturedVertexOffset() const
+	{
+		return mNumVertices * GetVertexSize();
+	}
+
+	lcVector3 GetVertexPosition(int VertexIndex) const
+	{
+		if (!mQuantized)
+			return ((lcVertex*)mVertexBuffer.mData)[VertexIndex].Position;
+
+		const lcint16* Position = ((lcVertexQuantized*)mVertexBuffer.mData)[VertexIndex].Position;
+		return lcVector3(Position[0] * mPositionScale.x + mPositionOffset.x, Position[1] * mPositionScale.y + mPositionOffset.y, Position[2] * mPositionScale.z + mPositionOffset.z);
+	}
+
+	lcVector3 GetTexturedVertexPosition(int VertexIndex) const
+	{
+		char* TexturedVertices = (char*)mVertexBuffer.mData + GetTexturedVertexOffset();
+
+		if (!mQuantized)
+			return ((lcVertexTextured*)TexturedVertices)[VertexIndex].Position;
+
+		const lcint16* Position = ((lcVertexTexturedQuantized*)TexturedVertices)[VertexIndex].Position;
+		return lcVector3(Position[0] * mPositionScale.x + mPositionOffset.x, Position[1] * mPositionScale.y + mPositionOffset.y, Position[2] * mPositionScale.z + mPositionOffset.z);
+	}
+
+	// Transforms quantized positions back to model space, to be combined with the world matrix.
+	lcMatrix44 GetDequantizeMatrix() const
+	{
+		lcMatrix44 Matrix = lcMatrix44Scale(mPositionScale);
+		Matrix.SetTranslation(mPositionOffset);
+		return Matrix;
+	}
+
+	lcMatrix44 GetTextureMatrix() const
+	{
+		lcMatrix44 Matrix = lcMatrix44Scale(lcVector3(mTexCoordScale.x, mTexCoordScale.y, 1.0f));
+		Matrix.SetTranslation(lcVector3(mTexCoordOffset.x, mTexCoordOffset.y, 0.0f));
+		return Matrix;
+	}
+
 	lcMeshSection* mSections;
 	int mNumSections;
 
@@ -163,6 +240,16 @@ public:
 	int mNumVertices;
 	int mNumTexturedVertices;
 	int mIndexType;
+
+	bool mQuantized;
+	lcVector3 mPositionOffset;
+	lcVector3 mPositionScale;
+	lcVector2 mTexCoordOffset;
+	lcVector2 mTexCoordScale;
+
+	// Built when the mesh is created or on the first intersection query, each item is the position of the first index of a triangle in the index buffer.
+	lcBVH* mTriangleBVH;
+	lcArray<lcuint32> mBVHTriangles;
 };
 
 struct lcRenderMesh
@@ -173,6 +260,7 @@ struct lcRenderMesh
 	int ColorIndex;
 	bool Focused;
 	bool Selected;
+	lcPiece* Piece;
 };
 
 extern lcMesh* gPlaceholderMesh;
@@ -0,0 +1,246 @@
+#include "lc_global.h"
+#include "lc_meshoptimizer.h"
+#include "lc_math.h"
+#include "lc_array.h"
+#include <math.h>
+
+#define LC_VALENCE_SCORE_SIZE 32
+
+struct lcOptimizerVertex
+{
+	int CachePosition;
+	int FirstTriangle;
+	int NumTriangles;
+	float Score;
+};
+
+static inline float lcGetVertexScore(const lcOptimizerVertex& Vertex, const float* CacheScores, const float* ValenceScores)
+{
+	if (!Vertex.NumTriangles)
+		return -1.0f;
+
+	float Score = (Vertex.CachePosition >= 0) ? CacheScores[Vertex.CachePosition] : 0.0f;
+
+	if (Vertex.NumTriangles < LC_VALENCE_SCORE_SIZE)
+		Score += ValenceScores[Vertex.NumTriangles];
+	else
+		Score += 2.0f * powf((float)Vertex.NumTriangles, -0.5f);
+
+	return Score;
+}
+
+void lcOptimizeTriangleOrder(lcuint32* Indices, int NumIndices, int NumVertices)
+{
+	int NumTriangles = NumIndices / 3;
+
+	if (NumTriangles < 3 || !NumVertices)
+		return;
+
+	float CacheScores[LC_VERTEX_CACHE_SIZE];
+	float ValenceScores[LC_VALENCE_SCORE_SIZE];
+
+	// The last triangle added gets a fixed score so it doesn't matter in which order its vertices are used.
+	for (int CachePosition = 0; CachePosition < LC_VERTEX_CACHE_SIZE; CachePosition++)
+	{
+		if (CachePosition < 3)
+			CacheScores[CachePosition] = 0.75f;
+		else
+			CacheScores[CachePosition] = powf(1.0f - (float)(CachePosition - 3) / (LC_VERTEX_CACHE_SIZE - 3), 1.5f);
+	}
+
+	// Boost vertices with few triangles left so we get rid of lone triangles early.
+	ValenceScores[0] = 0.0f;
+	for (int Valence = 1; Valence < LC_VALENCE_SCORE_SIZE; Valence++)
+		ValenceScores[Valence] = 2.0f * powf((float)Valence, -0.5f);
+
+	lcArray<lcOptimizerVertex> Vertices;
+	Vertices.SetSize(NumVertices);
+	memset(&Vertices[0], 0, NumVertices * sizeof(lcOptimizerVertex));
+
+	for (int IndexIdx = 0; IndexIdx < NumTriangles * 3; IndexIdx++)
+		Vertices[Indices[IndexIdx]].NumTriangles++;
+
+	int FirstTriangle = 0;
+
+	for (int VertexIdx = 0; VertexIdx < NumVertices; VertexIdx++)
+	{
+		lcOptimizerVertex& Vertex = Vertices[VertexIdx];
+
+		Vertex.CachePosition = -1;
+		Vertex.FirstTriangle = FirstTriangle;
+		FirstTriangle += Vertex.NumTriangles;
+		Vertex.NumTriangles = 0;
+	}
+
+	lcArray<int> VertexTriangles;
+	VertexTriangles.SetSize(NumTriangles * 3);
+
+	for (int TriangleIdx = 0; TriangleIdx < NumTriangles; TriangleIdx++)
+	{
+		for (int CornerIdx = 0; CornerIdx < 3; CornerIdx++)
+		{
+			lcOptimizerVertex& Vertex = Vertices[Indices[TriangleIdx * 3 + CornerIdx]];
+			VertexTriangles[Vertex.FirstTriangle + Vertex.NumTriangles++] = TriangleIdx;
+		}
+	}
+
+	for (int VertexIdx = 0; VertexIdx < NumVertices; VertexIdx++)
+		Vertices[VertexIdx].Score = lcGetVertexScore(Vertices[VertexIdx], CacheScores, ValenceScores);
+
+	lcArray<bool> TriangleAdded;
+	TriangleAdded.SetSize(NumTriangles);
+
+	int BestTriangle = -1;
+	float BestScore = -1.0f;
+
+	for (int TriangleIdx = 0; TriangleIdx < NumTriangles; TriangleIdx++)
+	{
+		const lcuint32* TriangleIndices = Indices + TriangleIdx * 3;
+		float Score = Vertices[TriangleIndices[0]].Score + Vertices[TriangleIndices[1]].Score + Vertices[TriangleIndices[2]].Score;
+
+		TriangleAdded[TriangleIdx] = false;
+
+		if (Score > BestScore)
+		{
+			BestScore = Score;
+			BestTriangle = TriangleIdx;
+		}
+	}
+
+	lcArray<lcuint32> OptimizedIndices;
+	OptimizedIndices.SetSize(NumTriangles * 3);
+
+	int Cache[LC_VERTEX_CACHE_SIZE + 3];
+	int CacheSize = 0;
+	int ScanPosition = 0;
+
+	for (int OutputIdx = 0; OutputIdx < NumTriangles; OutputIdx++)
+	{
+		// None of the vertices in the cache have triangles left, continue with the first triangle not yet added.
+		if (BestTriangle == -1)
+		{
+			while (TriangleAdded[ScanPosition])
+				ScanPosition++;
+
+			BestTriangle = ScanPosition;
+		}
+
+		const lcuint32* TriangleIndices = Indices + BestTriangle * 3;
+		TriangleAdded[BestTriangle] = true;
+
+		int NewCache[LC_VERTEX_CACHE_SIZE + 3];
+		int NewCacheSize = 0;
+
+		for (int CornerIdx = 0; CornerIdx < 3; CornerIdx++)
+		{
+			int VertexIndex = TriangleIndices[CornerIdx];
+			lcOptimizerVertex& Vertex = Vertices[VertexIndex];
+			OptimizedIndices[OutputIdx * 3 + CornerIdx] = VertexIndex;
+
+			int* Triangles = &VertexTriangles[Vertex.FirstTriangle];
+
+			for (int TriangleIdx = 0; TriangleIdx < Vertex.NumTriangles; TriangleIdx++)
+			{
+				if (Triangles[TriangleIdx] == BestTriangle)
+				{
+					Triangles[TriangleIdx] = Triangles[Vertex.NumTriangles - 1];
+					Vertex.NumTriangles--;
+					break;
+				}
+			}
+
+			if (NewCacheSize == 0 || (NewCache[0] != VertexIndex && (NewCacheSize == 1 || NewCache[1] != VertexIndex)))
+				NewCache[NewCacheSize++] = VertexIndex;
+		}
+
+		int NumTriangleVertices = NewCacheSize;
+
+		for (int CacheIdx = 0; CacheIdx < CacheSize; CacheIdx++)
+		{
+			int VertexIndex = Cache[CacheIdx];
+			bool Duplicate = false;
+
+			for (int NewIdx = 0; NewIdx < NumTriangleVertices; NewIdx++)
+				if (NewCache[NewIdx] == VertexIndex)
+					Duplicate = true;
+
+			if (!Duplicate)
+				NewCache[NewCacheSize++] = VertexIndex;
+		}
+
+		for (int CacheIdx = 0; CacheIdx < NewCacheSize; CacheIdx++)
+		{
+			lcOptimizerVertex& Vertex = Vertices[NewCache[CacheIdx]];
+
+			Vertex.CachePosition = (CacheIdx < LC_VERTEX_CACHE_SIZE) ? CacheIdx : -1;
+			Vertex.Score = lcGetVertexScore(Vertex, CacheScores, ValenceScores);
+		}
+
+		BestTriangle = -1;
+		BestScore = -1.0f;
+
+		for (int CacheIdx = 0; CacheIdx < NewCacheSize; CacheIdx++)
+		{
+			const lcOptimizerVertex& Vertex = Vertices[NewCache[CacheIdx]];
+			const int* Triangles = &VertexTriangles[Vertex.FirstTriangle];
+
+			for (int TriangleIdx = 0; TriangleIdx < Vertex.NumTriangles; TriangleIdx++)
+			{
+				int Triangle = Triangles[TriangleIdx];
+				const lcuint32* Corners = Indices + Triangle * 3;
+				float Score = Vertices[Corners[0]].Score + Vertices[Corners[1]].Score + Vertices[Corners[2]].Score;
+
+				if (Score > BestScore)
+				{
+					BestScore = Score;
+					BestTriangle = Triangle;
+				}
+			}
+		}
+
+		CacheSize = lcMin(NewCacheSize, LC_VERTEX_CACHE_SIZE);
+		memcpy(Cache, NewCache, CacheSize * sizeof(int));
+	}
+
+	memcpy(Indices, &OptimizedIndices[0], NumTriangles * 3 * sizeof(lcuint32));
+}
+
+int lcOptimizeVertexOrder(const lcuint32* Indices, int NumIndices, lcuint32* Remap, int NextVertex)
+{
+	for (int IndexIdx = 0; IndexIdx < NumIndices; IndexIdx++)
+	{
+		lcuint32& NewIndex = Remap[Indices[IndexIdx]];
+
+		if (NewIndex == LC_VERTEX_UNUSED)
+			NewIndex = NextVertex++;
+	}
+
+	return NextVertex;
+}
+
+int lcGetVertexCacheMisses(const lcuint32* Indices, int NumIndices, int NumVertices, int CacheSize)
+{
+	if (!NumVertices)
+		return 0;
+
+	// A vertex is in the cache if less than CacheSize vertices were transformed since it was last transformed.
+	lcArray<int> TransformTime;
+	TransformTime.SetSize(NumVertices);
+	memset(&TransformTime[0], 0, NumVertices * sizeof(int));
+
+	int Time = CacheSize + 1;
+	int Misses = 0;
+
+	for (int IndexIdx = 0; IndexIdx < NumIndices; IndexIdx++)
+	{
+		int& VertexTime = TransformTime[Indices[IndexIdx]];
+
+		if (Time - VertexTime > CacheSize)
+		{
+			VertexTime = Time++;
+			Misses++;
+		}
+	}
+
+	return Misses;
+}
@@ -0,0 +1,18 @@
+#ifndef _LC_MESHOPTIMIZER_H_
+#define _LC_MESHOPTIMIZER_H_
+
+#define LC_VERTEX_CACHE_SIZE       32
+#define LC_VERTEX_CACHE_FIFO_SIZE  16
+#define LC_VERTEX_UNUSED           0xffffffff
+
+// Reorders a triangle list to improve post-transform vertex cache usage (Forsyth's linear-speed algorithm).
+void lcOptimizeTriangleOrder(lcuint32* Indices, int NumIndices, int NumVertices);
+
+// Assigns new positions to vertices in the order they are first used, starting at NextVertex.
+// Vertices that already have a position in Remap keep it. Returns the next unassigned position.
+int lcOptimizeVertexOrder(const lcuint32* Indices, int NumIndices, lcuint32* Remap, int NextVertex);
+
+// Returns the number of vertex transforms needed to draw a triangle list with a FIFO cache of the given size.
+int lcGetVertexCacheMisses(const lcuint32* Indices, int NumIndices, int NumVertices, int CacheSize);
+
+#endif // _LC_MESHOPTIMIZER_H_
@@ -13,6 +13,8 @@
 #include "view.h"
 #include "preview.h"
 #include "minifig.h"
+#include "lc_pngwriter.h"
+#include "tr.h"
 
 void lcModelProperties::LoadDefaults()
 {
@@ -150,6 +152,7 @@ lcModel::lcModel(const QString& Name)
 	mCurrentStep = 1;
 	mBackgroundTexture = NULL;
 	mPieceInfo = NULL;
+	mPieceBVHDirty = true;
 }
 
 lcModel::~lcModel()
@@ -210,6 +213,8 @@ void lcModel::DeleteModel()
 	mLights.DeleteAll();
 	mGroups.DeleteAll();
 	mFileLines.clear();
+	mPieceBVHDirty = true;
+	InvalidateScene();
 }
 
 void lcModel::CreatePieceInfo(Project* Project)
@@ -226,6 +231,7 @@ void lcModel::UpdatePieceInfo(lcArray<lcModel*>& UpdatedModels)
 
 	mPieceInfo->SetModel(this, false);
 	UpdatedModels.Add(this);
+	InvalidateScene();
 
 	lcMesh* Mesh = mPieceInfo->GetMesh();
 
@@ -250,18 +256,28 @@ void lcModel::UpdatePieceInfo(lcArray<lcModel*>& UpdatedModels)
 
 	if (Mesh)
 	{
-		int NumVerts = Mesh->mVertexBuffer.mSize / sizeof(lcVertex);
-		float* Vertex = (float*)Mesh->mVertexBuffer.mData;
+		for (int VertexIdx = 0; VertexIdx < Mesh->mNumVertices; VertexIdx++)
+		{
+			lcVector3 Vertex = Mesh->GetVertexPosition(VertexIdx);
 
-		for (int VertexIdx = 0; VertexIdx < NumVerts; VertexIdx++)
+			if (Vertex[0] < BoundingBox[0]) BoundingBox[0] = Vertex[0];
+			if (Vertex[1] < BoundingBox[1]) BoundingBox[1] = Vertex[1];
+			if (Vertex[2] < BoundingBox[2]) BoundingBox[2] = Vertex[2];
+			if (Vertex[0] > BoundingBox[3]) BoundingBox[3] = Vertex[0];
+			if (Vertex[1] > BoundingBox[4]) BoundingBox[4] = Vertex[1];
+			if (Vertex[2] > BoundingBox[5]) BoundingBox[5] = Vertex[2];
+		}
+
+		for (int VertexIdx = 0; VertexIdx < Mesh->mNumTexturedVertices; VertexIdx++)
 		{
+			lcVector3 Vertex = Mesh->GetTexturedVertexPosition(VertexIdx);
+
 			if (Vertex[0] < BoundingBox[0]) BoundingBox[0] = Vertex[0];
 			if (Vertex[1] < BoundingBox[1]) BoundingBox[1] = Vertex[1];
 			if (Vertex[2] < BoundingBox[2]) BoundingBox[2] = Vertex[2];
 			if (Vertex[0] > BoundingBox[3]) BoundingBox[3] = Vertex[0];
 			if (Vertex[1] > BoundingBox[4]) BoundingBox[4] = Vertex[1];
 			if (Vertex[2] > BoundingBox[5]) BoundingBox[5] = Vertex[2];
-			Vertex += 3;
 		}
 	}
 
@@ -957,17 +973,28 @@ void lcModel::Paste()
 	gMainWindow->UpdateAllViews();
 }
 
-void lcModel::GetScene(lcScene& Scene, lcCamera* ViewCamera, bool DrawInterface) const
+// Any change to a model invalidates the scenes of all views since the model can be a submodel of the one being drawn.
+static lcuint32 gSceneRevision = 1;
+
+void lcModel::InvalidateScene() const
 {
-	Scene.Begin(ViewCamera->mWorldView);
+	gSceneRevision++;
+}
+
+// Pieces shown before FirstStep are left out so a step can be drawn over the image of the previous one.
+void lcModel::GetScene(lcScene& Scene, lcCamera* ViewCamera, const lcMatrix44& ProjectionMatrix, bool DrawInterface, lcStep FirstStep) const
+{
+	Scene.mStepOrder = !DrawInterface;
+	Scene.Begin(ViewCamera->mWorldView, ProjectionMatrix);
 
-	mPieceInfo->AddRenderMesh(Scene);
+	if (FirstStep <= 1)
+		mPieceInfo->AddRenderMesh(Scene);
 
 	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
 	{
 		lcPiece* Piece = mPieces[PieceIdx];
 
-		if (!Piece->IsVisible(mCurrentStep))
+		if (!Piece->IsVisible(mCurrentStep) || Piece->GetStepShow() < FirstStep)
 			continue;
 
 		PieceInfo* Info = Piece->mPieceInfo;
@@ -984,10 +1011,12 @@ void lcModel::GetScene(lcScene& Scene, lcCamera* ViewCamera, bool DrawInterface)
 			Selected = false;
 		}
 
-		Info->AddRenderMeshes(Scene, Piece->mModelWorld, Piece->mColorIndex, Focused, Selected);
-
 		if (Selected)
 			Scene.mInterfaceObjects.Add(Piece);
+
+		Scene.BeginPiece(Piece, Info, Piece->mModelWorld, !Focused && !Selected && !Piece->IsAnimated());
+		Info->AddRenderMeshes(Scene, Piece->mModelWorld, Piece->mColorIndex, Focused, Selected);
+		Scene.EndPiece();
 	}
 
 	if (DrawInterface)
@@ -1010,6 +1039,21 @@ void lcModel::GetScene(lcScene& Scene, lcCamera* ViewCamera, bool DrawInterface)
 	}
 
 	Scene.End();
+
+	Scene.mModel = this;
+	Scene.mViewCamera = ViewCamera;
+	Scene.mDrawInterface = DrawInterface;
+	Scene.mFirstStep = FirstStep;
+	Scene.mRevision = gSceneRevision;
+}
+
+// Reuses a scene built for the same model and camera when nothing changed since, only culling and sorting it for the current view.
+void lcModel::UpdateScene(lcScene& Scene, lcCamera* ViewCamera, const lcMatrix44& ProjectionMatrix, bool DrawInterface, lcStep FirstStep) const
+{
+	if (Scene.mModel != this || Scene.mRevision != gSceneRevision || Scene.mViewCamera != ViewCamera || Scene.mDrawInterface != DrawInterface || Scene.mFirstStep != FirstStep)
+		GetScene(Scene, ViewCamera, ProjectionMatrix, DrawInterface, FirstStep);
+	else
+		Scene.SetView(ViewCamera->mWorldView, ProjectionMatrix);
 }
 
 void lcModel::SubModelAddRenderMeshes(lcScene& Scene, const lcMatrix44& WorldMatrix, int DefaultColorIndex, bool Focused, bool Selected) const
@@ -1027,11 +1071,22 @@ void lcModel::SubModelAddRenderMeshes(lcScene& Scene, const lcMatrix44& WorldMat
 			ColorIndex = DefaultColorIndex;
 
 		PieceInfo* Info = Piece->mPieceInfo;
-		Info->AddRenderMeshes(Scene, lcMul(Piece->mModelWorld, WorldMatrix), ColorIndex, Focused, Selected);
+		lcMatrix44 PieceWorldMatrix = lcMul(Piece->mModelWorld, WorldMatrix);
+
+		int SubModelPiece = Scene.BeginSubModelPiece(Info, PieceWorldMatrix);
+		Info->AddRenderMeshes(Scene, PieceWorldMatrix, ColorIndex, Focused, Selected);
+		Scene.EndSubModelPiece(SubModelPiece);
 	}
 }
 
 void lcModel::DrawBackground(lcContext* Context)
+{
+	DrawBackground(Context, 0, 0, Context->GetViewportWidth(), Context->GetViewportHeight());
+}
+
+// Draws the part of the background of an image of the given size that falls in the viewport, the viewport's lower
+// left corner is at ImageX, ImageY so images drawn in tiles show one continuous background.
+void lcModel::DrawBackground(lcContext* Context, int ImageX, int ImageY, int ImageWidth, int ImageHeight)
 {
 	if (mProperties.mBackgroundType == LC_BACKGROUND_SOLID)
 	{
@@ -1046,10 +1101,12 @@ void lcModel::DrawBackground(lcContext* Context)
 	glDisable(GL_DEPTH_TEST);
 	glDisable(GL_LIGHTING);
 
-	float ViewWidth = (float)Context->GetViewportWidth();
-	float ViewHeight = (float)Context->GetViewportHeight();
+	float ViewLeft = (float)ImageX;
+	float ViewBottom = (float)ImageY;
+	float FullWidth = (float)ImageWidth;
+	float FullHeight = (float)ImageHeight;
 
-	Context->SetProjectionMatrix(lcMatrix44Ortho(0.0f, ViewWidth, 0.0f, ViewHeight, -1.0f, 1.0f));
+	Context->SetProjectionMatrix(lcMatrix44Ortho(ViewLeft, ViewLeft + Context->GetViewportWidth(), ViewBottom, ViewBottom + Context->GetViewportHeight(), -1.0f, 1.0f));
 	Context->SetWorldViewMatrix(lcMatrix44Translation(lcVector3(0.375f, 0.375f, 0.0f)));
 
 	if (mProperties.mBackgroundType == LC_BACKGROUND_GRADIENT)
@@ -1061,10 +1118,10 @@ void lcModel::DrawBackground(lcContext* Context)
 
 		float Verts[] =
 		{
-			ViewWidth, ViewHeight, Color1[0], Color1[1], Color1[2], 1.0f,
-			0.0f,      ViewHeight, Color1[0], Color1[1], Color1[2], 1.0f,
+			FullWidth, FullHeight, Color1[0], Color1[1], Color1[2], 1.0f,
+			0.0f,      FullHeight, Color1[0], Color1[1], Color1[2], 1.0f,
 			0.0f,      0.0f,       Color2[0], Color2[1], Color2[2], 1.0f,
-			ViewWidth, 0.0f,       Color2[0], Color2[1], Color2[2], 1.0f
+			FullWidth, 0.0f,       Color2[0], Color2[1], Color2[2], 1.0f
 		};
 
 		Context->SetVertexBufferPointer(Verts);
@@ -1087,15 +1144,15 @@ void lcModel::DrawBackground(lcContext* Context)
 
 		if (mProperties.mBackgroundImageTile)
 		{
-			TileWidth = ViewWidth / mBackgroundTexture->mWidth;
-			TileHeight = ViewHeight / mBackgroundTexture->mHeight;
+			TileWidth = FullWidth / mBackgroundTexture->mWidth;
+			TileHeight = FullHeight / mBackgroundTexture->mHeight;
 		}
 
 		float Verts[] =
 		{
-			0.0f,      ViewHeight, 0.0f,      0.0f,
-			ViewWidth, ViewHeight, TileWidth, 0.0f,
-			ViewWidth, 0.0f,       TileWidth, TileHeight,
+			0.0f,      FullHeight, 0.0f,      0.0f,
+			FullWidth, FullHeight, TileWidth, 0.0f,
+			FullWidth, 0.0f,       TileWidth, TileHeight,
 			0.0f,      0.0f,       0.0f,      TileHeight
 		};
 
@@ -1115,45 +1172,151 @@ void lcModel::DrawBackground(lcContext* Context)
 
 void lcModel::SaveStepImages(const QString& BaseName, int Width, int Height, lcStep Start, lcStep End)
 {
-	gMainWindow->mPreviewWidget->MakeCurrent();
-	lcContext* Context = gMainWindow->mPreviewWidget->mContext;
+	if (!SaveStepImages(gMainWindow->mPreviewWidget, gMainWindow->GetActiveView()->mCamera, BaseName, Start != End, Width, Height, Start, End))
+		QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Error creating images."));
+}
+
+bool lcModel::SaveStepImages(lcGLWidget* Widget, lcCamera* Camera, const QString& BaseName, bool AddStepSuffix, int Width, int Height, lcStep Start, lcStep End)
+{
+	Widget->MakeCurrent();
+	lcContext* Context = Widget->mContext;
 
 	if (!Context->BeginRenderToTexture(Width, Height))
-	{
-		QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Error creating images."));
-		return;
-	}
+		return false;
 
 	lcStep CurrentStep = mCurrentStep;
 
 	View View(this);
-	View.SetCamera(gMainWindow->GetActiveView()->mCamera, false);
+	View.SetCamera(Camera, false);
 	View.mWidth = Width;
 	View.mHeight = Height;
 	View.SetContext(Context);
 
+	// Steps that only add opaque pieces are drawn over the image of the previous step, which is still in the texture.
+	bool Opaque = false;
+	lcMatrix44 PreviousWorldView, PreviousProjection;
+
 	for (lcStep Step = Start; Step <= End; Step++)
 	{
 		SetTemporaryStep(Step);
+
+		lcMatrix44 WorldView = View.mCamera->mWorldView;
+		lcMatrix44 Projection = View.GetProjectionMatrix();
+
+		View.mIncrementalStep = Step > Start && Opaque && !memcmp(&WorldView, &PreviousWorldView, sizeof(WorldView)) &&
+		                        !memcmp(&Projection, &PreviousProjection, sizeof(Projection)) && StepOnlyAddsPieces(Step);
 		View.OnDraw();
 
+		Opaque = View.GetScene().mTranslucentMeshes.IsEmpty();
+		PreviousWorldView = WorldView;
+		PreviousProjection = Projection;
+
 		QString FileName;
 
-		if (Start == End)
-			FileName = BaseName;
-		else
+		if (AddStepSuffix)
 			FileName = BaseName.arg(Step, 2, 10, QLatin1Char('0'));
+		else
+			FileName = BaseName;
 
-		if (!Context->SaveRenderToTextureImage(FileName, Width, Height))
-			break;
+		Context->QueueRenderToTextureImage(FileName, Width, Height);
 	}
 
+	bool Saved = Context->FinishRenderToTextureImages();
+	Context->EndRenderToTexture();
+
+	SetTemporaryStep(CurrentStep);
+
+	if (!mActive)
+		CalculateStep(LC_STEP_MAX);
+
+	return Saved;
+}
+
+// Draws an image of any size in tiles, each row of tiles is compressed on a worker thread while the next one is drawn.
+bool lcModel::SavePosterImage(lcGLWidget* Widget, lcCamera* Camera, const QString& FileName, int Width, int Height, lcStep Step)
+{
+	Widget->MakeCurrent();
+	lcContext* Context = Widget->mContext;
+
+	GLint MaxTexture;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &MaxTexture);
+
+	int TileWidth = lcMin(Width, lcMin((int)MaxTexture, LC_POSTER_TILE_WIDTH));
+	int TileHeight = lcMin(Height, lcMin((int)MaxTexture, LC_POSTER_TILE_HEIGHT));
+
+	lcPngWriter Writer;
+
+	if (!Writer.Open(FileName, Width, Height, TileHeight))
+		return false;
+
+	if (!Context->BeginRenderToTexture(TileWidth, TileHeight))
+	{
+		Writer.Abort();
+		return false;
+	}
+
+	lcStep CurrentStep = mCurrentStep;
+	SetTemporaryStep(Step);
+
+	View View(this);
+	View.SetCamera(Camera, true);
+	View.mWidth = TileWidth;
+	View.mHeight = TileHeight;
+	View.SetContext(Context);
+
+	lcCamera* TileCamera = View.mCamera;
+	TileCamera->StartTiledRendering(TileWidth, TileHeight, Width, Height, (float)Width / (float)Height);
+	TileCamera->m_pTR->RowOrder(TR_TOP_TO_BOTTOM);
+
+	// Tiles are read straight into their place in the row, which goes to the writer after its last column is drawn.
+	lcuint8* Rows = NULL;
+	bool ReadError = false;
+	glPixelStorei(GL_PACK_ROW_LENGTH, Width);
+
+	// Clear errors left by earlier calls so only failed reads are caught below.
+	while (glGetError() != GL_NO_ERROR)
+		;
+
+	do
+	{
+		View.OnDraw();
+
+		int TileRow, TileColumn, CurrentTileWidth, CurrentTileHeight;
+		TileCamera->GetTileInfo(&TileRow, &TileColumn, &CurrentTileWidth, &CurrentTileHeight);
+
+		if (TileColumn == 0)
+			Rows = Writer.BeginRows();
+
+		glReadPixels(0, 0, CurrentTileWidth, CurrentTileHeight, GL_BGRA, GL_UNSIGNED_BYTE, Rows + TileColumn * TileWidth * 4);
+
+		if (glGetError() != GL_NO_ERROR)
+		{
+			delete TileCamera->m_pTR;
+			TileCamera->m_pTR = NULL;
+			ReadError = true;
+			break;
+		}
+
+		if (TileColumn == TileCamera->m_pTR->Get(TR_COLUMNS) - 1)
+			Writer.EndRows(CurrentTileHeight);
+	} while (TileCamera->EndTile());
+
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
 	Context->EndRenderToTexture();
 
 	SetTemporaryStep(CurrentStep);
 
 	if (!mActive)
 		CalculateStep(LC_STEP_MAX);
+
+	if (ReadError)
+	{
+		Writer.Abort();
+		return false;
+	}
+
+	return Writer.Close();
 }
 
 void lcModel::UpdateBackgroundTexture()
@@ -1170,19 +1333,62 @@ void lcModel::UpdateBackgroundTexture()
 	}
 }
 
+void lcModel::UpdatePieceBVH() const
+{
+	int NumPieces = mPieces.GetSize();
+	bool Rebuild = (mPieceBVHPieces.GetSize() != NumPieces) || (NumPieces && memcmp(&mPieceBVHPieces[0], &mPieces[0], NumPieces * sizeof(lcPiece*)));
+
+	if (!Rebuild && !mPieceBVHDirty)
+		return;
+
+	lcArray<lcBVHBounds> PieceBounds;
+	PieceBounds.SetSize(NumPieces);
+
+	for (int PieceIdx = 0; PieceIdx < NumPieces; PieceIdx++)
+	{
+		float BoundingBox[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		mPieces[PieceIdx]->CompareBoundingBox(BoundingBox);
+
+		PieceBounds[PieceIdx].Min = lcVector3(BoundingBox[0], BoundingBox[1], BoundingBox[2]);
+		PieceBounds[PieceIdx].Max = lcVector3(BoundingBox[3], BoundingBox[4], BoundingBox[5]);
+	}
+
+	if (Rebuild)
+	{
+		mPieceBVHPieces = mPieces;
+		mPieceBVH.Build(PieceBounds);
+	}
+	else
+		mPieceBVH.Refit(PieceBounds);
+
+	mPieceBVHDirty = false;
+}
+
 void lcModel::RayTest(lcObjectRayTest& ObjectRayTest) const
 {
-	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
+	UpdatePieceBVH();
+
+	lcArray<lcBVHRayHit> Hits;
+	mPieceBVH.RayTest(ObjectRayTest.Start, ObjectRayTest.End, ObjectRayTest.Distance, Hits);
+
+	for (int HitIdx = 0; HitIdx < Hits.GetSize(); HitIdx++)
 	{
-		lcPiece* Piece = mPieces[PieceIdx];
+		// Hits are sorted by distance, pieces further away can't be closer than the current intersection.
+		if (Hits[HitIdx].Distance >= ObjectRayTest.Distance)
+			break;
+
+		lcPiece* Piece = mPieces[Hits[HitIdx].Item];
 
 		if (Piece->IsVisible(mCurrentStep))
 			Piece->RayTest(ObjectRayTest);
 	}
 
-	if (ObjectRayTest.PiecesOnly)
-		return;
+	if (!ObjectRayTest.PiecesOnly)
+		RayTestCamerasAndLights(ObjectRayTest);
+}
 
+void lcModel::RayTestCamerasAndLights(lcObjectRayTest& ObjectRayTest) const
+{
 	for (int CameraIdx = 0; CameraIdx < mCameras.GetSize(); CameraIdx++)
 	{
 		lcCamera* Camera = mCameras[CameraIdx];
@@ -1198,14 +1404,24 @@ void lcModel::RayTest(lcObjectRayTest& ObjectRayTest) const
 
 void lcModel::BoxTest(lcObjectBoxTest& ObjectBoxTest) const
 {
-	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
+	UpdatePieceBVH();
+
+	lcArray<int> PieceIndices;
+	mPieceBVH.BoxTest(ObjectBoxTest.Planes, PieceIndices);
+
+	for (int Idx = 0; Idx < PieceIndices.GetSize(); Idx++)
 	{
-		lcPiece* Piece = mPieces[PieceIdx];
+		lcPiece* Piece = mPieces[PieceIndices[Idx]];
 
 		if (Piece->IsVisible(mCurrentStep))
 			Piece->BoxTest(ObjectBoxTest);
 	}
 
+	BoxTestCamerasAndLights(ObjectBoxTest);
+}
+
+void lcModel::BoxTestCamerasAndLights(lcObjectBoxTest& ObjectBoxTest) const
+{
 	for (int CameraIdx = 0; CameraIdx < mCameras.GetSize(); CameraIdx++)
 	{
 		lcCamera* Camera = mCameras[CameraIdx];
@@ -1252,6 +1468,8 @@ bool lcModel::SubModelBoxTest(const lcVector4 Planes[6]) const
 
 void lcModel::SaveCheckpoint(const QString& Description)
 {
+	InvalidateScene();
+
 	lcModelHistoryEntry* ModelHistoryEntry = new lcModelHistoryEntry();
 
 	ModelHistoryEntry->Description = Description;
@@ -1307,6 +1525,9 @@ void lcModel::SetActive(bool Active)
 
 void lcModel::CalculateStep(lcStep Step)
 {
+	mPieceBVHDirty = true;
+	InvalidateScene();
+
 	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
 	{
 		lcPiece* Piece = mPieces[PieceIdx];
@@ -1384,6 +1605,23 @@ lcStep lcModel::GetLastStep() const
 	return Step;
 }
 
+// Returns true if the pieces shown in the previous step are still there and haven't moved.
+bool lcModel::StepOnlyAddsPieces(lcStep Step) const
+{
+	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
+	{
+		lcPiece* Piece = mPieces[PieceIdx];
+
+		if (Piece->GetStepShow() >= Step || Piece->GetStepHide() < Step)
+			continue;
+
+		if (Piece->GetStepHide() == Step || Piece->HasKeys(Step))
+			return false;
+	}
+
+	return true;
+}
+
 void lcModel::InsertStep(lcStep Step)
 {
 	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
@@ -1884,6 +2122,9 @@ void lcModel::AddPiece()
 
 void lcModel::AddPiece(lcPiece* Piece)
 {
+	mPieceBVHDirty = true;
+	InvalidateScene();
+
 	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
 	{
 		if (mPieces[PieceIdx]->GetStepShow() > Piece->GetStepShow())
@@ -2135,6 +2376,9 @@ void lcModel::MoveSelectedObjects(const lcVector3& PieceDistance, const lcVector
 				Moved = true;
 			}
 		}
+
+		mPieceBVHDirty = true;
+		InvalidateScene();
 	}
 
 	if (ObjectDistance.LengthSquared() >= 0.001f)
@@ -2263,6 +2507,12 @@ void lcModel::RotateSelectedPieces(const lcVector3& Angles, bool Relative, bool
 		Rotated = true;
 	}
 
+	if (Rotated)
+	{
+		mPieceBVHDirty = true;
+		InvalidateScene();
+	}
+
 	if (Rotated && Update)
 	{
 		gMainWindow->UpdateAllViews();
@@ -2309,6 +2559,7 @@ void lcModel::SetObjectProperty(lcObject* Object, lcObjectPropertyType ObjectPro
 			{
 				Piece->SetPosition(Position, mCurrentStep, gMainWindow->GetAddKeys());
 				Piece->UpdatePosition(mCurrentStep);
+				mPieceBVHDirty = true;
 
 				CheckPointString = tr("Moving");
 			}
@@ -2325,6 +2576,7 @@ void lcModel::SetObjectProperty(lcObject* Object, lcObjectPropertyType ObjectPro
 
 				Piece->SetRotation(RotationMatrix, mCurrentStep, gMainWindow->GetAddKeys());
 				Piece->UpdatePosition(mCurrentStep);
+				mPieceBVHDirty = true;
 
 				CheckPointString = tr("Rotating");
 			}
@@ -2381,6 +2633,7 @@ void lcModel::SetObjectProperty(lcObject* Object, lcObjectPropertyType ObjectPro
 				Part->mPieceInfo->Release();
 				Part->mPieceInfo = Info;
 				Part->mPieceInfo->AddRef();
+				mPieceBVHDirty = true;
 
 				CheckPointString = tr("Setting Part");
 			}
@@ -2791,6 +3044,28 @@ void lcModel::GetPartsListForStep(lcStep Step, int DefaultColorIndex, lcArray<lc
 	}
 }
 
+// Fills the parts lists of all steps in one pass, StepPartsLists[Step] has the pieces added in that step.
+void lcModel::GetStepPartsLists(int DefaultColorIndex, lcArray<lcArray<lcPartsListEntry> >& StepPartsLists) const
+{
+	StepPartsLists.SetSize(GetLastStep() + 1);
+
+	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
+	{
+		lcPiece* Piece = mPieces[PieceIdx];
+		lcStep Step = Piece->GetStepShow();
+
+		if (Step >= (lcStep)StepPartsLists.GetSize())
+			StepPartsLists.SetSize(Step + 1);
+
+		int ColorIndex = Piece->mColorIndex;
+
+		if (ColorIndex == gDefaultColor)
+			ColorIndex = DefaultColorIndex;
+
+		Piece->mPieceInfo->GetPartsList(ColorIndex, StepPartsLists[Step]);
+	}
+}
+
 void lcModel::GetModelParts(const lcMatrix44& WorldMatrix, int DefaultColorIndex, lcArray<lcModelPartsEntry>& ModelParts) const
 {
 	for (int PieceIdx = 0; PieceIdx < mPieces.GetSize(); PieceIdx++)
@@ -2808,6 +3083,8 @@ void lcModel::GetModelParts(const lcMatrix44& WorldMatrix, int DefaultColorIndex
 
 void lcModel::UpdateSelection() const
 {
+	InvalidateScene();
+
 	int Flags = 0;
 	int SelectedCount = 0;
 	lcObject* Focus = NULL;
@@ -3504,6 +3781,12 @@ void lcModel::ZoomExtents(lcCamera* Camera, float Aspect)
 		lcVector3(BoundingBox[3], BoundingBox[1], BoundingBox[2])
 	};
 
+	if (!gMainWindow)
+	{
+		Camera->ZoomExtents(Aspect, Center, Points, 8, mCurrentStep, false);
+		return;
+	}
+
 	Camera->ZoomExtents(Aspect, Center, Points, 8, mCurrentStep, gMainWindow->GetAddKeys());
 
 	gMainWindow->UpdateFocusObject(GetFocusObject());
@@ -3678,6 +3961,9 @@ void lcModel::ShowMinifigDialog()
 
 void lcModel::UpdateInterface()
 {
+	if (!gMainWindow)
+		return;
+
 	gMainWindow->UpdateTimeline(true);
 	gMainWindow->UpdateUndoRedo(mUndoHistory.GetSize() > 1 ? mUndoHistory[0]->Description : NULL, !mRedoHistory.IsEmpty() ? mRedoHistory[0]->Description : NULL);
 	gMainWindow->UpdatePaste(!g_App->mClipboard.isEmpty());
@@ -4,6 +4,7 @@
 #include "lc_file.h"
 #include "lc_math.h"
 #include "object.h"
+#include "lc_bvh.h"
 
 #define LC_SEL_NO_PIECES         0x001 // No pieces in model
 #define LC_SEL_PIECE             0x002 // At last 1 piece selected
@@ -16,6 +17,9 @@
 #define LC_SEL_FOCUS_GROUPED     0x100 // Focused piece is grouped
 #define LC_SEL_CAN_GROUP         0x200 // Can make a new group
 
+#define LC_POSTER_TILE_WIDTH 2048
+#define LC_POSTER_TILE_HEIGHT 256
+
 enum lcTransformType
 {
 	LC_TRANSFORM_ABSOLUTE_TRANSLATION,
@@ -170,6 +174,7 @@ public:
 	}
 
 	lcStep GetLastStep() const;
+	bool StepOnlyAddsPieces(lcStep Step) const;
 
 	lcStep GetCurrentStep() const
 	{
@@ -225,13 +230,19 @@ public:
 	void Copy();
 	void Paste();
 
-	void GetScene(lcScene& Scene, lcCamera* ViewCamera, bool DrawInterface) const;
+	void GetScene(lcScene& Scene, lcCamera* ViewCamera, const lcMatrix44& ProjectionMatrix, bool DrawInterface, lcStep FirstStep) const;
+	void UpdateScene(lcScene& Scene, lcCamera* ViewCamera, const lcMatrix44& ProjectionMatrix, bool DrawInterface, lcStep FirstStep) const;
 	void SubModelAddRenderMeshes(lcScene& Scene, const lcMatrix44& WorldMatrix, int DefaultColorIndex, bool Focused, bool Selected) const;
 	void DrawBackground(lcContext* Context);
+	void DrawBackground(lcContext* Context, int ImageX, int ImageY, int ImageWidth, int ImageHeight);
 	void SaveStepImages(const QString& BaseName, int Width, int Height, lcStep Start, lcStep End);
+	bool SaveStepImages(lcGLWidget* Widget, lcCamera* Camera, const QString& BaseName, bool AddStepSuffix, int Width, int Height, lcStep Start, lcStep End);
+	bool SavePosterImage(lcGLWidget* Widget, lcCamera* Camera, const QString& FileName, int Width, int Height, lcStep Step);
 
 	void RayTest(lcObjectRayTest& ObjectRayTest) const;
 	void BoxTest(lcObjectBoxTest& ObjectBoxTest) const;
+	void RayTestCamerasAndLights(lcObjectRayTest& ObjectRayTest) const;
+	void BoxTestCamerasAndLights(lcObjectBoxTest& ObjectBoxTest) const;
 	bool SubModelMinIntersectDist(const lcVector3& WorldStart, const lcVector3& WorldEnd, float& MinDistance) const;
 	bool SubModelBoxTest(const lcVector4 Planes[6]) const;
 
@@ -247,6 +258,7 @@ public:
 	bool GetPiecesBoundingBox(float BoundingBox[6]) const;
 	void GetPartsList(int DefaultColorIndex, lcArray<lcPartsListEntry>& PartsList) const;
 	void GetPartsListForStep(lcStep Step, int DefaultColorIndex, lcArray<lcPartsListEntry>& PartsList) const;
+	void GetStepPartsLists(int DefaultColorIndex, lcArray<lcArray<lcPartsListEntry> >& StepPartsLists) const;
 	void GetModelParts(const lcMatrix44& WorldMatrix, int DefaultColorIndex, lcArray<lcModelPartsEntry>& ModelParts) const;
 
 	void FocusOrDeselectObject(const lcObjectSection& ObjectSection);
@@ -331,6 +343,8 @@ protected:
 	void SelectGroup(lcGroup* TopGroup, bool Select);
 
 	void AddPiece(lcPiece* Piece);
+	void UpdatePieceBVH() const;
+	void InvalidateScene() const;
 
 	lcModelProperties mProperties;
 	PieceInfo* mPieceInfo;
@@ -346,6 +360,10 @@ protected:
 	lcArray<lcGroup*> mGroups;
 	QStringList mFileLines;
 
+	mutable lcBVH mPieceBVH;
+	mutable lcArray<lcPiece*> mPieceBVHPieces;
+	mutable bool mPieceBVHDirty;
+
 	lcModelHistoryEntry* mSavedHistory;
 	lcArray<lcModelHistoryEntry*> mUndoHistory;
 	lcArray<lcModelHistoryEntry*> mRedoHistory;
@@ -0,0 +1,341 @@
+#include "lc_global.h"
+#include "lc_occlusion.h"
+#include "lc_mesh.h"
+#include "lc_colors.h"
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LC_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+lcOcclusionBuffer::lcOcclusionBuffer()
+{
+	Clear(lcMatrix44Identity());
+}
+
+void lcOcclusionBuffer::Clear(const lcMatrix44& ViewProjectionMatrix)
+{
+	mViewProjectionMatrix = ViewProjectionMatrix;
+	mNumTriangles = 0;
+
+	for (int PixelIdx = 0; PixelIdx < LC_OCCLUSION_WIDTH * LC_OCCLUSION_HEIGHT; PixelIdx++)
+		mDepth[PixelIdx] = 1.0f;
+
+	for (int TileIdx = 0; TileIdx < LC_OCCLUSION_TILES_X * LC_OCCLUSION_TILES_Y; TileIdx++)
+		mTileDepth[TileIdx] = 1.0f;
+}
+
+void lcOcclusionBuffer::DrawMesh(const lcMesh* Mesh, const lcMatrix44& WorldMatrix, int ColorIndex)
+{
+	lcMatrix44 WorldViewProjection = lcMul(WorldMatrix, mViewProjectionMatrix);
+	bool VerticesTransformed = false;
+	bool TexturedVerticesTransformed = false;
+
+	for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
+	{
+		const lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+		int SectionColorIndex = Section->ColorIndex;
+
+		if (Section->PrimitiveType != GL_TRIANGLES || !Section->NumIndices)
+			continue;
+
+		if (SectionColorIndex == gDefaultColor)
+			SectionColorIndex = ColorIndex;
+
+		if (lcIsColorTranslucent(SectionColorIndex))
+			continue;
+
+		if (IsFull())
+			return;
+
+		if (!Section->Texture && !VerticesTransformed)
+		{
+			mClipVertices.SetSize(Mesh->mNumVertices);
+
+			for (int VertexIdx = 0; VertexIdx < Mesh->mNumVertices; VertexIdx++)
+				mClipVertices[VertexIdx] = lcMul4(lcVector4(Mesh->GetVertexPosition(VertexIdx), 1.0f), WorldViewProjection);
+
+			VerticesTransformed = true;
+		}
+		else if (Section->Texture && !TexturedVerticesTransformed)
+		{
+			mClipTexturedVertices.SetSize(Mesh->mNumTexturedVertices);
+
+			for (int VertexIdx = 0; VertexIdx < Mesh->mNumTexturedVertices; VertexIdx++)
+				mClipTexturedVertices[VertexIdx] = lcMul4(lcVector4(Mesh->GetTexturedVertexPosition(VertexIdx), 1.0f), WorldViewProjection);
+
+			TexturedVerticesTransformed = true;
+		}
+
+		if (Mesh->mIndexType == GL_UNSIGNED_SHORT)
+			DrawMeshSection<GLushort>(Mesh, Section);
+		else
+			DrawMeshSection<GLuint>(Mesh, Section);
+	}
+}
+
+template<typename IndexType>
+void lcOcclusionBuffer::DrawMeshSection(const lcMesh* Mesh, const lcMeshSection* Section)
+{
+	const IndexType* Indices = (const IndexType*)((const char*)Mesh->mIndexBuffer.mData + Section->IndexOffset);
+	const lcVector4* Vertices = Section->Texture ? &mClipTexturedVertices[0] : &mClipVertices[0];
+
+	for (int Idx = 0; Idx + 2 < Section->NumIndices && !IsFull(); Idx += 3)
+		DrawClipTriangle(Vertices[Indices[Idx]], Vertices[Indices[Idx + 1]], Vertices[Indices[Idx + 2]]);
+}
+
+void lcOcclusionBuffer::DrawTriangles(const lcVector3* Vertices, int NumTriangles, const lcMatrix44& WorldMatrix)
+{
+	lcMatrix44 WorldViewProjection = lcMul(WorldMatrix, mViewProjectionMatrix);
+
+	for (int TriangleIdx = 0; TriangleIdx < NumTriangles && !IsFull(); TriangleIdx++)
+	{
+		const lcVector3* Triangle = Vertices + TriangleIdx * 3;
+
+		lcVector4 v0 = lcMul4(lcVector4(Triangle[0], 1.0f), WorldViewProjection);
+		lcVector4 v1 = lcMul4(lcVector4(Triangle[1], 1.0f), WorldViewProjection);
+		lcVector4 v2 = lcMul4(lcVector4(Triangle[2], 1.0f), WorldViewProjection);
+
+		DrawClipTriangle(v0, v1, v2);
+	}
+}
+
+// Triangles that cross the near plane are skipped instead of clipped, leaving out an occluder never hides anything by mistake.
+void lcOcclusionBuffer::DrawClipTriangle(const lcVector4& v0, const lcVector4& v1, const lcVector4& v2)
+{
+	const lcVector4* ClipVertices[3] = { &v0, &v1, &v2 };
+	lcVector3 ScreenVertices[3];
+
+	for (int VertexIdx = 0; VertexIdx < 3; VertexIdx++)
+	{
+		const lcVector4& Clip = *ClipVertices[VertexIdx];
+
+		if (Clip.w <= 0.0f || Clip.z < -Clip.w)
+			return;
+
+		float InverseW = 1.0f / Clip.w;
+
+		ScreenVertices[VertexIdx] = lcVector3((Clip.x * InverseW * 0.5f + 0.5f) * LC_OCCLUSION_WIDTH, (Clip.y * InverseW * 0.5f + 0.5f) * LC_OCCLUSION_HEIGHT, Clip.z * InverseW);
+	}
+
+	mNumTriangles++;
+
+	RasterizeTriangle(ScreenVertices[0], ScreenVertices[1], ScreenVertices[2]);
+}
+
+// Writes the depth of the pixels whose center is inside the triangle. Edge functions and depth are evaluated directly at each
+// pixel center, the vector and scalar loops visit the same groups of 4 pixels so both paths give the same result.
+void lcOcclusionBuffer::RasterizeTriangle(const lcVector3& v0, const lcVector3& v1, const lcVector3& v2)
+{
+	lcVector3 Points[3] = { v0, v1, v2 };
+	float Area = (Points[1].x - Points[0].x) * (Points[2].y - Points[0].y) - (Points[1].y - Points[0].y) * (Points[2].x - Points[0].x);
+
+	if (Area < 0.0f)
+	{
+		lcVector3 Swap = Points[1];
+		Points[1] = Points[2];
+		Points[2] = Swap;
+		Area = -Area;
+	}
+
+	if (!(Area > 0.0f))
+		return;
+
+	int MinX = (int)ceilf(lcMax(lcMin(lcMin(Points[0].x, Points[1].x), Points[2].x) - 0.5f, 0.0f));
+	int MaxX = (int)floorf(lcMin(lcMax(lcMax(Points[0].x, Points[1].x), Points[2].x) - 0.5f, (float)(LC_OCCLUSION_WIDTH - 1)));
+	int MinY = (int)ceilf(lcMax(lcMin(lcMin(Points[0].y, Points[1].y), Points[2].y) - 0.5f, 0.0f));
+	int MaxY = (int)floorf(lcMin(lcMax(lcMax(Points[0].y, Points[1].y), Points[2].y) - 0.5f, (float)(LC_OCCLUSION_HEIGHT - 1)));
+
+	if (MinX > MaxX || MinY > MaxY)
+		return;
+
+	// Edge Idx is opposite to vertex Idx and is positive on the inside.
+	float EdgeA[3], EdgeB[3], EdgeC[3];
+
+	for (int EdgeIdx = 0; EdgeIdx < 3; EdgeIdx++)
+	{
+		const lcVector3& a = Points[(EdgeIdx + 1) % 3];
+		const lcVector3& b = Points[(EdgeIdx + 2) % 3];
+
+		EdgeA[EdgeIdx] = a.y - b.y;
+		EdgeB[EdgeIdx] = b.x - a.x;
+		EdgeC[EdgeIdx] = a.x * b.y - a.y * b.x;
+	}
+
+	float DepthA = (EdgeA[0] * Points[0].z + EdgeA[1] * Points[1].z + EdgeA[2] * Points[2].z) / Area;
+	float DepthB = (EdgeB[0] * Points[0].z + EdgeB[1] * Points[1].z + EdgeB[2] * Points[2].z) / Area;
+	float DepthC = (EdgeC[0] * Points[0].z + EdgeC[1] * Points[1].z + EdgeC[2] * Points[2].z) / Area;
+
+	int StartX = MinX & ~3;
+	int EndX = MaxX | 3;
+
+	for (int y = MinY; y <= MaxY; y++)
+	{
+		float py = (float)y + 0.5f;
+		float Row0 = EdgeB[0] * py + EdgeC[0];
+		float Row1 = EdgeB[1] * py + EdgeC[1];
+		float Row2 = EdgeB[2] * py + EdgeC[2];
+		float RowDepth = DepthB * py + DepthC;
+		float* Depth = mDepth + y * LC_OCCLUSION_WIDTH;
+
+#ifdef LC_SIMD_SSE2
+		const __m128 Offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 Zero = _mm_setzero_ps();
+
+		for (int x = StartX; x <= EndX; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), Offsets);
+			__m128 Edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(EdgeA[0]), px), _mm_set1_ps(Row0));
+			__m128 Edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(EdgeA[1]), px), _mm_set1_ps(Row1));
+			__m128 Edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(EdgeA[2]), px), _mm_set1_ps(Row2));
+			__m128 Inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(Edge0, Zero), _mm_cmpge_ps(Edge1, Zero)), _mm_cmpge_ps(Edge2, Zero));
+
+			__m128 PixelDepth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(DepthA), px), _mm_set1_ps(RowDepth));
+			__m128 OldDepth = _mm_loadu_ps(Depth + x);
+			__m128 NewDepth = _mm_min_ps(PixelDepth, OldDepth);
+
+			_mm_storeu_ps(Depth + x, _mm_or_ps(_mm_and_ps(Inside, NewDepth), _mm_andnot_ps(Inside, OldDepth)));
+		}
+#else
+		for (int x = StartX; x <= EndX; x++)
+		{
+			float px = (float)x + 0.5f;
+			float Edge0 = EdgeA[0] * px + Row0;
+			float Edge1 = EdgeA[1] * px + Row1;
+			float Edge2 = EdgeA[2] * px + Row2;
+
+			if (Edge0 >= 0.0f && Edge1 >= 0.0f && Edge2 >= 0.0f)
+			{
+				float PixelDepth = DepthA * px + RowDepth;
+
+				if (PixelDepth < Depth[x])
+					Depth[x] = PixelDepth;
+			}
+		}
+#endif
+	}
+}
+
+void lcOcclusionBuffer::UpdateHierarchy()
+{
+	for (int TileY = 0; TileY < LC_OCCLUSION_TILES_Y; TileY++)
+	{
+		for (int TileX = 0; TileX < LC_OCCLUSION_TILES_X; TileX++)
+		{
+			const float* Depth = mDepth + TileY * LC_OCCLUSION_TILE_SIZE * LC_OCCLUSION_WIDTH + TileX * LC_OCCLUSION_TILE_SIZE;
+			float MaxDepth = Depth[0];
+
+			for (int y = 0; y < LC_OCCLUSION_TILE_SIZE; y++, Depth += LC_OCCLUSION_WIDTH)
+				for (int x = 0; x < LC_OCCLUSION_TILE_SIZE; x++)
+					MaxDepth = lcMax(MaxDepth, Depth[x]);
+
+			mTileDepth[TileY * LC_OCCLUSION_TILES_X + TileX] = MaxDepth;
+		}
+	}
+}
+
+// A box is hidden if its closest point is behind every pixel its screen rectangle touches. Tiles that are entirely
+// closer than the box are accepted without looking at their pixels.
+bool lcOcclusionBuffer::IsBoxVisible(const lcVector3& Min, const lcVector3& Max, const lcMatrix44& WorldMatrix) const
+{
+	lcMatrix44 WorldViewProjection = lcMul(WorldMatrix, mViewProjectionMatrix);
+	float MinX = FLT_MAX, MinY = FLT_MAX, MinZ = FLT_MAX;
+	float MaxX = -FLT_MAX, MaxY = -FLT_MAX;
+
+	for (int CornerIdx = 0; CornerIdx < 8; CornerIdx++)
+	{
+		lcVector3 Corner((CornerIdx & 1) ? Max.x : Min.x, (CornerIdx & 2) ? Max.y : Min.y, (CornerIdx & 4) ? Max.z : Min.z);
+		lcVector4 Clip = lcMul4(lcVector4(Corner, 1.0f), WorldViewProjection);
+
+		if (Clip.w <= 0.0f || Clip.z < -Clip.w)
+			return true;
+
+		float InverseW = 1.0f / Clip.w;
+		float x = Clip.x * InverseW;
+		float y = Clip.y * InverseW;
+		float z = Clip.z * InverseW;
+
+		MinX = lcMin(MinX, x);
+		MinY = lcMin(MinY, y);
+		MinZ = lcMin(MinZ, z);
+		MaxX = lcMax(MaxX, x);
+		MaxY = lcMax(MaxY, y);
+	}
+
+	int X0 = (int)floorf(lcClamp((MinX * 0.5f + 0.5f) * LC_OCCLUSION_WIDTH, 0.0f, (float)(LC_OCCLUSION_WIDTH - 1)));
+	int X1 = (int)floorf(lcClamp((MaxX * 0.5f + 0.5f) * LC_OCCLUSION_WIDTH, 0.0f, (float)(LC_OCCLUSION_WIDTH - 1)));
+	int Y0 = (int)floorf(lcClamp((MinY * 0.5f + 0.5f) * LC_OCCLUSION_HEIGHT, 0.0f, (float)(LC_OCCLUSION_HEIGHT - 1)));
+	int Y1 = (int)floorf(lcClamp((MaxY * 0.5f + 0.5f) * LC_OCCLUSION_HEIGHT, 0.0f, (float)(LC_OCCLUSION_HEIGHT - 1)));
+
+	for (int TileY = Y0 / LC_OCCLUSION_TILE_SIZE; TileY <= Y1 / LC_OCCLUSION_TILE_SIZE; TileY++)
+	{
+		for (int TileX = X0 / LC_OCCLUSION_TILE_SIZE; TileX <= X1 / LC_OCCLUSION_TILE_SIZE; TileX++)
+		{
+			if (MinZ > mTileDepth[TileY * LC_OCCLUSION_TILES_X + TileX])
+				continue;
+
+			int TileX0 = lcMax(X0, TileX * LC_OCCLUSION_TILE_SIZE);
+			int TileX1 = lcMin(X1, TileX * LC_OCCLUSION_TILE_SIZE + LC_OCCLUSION_TILE_SIZE - 1);
+			int TileY0 = lcMax(Y0, TileY * LC_OCCLUSION_TILE_SIZE);
+			int TileY1 = lcMin(Y1, TileY * LC_OCCLUSION_TILE_SIZE + LC_OCCLUSION_TILE_SIZE - 1);
+
+			for (int y = TileY0; y <= TileY1; y++)
+			{
+				const float* Depth = mDepth + y * LC_OCCLUSION_WIDTH;
+
+				for (int x = TileX0; x <= TileX1; x++)
+					if (MinZ <= Depth[x])
+						return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static void lcOcclusionTestBoxTriangles(const lcVector3& Min, const lcVector3& Max, lcVector3* Vertices)
+{
+	// Corner bit 0 picks the maximum x, bit 1 the maximum y and bit 2 the maximum z, two triangles for each face.
+	const int Faces[6][4] = { { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 } };
+
+	for (int FaceIdx = 0; FaceIdx < 6; FaceIdx++)
+	{
+		const int Triangles[6] = { Faces[FaceIdx][0], Faces[FaceIdx][1], Faces[FaceIdx][2], Faces[FaceIdx][0], Faces[FaceIdx][2], Faces[FaceIdx][3] };
+
+		for (int VertexIdx = 0; VertexIdx < 6; VertexIdx++)
+		{
+			int Corner = Triangles[VertexIdx];
+			*Vertices++ = lcVector3((Corner & 1) ? Max.x : Min.x, (Corner & 2) ? Max.y : Min.y, (Corner & 4) ? Max.z : Min.z);
+		}
+	}
+}
+
+bool lcOcclusionTest()
+{
+	lcOcclusionBuffer* OcclusionBuffer = new lcOcclusionBuffer();
+	lcMatrix44 ViewMatrix = lcMatrix44LookAt(lcVector3(0.0f, -100.0f, 0.0f), lcVector3(0.0f, 0.0f, 0.0f), lcVector3(0.0f, 0.0f, 1.0f));
+	lcMatrix44 ProjectionMatrix = lcMatrix44Perspective(30.0f, (float)LC_OCCLUSION_WIDTH / (float)LC_OCCLUSION_HEIGHT, 1.0f, 1000.0f);
+	lcVector3 Vertices[36];
+
+	OcclusionBuffer->Clear(lcMul(ViewMatrix, ProjectionMatrix));
+	lcOcclusionTestBoxTriangles(lcVector3(-10.0f, -10.0f, -10.0f), lcVector3(10.0f, 10.0f, 10.0f), Vertices);
+	OcclusionBuffer->DrawTriangles(Vertices, 12, lcMatrix44Identity());
+	OcclusionBuffer->UpdateHierarchy();
+
+	// The camera looks down the y axis at the occluder, the first box is right behind it and the second one next to it.
+	bool BehindVisible = OcclusionBuffer->IsBoxVisible(lcVector3(-5.0f, 20.0f, -5.0f), lcVector3(5.0f, 30.0f, 5.0f), lcMatrix44Identity());
+	bool BesideVisible = OcclusionBuffer->IsBoxVisible(lcVector3(20.0f, -5.0f, -5.0f), lcVector3(30.0f, 5.0f, 5.0f), lcMatrix44Identity());
+
+	delete OcclusionBuffer;
+
+	printf("Occlusion test: box behind the occluder %s, box beside it %s.\n", BehindVisible ? "visible" : "hidden", BesideVisible ? "visible" : "hidden");
+
+	if (BehindVisible)
+		fprintf(stderr, "ERROR: The box behind the occluder should be hidden.\n");
+
+	if (!BesideVisible)
+		fprintf(stderr, "ERROR: The box beside the occluder should be visible.\n");
+
+	return !BehindVisible && BesideVisible;
+}
@@ -0,0 +1,63 @@
+#ifndef _LC_OCCLUSION_H_
+#define _LC_OCCLUSION_H_
+
+#include "lc_array.h"
+#include "lc_math.h"
+
+#define LC_OCCLUSION_WIDTH 256
+#define LC_OCCLUSION_HEIGHT 160
+#define LC_OCCLUSION_TILE_SIZE 8
+#define LC_OCCLUSION_TILES_X (LC_OCCLUSION_WIDTH / LC_OCCLUSION_TILE_SIZE)
+#define LC_OCCLUSION_TILES_Y (LC_OCCLUSION_HEIGHT / LC_OCCLUSION_TILE_SIZE)
+#define LC_OCCLUSION_MAX_OCCLUDERS 128
+#define LC_OCCLUSION_MAX_TRIANGLES 131072
+#define LC_OCCLUSION_MIN_OCCLUDER_SIZE 0.03f
+
+// Low resolution depth buffer drawn on the CPU with the opaque triangles of the largest pieces near the camera, pieces
+// whose bounds are behind it don't need to be drawn. Depths are normalized device z values and the result only depends
+// on what was drawn, in the same order, so it's the same every time.
+class lcOcclusionBuffer
+{
+public:
+	lcOcclusionBuffer();
+
+	void Clear(const lcMatrix44& ViewProjectionMatrix);
+
+	// Draws the opaque triangle sections of a mesh, ColorIndex replaces the default color like when the mesh is drawn.
+	void DrawMesh(const lcMesh* Mesh, const lcMatrix44& WorldMatrix, int ColorIndex);
+	void DrawTriangles(const lcVector3* Vertices, int NumTriangles, const lcMatrix44& WorldMatrix);
+
+	// Updates the farthest depth of each tile, must be called after drawing and before testing.
+	void UpdateHierarchy();
+
+	bool IsBoxVisible(const lcVector3& Min, const lcVector3& Max, const lcMatrix44& WorldMatrix) const;
+
+	bool IsFull() const
+	{
+		return mNumTriangles >= LC_OCCLUSION_MAX_TRIANGLES;
+	}
+
+	float GetDepth(int x, int y) const
+	{
+		return mDepth[y * LC_OCCLUSION_WIDTH + x];
+	}
+
+protected:
+	template<typename IndexType>
+	void DrawMeshSection(const lcMesh* Mesh, const lcMeshSection* Section);
+	void DrawClipTriangle(const lcVector4& v0, const lcVector4& v1, const lcVector4& v2);
+	void RasterizeTriangle(const lcVector3& v0, const lcVector3& v1, const lcVector3& v2);
+
+	lcMatrix44 mViewProjectionMatrix;
+	int mNumTriangles;
+	lcArray<lcVector4> mClipVertices;
+	lcArray<lcVector4> mClipTexturedVertices;
+	float mDepth[LC_OCCLUSION_WIDTH * LC_OCCLUSION_HEIGHT];
+	float mTileDepth[LC_OCCLUSION_TILES_X * LC_OCCLUSION_TILES_Y];
+};
+
+// Draws a box and checks that it hides a box behind it but not one beside it, prints the results and returns false if
+// either is wrong.
+bool lcOcclusionTest();
+
+#endif // _LC_OCCLUSION_H_
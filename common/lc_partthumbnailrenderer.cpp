@@ -0,0 +1,277 @@
+#include "lc_global.h"
+#include "lc_partthumbnailrenderer.h"
+#include "lc_mainwindow.h"
+#include "lc_library.h"
+#include "lc_context.h"
+#include "pieceinf.h"
+#include "preview.h"
+#include "opengl.h"
+
+class lcThumbnailLoadTask : public QRunnable
+{
+public:
+	lcThumbnailLoadTask(lcPartThumbnailRenderer* Renderer, int Generation, PieceInfo* Info, const QString& FileName)
+		: mRenderer(Renderer), mGeneration(Generation), mInfo(Info), mFileName(FileName)
+	{
+	}
+
+	virtual void run()
+	{
+		QImage Image(mFileName);
+
+		QMetaObject::invokeMethod(mRenderer, "ThumbnailLoaded", Qt::QueuedConnection, Q_ARG(int, mGeneration), Q_ARG(void*, mInfo), Q_ARG(QImage, Image));
+	}
+
+protected:
+	lcPartThumbnailRenderer* mRenderer;
+	int mGeneration;
+	PieceInfo* mInfo;
+	QString mFileName;
+};
+
+class lcThumbnailPieceTask : public QRunnable
+{
+public:
+	lcThumbnailPieceTask(lcPartThumbnailRenderer* Renderer, int Generation, PieceInfo* Info)
+		: mRenderer(Renderer), mGeneration(Generation), mInfo(Info)
+	{
+	}
+
+	virtual void run()
+	{
+		lcGetPiecesLibrary()->PreloadPiece(mInfo);
+
+		QMetaObject::invokeMethod(mRenderer, "PieceRead", Qt::QueuedConnection, Q_ARG(int, mGeneration), Q_ARG(void*, mInfo));
+	}
+
+protected:
+	lcPartThumbnailRenderer* mRenderer;
+	int mGeneration;
+	PieceInfo* mInfo;
+};
+
+lcPartThumbnailRenderer::lcPartThumbnailRenderer(QObject* Parent)
+	: QObject(Parent)
+{
+	mGeneration = 0;
+	mCacheCreated = false;
+
+	mThreadPool.setMaxThreadCount(2);
+
+	mRenderTimer.setSingleShot(true);
+	mRenderTimer.setInterval(0);
+	connect(&mRenderTimer, SIGNAL(timeout()), this, SLOT(RenderThumbnails()));
+}
+
+lcPartThumbnailRenderer::~lcPartThumbnailRenderer()
+{
+	mThreadPool.waitForDone();
+}
+
+void lcPartThumbnailRenderer::Clear()
+{
+	mRenderTimer.stop();
+	mThumbnails.clear();
+	mLoadingPieces.clear();
+	mReadingPieces.clear();
+	mReadPieces.clear();
+	mRenderQueue.RemoveAll();
+	mCacheCreated = false;
+
+	// Images that are still being read belong to pieces that may not exist anymore.
+	mGeneration++;
+}
+
+QString lcPartThumbnailRenderer::GetCacheFileName(PieceInfo* Info)
+{
+	QString FileName = lcGetPiecesLibrary()->GetThumbnailCacheFileName(Info, gDefaultColor, LC_THUMBNAIL_SIZE, LC_THUMBNAIL_SIZE);
+
+	if (!FileName.isEmpty() && !mCacheCreated)
+	{
+		QDir().mkpath(QFileInfo(FileName).absolutePath());
+		mCacheCreated = true;
+	}
+
+	return FileName;
+}
+
+void lcPartThumbnailRenderer::RequestThumbnails(const lcArray<PieceInfo*>& Pieces)
+{
+	mRenderQueue.RemoveAll();
+
+	for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
+	{
+		PieceInfo* Info = Pieces[PieceIdx];
+
+		if (Info->IsTemporary() || mThumbnails.contains(Info) || mLoadingPieces.contains(Info))
+			continue;
+
+		QString FileName = GetCacheFileName(Info);
+
+		if (FileName.isEmpty())
+		{
+			mRenderQueue.Add(Info);
+			continue;
+		}
+
+		mLoadingPieces.insert(Info);
+		mThreadPool.start(new lcThumbnailLoadTask(this, mGeneration, Info, FileName));
+	}
+
+	if (!mRenderQueue.IsEmpty())
+		mRenderTimer.start();
+}
+
+void lcPartThumbnailRenderer::ThumbnailLoaded(int Generation, void* Data, const QImage& Image)
+{
+	if (Generation != mGeneration)
+		return;
+
+	PieceInfo* Info = (PieceInfo*)Data;
+	mLoadingPieces.remove(Info);
+
+	if (Image.isNull())
+	{
+		if (mRenderQueue.FindIndex(Info) == -1)
+			mRenderQueue.Add(Info);
+
+		mRenderTimer.start();
+		return;
+	}
+
+	mThumbnails.insert(Info, QPixmap::fromImage(Image));
+
+	emit ThumbnailsReady();
+}
+
+void lcPartThumbnailRenderer::PieceRead(int Generation, void* Data)
+{
+	// Pieces read for an old generation stay preloaded in the library until they're loaded or the library is unloaded.
+	if (Generation != mGeneration)
+		return;
+
+	PieceInfo* Info = (PieceInfo*)Data;
+	mReadingPieces.remove(Info);
+	mReadPieces.insert(Info);
+
+	mRenderTimer.start();
+}
+
+void lcPartThumbnailRenderer::RenderThumbnails()
+{
+	if (mRenderQueue.IsEmpty() || !gMainWindow || !gMainWindow->mPreviewWidget)
+		return;
+
+	gMainWindow->mPreviewWidget->MakeCurrent();
+	lcContext* Context = gMainWindow->mPreviewWidget->mContext;
+
+	const int BatchSize = LC_THUMBNAIL_BATCH_COLUMNS * LC_THUMBNAIL_BATCH_ROWS;
+	lcArray<PieceInfo*> Pieces;
+	int NumWaiting = 0;
+	QElapsedTimer Timer;
+	Timer.start();
+
+	// Pieces that haven't been read yet are skipped until a worker has read their files, creating the meshes of the
+	// others still takes time so the batch is drawn early if it's taking too long.
+	for (int QueueIdx = 0; QueueIdx < mRenderQueue.GetSize() && Pieces.GetSize() < BatchSize; )
+	{
+		if (!Pieces.IsEmpty() && Timer.elapsed() > LC_THUMBNAIL_TIME_BUDGET)
+			break;
+
+		PieceInfo* Info = mRenderQueue[QueueIdx];
+
+		if (mThumbnails.contains(Info))
+		{
+			mRenderQueue.RemoveIndex(QueueIdx);
+			continue;
+		}
+
+		if (!Info->IsLoaded() && !mReadPieces.contains(Info))
+		{
+			if (!mReadingPieces.contains(Info) && mReadingPieces.size() < BatchSize)
+			{
+				mReadingPieces.insert(Info);
+				mThreadPool.start(new lcThumbnailPieceTask(this, mGeneration, Info));
+			}
+
+			NumWaiting++;
+			QueueIdx++;
+			continue;
+		}
+
+		mRenderQueue.RemoveIndex(QueueIdx);
+		mReadPieces.remove(Info);
+
+		Info->AddRef();
+		Pieces.Add(Info);
+	}
+
+	const int Size = LC_THUMBNAIL_SIZE;
+	int BatchWidth = LC_THUMBNAIL_BATCH_COLUMNS * Size;
+	int BatchHeight = ((Pieces.GetSize() + LC_THUMBNAIL_BATCH_COLUMNS - 1) / LC_THUMBNAIL_BATCH_COLUMNS) * Size;
+
+	if (!Pieces.IsEmpty() && Context->BeginRenderToTexture(BatchWidth, BatchHeight))
+	{
+		lcMatrix44 ProjectionMatrix = lcMatrix44Perspective(30.0f, 1.0f, 1.0f, 2500.0f);
+		lcMatrix44 ViewMatrix;
+
+		Context->SetDefaultState();
+		Context->SetProjectionMatrix(ProjectionMatrix);
+		Context->SetViewport(0, 0, BatchWidth, BatchHeight);
+
+		glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
+		{
+			PieceInfo* Info = Pieces[PieceIdx];
+
+			Context->SetViewport((PieceIdx % LC_THUMBNAIL_BATCH_COLUMNS) * Size, (PieceIdx / LC_THUMBNAIL_BATCH_COLUMNS) * Size, Size, Size);
+
+			lcVector3 CameraPosition(-100.0f, -100.0f, 75.0f);
+			Info->ZoomExtents(ProjectionMatrix, ViewMatrix, CameraPosition);
+
+			lcScene Scene;
+			Scene.Begin(ViewMatrix, ProjectionMatrix);
+
+			Info->AddRenderMeshes(Scene, lcMatrix44Identity(), gDefaultColor, false, false);
+
+			Scene.End();
+
+			Context->DrawOpaqueMeshes(Scene);
+			Context->DrawTranslucentMeshes(Scene);
+
+			Context->UnbindMesh(); // context remove
+		}
+
+		QImage BatchImage(BatchWidth, BatchHeight, QImage::Format_ARGB32);
+		glReadPixels(0, 0, BatchWidth, BatchHeight, GL_BGRA, GL_UNSIGNED_BYTE, BatchImage.bits());
+		BatchImage = BatchImage.mirrored();
+
+		Context->EndRenderToTexture();
+
+		for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
+		{
+			PieceInfo* Info = Pieces[PieceIdx];
+			int Row = PieceIdx / LC_THUMBNAIL_BATCH_COLUMNS;
+			QImage Image = BatchImage.copy((PieceIdx % LC_THUMBNAIL_BATCH_COLUMNS) * Size, BatchHeight - (Row + 1) * Size, Size, Size);
+
+			mThumbnails.insert(Info, QPixmap::fromImage(Image));
+
+			QString FileName = GetCacheFileName(Info);
+
+			if (!FileName.isEmpty())
+				mCacheWriter.Write(FileName, Image);
+		}
+	}
+
+	for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
+		Pieces[PieceIdx]->Release();
+
+	if (!Pieces.IsEmpty())
+		emit ThumbnailsReady();
+
+	// The timer is started again by PieceRead when all the pieces left are waiting to be read.
+	if (mRenderQueue.GetSize() > NumWaiting)
+		mRenderTimer.start();
+}
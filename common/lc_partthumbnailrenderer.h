@@ -0,0 +1,58 @@
+#ifndef _LC_PARTTHUMBNAILRENDERER_H_
+#define _LC_PARTTHUMBNAILRENDERER_H_
+
+#include "lc_array.h"
+#include "lc_imagewriter.h"
+
+#define LC_THUMBNAIL_SIZE 32
+#define LC_THUMBNAIL_BATCH_COLUMNS 8
+#define LC_THUMBNAIL_BATCH_ROWS 8
+#define LC_THUMBNAIL_TIME_BUDGET 25
+
+// Creates the small piece images shown in the parts tree. Images cached next to the library cache are read on worker
+// threads, the others are drawn a batch at a time side by side in one texture and saved to the cache. The files of the
+// pieces to draw are also read on worker threads, the timer that draws each batch only creates their meshes and stops
+// after LC_THUMBNAIL_TIME_BUDGET milliseconds so the window keeps responding between batches.
+class lcPartThumbnailRenderer : public QObject
+{
+	Q_OBJECT
+
+public:
+	lcPartThumbnailRenderer(QObject* Parent);
+	~lcPartThumbnailRenderer();
+
+	// Forgets all images, must be called before the library is reloaded.
+	void Clear();
+
+	QPixmap GetThumbnail(PieceInfo* Info) const
+	{
+		return mThumbnails.value(Info);
+	}
+
+	// Replaces the pieces waiting to be drawn, they're drawn in the order given.
+	void RequestThumbnails(const lcArray<PieceInfo*>& Pieces);
+
+signals:
+	void ThumbnailsReady();
+
+protected slots:
+	void RenderThumbnails();
+	void ThumbnailLoaded(int Generation, void* Info, const QImage& Image);
+	void PieceRead(int Generation, void* Info);
+
+protected:
+	QString GetCacheFileName(PieceInfo* Info);
+
+	QHash<PieceInfo*, QPixmap> mThumbnails;
+	QSet<PieceInfo*> mLoadingPieces;
+	QSet<PieceInfo*> mReadingPieces;
+	QSet<PieceInfo*> mReadPieces;
+	lcArray<PieceInfo*> mRenderQueue;
+	QTimer mRenderTimer;
+	QThreadPool mThreadPool;
+	lcImageWriter mCacheWriter;
+	int mGeneration;
+	bool mCacheCreated;
+};
+
+#endif // _LC_PARTTHUMBNAILRENDERER_H_
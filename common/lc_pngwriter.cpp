@@ -0,0 +1,277 @@
+#include "lc_global.h"
+#include "lc_pngwriter.h"
+#include <zlib.h>
+
+#define LC_PNGWRITER_CHUNK_SIZE (256 * 1024)
+
+class lcPngWriterTask : public QRunnable
+{
+public:
+	lcPngWriterTask(lcPngWriter* Writer, const lcuint8* Pixels, int NumRows)
+		: mWriter(Writer), mPixels(Pixels), mNumRows(NumRows)
+	{
+	}
+
+	virtual void run()
+	{
+		mWriter->WriteRows(mPixels, mNumRows);
+		mWriter->mFreeBuffers.release();
+	}
+
+protected:
+	lcPngWriter* mWriter;
+	const lcuint8* mPixels;
+	int mNumRows;
+};
+
+static void lcWriteBigEndian32(lcuint8* Buffer, lcuint32 Value)
+{
+	Buffer[0] = (lcuint8)(Value >> 24);
+	Buffer[1] = (lcuint8)(Value >> 16);
+	Buffer[2] = (lcuint8)(Value >> 8);
+	Buffer[3] = (lcuint8)Value;
+}
+
+lcPngWriter::lcPngWriter()
+	: mFreeBuffers(LC_PNGWRITER_BUFFERS)
+{
+	mWidth = 0;
+	mHeight = 0;
+	mMaxRows = 0;
+	mRowsWritten = 0;
+	mError = false;
+	mStream = NULL;
+	mRowBuffer = NULL;
+	mOutputBuffer = NULL;
+	memset(mBuffers, 0, sizeof(mBuffers));
+	mCurrentBuffer = 0;
+
+	// A single thread compresses the bands in the order they were queued.
+	mThreadPool.setMaxThreadCount(1);
+}
+
+lcPngWriter::~lcPngWriter()
+{
+	Abort();
+
+	for (int BufferIdx = 0; BufferIdx < LC_PNGWRITER_BUFFERS; BufferIdx++)
+		free(mBuffers[BufferIdx]);
+
+	free(mRowBuffer);
+	free(mOutputBuffer);
+}
+
+bool lcPngWriter::Open(const QString& FileName, int Width, int Height, int MaxRows)
+{
+	if (Width <= 0 || Height <= 0 || MaxRows <= 0 || !mFile.Open(FileName, "wb"))
+		return false;
+
+	mFileName = FileName;
+	mWidth = Width;
+	mHeight = Height;
+	mMaxRows = MaxRows;
+
+	for (int BufferIdx = 0; BufferIdx < LC_PNGWRITER_BUFFERS; BufferIdx++)
+		mBuffers[BufferIdx] = (lcuint8*)malloc((size_t)Width * MaxRows * 4);
+
+	mRowBuffer = (lcuint8*)malloc((size_t)Width * 4 + 1);
+	mOutputBuffer = (lcuint8*)malloc(LC_PNGWRITER_CHUNK_SIZE);
+
+	bool BuffersAllocated = mRowBuffer && mOutputBuffer;
+
+	for (int BufferIdx = 0; BufferIdx < LC_PNGWRITER_BUFFERS; BufferIdx++)
+		if (!mBuffers[BufferIdx])
+			BuffersAllocated = false;
+
+	if (!BuffersAllocated)
+	{
+		Abort();
+		return false;
+	}
+
+	z_stream* Stream = new z_stream;
+	memset(Stream, 0, sizeof(z_stream));
+
+	if (deflateInit(Stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		delete Stream;
+		Abort();
+		return false;
+	}
+
+	Stream->next_out = mOutputBuffer;
+	Stream->avail_out = LC_PNGWRITER_CHUNK_SIZE;
+	mStream = Stream;
+
+	const lcuint8 Signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	mFile.WriteBuffer(Signature, sizeof(Signature));
+
+	// 8 bits per channel RGBA, no interlacing.
+	lcuint8 Header[13];
+	lcWriteBigEndian32(Header, Width);
+	lcWriteBigEndian32(Header + 4, Height);
+	Header[8] = 8;
+	Header[9] = 6;
+	Header[10] = 0;
+	Header[11] = 0;
+	Header[12] = 0;
+	WriteChunk("IHDR", Header, sizeof(Header));
+
+	if (mError)
+	{
+		Abort();
+		return false;
+	}
+
+	return true;
+}
+
+bool lcPngWriter::Close()
+{
+	if (!mStream)
+	{
+		Abort();
+		return false;
+	}
+
+	mThreadPool.waitForDone();
+
+	z_stream* Stream = (z_stream*)mStream;
+	Deflate(Z_FINISH);
+
+	if (Stream->avail_out != LC_PNGWRITER_CHUNK_SIZE)
+		WriteChunk("IDAT", mOutputBuffer, LC_PNGWRITER_CHUNK_SIZE - Stream->avail_out);
+
+	WriteChunk("IEND", NULL, 0);
+
+	deflateEnd(Stream);
+	delete Stream;
+	mStream = NULL;
+
+	mFile.Close();
+
+	if (mError || mRowsWritten != mHeight)
+	{
+		Abort();
+		return false;
+	}
+
+	mFileName.clear();
+
+	return true;
+}
+
+void lcPngWriter::Abort()
+{
+	mThreadPool.waitForDone();
+
+	if (mStream)
+	{
+		deflateEnd((z_stream*)mStream);
+		delete (z_stream*)mStream;
+		mStream = NULL;
+	}
+
+	mFile.Close();
+
+	if (!mFileName.isEmpty())
+	{
+		QFile::remove(mFileName);
+		mFileName.clear();
+	}
+}
+
+lcuint8* lcPngWriter::BeginRows()
+{
+	mFreeBuffers.acquire();
+
+	return mBuffers[mCurrentBuffer];
+}
+
+void lcPngWriter::EndRows(int NumRows)
+{
+	mThreadPool.start(new lcPngWriterTask(this, mBuffers[mCurrentBuffer], lcMin(NumRows, mMaxRows)));
+	mCurrentBuffer = (mCurrentBuffer + 1) % LC_PNGWRITER_BUFFERS;
+}
+
+// Converts the rows to RGBA from the top down with the Sub filter, which only needs the pixel to the left.
+void lcPngWriter::WriteRows(const lcuint8* Pixels, int NumRows)
+{
+	z_stream* Stream = (z_stream*)mStream;
+	int Stride = mWidth * 4;
+
+	for (int Row = NumRows - 1; Row >= 0 && mRowsWritten < mHeight; Row--)
+	{
+		const lcuint8* Source = Pixels + (size_t)Row * Stride;
+		lcuint8* Dest = mRowBuffer;
+		lcuint8 Left[4] = { 0, 0, 0, 0 };
+
+		*Dest++ = 1;
+
+		for (int x = 0; x < mWidth; x++)
+		{
+			lcuint8 Pixel[4] = { Source[2], Source[1], Source[0], Source[3] };
+
+			*Dest++ = Pixel[0] - Left[0];
+			*Dest++ = Pixel[1] - Left[1];
+			*Dest++ = Pixel[2] - Left[2];
+			*Dest++ = Pixel[3] - Left[3];
+
+			memcpy(Left, Pixel, sizeof(Left));
+			Source += 4;
+		}
+
+		Stream->next_in = mRowBuffer;
+		Stream->avail_in = Stride + 1;
+		Deflate(Z_NO_FLUSH);
+
+		mRowsWritten++;
+	}
+}
+
+// Each time the output buffer fills up it's written as an IDAT chunk.
+void lcPngWriter::Deflate(int FlushMode)
+{
+	z_stream* Stream = (z_stream*)mStream;
+
+	for (;;)
+	{
+		int Result = deflate(Stream, FlushMode);
+		bool Full = Stream->avail_out == 0;
+
+		if (Full)
+		{
+			WriteChunk("IDAT", mOutputBuffer, LC_PNGWRITER_CHUNK_SIZE);
+			Stream->next_out = mOutputBuffer;
+			Stream->avail_out = LC_PNGWRITER_CHUNK_SIZE;
+		}
+
+		if (Result == Z_STREAM_END || (!Full && FlushMode != Z_FINISH))
+			break;
+
+		if (Result != Z_OK && Result != Z_BUF_ERROR)
+		{
+			mError = true;
+			break;
+		}
+	}
+}
+
+void lcPngWriter::WriteChunk(const char* Type, const lcuint8* Data, lcuint32 Length)
+{
+	lcuint8 Header[8];
+	lcWriteBigEndian32(Header, Length);
+	memcpy(Header + 4, Type, 4);
+
+	lcuint32 Crc = crc32(0, Header + 4, 4);
+
+	if (Length)
+		Crc = crc32(Crc, Data, Length);
+
+	lcuint8 Footer[4];
+	lcWriteBigEndian32(Footer, Crc);
+
+	if (mFile.WriteBuffer(Header, sizeof(Header)) != sizeof(Header) || (Length && mFile.WriteBuffer(Data, Length) != Length) ||
+	    mFile.WriteBuffer(Footer, sizeof(Footer)) != sizeof(Footer))
+		mError = true;
+}
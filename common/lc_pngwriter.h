@@ -0,0 +1,52 @@
+#ifndef _LC_PNGWRITER_H_
+#define _LC_PNGWRITER_H_
+
+#include "lc_file.h"
+
+#define LC_PNGWRITER_BUFFERS 2
+
+// Writes a PNG file a band of rows at a time so images too large to fit in memory can be saved. Bands are filtered and
+// compressed in order on a worker thread while the caller draws the next one, only LC_PNGWRITER_BUFFERS bands are
+// allocated no matter how tall the image is.
+class lcPngWriter
+{
+public:
+	lcPngWriter();
+	~lcPngWriter();
+
+	// Open() and Close() delete the file if they fail, Abort() stops writing and deletes the unfinished file. The file is
+	// also deleted if the writer is destroyed before Close() is called.
+	bool Open(const QString& FileName, int Width, int Height, int MaxRows);
+	bool Close();
+	void Abort();
+
+	// Returns a buffer for up to MaxRows rows of BGRA pixels, waiting until one is free. Rows go from the bottom to the
+	// top like the ones read from OpenGL, EndRows() queues them to be written after the rows of the previous call.
+	lcuint8* BeginRows();
+	void EndRows(int NumRows);
+
+protected:
+	friend class lcPngWriterTask;
+
+	void WriteRows(const lcuint8* Pixels, int NumRows);
+	void Deflate(int FlushMode);
+	void WriteChunk(const char* Type, const lcuint8* Data, lcuint32 Length);
+
+	lcDiskFile mFile;
+	QString mFileName;
+	int mWidth;
+	int mHeight;
+	int mMaxRows;
+	int mRowsWritten;
+	bool mError;
+
+	void* mStream;
+	lcuint8* mRowBuffer;
+	lcuint8* mOutputBuffer;
+	lcuint8* mBuffers[LC_PNGWRITER_BUFFERS];
+	int mCurrentBuffer;
+	QThreadPool mThreadPool;
+	QSemaphore mFreeBuffers;
+};
+
+#endif // _LC_PNGWRITER_H_
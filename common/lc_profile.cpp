@@ -59,6 +59,14 @@ lcProfileEntry gProfileEntries[LC_NUM_PROFILE_KEYS] =
 	lcProfileEntry("Settings", "GridLineSpacing", 5),                                // LC_PROFILE_GRID_LINE_SPACING
 	lcProfileEntry("Settings", "GridLineColor", LC_RGBA(0, 0, 0, 255)),              // LC_PROFILE_GRID_LINE_COLOR
 	lcProfileEntry("Settings", "AASamples", 1),                                      // LC_PROFILE_ANTIALIASING_SAMPLES
+	lcProfileEntry("Settings", "CompactMeshes", 0),                                  // LC_PROFILE_COMPACT_MESHES
+	lcProfileEntry("Settings", "IDBufferPicking", 0),                                // LC_PROFILE_ID_BUFFER_PICKING
+	lcProfileEntry("Settings", "StaticBatching", 0),                                 // LC_PROFILE_STATIC_BATCHING
+	lcProfileEntry("Settings", "ShaderRendering", 0),                                // LC_PROFILE_SHADER_RENDERING
+	lcProfileEntry("Settings", "BlendedTransparency", 0),                            // LC_PROFILE_BLENDED_TRANSPARENCY
+	lcProfileEntry("Settings", "OcclusionCulling", 0),                               // LC_PROFILE_OCCLUSION_CULLING
+	lcProfileEntry("Settings", "AdaptiveQuality", 0),                                // LC_PROFILE_ADAPTIVE_QUALITY
+	lcProfileEntry("Settings", "ShowFrameStats", 0),                                 // LC_PROFILE_SHOW_FRAME_STATS
 
 	lcProfileEntry("Settings", "CheckUpdates", 1),                                   // LC_PROFILE_CHECK_UPDATES
 	lcProfileEntry("Settings", "ProjectsPath", ""),                                  // LC_PROFILE_PROJECTS_PATH
@@ -15,6 +15,14 @@ enum LC_PROFILE_KEY
 	LC_PROFILE_GRID_LINE_SPACING,
 	LC_PROFILE_GRID_LINE_COLOR,
 	LC_PROFILE_ANTIALIASING_SAMPLES,
+	LC_PROFILE_COMPACT_MESHES,
+	LC_PROFILE_ID_BUFFER_PICKING,
+	LC_PROFILE_STATIC_BATCHING,
+	LC_PROFILE_SHADER_RENDERING,
+	LC_PROFILE_BLENDED_TRANSPARENCY,
+	LC_PROFILE_OCCLUSION_CULLING,
+	LC_PROFILE_ADAPTIVE_QUALITY,
+	LC_PROFILE_SHOW_FRAME_STATS,
 
 	LC_PROFILE_CHECK_UPDATES,
 	LC_PROFILE_PROJECTS_PATH,
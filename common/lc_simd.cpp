@@ -0,0 +1,527 @@
+#include "lc_global.h"
+#include "lc_simd.h"
+#include "lc_mesh.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LC_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || (defined(_MSC_VER) && _MSC_VER >= 1800)
+#define LC_SIMD_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LC_TARGET_AVX2
+#else
+#define LC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+// Kernels return a bit mask of the triangles hit closer than MaxT and store the distance to each triangle in T.
+typedef int (*lcRayTriangleKernel)(const lcTrianglePacket& Packet, const lcVector3& Start, const lcVector3& Direction, float MaxT, float* T);
+typedef void (*lcPlanesKernel)(const lcTrianglePacket& Packet, const lcVector4 Planes[6], int& InsideMask, int& ClipMask);
+
+struct lcSimdKernels
+{
+	const char* Name;
+	lcRayTriangleKernel RayTriangle;
+	lcPlanesKernel Planes;
+};
+
+#define LC_SIMD_MAX_KERNELS 3
+
+// Moller-Trumbore ray triangle intersection, the vector kernels do the same operations in the same order.
+static int lcRayTriangleKernelScalar(const lcTrianglePacket& Packet, const lcVector3& Start, const lcVector3& Direction, float MaxT, float* T)
+{
+	int HitMask = 0;
+
+	for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+	{
+		lcVector3 v0(Packet.v0[0][Lane], Packet.v0[1][Lane], Packet.v0[2][Lane]);
+		lcVector3 Edge1 = lcVector3(Packet.v1[0][Lane], Packet.v1[1][Lane], Packet.v1[2][Lane]) - v0;
+		lcVector3 Edge2 = lcVector3(Packet.v2[0][Lane], Packet.v2[1][Lane], Packet.v2[2][Lane]) - v0;
+
+		lcVector3 P = lcCross(Direction, Edge2);
+		float Det = lcDot(Edge1, P);
+
+		if (Det == 0.0f)
+			continue;
+
+		float InverseDet = 1.0f / Det;
+		lcVector3 S = Start - v0;
+		float u = lcDot(S, P) * InverseDet;
+
+		lcVector3 Q = lcCross(S, Edge1);
+		float v = lcDot(Direction, Q) * InverseDet;
+		float t = lcDot(Edge2, Q) * InverseDet;
+
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= MaxT)
+		{
+			T[Lane] = t;
+			HitMask |= 1 << Lane;
+		}
+	}
+
+	return HitMask;
+}
+
+static void lcPlanesKernelScalar(const lcTrianglePacket& Packet, const lcVector4 Planes[6], int& InsideMask, int& ClipMask)
+{
+	InsideMask = 0;
+	ClipMask = 0;
+
+	for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+	{
+		lcVector3 Points[3] =
+		{
+			lcVector3(Packet.v0[0][Lane], Packet.v0[1][Lane], Packet.v0[2][Lane]),
+			lcVector3(Packet.v1[0][Lane], Packet.v1[1][Lane], Packet.v1[2][Lane]),
+			lcVector3(Packet.v2[0][Lane], Packet.v2[1][Lane], Packet.v2[2][Lane])
+		};
+		int Outcodes[3] = { 0, 0, 0 };
+
+		for (int PointIdx = 0; PointIdx < 3; PointIdx++)
+			for (int PlaneIdx = 0; PlaneIdx < 6; PlaneIdx++)
+				if (lcDot3(Points[PointIdx], Planes[PlaneIdx]) + Planes[PlaneIdx][3] > 0.0f)
+					Outcodes[PointIdx] |= 1 << PlaneIdx;
+
+		if ((Outcodes[0] & Outcodes[1] & Outcodes[2]) != 0)
+			continue;
+
+		if (!Outcodes[0] || !Outcodes[1] || !Outcodes[2])
+			InsideMask |= 1 << Lane;
+		else
+			ClipMask |= 1 << Lane;
+	}
+}
+
+#ifdef LC_SIMD_SSE2
+
+static int lcRayTriangleKernelSSE2(const lcTrianglePacket& Packet, const lcVector3& Start, const lcVector3& Direction, float MaxT, float* T)
+{
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 One = _mm_set1_ps(1.0f);
+	const __m128 MaxTv = _mm_set1_ps(MaxT);
+	const __m128 Ox = _mm_set1_ps(Start.x), Oy = _mm_set1_ps(Start.y), Oz = _mm_set1_ps(Start.z);
+	const __m128 Dx = _mm_set1_ps(Direction.x), Dy = _mm_set1_ps(Direction.y), Dz = _mm_set1_ps(Direction.z);
+	int HitMask = 0;
+
+	for (int Lane = 0; Lane < Packet.NumTriangles; Lane += 4)
+	{
+		__m128 v0x = _mm_loadu_ps(&Packet.v0[0][Lane]), v0y = _mm_loadu_ps(&Packet.v0[1][Lane]), v0z = _mm_loadu_ps(&Packet.v0[2][Lane]);
+		__m128 e1x = _mm_sub_ps(_mm_loadu_ps(&Packet.v1[0][Lane]), v0x);
+		__m128 e1y = _mm_sub_ps(_mm_loadu_ps(&Packet.v1[1][Lane]), v0y);
+		__m128 e1z = _mm_sub_ps(_mm_loadu_ps(&Packet.v1[2][Lane]), v0z);
+		__m128 e2x = _mm_sub_ps(_mm_loadu_ps(&Packet.v2[0][Lane]), v0x);
+		__m128 e2y = _mm_sub_ps(_mm_loadu_ps(&Packet.v2[1][Lane]), v0y);
+		__m128 e2z = _mm_sub_ps(_mm_loadu_ps(&Packet.v2[2][Lane]), v0z);
+
+		__m128 Px = _mm_sub_ps(_mm_mul_ps(Dy, e2z), _mm_mul_ps(Dz, e2y));
+		__m128 Py = _mm_sub_ps(_mm_mul_ps(Dz, e2x), _mm_mul_ps(Dx, e2z));
+		__m128 Pz = _mm_sub_ps(_mm_mul_ps(Dx, e2y), _mm_mul_ps(Dy, e2x));
+		__m128 Det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, Px), _mm_mul_ps(e1y, Py)), _mm_mul_ps(e1z, Pz));
+		__m128 InverseDet = _mm_div_ps(One, Det);
+
+		__m128 Sx = _mm_sub_ps(Ox, v0x), Sy = _mm_sub_ps(Oy, v0y), Sz = _mm_sub_ps(Oz, v0z);
+		__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Sx, Px), _mm_mul_ps(Sy, Py)), _mm_mul_ps(Sz, Pz)), InverseDet);
+
+		__m128 Qx = _mm_sub_ps(_mm_mul_ps(Sy, e1z), _mm_mul_ps(Sz, e1y));
+		__m128 Qy = _mm_sub_ps(_mm_mul_ps(Sz, e1x), _mm_mul_ps(Sx, e1z));
+		__m128 Qz = _mm_sub_ps(_mm_mul_ps(Sx, e1y), _mm_mul_ps(Sy, e1x));
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, Qx), _mm_mul_ps(Dy, Qy)), _mm_mul_ps(Dz, Qz)), InverseDet);
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, Qx), _mm_mul_ps(e2y, Qy)), _mm_mul_ps(e2z, Qz)), InverseDet);
+
+		__m128 Hit = _mm_cmpneq_ps(Det, Zero);
+		Hit = _mm_and_ps(Hit, _mm_cmpge_ps(u, Zero));
+		Hit = _mm_and_ps(Hit, _mm_cmpge_ps(v, Zero));
+		Hit = _mm_and_ps(Hit, _mm_cmple_ps(_mm_add_ps(u, v), One));
+		Hit = _mm_and_ps(Hit, _mm_cmpge_ps(t, Zero));
+		Hit = _mm_and_ps(Hit, _mm_cmple_ps(t, MaxTv));
+
+		_mm_storeu_ps(T + Lane, t);
+		HitMask |= _mm_movemask_ps(Hit) << Lane;
+	}
+
+	return HitMask & ((1 << Packet.NumTriangles) - 1);
+}
+
+static void lcPlanesKernelSSE2(const lcTrianglePacket& Packet, const lcVector4 Planes[6], int& InsideMask, int& ClipMask)
+{
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 AllSet = _mm_cmpeq_ps(Zero, Zero);
+
+	InsideMask = 0;
+	ClipMask = 0;
+
+	for (int Lane = 0; Lane < Packet.NumTriangles; Lane += 4)
+	{
+		__m128 v0x = _mm_loadu_ps(&Packet.v0[0][Lane]), v0y = _mm_loadu_ps(&Packet.v0[1][Lane]), v0z = _mm_loadu_ps(&Packet.v0[2][Lane]);
+		__m128 v1x = _mm_loadu_ps(&Packet.v1[0][Lane]), v1y = _mm_loadu_ps(&Packet.v1[1][Lane]), v1z = _mm_loadu_ps(&Packet.v1[2][Lane]);
+		__m128 v2x = _mm_loadu_ps(&Packet.v2[0][Lane]), v2y = _mm_loadu_ps(&Packet.v2[1][Lane]), v2z = _mm_loadu_ps(&Packet.v2[2][Lane]);
+		__m128 Outside = Zero;
+		__m128 Inside0 = AllSet, Inside1 = AllSet, Inside2 = AllSet;
+
+		for (int PlaneIdx = 0; PlaneIdx < 6; PlaneIdx++)
+		{
+			const lcVector4& Plane = Planes[PlaneIdx];
+			__m128 Nx = _mm_set1_ps(Plane.x), Ny = _mm_set1_ps(Plane.y), Nz = _mm_set1_ps(Plane.z), W = _mm_set1_ps(Plane.w);
+
+			__m128 Out0 = _mm_cmpgt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v0x, Nx), _mm_mul_ps(v0y, Ny)), _mm_mul_ps(v0z, Nz)), W), Zero);
+			__m128 Out1 = _mm_cmpgt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v1x, Nx), _mm_mul_ps(v1y, Ny)), _mm_mul_ps(v1z, Nz)), W), Zero);
+			__m128 Out2 = _mm_cmpgt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v2x, Nx), _mm_mul_ps(v2y, Ny)), _mm_mul_ps(v2z, Nz)), W), Zero);
+
+			Outside = _mm_or_ps(Outside, _mm_and_ps(_mm_and_ps(Out0, Out1), Out2));
+			Inside0 = _mm_andnot_ps(Out0, Inside0);
+			Inside1 = _mm_andnot_ps(Out1, Inside1);
+			Inside2 = _mm_andnot_ps(Out2, Inside2);
+		}
+
+		int OutsideMask = _mm_movemask_ps(Outside);
+		int AnyInsideMask = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(Inside0, Inside1), Inside2));
+
+		InsideMask |= (AnyInsideMask & ~OutsideMask) << Lane;
+		ClipMask |= (~AnyInsideMask & ~OutsideMask & 0xf) << Lane;
+	}
+
+	int LaneMask = (1 << Packet.NumTriangles) - 1;
+	InsideMask &= LaneMask;
+	ClipMask &= LaneMask;
+}
+
+#endif // LC_SIMD_SSE2
+
+#ifdef LC_SIMD_AVX2
+
+LC_TARGET_AVX2 static int lcRayTriangleKernelAVX2(const lcTrianglePacket& Packet, const lcVector3& Start, const lcVector3& Direction, float MaxT, float* T)
+{
+	const __m256 Zero = _mm256_setzero_ps();
+	const __m256 One = _mm256_set1_ps(1.0f);
+	const __m256 MaxTv = _mm256_set1_ps(MaxT);
+	const __m256 Ox = _mm256_set1_ps(Start.x), Oy = _mm256_set1_ps(Start.y), Oz = _mm256_set1_ps(Start.z);
+	const __m256 Dx = _mm256_set1_ps(Direction.x), Dy = _mm256_set1_ps(Direction.y), Dz = _mm256_set1_ps(Direction.z);
+
+	__m256 v0x = _mm256_loadu_ps(Packet.v0[0]), v0y = _mm256_loadu_ps(Packet.v0[1]), v0z = _mm256_loadu_ps(Packet.v0[2]);
+	__m256 e1x = _mm256_sub_ps(_mm256_loadu_ps(Packet.v1[0]), v0x);
+	__m256 e1y = _mm256_sub_ps(_mm256_loadu_ps(Packet.v1[1]), v0y);
+	__m256 e1z = _mm256_sub_ps(_mm256_loadu_ps(Packet.v1[2]), v0z);
+	__m256 e2x = _mm256_sub_ps(_mm256_loadu_ps(Packet.v2[0]), v0x);
+	__m256 e2y = _mm256_sub_ps(_mm256_loadu_ps(Packet.v2[1]), v0y);
+	__m256 e2z = _mm256_sub_ps(_mm256_loadu_ps(Packet.v2[2]), v0z);
+
+	__m256 Px = _mm256_sub_ps(_mm256_mul_ps(Dy, e2z), _mm256_mul_ps(Dz, e2y));
+	__m256 Py = _mm256_sub_ps(_mm256_mul_ps(Dz, e2x), _mm256_mul_ps(Dx, e2z));
+	__m256 Pz = _mm256_sub_ps(_mm256_mul_ps(Dx, e2y), _mm256_mul_ps(Dy, e2x));
+	__m256 Det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, Px), _mm256_mul_ps(e1y, Py)), _mm256_mul_ps(e1z, Pz));
+	__m256 InverseDet = _mm256_div_ps(One, Det);
+
+	__m256 Sx = _mm256_sub_ps(Ox, v0x), Sy = _mm256_sub_ps(Oy, v0y), Sz = _mm256_sub_ps(Oz, v0z);
+	__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Sx, Px), _mm256_mul_ps(Sy, Py)), _mm256_mul_ps(Sz, Pz)), InverseDet);
+
+	__m256 Qx = _mm256_sub_ps(_mm256_mul_ps(Sy, e1z), _mm256_mul_ps(Sz, e1y));
+	__m256 Qy = _mm256_sub_ps(_mm256_mul_ps(Sz, e1x), _mm256_mul_ps(Sx, e1z));
+	__m256 Qz = _mm256_sub_ps(_mm256_mul_ps(Sx, e1y), _mm256_mul_ps(Sy, e1x));
+	__m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Dx, Qx), _mm256_mul_ps(Dy, Qy)), _mm256_mul_ps(Dz, Qz)), InverseDet);
+	__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, Qx), _mm256_mul_ps(e2y, Qy)), _mm256_mul_ps(e2z, Qz)), InverseDet);
+
+	__m256 Hit = _mm256_cmp_ps(Det, Zero, _CMP_NEQ_UQ);
+	Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(u, Zero, _CMP_GE_OQ));
+	Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(v, Zero, _CMP_GE_OQ));
+	Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(_mm256_add_ps(u, v), One, _CMP_LE_OQ));
+	Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(t, Zero, _CMP_GE_OQ));
+	Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(t, MaxTv, _CMP_LE_OQ));
+
+	_mm256_storeu_ps(T, t);
+
+	return _mm256_movemask_ps(Hit) & ((1 << Packet.NumTriangles) - 1);
+}
+
+LC_TARGET_AVX2 static void lcPlanesKernelAVX2(const lcTrianglePacket& Packet, const lcVector4 Planes[6], int& InsideMask, int& ClipMask)
+{
+	const __m256 Zero = _mm256_setzero_ps();
+	const __m256 AllSet = _mm256_cmp_ps(Zero, Zero, _CMP_EQ_OQ);
+
+	__m256 v0x = _mm256_loadu_ps(Packet.v0[0]), v0y = _mm256_loadu_ps(Packet.v0[1]), v0z = _mm256_loadu_ps(Packet.v0[2]);
+	__m256 v1x = _mm256_loadu_ps(Packet.v1[0]), v1y = _mm256_loadu_ps(Packet.v1[1]), v1z = _mm256_loadu_ps(Packet.v1[2]);
+	__m256 v2x = _mm256_loadu_ps(Packet.v2[0]), v2y = _mm256_loadu_ps(Packet.v2[1]), v2z = _mm256_loadu_ps(Packet.v2[2]);
+	__m256 Outside = Zero;
+	__m256 Inside0 = AllSet, Inside1 = AllSet, Inside2 = AllSet;
+
+	for (int PlaneIdx = 0; PlaneIdx < 6; PlaneIdx++)
+	{
+		const lcVector4& Plane = Planes[PlaneIdx];
+		__m256 Nx = _mm256_set1_ps(Plane.x), Ny = _mm256_set1_ps(Plane.y), Nz = _mm256_set1_ps(Plane.z), W = _mm256_set1_ps(Plane.w);
+
+		__m256 Out0 = _mm256_cmp_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v0x, Nx), _mm256_mul_ps(v0y, Ny)), _mm256_mul_ps(v0z, Nz)), W), Zero, _CMP_GT_OQ);
+		__m256 Out1 = _mm256_cmp_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v1x, Nx), _mm256_mul_ps(v1y, Ny)), _mm256_mul_ps(v1z, Nz)), W), Zero, _CMP_GT_OQ);
+		__m256 Out2 = _mm256_cmp_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v2x, Nx), _mm256_mul_ps(v2y, Ny)), _mm256_mul_ps(v2z, Nz)), W), Zero, _CMP_GT_OQ);
+
+		Outside = _mm256_or_ps(Outside, _mm256_and_ps(_mm256_and_ps(Out0, Out1), Out2));
+		Inside0 = _mm256_andnot_ps(Out0, Inside0);
+		Inside1 = _mm256_andnot_ps(Out1, Inside1);
+		Inside2 = _mm256_andnot_ps(Out2, Inside2);
+	}
+
+	int LaneMask = (1 << Packet.NumTriangles) - 1;
+	int OutsideMask = _mm256_movemask_ps(Outside);
+	int AnyInsideMask = _mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(Inside0, Inside1), Inside2));
+
+	InsideMask = AnyInsideMask & ~OutsideMask & LaneMask;
+	ClipMask = ~AnyInsideMask & ~OutsideMask & LaneMask;
+}
+
+static bool lcCpuSupportsAVX2()
+{
+#ifdef _MSC_VER
+	int Info[4];
+
+	__cpuid(Info, 0);
+	if (Info[0] < 7)
+		return false;
+
+	// Check that the OS saves the AVX registers.
+	__cpuid(Info, 1);
+	if ((Info[2] & (1 << 27)) == 0 || (Info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(Info, 7, 0);
+	return (Info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // LC_SIMD_AVX2
+
+// Fills Kernels with the kernels this CPU supports from the slowest to the fastest, the scalar kernels are always first.
+static int lcGetSupportedSimdKernels(lcSimdKernels Kernels[LC_SIMD_MAX_KERNELS])
+{
+	int NumKernels = 0;
+
+	lcSimdKernels ScalarKernels = { "Scalar", lcRayTriangleKernelScalar, lcPlanesKernelScalar };
+	Kernels[NumKernels++] = ScalarKernels;
+
+#ifdef LC_SIMD_SSE2
+	lcSimdKernels SSE2Kernels = { "SSE2", lcRayTriangleKernelSSE2, lcPlanesKernelSSE2 };
+	Kernels[NumKernels++] = SSE2Kernels;
+#endif
+
+#ifdef LC_SIMD_AVX2
+	if (lcCpuSupportsAVX2())
+	{
+		lcSimdKernels AVX2Kernels = { "AVX2", lcRayTriangleKernelAVX2, lcPlanesKernelAVX2 };
+		Kernels[NumKernels++] = AVX2Kernels;
+	}
+#endif
+
+	return NumKernels;
+}
+
+static lcSimdKernels lcSelectSimdKernels()
+{
+	lcSimdKernels Kernels[LC_SIMD_MAX_KERNELS];
+	int NumKernels = lcGetSupportedSimdKernels(Kernels);
+
+	// Allow comparing against the reference kernels.
+	if (getenv("LEOCAD_DISABLE_SIMD"))
+		return Kernels[0];
+
+	return Kernels[NumKernels - 1];
+}
+
+static const lcSimdKernels gSimdKernels = lcSelectSimdKernels();
+
+int lcRayTrianglePacketIntersect(const lcTrianglePacket& Packet, const lcVector3& Start, const lcVector3& End, float& MinDist, lcVector3& Intersection)
+{
+	lcVector3 Direction = End - Start;
+	float Length = lcLength(Direction);
+
+	if (Length == 0.0f)
+		return -1;
+
+	Direction /= Length;
+
+	float T[LC_TRIANGLE_PACKET_SIZE];
+	int HitMask = gSimdKernels.RayTriangle(Packet, Start, Direction, MinDist, T);
+	int HitLane = -1;
+
+	for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+	{
+		if ((HitMask & (1 << Lane)) && (HitLane == -1 || T[Lane] < MinDist))
+		{
+			MinDist = T[Lane];
+			HitLane = Lane;
+		}
+	}
+
+	if (HitLane != -1)
+		Intersection = Start + Direction * MinDist;
+
+	return HitLane;
+}
+
+void lcTrianglePacketPlanesTest(const lcTrianglePacket& Packet, const lcVector4 Planes[6], int& InsideMask, int& ClipMask)
+{
+	gSimdKernels.Planes(Packet, Planes, InsideMask, ClipMask);
+}
+
+const char* lcGetSimdPath()
+{
+	return gSimdKernels.Name;
+}
+
+struct lcSimdBenchmarkQuery
+{
+	int FirstPacket;
+	int NumPackets;
+	lcVector3 Start;
+	lcVector3 Direction;
+	float MaxT;
+	lcVector4 Planes[6];
+};
+
+// Every run tests the same rays and boxes so the timings and hit counts can be compared between machines.
+static float lcSimdBenchmarkRandom(lcuint32& Seed)
+{
+	Seed = Seed * 1664525 + 1013904223;
+	return (Seed >> 8) / 16777216.0f;
+}
+
+static int lcSimdBenchmarkCountBits(int Mask)
+{
+	int Count = 0;
+
+	for (; Mask; Mask &= Mask - 1)
+		Count++;
+
+	return Count;
+}
+
+void lcSimdBenchmark(const lcArray<lcMesh*>& Meshes, int NumQueries)
+{
+	lcArray<lcTrianglePacket> Packets;
+	lcArray<lcSimdBenchmarkQuery> Queries;
+	int NumPackets = 0;
+	int NumTriangles = 0;
+
+	for (int MeshIdx = 0; MeshIdx < Meshes.GetSize(); MeshIdx++)
+	{
+		lcMesh* Mesh = Meshes[MeshIdx];
+
+		Mesh->BuildTriangleBVH();
+		NumPackets += (Mesh->mBVHTriangles.GetSize() + LC_TRIANGLE_PACKET_SIZE - 1) / LC_TRIANGLE_PACKET_SIZE;
+	}
+
+	Packets.AllocGrow(NumPackets);
+	Queries.AllocGrow(Meshes.GetSize() * NumQueries);
+	lcuint32 Seed = 1;
+
+	for (int MeshIdx = 0; MeshIdx < Meshes.GetSize(); MeshIdx++)
+	{
+		int FirstPacket = Packets.GetSize();
+		Meshes[MeshIdx]->AddTrianglePackets(Packets);
+
+		if (Packets.GetSize() == FirstPacket)
+			continue;
+
+		lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (int PacketIdx = FirstPacket; PacketIdx < Packets.GetSize(); PacketIdx++)
+		{
+			const lcTrianglePacket& Packet = Packets[PacketIdx];
+
+			for (int Lane = 0; Lane < Packet.NumTriangles; Lane++)
+			{
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					Min[Axis] = lcMin(Min[Axis], lcMin(Packet.v0[Axis][Lane], lcMin(Packet.v1[Axis][Lane], Packet.v2[Axis][Lane])));
+					Max[Axis] = lcMax(Max[Axis], lcMax(Packet.v0[Axis][Lane], lcMax(Packet.v1[Axis][Lane], Packet.v2[Axis][Lane])));
+				}
+			}
+
+			NumTriangles += Packet.NumTriangles;
+		}
+
+		lcVector3 Center = (Min + Max) * 0.5f;
+		float Radius = lcLength(Max - Center) + 1.0f;
+
+		for (int QueryIdx = 0; QueryIdx < NumQueries; QueryIdx++)
+		{
+			lcSimdBenchmarkQuery& Query = Queries.Add();
+			lcVector3 Offset, Target, BoxMin, BoxMax;
+
+			Query.FirstPacket = FirstPacket;
+			Query.NumPackets = Packets.GetSize() - FirstPacket;
+
+			// Rays start on a sphere around the mesh and go through a point in its bounds, boxes are a quarter of its size.
+			for (int Axis = 0; Axis < 3; Axis++)
+			{
+				float Size = Max[Axis] - Min[Axis];
+
+				Offset[Axis] = lcSimdBenchmarkRandom(Seed) * 2.0f - 1.0f;
+				Target[Axis] = Min[Axis] + Size * lcSimdBenchmarkRandom(Seed);
+				BoxMin[Axis] = Min[Axis] + Size * 0.75f * lcSimdBenchmarkRandom(Seed);
+				BoxMax[Axis] = BoxMin[Axis] + Size * 0.25f;
+			}
+
+			if (lcLengthSquared(Offset) == 0.0f)
+				Offset = lcVector3(0.0f, 0.0f, 1.0f);
+
+			Query.Start = Center + lcNormalize(Offset) * Radius;
+			Query.Direction = lcNormalize(Target - Query.Start);
+			Query.MaxT = Radius * 2.0f;
+
+			Query.Planes[0] = lcVector4(-1.0f, 0.0f, 0.0f, BoxMin.x);
+			Query.Planes[1] = lcVector4(1.0f, 0.0f, 0.0f, -BoxMax.x);
+			Query.Planes[2] = lcVector4(0.0f, -1.0f, 0.0f, BoxMin.y);
+			Query.Planes[3] = lcVector4(0.0f, 1.0f, 0.0f, -BoxMax.y);
+			Query.Planes[4] = lcVector4(0.0f, 0.0f, -1.0f, BoxMin.z);
+			Query.Planes[5] = lcVector4(0.0f, 0.0f, 1.0f, -BoxMax.z);
+		}
+	}
+
+	printf("Testing %d rays and %d boxes against each triangle of %d meshes, %d triangles in total. Selected kernels: %s.\n",
+	       NumQueries, NumQueries, Meshes.GetSize(), NumTriangles, lcGetSimdPath());
+
+	lcSimdKernels Kernels[LC_SIMD_MAX_KERNELS];
+	int NumKernels = lcGetSupportedSimdKernels(Kernels);
+
+	for (int KernelIdx = 0; KernelIdx < NumKernels; KernelIdx++)
+	{
+		const lcSimdKernels& Kernel = Kernels[KernelIdx];
+		QElapsedTimer Timer;
+		int RayHits = 0, InsideTriangles = 0, ClipTriangles = 0;
+
+		Timer.start();
+
+		for (int QueryIdx = 0; QueryIdx < Queries.GetSize(); QueryIdx++)
+		{
+			const lcSimdBenchmarkQuery& Query = Queries[QueryIdx];
+			float T[LC_TRIANGLE_PACKET_SIZE];
+
+			for (int PacketIdx = Query.FirstPacket; PacketIdx < Query.FirstPacket + Query.NumPackets; PacketIdx++)
+				RayHits += lcSimdBenchmarkCountBits(Kernel.RayTriangle(Packets[PacketIdx], Query.Start, Query.Direction, Query.MaxT, T));
+		}
+
+		double RayTime = Timer.nsecsElapsed() / 1000000.0;
+		Timer.start();
+
+		for (int QueryIdx = 0; QueryIdx < Queries.GetSize(); QueryIdx++)
+		{
+			const lcSimdBenchmarkQuery& Query = Queries[QueryIdx];
+
+			for (int PacketIdx = Query.FirstPacket; PacketIdx < Query.FirstPacket + Query.NumPackets; PacketIdx++)
+			{
+				int InsideMask, ClipMask;
+				Kernel.Planes(Packets[PacketIdx], Query.Planes, InsideMask, ClipMask);
+
+				InsideTriangles += lcSimdBenchmarkCountBits(InsideMask);
+				ClipTriangles += lcSimdBenchmarkCountBits(ClipMask);
+			}
+		}
+
+		double BoxTime = Timer.nsecsElapsed() / 1000000.0;
+
+		printf("%s: rays %.3f ms, %d hits. Boxes %.3f ms, %d triangles inside, %d to clip.\n", Kernel.Name, RayTime, RayHits, BoxTime, InsideTriangles, ClipTriangles);
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef _LC_SIMD_H_
+#define _LC_SIMD_H_
+
+#include "lc_math.h"
+#include "lc_array.h"
+
+#define LC_TRIANGLE_PACKET_SIZE 8
+
+// Triangles stored as a structure of arrays so they can be tested one per lane.
+struct lcTrianglePacket
+{
+	float v0[3][LC_TRIANGLE_PACKET_SIZE];
+	float v1[3][LC_TRIANGLE_PACKET_SIZE];
+	float v2[3][LC_TRIANGLE_PACKET_SIZE];
+	int NumTriangles;
+};
+
+inline void lcTrianglePacketSet(lcTrianglePacket& Packet, int Lane, const lcVector3& v0, const lcVector3& v1, const lcVector3& v2)
+{
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		Packet.v0[Axis][Lane] = v0[Axis];
+		Packet.v1[Axis][Lane] = v1[Axis];
+		Packet.v2[Axis][Lane] = v2[Axis];
+	}
+}
+
+// Returns the lane of the closest triangle hit by the ray that starts at Start and goes through End, or -1 if no triangle
+// is hit closer than MinDist. MinDist and Intersection are updated when a triangle is hit.
+int lcRayTrianglePacketIntersect(const lcTrianglePacket& Packet, const lcVector3& Start, const lcVector3& End, float& MinDist, lcVector3& Intersection);
+
+// Sets a bit in InsideMask for each triangle that has a vertex inside all planes and a bit in ClipMask for each triangle
+// that needs to be clipped against the planes to know if it intersects them. Other triangles are outside.
+void lcTrianglePacketPlanesTest(const lcTrianglePacket& Packet, const lcVector4 Planes[6], int& InsideMask, int& ClipMask);
+
+// Name of the kernels selected for this CPU.
+const char* lcGetSimdPath();
+
+// Tests random rays and boxes against all triangles of the meshes with each kernel supported by this CPU and prints how
+// long each kernel took, along with the number of hits so the results can be compared.
+void lcSimdBenchmark(const lcArray<lcMesh*>& Meshes, int NumQueries);
+
+#endif // _LC_SIMD_H_
@@ -0,0 +1,375 @@
+#include "lc_global.h"
+#include "lc_staticbatch.h"
+#include "lc_context.h"
+#include "lc_mesh.h"
+#include "lc_colors.h"
+#include <math.h>
+
+static inline lcuint64 lcHashBytes(lcuint64 Hash, const void* Data, size_t Size)
+{
+	const lcuint8* Bytes = (const lcuint8*)Data;
+
+	for (size_t ByteIdx = 0; ByteIdx < Size; ByteIdx++)
+	{
+		Hash ^= Bytes[ByteIdx];
+		Hash *= 0x100000001b3ULL;
+	}
+
+	return Hash;
+}
+
+// Translucent sections are still drawn by the translucent render meshes of the piece.
+static inline bool lcIsStaticBatchSection(const lcMeshSection* Section, int DefaultColorIndex)
+{
+	if (Section->PrimitiveType != GL_TRIANGLES)
+		return true;
+
+	int ColorIndex = Section->ColorIndex;
+
+	if (ColorIndex == gDefaultColor)
+		ColorIndex = DefaultColorIndex;
+
+	return !lcIsColorTranslucent(ColorIndex);
+}
+
+static inline void lcAddPointToBounds(const lcVector3& Point, lcVector3& Min, lcVector3& Max)
+{
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		Min[Axis] = lcMin(Min[Axis], Point[Axis]);
+		Max[Axis] = lcMax(Max[Axis], Point[Axis]);
+	}
+}
+
+static inline lcuint32 lcGetIndex(const void* Indices, int IndexType, int Index)
+{
+	if (IndexType == GL_UNSIGNED_SHORT)
+		return ((const lcuint16*)Indices)[Index];
+	else
+		return ((const lcuint32*)Indices)[Index];
+}
+
+lcStaticBatcher::lcStaticBatcher()
+{
+}
+
+lcStaticBatcher::~lcStaticBatcher()
+{
+	RemoveAll();
+}
+
+void lcStaticBatcher::RemoveAll()
+{
+	for (int BatchIdx = 0; BatchIdx < mBatches.GetSize(); BatchIdx++)
+		delete mBatches[BatchIdx].Mesh;
+
+	mBatches.RemoveAll();
+	mItems.RemoveAll();
+}
+
+void lcStaticBatcher::Update(const lcScene& Scene)
+{
+	mItems.RemoveAll();
+
+	for (int PieceIdx = 0; PieceIdx < Scene.mNumPieces; PieceIdx++)
+	{
+		const lcScenePiece& ScenePiece = Scene.mPieces[PieceIdx];
+
+		if (!ScenePiece.Static)
+			continue;
+
+		lcVector3 Position = ScenePiece.WorldMatrix.GetTranslation();
+		lcuint64 CellKey = 0;
+
+		for (int Axis = 0; Axis < 3; Axis++)
+			CellKey = (CellKey << 16) | (lcuint16)(int)floorf(Position[Axis] / LC_STATIC_BATCH_CELL_SIZE);
+
+		for (int MeshIdx = ScenePiece.FirstOpaqueMesh; MeshIdx < ScenePiece.FirstOpaqueMesh + ScenePiece.NumOpaqueMeshes; MeshIdx++)
+		{
+			lcStaticBatchItem& Item = mItems.Add();
+
+			Item.SortKey = (CellKey << 16) | (lcuint16)Scene.mOpaqueMeshes[MeshIdx].ColorIndex;
+			Item.RenderMeshIndex = MeshIdx;
+		}
+	}
+
+	lcRadixSort(mItems, mSortTemp);
+
+	lcArray<lcStaticBatch> Batches;
+	int OldBatchIdx = 0;
+
+	for (int FirstItem = 0; FirstItem < mItems.GetSize(); )
+	{
+		lcuint64 Key = mItems[FirstItem].SortKey;
+		lcuint64 Hash = 0xcbf29ce484222325ULL;
+		int NumItems = 0;
+
+		while (FirstItem + NumItems < mItems.GetSize() && mItems[FirstItem + NumItems].SortKey == Key)
+		{
+			const lcRenderMesh& RenderMesh = Scene.mOpaqueMeshes[mItems[FirstItem + NumItems].RenderMeshIndex];
+
+			Hash = lcHashBytes(Hash, &RenderMesh.Mesh, sizeof(RenderMesh.Mesh));
+			Hash = lcHashBytes(Hash, &RenderMesh.WorldMatrix, sizeof(RenderMesh.WorldMatrix));
+			NumItems++;
+		}
+
+		if (NumItems >= LC_STATIC_BATCH_MIN_MESHES)
+		{
+			lcStaticBatch& Batch = Batches.Add();
+
+			Batch.Key = Key;
+			Batch.Hash = Hash;
+			Batch.ColorIndex = Scene.mOpaqueMeshes[mItems[FirstItem].RenderMeshIndex].ColorIndex;
+			Batch.FirstItem = FirstItem;
+			Batch.NumItems = NumItems;
+			Batch.Mesh = NULL;
+
+			// Both lists are sorted by key so the old batch with the same key can be found by walking them together.
+			while (OldBatchIdx < mBatches.GetSize() && mBatches[OldBatchIdx].Key < Key)
+				OldBatchIdx++;
+
+			if (OldBatchIdx < mBatches.GetSize())
+			{
+				lcStaticBatch& OldBatch = mBatches[OldBatchIdx];
+
+				if (OldBatch.Key == Key && OldBatch.Hash == Hash && OldBatch.Mesh)
+				{
+					Batch.Mesh = OldBatch.Mesh;
+					Batch.Min = OldBatch.Min;
+					Batch.Max = OldBatch.Max;
+					OldBatch.Mesh = NULL;
+				}
+			}
+		}
+
+		FirstItem += NumItems;
+	}
+
+	for (int BatchIdx = 0; BatchIdx < mBatches.GetSize(); BatchIdx++)
+		delete mBatches[BatchIdx].Mesh;
+
+	mBatches = Batches;
+}
+
+void lcStaticBatcher::Apply(lcScene& Scene) const
+{
+	for (int BatchIdx = 0; BatchIdx < mBatches.GetSize(); BatchIdx++)
+	{
+		const lcStaticBatch& Batch = mBatches[BatchIdx];
+
+		if (!Batch.Mesh)
+			continue;
+
+		for (int ItemIdx = Batch.FirstItem; ItemIdx < Batch.FirstItem + Batch.NumItems; ItemIdx++)
+			Scene.mOpaqueMeshBatched[mItems[ItemIdx].RenderMeshIndex] = true;
+
+		lcRenderMesh& RenderMesh = Scene.mOpaqueMeshes.Add();
+
+		RenderMesh.WorldMatrix = lcMatrix44Identity();
+		RenderMesh.Mesh = Batch.Mesh;
+		RenderMesh.Distance = 0.0f;
+		RenderMesh.ColorIndex = Batch.ColorIndex;
+		RenderMesh.Focused = false;
+		RenderMesh.Selected = false;
+		RenderMesh.Piece = NULL;
+
+		lcScenePiece& ScenePiece = Scene.mPieces.Add();
+
+		ScenePiece.WorldMatrix = lcMatrix44Identity();
+		ScenePiece.Min = Batch.Min;
+		ScenePiece.Max = Batch.Max;
+		ScenePiece.Model = false;
+		ScenePiece.Static = false;
+		ScenePiece.FirstOpaqueMesh = Scene.mOpaqueMeshes.GetSize() - 1;
+		ScenePiece.NumOpaqueMeshes = 1;
+		ScenePiece.FirstTranslucentMesh = 0;
+		ScenePiece.NumTranslucentMeshes = 0;
+		ScenePiece.FirstSubModelPiece = 0;
+		ScenePiece.NumSubModelPieces = 0;
+	}
+}
+
+bool lcStaticBatcher::BuildPendingBatches(const lcScene& Scene)
+{
+	int NumVertices = 0;
+	bool Built = false;
+
+	for (int BatchIdx = 0; BatchIdx < mBatches.GetSize() && NumVertices < LC_STATIC_BATCH_VERTICES_PER_FRAME; BatchIdx++)
+	{
+		lcStaticBatch& Batch = mBatches[BatchIdx];
+
+		if (Batch.Mesh)
+			continue;
+
+		Batch.Mesh = BuildBatchMesh(Scene, Batch);
+		NumVertices += Batch.Mesh->mNumVertices + Batch.Mesh->mNumTexturedVertices;
+		Built = true;
+	}
+
+	return Built;
+}
+
+bool lcStaticBatcher::HasPendingBatches() const
+{
+	for (int BatchIdx = 0; BatchIdx < mBatches.GetSize(); BatchIdx++)
+		if (!mBatches[BatchIdx].Mesh)
+			return true;
+
+	return false;
+}
+
+lcMesh* lcStaticBatcher::BuildBatchMesh(const lcScene& Scene, lcStaticBatch& Batch) const
+{
+	// Sections with the same color, primitive and texture are merged, remember which merged section each one goes to.
+	lcArray<lcMeshSection> Sections;
+	lcArray<int> SectionIndices;
+	int NumVertices = 0;
+	int NumTexturedVertices = 0;
+	int NumIndices = 0;
+
+	for (int ItemIdx = Batch.FirstItem; ItemIdx < Batch.FirstItem + Batch.NumItems; ItemIdx++)
+	{
+		const lcRenderMesh& RenderMesh = Scene.mOpaqueMeshes[mItems[ItemIdx].RenderMeshIndex];
+		lcMesh* Mesh = RenderMesh.Mesh;
+
+		NumVertices += Mesh->mNumVertices;
+		NumTexturedVertices += Mesh->mNumTexturedVertices;
+
+		for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
+		{
+			lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+
+			if (!lcIsStaticBatchSection(Section, RenderMesh.ColorIndex))
+			{
+				SectionIndices.Add(-1);
+				continue;
+			}
+
+			int BatchSectionIdx;
+
+			for (BatchSectionIdx = 0; BatchSectionIdx < Sections.GetSize(); BatchSectionIdx++)
+			{
+				const lcMeshSection& BatchSection = Sections[BatchSectionIdx];
+
+				if (BatchSection.ColorIndex == Section->ColorIndex && BatchSection.PrimitiveType == Section->PrimitiveType && BatchSection.Texture == Section->Texture)
+					break;
+			}
+
+			if (BatchSectionIdx == Sections.GetSize())
+			{
+				lcMeshSection& BatchSection = Sections.Add();
+
+				BatchSection.ColorIndex = Section->ColorIndex;
+				BatchSection.IndexOffset = 0;
+				BatchSection.NumIndices = 0;
+				BatchSection.PrimitiveType = Section->PrimitiveType;
+				BatchSection.Texture = Section->Texture;
+			}
+
+			Sections[BatchSectionIdx].NumIndices += Section->NumIndices;
+			NumIndices += Section->NumIndices;
+			SectionIndices.Add(BatchSectionIdx);
+		}
+	}
+
+	lcMesh* BatchMesh = new lcMesh();
+	BatchMesh->Create(Sections.GetSize(), NumVertices, NumTexturedVertices, NumIndices);
+
+	lcVertex* Vertices = (lcVertex*)BatchMesh->mVertexBuffer.mData;
+	lcVertexTextured* TexturedVertices = (lcVertexTextured*)((char*)BatchMesh->mVertexBuffer.mData + BatchMesh->GetTexturedVertexOffset());
+	lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX);
+	lcVector3 Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	lcArray<int> VertexOffsets;
+	lcArray<int> TexturedVertexOffsets;
+	int VertexOffset = 0;
+	int TexturedVertexOffset = 0;
+
+	for (int ItemIdx = Batch.FirstItem; ItemIdx < Batch.FirstItem + Batch.NumItems; ItemIdx++)
+	{
+		const lcRenderMesh& RenderMesh = Scene.mOpaqueMeshes[mItems[ItemIdx].RenderMeshIndex];
+		lcMesh* Mesh = RenderMesh.Mesh;
+
+		VertexOffsets.Add(VertexOffset);
+		TexturedVertexOffsets.Add(TexturedVertexOffset);
+
+		for (int VertexIdx = 0; VertexIdx < Mesh->mNumVertices; VertexIdx++)
+		{
+			lcVector3 Position = lcMul31(Mesh->GetVertexPosition(VertexIdx), RenderMesh.WorldMatrix);
+
+			Vertices[VertexOffset++].Position = Position;
+			lcAddPointToBounds(Position, Min, Max);
+		}
+
+		char* MeshTexturedVertices = (char*)Mesh->mVertexBuffer.mData + Mesh->GetTexturedVertexOffset();
+
+		for (int VertexIdx = 0; VertexIdx < Mesh->mNumTexturedVertices; VertexIdx++)
+		{
+			lcVertexTextured& Vertex = TexturedVertices[TexturedVertexOffset++];
+
+			Vertex.Position = lcMul31(Mesh->GetTexturedVertexPosition(VertexIdx), RenderMesh.WorldMatrix);
+			lcAddPointToBounds(Vertex.Position, Min, Max);
+
+			if (!Mesh->mQuantized)
+				Vertex.TexCoord = ((lcVertexTextured*)MeshTexturedVertices)[VertexIdx].TexCoord;
+			else
+			{
+				const lcint16* TexCoord = ((lcVertexTexturedQuantized*)MeshTexturedVertices)[VertexIdx].TexCoord;
+				Vertex.TexCoord = lcVector2(TexCoord[0] * Mesh->mTexCoordScale.x + Mesh->mTexCoordOffset.x, TexCoord[1] * Mesh->mTexCoordScale.y + Mesh->mTexCoordOffset.y);
+			}
+		}
+	}
+
+	int IndexSize = (BatchMesh->mIndexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+	int IndexCount = 0;
+
+	for (int BatchSectionIdx = 0; BatchSectionIdx < Sections.GetSize(); BatchSectionIdx++)
+	{
+		lcMeshSection& BatchSection = BatchMesh->mSections[BatchSectionIdx];
+
+		BatchSection = Sections[BatchSectionIdx];
+		BatchSection.IndexOffset = IndexCount * IndexSize;
+
+		int SectionIndex = 0;
+
+		for (int ItemIdx = 0; ItemIdx < Batch.NumItems; ItemIdx++)
+		{
+			const lcRenderMesh& RenderMesh = Scene.mOpaqueMeshes[mItems[Batch.FirstItem + ItemIdx].RenderMeshIndex];
+			lcMesh* Mesh = RenderMesh.Mesh;
+
+			for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++, SectionIndex++)
+			{
+				if (SectionIndices[SectionIndex] != BatchSectionIdx)
+					continue;
+
+				lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+				const char* SrcIndices = (char*)Mesh->mIndexBuffer.mData + Section->IndexOffset;
+				lcuint32 BaseVertex = Section->Texture ? TexturedVertexOffsets[ItemIdx] : VertexOffsets[ItemIdx];
+
+				if (IndexSize == 2)
+				{
+					lcuint16* DstIndices = (lcuint16*)BatchMesh->mIndexBuffer.mData + IndexCount;
+
+					for (int Index = 0; Index < Section->NumIndices; Index++)
+						DstIndices[Index] = (lcuint16)(BaseVertex + lcGetIndex(SrcIndices, Mesh->mIndexType, Index));
+				}
+				else
+				{
+					lcuint32* DstIndices = (lcuint32*)BatchMesh->mIndexBuffer.mData + IndexCount;
+
+					for (int Index = 0; Index < Section->NumIndices; Index++)
+						DstIndices[Index] = BaseVertex + lcGetIndex(SrcIndices, Mesh->mIndexType, Index);
+				}
+
+				IndexCount += Section->NumIndices;
+			}
+		}
+	}
+
+	BatchMesh->UpdateBuffers();
+
+	Batch.Min = Min;
+	Batch.Max = Max;
+
+	return BatchMesh;
+}
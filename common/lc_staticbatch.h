@@ -0,0 +1,59 @@
+#ifndef _LC_STATICBATCH_H_
+#define _LC_STATICBATCH_H_
+
+#include "lc_array.h"
+#include "lc_math.h"
+
+#define LC_STATIC_BATCH_CELL_SIZE 320.0f
+#define LC_STATIC_BATCH_MIN_MESHES 4
+#define LC_STATIC_BATCH_VERTICES_PER_FRAME 262144
+
+struct lcStaticBatchItem
+{
+	lcuint64 SortKey;
+	int RenderMeshIndex;
+};
+
+// Opaque meshes of static pieces with the same color in the same spatial cell, merged into one mesh in world space.
+struct lcStaticBatch
+{
+	lcuint64 Key;
+	lcuint64 Hash;
+	int ColorIndex;
+	int FirstItem;
+	int NumItems;
+	lcMesh* Mesh;
+	lcVector3 Min;
+	lcVector3 Max;
+};
+
+// Keeps the batches of a scene between rebuilds. Batches whose pieces changed are drawn piece by piece until they are
+// built again, which happens a few at a time on the following frames.
+class lcStaticBatcher
+{
+public:
+	lcStaticBatcher();
+	~lcStaticBatcher();
+
+	void RemoveAll();
+
+	// Groups the static meshes of a scene that was just built and keeps the batches that didn't change.
+	void Update(const lcScene& Scene);
+
+	// Replaces the meshes of the batches that are built with the batch meshes.
+	void Apply(lcScene& Scene) const;
+
+	// Builds some of the batches that changed, returns true if the scene needs to be applied again.
+	bool BuildPendingBatches(const lcScene& Scene);
+
+	bool HasPendingBatches() const;
+
+protected:
+	lcMesh* BuildBatchMesh(const lcScene& Scene, lcStaticBatch& Batch) const;
+
+	lcArray<lcStaticBatchItem> mItems;
+	lcArray<lcStaticBatchItem> mSortTemp;
+	lcArray<lcStaticBatch> mBatches;
+};
+
+#endif // _LC_STATICBATCH_H_
@@ -1141,7 +1141,7 @@ void MinifigWizard::OnDraw()
 	Calculate();
 
 	lcScene Scene;
-	Scene.Begin(ViewMatrix);
+	Scene.Begin(ViewMatrix, Projection);
 
 	for (int PieceIdx = 0; PieceIdx < LC_MFW_NUMITEMS; PieceIdx++)
 		if (mMinifig->Parts[PieceIdx])
@@ -1149,8 +1149,8 @@ void MinifigWizard::OnDraw()
 
 	Scene.End();
 
-	mContext->DrawOpaqueMeshes(ViewMatrix, Scene.mOpaqueMeshes);
-	mContext->DrawTranslucentMeshes(ViewMatrix, Scene.mTranslucentMeshes);
+	mContext->DrawOpaqueMeshes(Scene);
+	mContext->DrawTranslucentMeshes(Scene);
 
 	mContext->UnbindMesh(); // context remove
 }
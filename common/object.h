@@ -152,6 +152,21 @@ protected:
 		return PreviousKey->Value;
 	}
 
+	template<typename T>
+	bool HasKey(const lcArray<lcObjectKey<T>>& Keys, lcStep Step) const
+	{
+		for (int KeyIdx = 0; KeyIdx < Keys.GetSize(); KeyIdx++)
+		{
+			if (Keys[KeyIdx].Step == Step)
+				return true;
+
+			if (Keys[KeyIdx].Step > Step)
+				break;
+		}
+
+		return false;
+	}
+
 	template<typename T>
 	void ChangeKey(lcArray<lcObjectKey<T>>& Keys, const T& Value, lcStep Step, bool AddKey)
 	{
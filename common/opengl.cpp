@@ -101,6 +101,47 @@ GLBINDATTRIBLOCATIONARBPROC lcBindAttribLocationARB;
 GLGETACTIVEATTRIBARBPROC lcGetActiveAttribARB;
 GLGETATTRIBLOCATIONARBPROC lcGetAttribLocationARB;
 
+GLGENQUERIESPROC lcGenQueries;
+GLDELETEQUERIESPROC lcDeleteQueries;
+GLBEGINQUERYPROC lcBeginQuery;
+GLENDQUERYPROC lcEndQuery;
+GLGETQUERYOBJECTIVPROC lcGetQueryObjectiv;
+GLGETQUERYOBJECTUI64VPROC lcGetQueryObjectui64v;
+
+GLCREATESHADERPROC lcCreateShader;
+GLDELETESHADERPROC lcDeleteShader;
+GLSHADERSOURCEPROC lcShaderSource;
+GLCOMPILESHADERPROC lcCompileShader;
+GLGETSHADERIVPROC lcGetShaderiv;
+GLGETSHADERINFOLOGPROC lcGetShaderInfoLog;
+GLCREATEPROGRAMPROC lcCreateProgram;
+GLDELETEPROGRAMPROC lcDeleteProgram;
+GLATTACHSHADERPROC lcAttachShader;
+GLBINDATTRIBLOCATIONPROC lcBindAttribLocation;
+GLLINKPROGRAMPROC lcLinkProgram;
+GLGETPROGRAMIVPROC lcGetProgramiv;
+GLGETPROGRAMINFOLOGPROC lcGetProgramInfoLog;
+GLUSEPROGRAMPROC lcUseProgram;
+GLGETUNIFORMLOCATIONPROC lcGetUniformLocation;
+GLUNIFORM1IPROC lcUniform1i;
+GLUNIFORMMATRIX4FVPROC lcUniformMatrix4fv;
+GLENABLEVERTEXATTRIBARRAYPROC lcEnableVertexAttribArray;
+GLDISABLEVERTEXATTRIBARRAYPROC lcDisableVertexAttribArray;
+GLVERTEXATTRIBPOINTERPROC lcVertexAttribPointer;
+
+GLBINDVERTEXARRAYPROC lcBindVertexArray;
+GLDELETEVERTEXARRAYSPROC lcDeleteVertexArrays;
+GLGENVERTEXARRAYSPROC lcGenVertexArrays;
+GLBINDBUFFERBASEPROC lcBindBufferBase;
+GLGETUNIFORMBLOCKINDEXPROC lcGetUniformBlockIndex;
+GLUNIFORMBLOCKBINDINGPROC lcUniformBlockBinding;
+GLDRAWELEMENTSINSTANCEDPROC lcDrawElementsInstanced;
+GLVERTEXATTRIBDIVISORPROC lcVertexAttribDivisor;
+
+GLACTIVETEXTUREPROC lcActiveTexture;
+GLBLENDFUNCSEPARATEPROC lcBlendFuncSeparate;
+GLDRAWBUFFERSPROC lcDrawBuffers;
+
 bool GL_SupportsShaderObjects;
 bool GL_SupportsVertexBufferObject;
 bool GL_UseVertexBufferObject;
@@ -108,6 +149,10 @@ bool GL_SupportsFramebufferObjectARB;
 bool GL_SupportsFramebufferObjectEXT;
 bool GL_SupportsAnisotropic;
 GLfloat GL_MaxAnisotropy;
+bool GL_SupportsCoreShaders;
+bool GL_SupportsTimerQuery;
+bool GL_SupportsBlendedTransparency;
+bool GL_SupportsPixelBufferObject;
 
 bool GL_ExtensionSupported(const GLubyte* Extensions, const char* Name)
 {
@@ -288,4 +333,69 @@ void GL_InitializeSharedExtensions(lcGLWidget* Window)
 
 		GL_SupportsShaderObjects = true;
 	}
+	const char* Version = (const char*)glGetString(GL_VERSION);
+	int VersionMajor = 0, VersionMinor = 0;
+
+	if (Version)
+		sscanf(Version, "%d.%d", &VersionMajor, &VersionMinor);
+
+	bool Version33 = VersionMajor > 3 || (VersionMajor == 3 && VersionMinor >= 3);
+	bool Version15 = VersionMajor > 1 || (VersionMajor == 1 && VersionMinor >= 5);
+	bool Version21 = VersionMajor > 2 || (VersionMajor == 2 && VersionMinor >= 1);
+
+	if (GL_SupportsVertexBufferObject && (Version21 || GL_ExtensionSupported(Extensions, "GL_ARB_pixel_buffer_object")))
+		GL_SupportsPixelBufferObject = lcMapBufferARB && lcUnmapBufferARB;
+
+	if (Version33 || (Version15 && GL_ExtensionSupported(Extensions, "GL_ARB_timer_query")))
+	{
+		lcGenQueries = (GLGENQUERIESPROC)Window->GetExtensionAddress("glGenQueries");
+		lcDeleteQueries = (GLDELETEQUERIESPROC)Window->GetExtensionAddress("glDeleteQueries");
+		lcBeginQuery = (GLBEGINQUERYPROC)Window->GetExtensionAddress("glBeginQuery");
+		lcEndQuery = (GLENDQUERYPROC)Window->GetExtensionAddress("glEndQuery");
+		lcGetQueryObjectiv = (GLGETQUERYOBJECTIVPROC)Window->GetExtensionAddress("glGetQueryObjectiv");
+		lcGetQueryObjectui64v = (GLGETQUERYOBJECTUI64VPROC)Window->GetExtensionAddress("glGetQueryObjectui64v");
+
+		GL_SupportsTimerQuery = lcGenQueries && lcBeginQuery && lcEndQuery && lcGetQueryObjectiv && lcGetQueryObjectui64v;
+	}
+
+	if (Version33)
+	{
+		lcCreateShader = (GLCREATESHADERPROC)Window->GetExtensionAddress("glCreateShader");
+		lcDeleteShader = (GLDELETESHADERPROC)Window->GetExtensionAddress("glDeleteShader");
+		lcShaderSource = (GLSHADERSOURCEPROC)Window->GetExtensionAddress("glShaderSource");
+		lcCompileShader = (GLCOMPILESHADERPROC)Window->GetExtensionAddress("glCompileShader");
+		lcGetShaderiv = (GLGETSHADERIVPROC)Window->GetExtensionAddress("glGetShaderiv");
+		lcGetShaderInfoLog = (GLGETSHADERINFOLOGPROC)Window->GetExtensionAddress("glGetShaderInfoLog");
+		lcCreateProgram = (GLCREATEPROGRAMPROC)Window->GetExtensionAddress("glCreateProgram");
+		lcDeleteProgram = (GLDELETEPROGRAMPROC)Window->GetExtensionAddress("glDeleteProgram");
+		lcAttachShader = (GLATTACHSHADERPROC)Window->GetExtensionAddress("glAttachShader");
+		lcBindAttribLocation = (GLBINDATTRIBLOCATIONPROC)Window->GetExtensionAddress("glBindAttribLocation");
+		lcLinkProgram = (GLLINKPROGRAMPROC)Window->GetExtensionAddress("glLinkProgram");
+		lcGetProgramiv = (GLGETPROGRAMIVPROC)Window->GetExtensionAddress("glGetProgramiv");
+		lcGetProgramInfoLog = (GLGETPROGRAMINFOLOGPROC)Window->GetExtensionAddress("glGetProgramInfoLog");
+		lcUseProgram = (GLUSEPROGRAMPROC)Window->GetExtensionAddress("glUseProgram");
+		lcGetUniformLocation = (GLGETUNIFORMLOCATIONPROC)Window->GetExtensionAddress("glGetUniformLocation");
+		lcUniform1i = (GLUNIFORM1IPROC)Window->GetExtensionAddress("glUniform1i");
+		lcUniformMatrix4fv = (GLUNIFORMMATRIX4FVPROC)Window->GetExtensionAddress("glUniformMatrix4fv");
+		lcEnableVertexAttribArray = (GLENABLEVERTEXATTRIBARRAYPROC)Window->GetExtensionAddress("glEnableVertexAttribArray");
+		lcDisableVertexAttribArray = (GLDISABLEVERTEXATTRIBARRAYPROC)Window->GetExtensionAddress("glDisableVertexAttribArray");
+		lcVertexAttribPointer = (GLVERTEXATTRIBPOINTERPROC)Window->GetExtensionAddress("glVertexAttribPointer");
+
+		lcBindVertexArray = (GLBINDVERTEXARRAYPROC)Window->GetExtensionAddress("glBindVertexArray");
+		lcDeleteVertexArrays = (GLDELETEVERTEXARRAYSPROC)Window->GetExtensionAddress("glDeleteVertexArrays");
+		lcGenVertexArrays = (GLGENVERTEXARRAYSPROC)Window->GetExtensionAddress("glGenVertexArrays");
+		lcBindBufferBase = (GLBINDBUFFERBASEPROC)Window->GetExtensionAddress("glBindBufferBase");
+		lcGetUniformBlockIndex = (GLGETUNIFORMBLOCKINDEXPROC)Window->GetExtensionAddress("glGetUniformBlockIndex");
+		lcUniformBlockBinding = (GLUNIFORMBLOCKBINDINGPROC)Window->GetExtensionAddress("glUniformBlockBinding");
+		lcDrawElementsInstanced = (GLDRAWELEMENTSINSTANCEDPROC)Window->GetExtensionAddress("glDrawElementsInstanced");
+		lcVertexAttribDivisor = (GLVERTEXATTRIBDIVISORPROC)Window->GetExtensionAddress("glVertexAttribDivisor");
+
+		GL_SupportsCoreShaders = lcCreateShader && lcCreateProgram && lcBindVertexArray && lcBindBufferBase && lcDrawElementsInstanced && lcVertexAttribDivisor;
+
+		lcActiveTexture = (GLACTIVETEXTUREPROC)Window->GetExtensionAddress("glActiveTexture");
+		lcBlendFuncSeparate = (GLBLENDFUNCSEPARATEPROC)Window->GetExtensionAddress("glBlendFuncSeparate");
+		lcDrawBuffers = (GLDRAWBUFFERSPROC)Window->GetExtensionAddress("glDrawBuffers");
+
+		GL_SupportsBlendedTransparency = GL_SupportsCoreShaders && GL_SupportsFramebufferObjectARB && lcActiveTexture && lcBlendFuncSeparate && lcDrawBuffers;
+	}
 }
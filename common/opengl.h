@@ -12,6 +12,10 @@ extern bool GL_SupportsFramebufferObjectARB;
 extern bool GL_SupportsFramebufferObjectEXT;
 extern bool GL_SupportsAnisotropic;
 extern GLfloat GL_MaxAnisotropy;
+extern bool GL_SupportsCoreShaders;
+extern bool GL_SupportsTimerQuery;
+extern bool GL_SupportsBlendedTransparency;
+extern bool GL_SupportsPixelBufferObject;
 
 inline void GL_DisableVertexBufferObject()
 {
@@ -38,6 +42,18 @@ inline bool GL_HasFramebufferObjectEXT()
 	return GL_SupportsFramebufferObjectEXT;
 }
 
+// OpenGL 3.3 shaders, vertex array objects, uniform buffers and instancing, the mesh drawing code also needs buffer objects.
+inline bool GL_HasCoreShaders()
+{
+	return GL_SupportsCoreShaders && GL_UseVertexBufferObject;
+}
+
+// Floating point render targets, multiple draw buffers and separate blend functions used to blend translucent meshes without sorting them.
+inline bool GL_HasBlendedTransparency()
+{
+	return GL_SupportsBlendedTransparency && GL_HasCoreShaders();
+}
+
 #ifndef GL_VERSION_1_4
 #define GL_BLEND_DST_RGB                  0x80C8
 #define GL_BLEND_SRC_RGB                  0x80C9
@@ -165,6 +181,15 @@ typedef unsigned int GLhandleARB;
 #define GL_DYNAMIC_COPY_ARB                          0x88EA
 #endif
 
+#ifndef GL_ARB_pixel_buffer_object
+#define GL_PIXEL_PACK_BUFFER_ARB                     0x88EB
+#define GL_PIXEL_UNPACK_BUFFER_ARB                   0x88EC
+#endif
+
+#ifndef GL_BGRA
+#define GL_BGRA                                      0x80E1
+#endif
+
 #ifndef APIENTRY
 #define APIENTRY
 #endif
@@ -475,6 +500,85 @@ typedef GLint (APIENTRY *GLGETATTRIBLOCATIONARBPROC) (GLhandleARB programObj, co
 #define GL_ARB_fragment_shader 1
 #endif
 
+#ifndef GL_VERSION_2_0
+#define GL_FRAGMENT_SHADER                           0x8B30
+#define GL_VERTEX_SHADER                             0x8B31
+#define GL_COMPILE_STATUS                            0x8B81
+#define GL_LINK_STATUS                               0x8B82
+#define GL_INFO_LOG_LENGTH                           0x8B84
+#define GL_SHADING_LANGUAGE_VERSION                  0x8B8C
+#endif
+
+#ifndef GL_VERSION_3_1
+#define GL_UNIFORM_BUFFER                            0x8A11
+#define GL_INVALID_INDEX                             0xFFFFFFFFu
+#endif
+
+#ifndef GL_VERSION_1_3
+#define GL_TEXTURE0                                  0x84C0
+#define GL_TEXTURE1                                  0x84C1
+#endif
+
+#ifndef GL_VERSION_3_0
+#define GL_RGBA16F                                   0x881A
+#define GL_R16F                                      0x822D
+#define GL_HALF_FLOAT                                0x140B
+#endif
+
+#ifndef GL_VERSION_1_5
+#define GL_QUERY_RESULT                              0x8866
+#define GL_QUERY_RESULT_AVAILABLE                    0x8867
+#endif
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED                              0x88BF
+#endif
+
+// OpenGL 1.5 queries and 3.3 timer queries
+typedef void (APIENTRY *GLGENQUERIESPROC) (GLsizei n, GLuint *ids);
+typedef void (APIENTRY *GLDELETEQUERIESPROC) (GLsizei n, const GLuint *ids);
+typedef void (APIENTRY *GLBEGINQUERYPROC) (GLenum target, GLuint id);
+typedef void (APIENTRY *GLENDQUERYPROC) (GLenum target);
+typedef void (APIENTRY *GLGETQUERYOBJECTIVPROC) (GLuint id, GLenum pname, GLint *params);
+typedef void (APIENTRY *GLGETQUERYOBJECTUI64VPROC) (GLuint id, GLenum pname, lcuint64 *params);
+
+// OpenGL 2.0 shaders
+typedef GLuint (APIENTRY *GLCREATESHADERPROC) (GLenum type);
+typedef void (APIENTRY *GLDELETESHADERPROC) (GLuint shader);
+typedef void (APIENTRY *GLSHADERSOURCEPROC) (GLuint shader, GLsizei count, const GLchar* const *string, const GLint *length);
+typedef void (APIENTRY *GLCOMPILESHADERPROC) (GLuint shader);
+typedef void (APIENTRY *GLGETSHADERIVPROC) (GLuint shader, GLenum pname, GLint *params);
+typedef void (APIENTRY *GLGETSHADERINFOLOGPROC) (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+typedef GLuint (APIENTRY *GLCREATEPROGRAMPROC) (void);
+typedef void (APIENTRY *GLDELETEPROGRAMPROC) (GLuint program);
+typedef void (APIENTRY *GLATTACHSHADERPROC) (GLuint program, GLuint shader);
+typedef void (APIENTRY *GLBINDATTRIBLOCATIONPROC) (GLuint program, GLuint index, const GLchar *name);
+typedef void (APIENTRY *GLLINKPROGRAMPROC) (GLuint program);
+typedef void (APIENTRY *GLGETPROGRAMIVPROC) (GLuint program, GLenum pname, GLint *params);
+typedef void (APIENTRY *GLGETPROGRAMINFOLOGPROC) (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+typedef void (APIENTRY *GLUSEPROGRAMPROC) (GLuint program);
+typedef GLint (APIENTRY *GLGETUNIFORMLOCATIONPROC) (GLuint program, const GLchar *name);
+typedef void (APIENTRY *GLUNIFORM1IPROC) (GLint location, GLint v0);
+typedef void (APIENTRY *GLUNIFORMMATRIX4FVPROC) (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+typedef void (APIENTRY *GLENABLEVERTEXATTRIBARRAYPROC) (GLuint index);
+typedef void (APIENTRY *GLDISABLEVERTEXATTRIBARRAYPROC) (GLuint index);
+typedef void (APIENTRY *GLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+
+// OpenGL 3.0 vertex array objects, 3.1 uniform buffers and instancing, 3.3 instanced arrays
+typedef void (APIENTRY *GLBINDVERTEXARRAYPROC) (GLuint array);
+typedef void (APIENTRY *GLDELETEVERTEXARRAYSPROC) (GLsizei n, const GLuint *arrays);
+typedef void (APIENTRY *GLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
+typedef void (APIENTRY *GLBINDBUFFERBASEPROC) (GLenum target, GLuint index, GLuint buffer);
+typedef GLuint (APIENTRY *GLGETUNIFORMBLOCKINDEXPROC) (GLuint program, const GLchar *uniformBlockName);
+typedef void (APIENTRY *GLUNIFORMBLOCKBINDINGPROC) (GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+typedef void (APIENTRY *GLDRAWELEMENTSINSTANCEDPROC) (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount);
+typedef void (APIENTRY *GLVERTEXATTRIBDIVISORPROC) (GLuint index, GLuint divisor);
+
+// OpenGL 1.3 multitexture, 1.4 separate blend functions and 2.0 multiple draw buffers
+typedef void (APIENTRY *GLACTIVETEXTUREPROC) (GLenum texture);
+typedef void (APIENTRY *GLBLENDFUNCSEPARATEPROC) (GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
+typedef void (APIENTRY *GLDRAWBUFFERSPROC) (GLsizei n, const GLenum *bufs);
+
 extern GLBINDBUFFERARBPROC lcBindBufferARB;
 extern GLDELETEBUFFERSARBPROC lcDeleteBuffersARB;
 extern GLGENBUFFERSARBPROC lcGenBuffersARB;
@@ -570,6 +674,47 @@ extern GLBINDATTRIBLOCATIONARBPROC lcBindAttribLocationARB;
 extern GLGETACTIVEATTRIBARBPROC lcGetActiveAttribARB;
 extern GLGETATTRIBLOCATIONARBPROC lcGetAttribLocationARB;
 
+extern GLGENQUERIESPROC lcGenQueries;
+extern GLDELETEQUERIESPROC lcDeleteQueries;
+extern GLBEGINQUERYPROC lcBeginQuery;
+extern GLENDQUERYPROC lcEndQuery;
+extern GLGETQUERYOBJECTIVPROC lcGetQueryObjectiv;
+extern GLGETQUERYOBJECTUI64VPROC lcGetQueryObjectui64v;
+
+extern GLCREATESHADERPROC lcCreateShader;
+extern GLDELETESHADERPROC lcDeleteShader;
+extern GLSHADERSOURCEPROC lcShaderSource;
+extern GLCOMPILESHADERPROC lcCompileShader;
+extern GLGETSHADERIVPROC lcGetShaderiv;
+extern GLGETSHADERINFOLOGPROC lcGetShaderInfoLog;
+extern GLCREATEPROGRAMPROC lcCreateProgram;
+extern GLDELETEPROGRAMPROC lcDeleteProgram;
+extern GLATTACHSHADERPROC lcAttachShader;
+extern GLBINDATTRIBLOCATIONPROC lcBindAttribLocation;
+extern GLLINKPROGRAMPROC lcLinkProgram;
+extern GLGETPROGRAMIVPROC lcGetProgramiv;
+extern GLGETPROGRAMINFOLOGPROC lcGetProgramInfoLog;
+extern GLUSEPROGRAMPROC lcUseProgram;
+extern GLGETUNIFORMLOCATIONPROC lcGetUniformLocation;
+extern GLUNIFORM1IPROC lcUniform1i;
+extern GLUNIFORMMATRIX4FVPROC lcUniformMatrix4fv;
+extern GLENABLEVERTEXATTRIBARRAYPROC lcEnableVertexAttribArray;
+extern GLDISABLEVERTEXATTRIBARRAYPROC lcDisableVertexAttribArray;
+extern GLVERTEXATTRIBPOINTERPROC lcVertexAttribPointer;
+
+extern GLBINDVERTEXARRAYPROC lcBindVertexArray;
+extern GLDELETEVERTEXARRAYSPROC lcDeleteVertexArrays;
+extern GLGENVERTEXARRAYSPROC lcGenVertexArrays;
+extern GLBINDBUFFERBASEPROC lcBindBufferBase;
+extern GLGETUNIFORMBLOCKINDEXPROC lcGetUniformBlockIndex;
+extern GLUNIFORMBLOCKBINDINGPROC lcUniformBlockBinding;
+extern GLDRAWELEMENTSINSTANCEDPROC lcDrawElementsInstanced;
+extern GLVERTEXATTRIBDIVISORPROC lcVertexAttribDivisor;
+
+extern GLACTIVETEXTUREPROC lcActiveTexture;
+extern GLBLENDFUNCSEPARATEPROC lcBlendFuncSeparate;
+extern GLDRAWBUFFERSPROC lcDrawBuffers;
+
 #define glBindBuffer lcBindBufferARB
 #define glDeleteBuffers lcDeleteBuffersARB
 #define glGenBuffers lcGenBuffersARB
@@ -665,4 +810,45 @@ extern GLGETATTRIBLOCATIONARBPROC lcGetAttribLocationARB;
 #define glGetActiveAttribARB lcGetActiveAttribARB
 #define glGetAttribLocationARB lcGetAttribLocationARB
 
+#define glGenQueries lcGenQueries
+#define glDeleteQueries lcDeleteQueries
+#define glBeginQuery lcBeginQuery
+#define glEndQuery lcEndQuery
+#define glGetQueryObjectiv lcGetQueryObjectiv
+#define glGetQueryObjectui64v lcGetQueryObjectui64v
+
+#define glCreateShader lcCreateShader
+#define glDeleteShader lcDeleteShader
+#define glShaderSource lcShaderSource
+#define glCompileShader lcCompileShader
+#define glGetShaderiv lcGetShaderiv
+#define glGetShaderInfoLog lcGetShaderInfoLog
+#define glCreateProgram lcCreateProgram
+#define glDeleteProgram lcDeleteProgram
+#define glAttachShader lcAttachShader
+#define glBindAttribLocation lcBindAttribLocation
+#define glLinkProgram lcLinkProgram
+#define glGetProgramiv lcGetProgramiv
+#define glGetProgramInfoLog lcGetProgramInfoLog
+#define glUseProgram lcUseProgram
+#define glGetUniformLocation lcGetUniformLocation
+#define glUniform1i lcUniform1i
+#define glUniformMatrix4fv lcUniformMatrix4fv
+#define glEnableVertexAttribArray lcEnableVertexAttribArray
+#define glDisableVertexAttribArray lcDisableVertexAttribArray
+#define glVertexAttribPointer lcVertexAttribPointer
+
+#define glBindVertexArray lcBindVertexArray
+#define glDeleteVertexArrays lcDeleteVertexArrays
+#define glGenVertexArrays lcGenVertexArrays
+#define glBindBufferBase lcBindBufferBase
+#define glGetUniformBlockIndex lcGetUniformBlockIndex
+#define glUniformBlockBinding lcUniformBlockBinding
+#define glDrawElementsInstanced lcDrawElementsInstanced
+#define glVertexAttribDivisor lcVertexAttribDivisor
+
+#define glActiveTexture lcActiveTexture
+#define glBlendFuncSeparate lcBlendFuncSeparate
+#define glDrawBuffers lcDrawBuffers
+
 #endif // _OPENGL_H_
@@ -113,6 +113,17 @@ public:
 		return (mState & LC_PIECE_HIDDEN) != 0;
 	}
 
+	bool IsAnimated() const
+	{
+		return mPositionKeys.GetSize() > 1 || mRotationKeys.GetSize() > 1;
+	}
+
+	// Returns true if the piece moves in this step.
+	bool HasKeys(lcStep Step) const
+	{
+		return HasKey(mPositionKeys, Step) || HasKey(mRotationKeys, Step);
+	}
+
 	void SetHidden(bool Hidden)
 	{
 		if (Hidden)
@@ -82,12 +82,19 @@ void PieceInfo::SetModel(lcModel* Model, bool UpdateMesh)
 		lcArray<lcLibraryTextureMap> TextureStack;
 		PieceFile.Seek(0, SEEK_SET);
 
+		lcPiecesLibrary* Library = lcGetPiecesLibrary();
+
+		Library->mLoadMutex.lock();
 		const char* OldLocale = setlocale(LC_NUMERIC, "C");
-		bool Ret = lcGetPiecesLibrary()->ReadMeshData(PieceFile, lcMatrix44Identity(), 16, TextureStack, MeshData);
+		bool Ret = Library->ReadMeshData(PieceFile, lcMatrix44Identity(), 16, TextureStack, MeshData);
 		setlocale(LC_NUMERIC, OldLocale);
 
 		if (Ret)
-			lcGetPiecesLibrary()->CreateMesh(this, MeshData);
+			Library->OptimizeMeshData(MeshData);
+		Library->mLoadMutex.unlock();
+
+		if (Ret)
+			Library->CreateMesh(this, MeshData);
 	}
 }
 
@@ -289,16 +296,13 @@ void PieceInfo::AddRenderMesh(lcScene& Scene)
 	RenderMesh.ColorIndex = gDefaultColor;
 	RenderMesh.Focused = false;
 	RenderMesh.Selected = false;
+	RenderMesh.Piece = Scene.mCurrentPiece;
 
 	if (mFlags & (LC_PIECE_HAS_SOLID | LC_PIECE_HAS_DEFAULT | LC_PIECE_HAS_LINES))
 		Scene.mOpaqueMeshes.Add(RenderMesh);
 
 	if (mFlags & LC_PIECE_HAS_TRANSLUCENT)
-	{
-		RenderMesh.Distance = Scene.mViewMatrix.r[3].z;
-
 		Scene.mTranslucentMeshes.Add(RenderMesh);
-	}
 }
 
 void PieceInfo::AddRenderMeshes(lcScene& Scene, const lcMatrix44& WorldMatrix, int ColorIndex, bool Focused, bool Selected)
@@ -312,6 +316,7 @@ void PieceInfo::AddRenderMeshes(lcScene& Scene, const lcMatrix44& WorldMatrix, i
 		RenderMesh.ColorIndex = ColorIndex;
 		RenderMesh.Focused = Focused;
 		RenderMesh.Selected = Selected;
+		RenderMesh.Piece = Scene.mCurrentPiece;
 
 		bool Translucent = lcIsColorTranslucent(ColorIndex);
 
@@ -319,13 +324,7 @@ void PieceInfo::AddRenderMeshes(lcScene& Scene, const lcMatrix44& WorldMatrix, i
 			Scene.mOpaqueMeshes.Add(RenderMesh);
 
 		if ((mFlags & LC_PIECE_HAS_TRANSLUCENT) || ((mFlags & LC_PIECE_HAS_DEFAULT) && Translucent))
-		{
-			lcVector3 Pos = lcMul31(WorldMatrix[3], Scene.mViewMatrix);
-
-			RenderMesh.Distance = Pos[2];
-
 			Scene.mTranslucentMeshes.Add(RenderMesh);
-		}
 	}
 
 	if (mFlags & LC_PIECE_MODEL)
@@ -63,14 +63,14 @@ void PiecePreview::OnDraw()
 	mContext->SetProjectionMatrix(ProjectionMatrix);
 
 	lcScene Scene;
-	Scene.Begin(ViewMatrix);
+	Scene.Begin(ViewMatrix, ProjectionMatrix);
 
 	m_PieceInfo->AddRenderMeshes(Scene, lcMatrix44Identity(), gMainWindow->mColorIndex, false, false);
 
 	Scene.End();
 
-	mContext->DrawOpaqueMeshes(ViewMatrix, Scene.mOpaqueMeshes);
-	mContext->DrawTranslucentMeshes(ViewMatrix, Scene.mTranslucentMeshes);
+	mContext->DrawOpaqueMeshes(Scene);
+	mContext->DrawTranslucentMeshes(Scene);
 
 	mContext->UnbindMesh(); // context remove
 }
@@ -18,6 +18,7 @@
 #include "lc_profile.h"
 #include "preview.h"
 #include "lc_qmodellistdialog.h"
+#include "lc_imagewriter.h"
 
 Project::Project()
 {
@@ -70,6 +71,9 @@ void Project::SetActiveModel(int ModelIndex)
 	mActiveModel = mModels[ModelIndex];
 	mActiveModel->UpdateInterface();
 
+	if (!gMainWindow)
+		return;
+
 	const lcArray<View*>& Views = gMainWindow->GetViews();
 	for (int ViewIdx = 0; ViewIdx < Views.GetSize(); ViewIdx++)
 		Views[ViewIdx]->SetModel(lcGetActiveModel());
@@ -350,6 +354,59 @@ void Project::GetModelParts(lcArray<lcModelPartsEntry>& ModelParts)
 	SetActiveModel(mModels.FindIndex(mActiveModel));
 }
 
+// Meshes of the parts of a model to export, pieces quantized to save memory are read again at full precision.
+// GetMesh() only reads the table so export tasks can call it from several threads.
+class lcExportMeshes
+{
+public:
+	lcExportMeshes(const lcArray<lcModelPartsEntry>& ModelParts)
+	{
+		lcPiecesLibrary* Library = lcGetPiecesLibrary();
+
+		for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
+		{
+			PieceInfo* Info = ModelParts[PartIdx].Info;
+
+			if (mMeshes.contains(Info))
+				continue;
+
+			lcMesh* Mesh = Library->LoadFullPrecisionMesh(Info);
+
+			if (Mesh)
+				mLoadedMeshes.Add(Mesh);
+			else
+				Mesh = Info->GetMesh();
+
+			mMeshes.insert(Info, Mesh);
+		}
+	}
+
+	~lcExportMeshes()
+	{
+		mLoadedMeshes.DeleteAll();
+	}
+
+	lcMesh* GetMesh(PieceInfo* Info) const
+	{
+		return mMeshes.value(Info);
+	}
+
+protected:
+	QHash<PieceInfo*, lcMesh*> mMeshes;
+	lcArray<lcMesh*> mLoadedMeshes;
+};
+
+// Exports also run from the command line, where there's no window and a message box would wait forever for a click.
+static void lcShowExportError(const QString& Message, bool Warning)
+{
+	if (!gMainWindow)
+		fprintf(stderr, "ERROR: %s\n", Message.toLocal8Bit().data());
+	else if (Warning)
+		QMessageBox::warning(gMainWindow, Project::tr("LeoCAD"), Message);
+	else
+		QMessageBox::information(gMainWindow, Project::tr("LeoCAD"), Message);
+}
+
 QString Project::GetExportFileName(const QString& FileName, const QString& DefaultExtension, const QString& DialogTitle, const QString& DialogFilter) const
 {
 	if (!FileName.isEmpty())
@@ -375,7 +432,7 @@ QString Project::GetExportFileName(const QString& FileName, const QString& Defau
 	return QFileDialog::getSaveFileName(gMainWindow, DialogTitle, SaveFileName, DialogFilter);
 }
 
-void Project::Export3DStudio(const QString& FileName)
+bool Project::Export3DStudio(const QString& FileName)
 {
 	lcArray<lcModelPartsEntry> ModelParts;
 
@@ -383,23 +440,25 @@ void Project::Export3DStudio(const QString& FileName)
 
 	if (ModelParts.IsEmpty())
 	{
-		QMessageBox::information(gMainWindow, tr("LeoCAD"), tr("Nothing to export."));
-		return;
+		lcShowExportError(tr("Nothing to export."), false);
+		return false;
 	}
 
 	QString SaveFileName = GetExportFileName(FileName, "3ds", tr("Export 3D Studio"), tr("3DS Files (*.3ds);;All Files (*.*)"));
 
 	if (SaveFileName.isEmpty())
-		return;
+		return false;
 
 	lcDiskFile File;
 
 	if (!File.Open(SaveFileName, "wb"))
 	{
-		QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Could not open file '%1' for writing.").arg(FileName));
-		return;
+		lcShowExportError(tr("Could not open file '%1' for writing.").arg(SaveFileName), true);
+		return false;
 	}
 
+	lcExportMeshes ExportMeshes(ModelParts);
+
 	long M3DStart = File.GetPosition();
 	File.WriteU16(0x4D4D); // CHK_M3DMAGIC
 	File.WriteU32(0);
@@ -710,8 +769,7 @@ void Project::Export3DStudio(const QString& FileName)
 	int NumPieces = 0;
 	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
 	{
-		PieceInfo* Info = ModelParts[PartIdx].Info;
-		lcMesh* Mesh = Info->GetMesh();
+		lcMesh* Mesh = ExportMeshes.GetMesh(ModelParts[PartIdx].Info);
 
 		if (!Mesh || Mesh->mIndexType == GL_UNSIGNED_INT)
 			continue;
@@ -734,13 +792,11 @@ void Project::Export3DStudio(const QString& FileName)
 
 		File.WriteU16(Mesh->mNumVertices);
 
-		float* Verts = (float*)Mesh->mVertexBuffer.mData;
 		const lcMatrix44& ModelWorld = ModelParts[PartIdx].WorldMatrix;
 
 		for (int VertexIdx = 0; VertexIdx < Mesh->mNumVertices; VertexIdx++)
 		{
-			lcVector3 Pos(Verts[VertexIdx * 3], Verts[VertexIdx * 3 + 1], Verts[VertexIdx * 3 + 2]);
-			Pos = lcMul31(Pos, ModelWorld);
+			lcVector3 Pos = lcMul31(Mesh->GetVertexPosition(VertexIdx), ModelWorld);
 			File.WriteFloat(Pos[0]);
 			File.WriteFloat(Pos[1]);
 			File.WriteFloat(Pos[2]);
@@ -860,6 +916,8 @@ void Project::Export3DStudio(const QString& FileName)
 	File.Seek(M3DStart + 2, SEEK_SET);
 	File.WriteU32(M3DEnd - M3DStart);
 	File.Seek(M3DEnd, SEEK_SET);
+
+	return true;
 }
 
 void Project::ExportBrickLink()
@@ -962,22 +1020,26 @@ void Project::ExportCSV()
 	setlocale(LC_NUMERIC, OldLocale);
 }
 
-void Project::CreateHTMLPieceList(QTextStream& Stream, lcModel* Model, lcStep Step, bool Images, const QString& ImageExtension)
+void Project::CreateHTMLPieceList(QTextStream& Stream, const lcArray<lcPartsListEntry>& PartsList, const QHash<PieceInfo*, int>& LibraryIndices, bool Images, const QString& ImageExtension)
 {
 	int* ColorsUsed = new int[gColorList.GetSize()];
 	memset(ColorsUsed, 0, sizeof(ColorsUsed[0]) * gColorList.GetSize());
 	int* PiecesUsed = new int[gColorList.GetSize()];
 	int NumColors = 0;
 
-	lcArray<lcPartsListEntry> PartsList;
-
-	if (Step == 0)
-		Model->GetPartsList(gDefaultColor, PartsList);
-	else
-		Model->GetPartsListForStep(Step, gDefaultColor, PartsList);
+	// Rows are listed in the same order as the library.
+	QMap<int, PieceInfo*> Pieces;
 
 	for (int PieceIdx = 0; PieceIdx < PartsList.GetSize(); PieceIdx++)
+	{
+		PieceInfo* Info = PartsList[PieceIdx].Info;
+		QHash<PieceInfo*, int>::const_iterator LibraryIndex = LibraryIndices.find(Info);
+
+		if (LibraryIndex != LibraryIndices.end())
+			Pieces.insert(LibraryIndex.value(), Info);
+
 		ColorsUsed[PartsList[PieceIdx].ColorIndex]++;
+	}
 
 	Stream << QLatin1String("<br><table border=1><tr><td><center>Piece</center></td>\r\n");
 
@@ -993,57 +1055,528 @@ void Project::CreateHTMLPieceList(QTextStream& Stream, lcModel* Model, lcStep St
 	NumColors++;
 	Stream << QLatin1String("</tr>\n");
 
-	for (int j = 0; j < lcGetPiecesLibrary()->mPieces.GetSize(); j++)
+	for (QMap<int, PieceInfo*>::const_iterator PieceIt = Pieces.constBegin(); PieceIt != Pieces.constEnd(); ++PieceIt)
 	{
-		bool Add = false;
 		memset(PiecesUsed, 0, sizeof(PiecesUsed[0]) * gColorList.GetSize());
-		PieceInfo* pInfo = lcGetPiecesLibrary()->mPieces[j];
+		PieceInfo* pInfo = PieceIt.value();
 
 		for (int PieceIdx = 0; PieceIdx < PartsList.GetSize(); PieceIdx++)
-		{
 			if (PartsList[PieceIdx].Info == pInfo)
-			{
 				PiecesUsed[PartsList[PieceIdx].ColorIndex] += PartsList[PieceIdx].Count;
-				Add = true;
+
+		if (Images)
+			Stream << QString("<tr><td><IMG SRC=\"%1%2\" ALT=\"%3\"></td>\n").arg(pInfo->m_strName, ImageExtension, pInfo->m_strDescription);
+		else
+			Stream << QString("<tr><td>%1</td>\r\n").arg(pInfo->m_strDescription);
+
+		int curcol = 1;
+		for (int ColorIdx = 0; ColorIdx < gColorList.GetSize(); ColorIdx++)
+		{
+			if (PiecesUsed[ColorIdx])
+			{
+				while (curcol != ColorsUsed[ColorIdx] + 1)
+				{
+					Stream << QLatin1String("<td><center>-</center></td>\r\n");
+					curcol++;
+				}
+
+				Stream << QString("<td><center>%1</center></td>\r\n").arg(QString::number(PiecesUsed[ColorIdx]));
+				curcol++;
 			}
 		}
 
-		if (Add)
+		while (curcol != NumColors)
 		{
-			if (Images)
-				Stream << QString("<tr><td><IMG SRC=\"%1%2\" ALT=\"%3\"></td>\n").arg(pInfo->m_strName, ImageExtension, pInfo->m_strDescription);
-			else
-				Stream << QString("<tr><td>%1</td>\r\n").arg(pInfo->m_strDescription);
+			Stream << QLatin1String("<td><center>-</center></td>\r\n");
+			curcol++;
+		}
+
+		Stream << QLatin1String("</tr>\r\n");
+	}
+	Stream << QLatin1String("</table>\r\n<br>");
+
+	delete[] PiecesUsed;
+	delete[] ColorsUsed;
+}
+
+// Writes JSON numbers without the trailing zeros, the decimal point doesn't depend on the locale.
+static void lcWriteJsonFloats(lcFile& File, const float* Values, int Count, int Decimals)
+{
+	char Buffer[64];
+
+	File.WriteBuffer("[", 1);
+
+	for (int ValueIdx = 0; ValueIdx < Count; ValueIdx++)
+	{
+		if (ValueIdx)
+			File.WriteBuffer(",", 1);
+
+		int Length = lcFormatFloat(Buffer, Values[ValueIdx], Decimals);
+
+		if (memchr(Buffer, '.', Length))
+		{
+			while (Buffer[Length - 1] == '0')
+				Length--;
+
+			if (Buffer[Length - 1] == '.')
+				Length--;
+		}
+
+		File.WriteBuffer(Buffer, Length);
+	}
+
+	File.WriteBuffer("]", 1);
+}
+
+static void lcWriteJsonString(lcFile& File, const char* String)
+{
+	File.WriteBuffer("\"", 1);
+
+	for (const char* Char = String; *Char; Char++)
+	{
+		if (*Char == '"' || *Char == '\\')
+			File.WriteBuffer("\\", 1);
+
+		File.WriteBuffer(Char, 1);
+	}
+
+	File.WriteBuffer("\"", 1);
+}
+
+// Rotation of a piece as the quaternion used by glTF, the matrix rows are the rotated axes.
+static lcVector4 lcGLTFRotation(const lcMatrix44& Matrix)
+{
+	const lcVector4* r = Matrix.r;
+	float Trace = r[0][0] + r[1][1] + r[2][2];
+
+	if (Trace > 0.0f)
+	{
+		float s = 0.5f / sqrtf(Trace + 1.0f);
+		return lcVector4((r[1][2] - r[2][1]) * s, (r[2][0] - r[0][2]) * s, (r[0][1] - r[1][0]) * s, 0.25f / s);
+	}
+	else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		float s = 2.0f * sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]);
+		return lcVector4(0.25f * s, (r[1][0] + r[0][1]) / s, (r[2][0] + r[0][2]) / s, (r[1][2] - r[2][1]) / s);
+	}
+	else if (r[1][1] > r[2][2])
+	{
+		float s = 2.0f * sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]);
+		return lcVector4((r[1][0] + r[0][1]) / s, 0.25f * s, (r[2][1] + r[1][2]) / s, (r[2][0] - r[0][2]) / s);
+	}
+	else
+	{
+		float s = 2.0f * sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]);
+		return lcVector4((r[2][0] + r[0][2]) / s, (r[2][1] + r[1][2]) / s, 0.25f * s, (r[0][1] - r[1][0]) / s);
+	}
+}
+
+// Only rotations and translations can be stored as instances, other pieces are written as nodes.
+static bool lcGLTFIsRigid(const lcMatrix44& Matrix)
+{
+	lcVector3 Rows[3];
+
+	for (int Row = 0; Row < 3; Row++)
+	{
+		Rows[Row] = lcVector3(Matrix.r[Row][0], Matrix.r[Row][1], Matrix.r[Row][2]);
+
+		if (fabsf(lcLength(Rows[Row]) - 1.0f) > 0.001f)
+			return false;
+	}
+
+	return lcDot(lcCross(Rows[0], Rows[1]), Rows[2]) > 0.999f;
+}
+
+// Collects the data of a binary glTF file in one buffer, each accessor has its own view of the buffer.
+class lcGLTFBuffer
+{
+public:
+	lcGLTFBuffer()
+	{
+		mBinary.mGrowBytes = 1024 * 1024;
+		mAccessors.mGrowBytes = 64 * 1024;
+		mViews.mGrowBytes = 64 * 1024;
+		mNumAccessors = 0;
+	}
+
+	int AddAccessor(const void* Data, int Size, int Target, int ComponentType, int Count, const char* Type, const float* Min = NULL, const float* Max = NULL, int NumComponents = 0)
+	{
+		char Line[256];
+		const char* Separator = mNumAccessors ? "," : "";
+
+		// Accessors must start at a multiple of their component size.
+		long Offset = (long)mBinary.GetLength();
+		const lcuint8 Padding[4] = { 0, 0, 0, 0 };
+
+		if (Offset % 4)
+		{
+			mBinary.WriteBuffer(Padding, 4 - Offset % 4);
+			Offset = (long)mBinary.GetLength();
+		}
+
+		mBinary.WriteBuffer(Data, Size);
+
+		if (Target)
+			sprintf(Line, "%s{\"buffer\":0,\"byteOffset\":%ld,\"byteLength\":%d,\"target\":%d}", Separator, Offset, Size, Target);
+		else
+			sprintf(Line, "%s{\"buffer\":0,\"byteOffset\":%ld,\"byteLength\":%d}", Separator, Offset, Size);
+		mViews.WriteLine(Line);
 
-			int curcol = 1;
-			for (int ColorIdx = 0; ColorIdx < gColorList.GetSize(); ColorIdx++)
+		sprintf(Line, "%s{\"bufferView\":%d,\"componentType\":%d,\"count\":%d,\"type\":\"%s\"", Separator, mNumAccessors, ComponentType, Count, Type);
+		mAccessors.WriteLine(Line);
+
+		if (Min && Max)
+		{
+			mAccessors.WriteLine(",\"min\":");
+			lcWriteJsonFloats(mAccessors, Min, NumComponents, 6);
+			mAccessors.WriteLine(",\"max\":");
+			lcWriteJsonFloats(mAccessors, Max, NumComponents, 6);
+		}
+
+		mAccessors.WriteLine("}");
+
+		return mNumAccessors++;
+	}
+
+	int AddPositions(const lcArray<lcVector3>& Positions)
+	{
+		lcVector3 Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		for (int VertexIdx = 0; VertexIdx < Positions.GetSize(); VertexIdx++)
+		{
+			for (int Axis = 0; Axis < 3; Axis++)
 			{
-				if (PiecesUsed[ColorIdx])
+				Min[Axis] = lcMin(Min[Axis], Positions[VertexIdx][Axis]);
+				Max[Axis] = lcMax(Max[Axis], Positions[VertexIdx][Axis]);
+			}
+		}
+
+		return AddAccessor(&Positions[0], Positions.GetSize() * sizeof(lcVector3), 34962, 5126, Positions.GetSize(), "VEC3", Min, Max, 3);
+	}
+
+	lcMemFile mBinary;
+	lcMemFile mAccessors;
+	lcMemFile mViews;
+	int mNumAccessors;
+};
+
+struct lcGLTFPiece
+{
+	lcMesh* Mesh;
+	int PositionAccessor;
+	int TexturedPositionAccessor;
+	int FirstSection;
+	bool HasDefaultColor;
+};
+
+bool Project::ExportGLTF(const QString& FileName, bool Instancing)
+{
+	lcArray<lcModelPartsEntry> ModelParts;
+
+	GetModelParts(ModelParts);
+
+	if (ModelParts.IsEmpty())
+	{
+		lcShowExportError(tr("Nothing to export."), false);
+		return false;
+	}
+
+	QString SaveFileName = GetExportFileName(FileName, "glb", tr("Export glTF"), tr("Binary glTF Files (*.glb);;All Files (*.*)"));
+
+	if (SaveFileName.isEmpty())
+		return false;
+
+	// The geometry of each piece is stored once, parts with the same piece and color share a mesh.
+	lcExportMeshes ExportMeshes(ModelParts);
+	lcGLTFBuffer Buffer;
+	lcArray<lcGLTFPiece> Pieces;
+	lcArray<int> SectionAccessors;
+	QHash<PieceInfo*, int> PieceIndices;
+	QHash<lcuint64, int> MeshIndices;
+	QHash<int, int> MaterialIndices;
+	lcArray<int> MaterialColors;
+	lcArray<int> PartMeshes;
+	lcMemFile Meshes;
+	char Line[256];
+
+	Meshes.mGrowBytes = 64 * 1024;
+	PartMeshes.SetSize(ModelParts.GetSize());
+
+	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
+	{
+		const lcModelPartsEntry& ModelPart = ModelParts[PartIdx];
+		PieceInfo* Info = ModelPart.Info;
+		int PieceIdx = PieceIndices.value(Info, -1);
+
+		PartMeshes[PartIdx] = -1;
+
+		if (PieceIdx == -1)
+		{
+			lcMesh* Mesh = ExportMeshes.GetMesh(Info);
+			lcGLTFPiece Piece;
+
+			Piece.Mesh = NULL;
+			Piece.PositionAccessor = -1;
+			Piece.TexturedPositionAccessor = -1;
+			Piece.FirstSection = SectionAccessors.GetSize();
+			Piece.HasDefaultColor = false;
+
+			if (Mesh)
+			{
+				int IndexSize = (Mesh->mIndexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+				int ComponentType = (Mesh->mIndexType == GL_UNSIGNED_SHORT) ? 5123 : 5125;
+				bool HasTriangles = false;
+
+				for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
 				{
-					while (curcol != ColorsUsed[ColorIdx] + 1)
+					lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+					int Accessor = -1;
+
+					if (Section->PrimitiveType == GL_TRIANGLES && Section->NumIndices)
 					{
-						Stream << QLatin1String("<td><center>-</center></td>\r\n");
-						curcol++;
+						Accessor = Buffer.AddAccessor((char*)Mesh->mIndexBuffer.mData + Section->IndexOffset, Section->NumIndices * IndexSize, 34963, ComponentType, Section->NumIndices, "SCALAR");
+						HasTriangles = true;
+
+						if (Section->ColorIndex == gDefaultColor)
+							Piece.HasDefaultColor = true;
 					}
 
-					Stream << QString("<td><center>%1</center></td>\r\n").arg(QString::number(PiecesUsed[ColorIdx]));
-					curcol++;
+					SectionAccessors.Add(Accessor);
+				}
+
+				if (HasTriangles)
+				{
+					lcArray<lcVector3> Positions;
+
+					Piece.Mesh = Mesh;
+
+					Positions.SetSize(Mesh->mNumVertices);
+					for (int VertexIdx = 0; VertexIdx < Mesh->mNumVertices; VertexIdx++)
+						Positions[VertexIdx] = Mesh->GetVertexPosition(VertexIdx);
+
+					if (Mesh->mNumVertices)
+						Piece.PositionAccessor = Buffer.AddPositions(Positions);
+
+					Positions.SetSize(Mesh->mNumTexturedVertices);
+					for (int VertexIdx = 0; VertexIdx < Mesh->mNumTexturedVertices; VertexIdx++)
+						Positions[VertexIdx] = Mesh->GetTexturedVertexPosition(VertexIdx);
+
+					if (Mesh->mNumTexturedVertices)
+						Piece.TexturedPositionAccessor = Buffer.AddPositions(Positions);
 				}
 			}
 
-			while (curcol != NumColors)
+			PieceIdx = Pieces.GetSize();
+			PieceIndices.insert(Info, PieceIdx);
+			Pieces.Add(Piece);
+		}
+
+		const lcGLTFPiece& Piece = Pieces[PieceIdx];
+
+		if (!Piece.Mesh)
+			continue;
+
+		int DefaultColorIndex = Piece.HasDefaultColor ? ModelPart.ColorIndex : -1;
+		lcuint64 MeshKey = ((lcuint64)PieceIdx << 32) | (lcuint32)DefaultColorIndex;
+		int MeshIdx = MeshIndices.value(MeshKey, -1);
+
+		if (MeshIdx == -1)
+		{
+			lcMesh* Mesh = Piece.Mesh;
+			bool FirstPrimitive = true;
+
+			MeshIdx = MeshIndices.size();
+			MeshIndices.insert(MeshKey, MeshIdx);
+
+			Meshes.WriteLine(MeshIdx ? ",{\"name\":" : "{\"name\":");
+			lcWriteJsonString(Meshes, Info->m_strName);
+			Meshes.WriteLine(",\"primitives\":[");
+
+			for (int SectionIdx = 0; SectionIdx < Mesh->mNumSections; SectionIdx++)
 			{
-				Stream << QLatin1String("<td><center>-</center></td>\r\n");
-				curcol++;
+				lcMeshSection* Section = &Mesh->mSections[SectionIdx];
+				int IndexAccessor = SectionAccessors[Piece.FirstSection + SectionIdx];
+				int PositionAccessor = Section->Texture ? Piece.TexturedPositionAccessor : Piece.PositionAccessor;
+
+				if (IndexAccessor == -1 || PositionAccessor == -1)
+					continue;
+
+				int ColorIndex = (Section->ColorIndex == gDefaultColor) ? DefaultColorIndex : Section->ColorIndex;
+				int MaterialIdx = MaterialIndices.value(ColorIndex, -1);
+
+				if (MaterialIdx == -1)
+				{
+					MaterialIdx = MaterialColors.GetSize();
+					MaterialIndices.insert(ColorIndex, MaterialIdx);
+					MaterialColors.Add(ColorIndex);
+				}
+
+				sprintf(Line, "%s{\"attributes\":{\"POSITION\":%d},\"indices\":%d,\"material\":%d}", FirstPrimitive ? "" : ",", PositionAccessor, IndexAccessor, MaterialIdx);
+				Meshes.WriteLine(Line);
+				FirstPrimitive = false;
 			}
 
-			Stream << QLatin1String("</tr>\r\n");
+			Meshes.WriteLine("]}");
 		}
+
+		PartMeshes[PartIdx] = MeshIdx;
 	}
-	Stream << QLatin1String("</table>\r\n<br>");
 
-	delete[] PiecesUsed;
-	delete[] ColorsUsed;
+	if (MeshIndices.isEmpty())
+	{
+		lcShowExportError(tr("Nothing to export."), false);
+		return false;
+	}
+
+	// Node 0 turns the model from LeoCAD's Z up LDraw units to the Y up meters used by glTF, the parts are its children.
+	lcMemFile Nodes;
+	int NumNodes = 1;
+	bool InstancesUsed = false;
+
+	Nodes.mGrowBytes = 256 * 1024;
+
+	if (Instancing)
+	{
+		// Parts that share a mesh are placed by one node with the EXT_mesh_gpu_instancing transforms of each part.
+		lcArray<lcArray<int> > MeshParts;
+		MeshParts.SetSize(MeshIndices.size());
+
+		for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
+			if (PartMeshes[PartIdx] != -1 && lcGLTFIsRigid(ModelParts[PartIdx].WorldMatrix))
+				MeshParts[PartMeshes[PartIdx]].Add(PartIdx);
+
+		for (int MeshIdx = 0; MeshIdx < MeshParts.GetSize(); MeshIdx++)
+		{
+			const lcArray<int>& Parts = MeshParts[MeshIdx];
+
+			if (Parts.GetSize() < 2)
+				continue;
+
+			lcArray<lcVector3> Translations;
+			lcArray<lcVector4> Rotations;
+			Translations.SetSize(Parts.GetSize());
+			Rotations.SetSize(Parts.GetSize());
+
+			for (int InstanceIdx = 0; InstanceIdx < Parts.GetSize(); InstanceIdx++)
+			{
+				const lcMatrix44& WorldMatrix = ModelParts[Parts[InstanceIdx]].WorldMatrix;
+
+				Translations[InstanceIdx] = WorldMatrix.GetTranslation();
+				Rotations[InstanceIdx] = lcGLTFRotation(WorldMatrix);
+				PartMeshes[Parts[InstanceIdx]] = -1;
+			}
+
+			int TranslationAccessor = Buffer.AddAccessor(&Translations[0], Parts.GetSize() * sizeof(lcVector3), 0, 5126, Parts.GetSize(), "VEC3");
+			int RotationAccessor = Buffer.AddAccessor(&Rotations[0], Parts.GetSize() * sizeof(lcVector4), 0, 5126, Parts.GetSize(), "VEC4");
+
+			sprintf(Line, ",{\"mesh\":%d,\"extensions\":{\"EXT_mesh_gpu_instancing\":{\"attributes\":{\"TRANSLATION\":%d,\"ROTATION\":%d}}}}", MeshIdx, TranslationAccessor, RotationAccessor);
+			Nodes.WriteLine(Line);
+			NumNodes++;
+			InstancesUsed = true;
+		}
+	}
+
+	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
+	{
+		if (PartMeshes[PartIdx] == -1)
+			continue;
+
+		sprintf(Line, ",{\"mesh\":%d,\"matrix\":", PartMeshes[PartIdx]);
+		Nodes.WriteLine(Line);
+		lcWriteJsonFloats(Nodes, ModelParts[PartIdx].WorldMatrix, 16, 6);
+		Nodes.WriteLine("}");
+		NumNodes++;
+	}
+
+	lcMemFile Json;
+	Json.mGrowBytes = 1024 * 1024;
+
+	Json.WriteLine("{\"asset\":{\"version\":\"2.0\",\"generator\":\"LeoCAD " LC_VERSION_TEXT "\"},");
+
+	if (InstancesUsed)
+		Json.WriteLine("\"extensionsUsed\":[\"EXT_mesh_gpu_instancing\"],\"extensionsRequired\":[\"EXT_mesh_gpu_instancing\"],");
+
+	Json.WriteLine("\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"matrix\":[0.0004,0,0,0,0,0,-0.0004,0,0,0.0004,0,0,0,0,0,1],\"children\":[");
+
+	for (int NodeIdx = 1; NodeIdx < NumNodes; NodeIdx++)
+	{
+		sprintf(Line, NodeIdx > 1 ? ",%d" : "%d", NodeIdx);
+		Json.WriteLine(Line);
+	}
+
+	Json.WriteLine("]}");
+	Json.WriteBuffer(Nodes.mBuffer, (long)Nodes.GetLength());
+	Json.WriteLine("],\"meshes\":[");
+	Json.WriteBuffer(Meshes.mBuffer, (long)Meshes.GetLength());
+	Json.WriteLine("],\"materials\":[");
+
+	// Colors are stored in sRGB and glTF expects linear values.
+	for (int MaterialIdx = 0; MaterialIdx < MaterialColors.GetSize(); MaterialIdx++)
+	{
+		lcColor* Color = &gColorList[MaterialColors[MaterialIdx]];
+		float BaseColor[4];
+
+		for (int Channel = 0; Channel < 3; Channel++)
+		{
+			float Value = Color->Value[Channel];
+			BaseColor[Channel] = (Value <= 0.04045f) ? Value / 12.92f : powf((Value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		BaseColor[3] = Color->Value[3];
+
+		sprintf(Line, "%s{\"name\":\"%s\",\"pbrMetallicRoughness\":{\"baseColorFactor\":", MaterialIdx ? "," : "", Color->SafeName);
+		Json.WriteLine(Line);
+		lcWriteJsonFloats(Json, BaseColor, 4, 4);
+		Json.WriteLine(",\"metallicFactor\":0,\"roughnessFactor\":0.5},\"doubleSided\":true");
+
+		if (BaseColor[3] < 1.0f)
+			Json.WriteLine(",\"alphaMode\":\"BLEND\"");
+
+		Json.WriteLine("}");
+	}
+
+	Json.WriteLine("],\"accessors\":[");
+	Json.WriteBuffer(Buffer.mAccessors.mBuffer, (long)Buffer.mAccessors.GetLength());
+	Json.WriteLine("],\"bufferViews\":[");
+	Json.WriteBuffer(Buffer.mViews.mBuffer, (long)Buffer.mViews.GetLength());
+
+	// Both chunks are padded to 4 bytes, the JSON with spaces and the binary data with zeros.
+	const lcuint8 Padding[4] = { 0, 0, 0, 0 };
+	long BinaryLength = (long)Buffer.mBinary.GetLength();
+
+	if (BinaryLength % 4)
+		Buffer.mBinary.WriteBuffer(Padding, 4 - BinaryLength % 4);
+	BinaryLength = (long)Buffer.mBinary.GetLength();
+
+	sprintf(Line, "],\"buffers\":[{\"byteLength\":%ld}]}", BinaryLength);
+	Json.WriteLine(Line);
+
+	while (Json.GetLength() % 4)
+		Json.WriteBuffer(" ", 1);
+
+	long JsonLength = (long)Json.GetLength();
+
+	lcDiskFile File;
+
+	if (!File.Open(SaveFileName, "wb"))
+	{
+		lcShowExportError(tr("Could not open file '%1' for writing.").arg(SaveFileName), true);
+		return false;
+	}
+
+	File.WriteU32(0x46546C67); // glTF
+	File.WriteU32(2);
+	File.WriteU32(12 + 8 + JsonLength + 8 + BinaryLength);
+
+	File.WriteU32(JsonLength);
+	File.WriteU32(0x4E4F534A); // JSON
+	File.WriteBuffer(Json.mBuffer, JsonLength);
+
+	File.WriteU32(BinaryLength);
+	File.WriteU32(0x004E4942); // BIN
+	File.WriteBuffer(Buffer.mBinary.mBuffer, BinaryLength);
+
+	return true;
 }
 
 void Project::ExportHTML()
@@ -1126,6 +1659,21 @@ void Project::ExportHTML()
 	lcModel* Model = mModels[0];
 	lcStep LastStep = Model->GetLastStep();
 
+	lcArray<lcPartsListEntry> PartsList;
+	lcArray<lcArray<lcPartsListEntry> > StepPartsLists;
+	QHash<PieceInfo*, int> LibraryIndices;
+
+	if (Options.PartsListStep || Options.PartsListEnd || Options.PartsListImages)
+	{
+		Model->GetPartsList(gDefaultColor, PartsList);
+		Model->GetStepPartsLists(gDefaultColor, StepPartsLists);
+
+		lcPiecesLibrary* Library = lcGetPiecesLibrary();
+
+		for (int PieceIdx = 0; PieceIdx < Library->mPieces.GetSize(); PieceIdx++)
+			LibraryIndices.insert(Library->mPieces[PieceIdx], PieceIdx);
+	}
+
 	if (Options.SinglePage)
 	{
 		QString FileName = QFileInfo(Dir, BaseName + HTMLExtension).absoluteFilePath();
@@ -1147,11 +1695,11 @@ void Project::ExportHTML()
 			Stream << QString("<IMG SRC=\"%1-%2%3\" ALT=\"Step %4\" WIDTH=%5 HEIGHT=%6><BR><BR>\r\n").arg(BaseName, StepString, ImageExtension, StepString, QString::number(Options.StepImagesWidth), QString::number(Options.StepImagesHeight));
 
 			if (Options.PartsListStep)
-				CreateHTMLPieceList(Stream, Model, Step, Options.PartsListImages, ImageExtension);
+				CreateHTMLPieceList(Stream, StepPartsLists[Step], LibraryIndices, Options.PartsListImages, ImageExtension);
 		}
 
 		if (Options.PartsListEnd)
-			CreateHTMLPieceList(Stream, Model, 0, Options.PartsListImages, ImageExtension);
+			CreateHTMLPieceList(Stream, PartsList, LibraryIndices, Options.PartsListImages, ImageExtension);
 
 		Stream << QLatin1String("</CENTER>\n<BR><HR><BR><B><I>Created by <A HREF=\"http://www.leocad.org\">LeoCAD</A></B></I><BR></HTML>\r\n");
 	}
@@ -1199,7 +1747,7 @@ void Project::ExportHTML()
 			Stream << QString("<IMG SRC=\"%1-%2%3\" ALT=\"Step %4\" WIDTH=%5 HEIGHT=%6><BR><BR>\r\n").arg(BaseName, StepString, ImageExtension, StepString, QString::number(Options.StepImagesWidth), QString::number(Options.StepImagesHeight));
 
 			if (Options.PartsListStep)
-				CreateHTMLPieceList(Stream, Model, Step, Options.PartsListImages, ImageExtension);
+				CreateHTMLPieceList(Stream, StepPartsLists[Step], LibraryIndices, Options.PartsListImages, ImageExtension);
 
 			Stream << QLatin1String("</CENTER>\r\n<BR><HR><BR>");
 			if (Step != 1)
@@ -1231,7 +1779,7 @@ void Project::ExportHTML()
 
 			Stream << QString("<HTML>\r\n<HEAD>\r\n<TITLE>Pieces used by %1</TITLE>\r\n</HEAD>\r\n<BR>\r\n<CENTER>\n").arg(Title);
 
-			CreateHTMLPieceList(Stream, Model, 0, Options.PartsListImages, ImageExtension);
+			CreateHTMLPieceList(Stream, PartsList, LibraryIndices, Options.PartsListImages, ImageExtension);
 
 			Stream << QLatin1String("</CENTER>\n<BR><HR><BR>");
 			Stream << QString("<A HREF=\"%1-%2.html\">Previous</A> ").arg(BaseName, QString("%1").arg(LastStep, 2, 10, QLatin1Char('0')));
@@ -1248,57 +1796,160 @@ void Project::ExportHTML()
 
 	if (Options.PartsListImages)
 	{
-		gMainWindow->mPreviewWidget->MakeCurrent();
-		lcContext* Context = gMainWindow->mPreviewWidget->mContext;
-		int Width = Options.PartImagesWidth;
-		int Height = Options.PartImagesHeight;
+		lcArray<PieceInfo*> Pieces;
+		QSet<PieceInfo*> PiecesAdded;
 
-		if (!Context->BeginRenderToTexture(Width, Height))
+		for (int PieceIdx = 0; PieceIdx < PartsList.GetSize(); PieceIdx++)
 		{
-			QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Error creating images."));
-			return;
+			PieceInfo* Info = PartsList[PieceIdx].Info;
+
+			if (!PiecesAdded.contains(Info))
+			{
+				PiecesAdded.insert(Info);
+				Pieces.Add(Info);
+			}
 		}
 
-		float aspect = (float)Width/(float)Height;
-		Context->SetViewport(0, 0, Width, Height);
+		CreateHTMLPartImages(Dir, Pieces, Options.PartImagesWidth, Options.PartImagesHeight, Options.PartImagesColor, ImageExtension);
+	}
+}
 
-		lcArray<lcPartsListEntry> PartsList;
-		Model->GetPartsList(gDefaultColor, PartsList);
+// Copies the images found in the thumbnail cache and draws the others several at a time side by side in one texture,
+// each batch is read back at once and split into images that are saved to the folder and the cache on worker threads.
+void Project::CreateHTMLPartImages(const QDir& Dir, const lcArray<PieceInfo*>& Pieces, int Width, int Height, int ColorIndex, const QString& ImageExtension)
+{
+	lcPiecesLibrary* Library = lcGetPiecesLibrary();
+	lcImageWriter ImageWriter;
+	lcImageWriter CacheWriter;
+	QString ErrorMessage;
+	bool CacheCreated = false;
+	lcArray<PieceInfo*> MissingPieces;
+	QStringList MissingCacheFileNames;
+
+	for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
+	{
+		PieceInfo* Info = Pieces[PieceIdx];
+		QString FileName = QFileInfo(Dir, Info->m_strName + ImageExtension).absoluteFilePath();
+		QString CacheFileName = Library->GetThumbnailCacheFileName(Info, ColorIndex, Width, Height);
 
-		lcMatrix44 ProjectionMatrix = lcMatrix44Perspective(30.0f, aspect, 1.0f, 2500.0f);
-		lcMatrix44 ViewMatrix;
+		if (!CacheFileName.isEmpty() && QFileInfo(CacheFileName).isFile())
+		{
+			if (ImageExtension == QLatin1String(".png"))
+			{
+				QFile::remove(FileName);
 
-		Context->SetDefaultState();
-		Context->SetProjectionMatrix(ProjectionMatrix);
+				if (QFile::copy(CacheFileName, FileName))
+					continue;
+			}
+			else
+			{
+				QImage Image;
 
-		for (int PieceIdx = 0; PieceIdx < PartsList.GetSize(); PieceIdx++)
+				if (Image.load(CacheFileName))
+				{
+					ImageWriter.Write(FileName, Image);
+					continue;
+				}
+			}
+		}
+
+		if (!CacheFileName.isEmpty() && !CacheCreated)
 		{
-			PieceInfo* Info = PartsList[PieceIdx].Info;
+			QDir().mkpath(QFileInfo(CacheFileName).absolutePath());
+			CacheCreated = true;
+		}
 
-			glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		MissingPieces.Add(Info);
+		MissingCacheFileNames.append(CacheFileName);
+	}
+
+	if (MissingPieces.IsEmpty())
+	{
+		if (!ImageWriter.Finish(&ErrorMessage))
+			QMessageBox::information(gMainWindow, tr("Error"), ErrorMessage);
+		return;
+	}
+
+	const int MaxBatchSize = 2048;
+	int Columns = lcMax(MaxBatchSize / Width, 1);
+	int Rows = lcMin(lcMax(MaxBatchSize / Height, 1), (MissingPieces.GetSize() + Columns - 1) / Columns);
+	int BatchWidth = Columns * Width;
+	int BatchHeight = Rows * Height;
+
+	gMainWindow->mPreviewWidget->MakeCurrent();
+	lcContext* Context = gMainWindow->mPreviewWidget->mContext;
+
+	if (!Context->BeginRenderToTexture(BatchWidth, BatchHeight))
+	{
+		ImageWriter.Finish(NULL);
+		QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Error creating images."));
+		return;
+	}
+
+	float Aspect = (float)Width / (float)Height;
+	lcMatrix44 ProjectionMatrix = lcMatrix44Perspective(30.0f, Aspect, 1.0f, 2500.0f);
+	lcMatrix44 ViewMatrix;
+
+	Context->SetDefaultState();
+	Context->SetProjectionMatrix(ProjectionMatrix);
+
+	for (int FirstPieceIdx = 0; FirstPieceIdx < MissingPieces.GetSize(); FirstPieceIdx += Columns * Rows)
+	{
+		int NumPieces = lcMin(Columns * Rows, MissingPieces.GetSize() - FirstPieceIdx);
+
+		Context->SetViewport(0, 0, BatchWidth, BatchHeight);
+		glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		for (int CellIdx = 0; CellIdx < NumPieces; CellIdx++)
+		{
+			PieceInfo* Info = MissingPieces[FirstPieceIdx + CellIdx];
+
+			Context->SetViewport((CellIdx % Columns) * Width, (CellIdx / Columns) * Height, Width, Height);
 
 			lcVector3 CameraPosition(-100.0f, -100.0f, 75.0f);
 			Info->ZoomExtents(ProjectionMatrix, ViewMatrix, CameraPosition);
 
 			lcScene Scene;
-			Scene.Begin(ViewMatrix);
+			Scene.Begin(ViewMatrix, ProjectionMatrix);
 
-			Info->AddRenderMeshes(Scene, lcMatrix44Identity(), Options.PartImagesColor, false, false);
+			Info->AddRenderMeshes(Scene, lcMatrix44Identity(), ColorIndex, false, false);
 
 			Scene.End();
 
-			Context->DrawOpaqueMeshes(ViewMatrix, Scene.mOpaqueMeshes);
-			Context->DrawTranslucentMeshes(ViewMatrix, Scene.mTranslucentMeshes);
+			Context->DrawOpaqueMeshes(Scene);
+			Context->DrawTranslucentMeshes(Scene);
 
 			Context->UnbindMesh(); // context remove
+		}
+
+		QImage BatchImage(BatchWidth, BatchHeight, QImage::Format_ARGB32);
+		glReadPixels(0, 0, BatchWidth, BatchHeight, GL_BGRA, GL_UNSIGNED_BYTE, BatchImage.bits());
+		BatchImage = BatchImage.mirrored();
 
+		for (int CellIdx = 0; CellIdx < NumPieces; CellIdx++)
+		{
+			PieceInfo* Info = MissingPieces[FirstPieceIdx + CellIdx];
 			QString FileName = QFileInfo(Dir, Info->m_strName + ImageExtension).absoluteFilePath();
-			if (!Context->SaveRenderToTextureImage(FileName, Width, Height))
-				break;
+			const QString& CacheFileName = MissingCacheFileNames[FirstPieceIdx + CellIdx];
+			int Row = CellIdx / Columns;
+
+			QImage Image = BatchImage.copy((CellIdx % Columns) * Width, BatchHeight - (Row + 1) * Height, Width, Height);
+
+			ImageWriter.Write(FileName, Image);
+
+			if (!CacheFileName.isEmpty())
+				CacheWriter.Write(CacheFileName, Image);
 		}
-		Context->EndRenderToTexture();
 	}
+
+	Context->EndRenderToTexture();
+
+	// The cache is only an optimization so failing to write it isn't reported.
+	CacheWriter.Finish(NULL);
+
+	if (!ImageWriter.Finish(&ErrorMessage))
+		QMessageBox::information(gMainWindow, tr("Error"), ErrorMessage);
 }
 
 void Project::ExportPOVRay()
@@ -1326,54 +1977,158 @@ void Project::ExportPOVRay()
 	lcSetProfileString(LC_PROFILE_POVRAY_LGEO_PATH, Options.LGEOPath);
 	lcSetProfileInt(LC_PROFILE_POVRAY_RENDER, Options.Render);
 
+	if (!ExportPOVRay(Options.FileName, Options.LGEOPath, gMainWindow->GetActiveView()->mCamera))
+		return;
+
+	if (Options.Render)
+	{
+		QStringList Arguments;
+
+		Arguments.append(QString::fromLatin1("+I%1").arg(Options.FileName));
+
+		if (!Options.LGEOPath.isEmpty())
+		{
+			Arguments.append(QString::fromLatin1("+L%1lg/").arg(Options.LGEOPath));
+			Arguments.append(QString::fromLatin1("+L%1ar/").arg(Options.LGEOPath));
+		}
+
+		QString AbsolutePath = QFileInfo(Options.FileName).absolutePath();
+		if (!AbsolutePath.isEmpty())
+			Arguments.append(QString::fromLatin1("+o%1").arg(AbsolutePath));
+
+		QProcess::execute(Options.POVRayPath, Arguments);
+	}
+}
+
+enum
+{
+	LGEO_PIECE_LGEO  = 0x01,
+	LGEO_PIECE_AR    = 0x02,
+	LGEO_PIECE_SLOPE = 0x04
+};
+
+// A piece used by the model, Name is the object placed in the scene and MeshName is set when its mesh is declared in the file.
+struct lcPOVRayPiece
+{
+	PieceInfo* Info;
+	lcMesh* Mesh;
+	char Name[LC_PIECE_NAME_LEN];
+	char MeshName[LC_PIECE_NAME_LEN];
+	int Flags;
+};
+
+// Writes the mesh declarations of a range of pieces to memory so they can be formatted in parallel.
+class lcPOVRayExportTask : public QRunnable
+{
+public:
+	lcPOVRayExportTask(const lcArray<lcPOVRayPiece>& Pieces, const char* ColorTable, int FirstPiece, int LastPiece)
+		: mPieces(Pieces), mColorTable(ColorTable), mFirstPiece(FirstPiece), mLastPiece(LastPiece)
+	{
+		setAutoDelete(false);
+	}
+
+	virtual void run()
+	{
+		mFile.mGrowBytes = 1024 * 1024;
+
+		for (int PieceIdx = mFirstPiece; PieceIdx < mLastPiece; PieceIdx++)
+		{
+			const lcPOVRayPiece& Piece = mPieces[PieceIdx];
+
+			if (!Piece.MeshName[0])
+				continue;
+
+			char Line[1024];
+
+			Piece.Mesh->ExportPOVRay(mFile, Piece.MeshName, mColorTable);
+
+			mFile.WriteLine("}\n\n");
+
+			sprintf(Line, "#declare lc_%s_clear = lc_%s\n\n", Piece.MeshName, Piece.MeshName);
+			mFile.WriteLine(Line);
+		}
+	}
+
+	lcMemFile mFile;
+
+protected:
+	const lcArray<lcPOVRayPiece>& mPieces;
+	const char* mColorTable;
+	int mFirstPiece;
+	int mLastPiece;
+};
+
+bool Project::ExportPOVRay(const QString& FileName, const QString& LGEOPath, lcCamera* Camera)
+{
+	lcArray<lcModelPartsEntry> ModelParts;
+
+	GetModelParts(ModelParts);
+
+	if (ModelParts.IsEmpty())
+	{
+		lcShowExportError(tr("Nothing to export."), false);
+		return false;
+	}
+
 	lcDiskFile POVFile;
 
-	if (!POVFile.Open(Options.FileName, "wt"))
+	if (!POVFile.Open(FileName, "wt"))
 	{
-		QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Could not open file '%1' for writing.").arg(Options.FileName));
-		return;
+		lcShowExportError(tr("Could not open file '%1' for writing.").arg(FileName), true);
+		return false;
 	}
 
 	char Line[1024];
 
-	lcPiecesLibrary* Library = lcGetPiecesLibrary();
-	char* PieceTable = new char[Library->mPieces.GetSize() * LC_PIECE_NAME_LEN];
-	int* PieceFlags = new int[Library->mPieces.GetSize()];
-	int NumColors = gColorList.GetSize();
-	char* ColorTable = new char[NumColors * LC_MAX_COLOR_NAME];
+	// Only the pieces used by the model are looked up in the LGEO tables and declared, in the order they're first used.
+	lcExportMeshes ExportMeshes(ModelParts);
+	lcArray<lcPOVRayPiece> Pieces;
+	QHash<PieceInfo*, int> PieceIndices;
+	lcArray<int> PartPieces;
 
-	memset(PieceTable, 0, Library->mPieces.GetSize() * LC_PIECE_NAME_LEN);
-	memset(PieceFlags, 0, Library->mPieces.GetSize() * sizeof(int));
-	memset(ColorTable, 0, NumColors * LC_MAX_COLOR_NAME);
+	PartPieces.SetSize(ModelParts.GetSize());
 
-	enum
+	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
 	{
-		LGEO_PIECE_LGEO  = 0x01,
-		LGEO_PIECE_AR    = 0x02,
-		LGEO_PIECE_SLOPE = 0x04
-	};
+		PieceInfo* Info = ModelParts[PartIdx].Info;
+		int PieceIdx = PieceIndices.value(Info, -1);
 
-	enum
-	{
-		LGEO_COLOR_SOLID       = 0x01,
-		LGEO_COLOR_TRANSPARENT = 0x02,
-		LGEO_COLOR_CHROME      = 0x04,
-		LGEO_COLOR_PEARL       = 0x08,
-		LGEO_COLOR_METALLIC    = 0x10,
-		LGEO_COLOR_RUBBER      = 0x20,
-		LGEO_COLOR_GLITTER     = 0x40
-	};
+		if (PieceIdx == -1)
+		{
+			lcPOVRayPiece Piece;
+
+			Piece.Info = Info;
+			Piece.Mesh = ExportMeshes.GetMesh(Info);
+			Piece.Name[0] = 0;
+			Piece.MeshName[0] = 0;
+			Piece.Flags = 0;
 
-	if (!Options.LGEOPath.isEmpty())
+			PieceIdx = Pieces.GetSize();
+			PieceIndices.insert(Info, PieceIdx);
+			Pieces.Add(Piece);
+		}
+
+		PartPieces[PartIdx] = PieceIdx;
+	}
+
+	int NumColors = gColorList.GetSize();
+	char* ColorTable = new char[NumColors * LC_MAX_COLOR_NAME];
+
+	memset(ColorTable, 0, NumColors * LC_MAX_COLOR_NAME);
+
+	if (!LGEOPath.isEmpty())
 	{
 		lcDiskFile TableFile, ColorFile;
+		QHash<QByteArray, int> PieceNames;
+
+		for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
+			PieceNames.insert(QByteArray(Pieces[PieceIdx].Info->m_strName), PieceIdx);
 
-		if (!TableFile.Open(QFileInfo(QDir(Options.LGEOPath), QLatin1String("lg_elements.lst")).absoluteFilePath(), "rt"))
+		if (!TableFile.Open(QFileInfo(QDir(LGEOPath), QLatin1String("lg_elements.lst")).absoluteFilePath(), "rt"))
 		{
-			delete[] PieceTable;
-			delete[] PieceFlags;
-			QMessageBox::information(gMainWindow, tr("LeoCAD"), tr("Could not find LGEO files in folder '%1'.").arg(Options.LGEOPath));
-			return;
+			delete[] ColorTable;
+			lcShowExportError(tr("Could not find LGEO files in folder '%1'.").arg(LGEOPath), false);
+			return false;
 		}
 
 		while (TableFile.ReadLine(Line, sizeof(Line)))
@@ -1388,34 +2143,33 @@ void Project::ExportPOVRay()
 
 			strupr(Src);
 
-			PieceInfo* Info = Library->FindPiece(Src, NULL, false);
-			if (!Info)
+			int PieceIdx = PieceNames.value(QByteArray(Src), -1);
+			if (PieceIdx == -1)
 				continue;
 
-			int Index = Library->mPieces.FindIndex(Info);
+			lcPOVRayPiece& Piece = Pieces[PieceIdx];
 
 			if (strchr(Flags, 'L'))
 			{
-				PieceFlags[Index] |= LGEO_PIECE_LGEO;
-				sprintf(PieceTable + Index * LC_PIECE_NAME_LEN, "lg_%s", Dst);
+				Piece.Flags |= LGEO_PIECE_LGEO;
+				sprintf(Piece.Name, "lg_%s", Dst);
 			}
 
 			if (strchr(Flags, 'A'))
 			{
-				PieceFlags[Index] |= LGEO_PIECE_AR;
-				sprintf(PieceTable + Index * LC_PIECE_NAME_LEN, "ar_%s", Dst);
+				Piece.Flags |= LGEO_PIECE_AR;
+				sprintf(Piece.Name, "ar_%s", Dst);
 			}
 
 			if (strchr(Flags, 'S'))
-				PieceFlags[Index] |= LGEO_PIECE_SLOPE;
+				Piece.Flags |= LGEO_PIECE_SLOPE;
 		}
 
-		if (!ColorFile.Open(QFileInfo(QDir(Options.LGEOPath), QLatin1String("lg_colors.lst")).absoluteFilePath(), "rt"))
+		if (!ColorFile.Open(QFileInfo(QDir(LGEOPath), QLatin1String("lg_colors.lst")).absoluteFilePath(), "rt"))
 		{
-			delete[] PieceTable;
-			delete[] PieceFlags;
-			QMessageBox::information(gMainWindow, tr("LeoCAD"), tr("Could not find LGEO files in folder '%1'.").arg(Options.LGEOPath));
-			return;
+			delete[] ColorTable;
+			lcShowExportError(tr("Could not find LGEO files in folder '%1'.").arg(LGEOPath), false);
+			return false;
 		}
 
 		while (ColorFile.ReadLine(Line, sizeof(Line)))
@@ -1439,31 +2193,16 @@ void Project::ExportPOVRay()
 
 	const char* OldLocale = setlocale(LC_NUMERIC, "C");
 
-	if (!Options.LGEOPath.isEmpty())
+	if (!LGEOPath.isEmpty())
 	{
 		POVFile.WriteLine("#include \"lg_defs.inc\"\n#include \"lg_color.inc\"\n\n");
 
-		for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
+		for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
 		{
-			PieceInfo* Info = ModelParts[PartIdx].Info;
-
-			for (int CheckIdx = 0; CheckIdx < ModelParts.GetSize(); CheckIdx++)
+			if (Pieces[PieceIdx].Name[0])
 			{
-				if (ModelParts[CheckIdx].Info != Info)
-					continue;
-
-				if (CheckIdx != PartIdx)
-					break;
-
-				int Index = Library->mPieces.FindIndex(Info);
-
-				if (PieceTable[Index * LC_PIECE_NAME_LEN])
-				{
-					sprintf(Line, "#include \"%s.inc\"\n", PieceTable + Index * LC_PIECE_NAME_LEN);
-					POVFile.WriteLine(Line);
-				}
-
-				break;
+				sprintf(Line, "#include \"%s.inc\"\n", Pieces[PieceIdx].Name);
+				POVFile.WriteLine(Line);
 			}
 		}
 
@@ -1495,33 +2234,44 @@ void Project::ExportPOVRay()
 
 	POVFile.WriteLine("\n");
 
-	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
+	for (int PieceIdx = 0; PieceIdx < Pieces.GetSize(); PieceIdx++)
 	{
-		PieceInfo* Info = ModelParts[PartIdx].Info;
-		lcMesh* Mesh = Info->GetMesh();
-		int Index = Library->mPieces.FindIndex(Info);
+		lcPOVRayPiece& Piece = Pieces[PieceIdx];
+		char* Ptr;
 
-		if (!Mesh || PieceTable[Index * LC_PIECE_NAME_LEN])
+		if (!Piece.Mesh || Piece.Name[0])
 			continue;
 
-		char Name[LC_PIECE_NAME_LEN];
-		char* Ptr;
-
-		strcpy(Name, Info->m_strName);
-		while ((Ptr = strchr(Name, '-')))
+		strcpy(Piece.MeshName, Piece.Info->m_strName);
+		while ((Ptr = strchr(Piece.MeshName, '-')))
 			*Ptr = '_';
 
-		sprintf(PieceTable + Index * LC_PIECE_NAME_LEN, "lc_%s", Name);
+		sprintf(Piece.Name, "lc_%s", Piece.MeshName);
+	}
 
-		Mesh->ExportPOVRay(POVFile, Name, ColorTable);
+	// The triangles of the meshes make up most of the file so they're formatted by several threads, each into its own
+	// buffer, and the buffers are written in order.
+	QThreadPool ThreadPool;
+	int NumTasks = lcMin(Pieces.GetSize(), qMax(QThread::idealThreadCount(), 1) * 4);
+	lcArray<lcPOVRayExportTask*> Tasks;
 
-		POVFile.WriteLine("}\n\n");
+	for (int TaskIdx = 0; TaskIdx < NumTasks; TaskIdx++)
+	{
+		int FirstPiece = (int)((lcint64)Pieces.GetSize() * TaskIdx / NumTasks);
+		int LastPiece = (int)((lcint64)Pieces.GetSize() * (TaskIdx + 1) / NumTasks);
+		lcPOVRayExportTask* Task = new lcPOVRayExportTask(Pieces, ColorTable, FirstPiece, LastPiece);
 
-		sprintf(Line, "#declare lc_%s_clear = lc_%s\n\n", Name, Name);
-		POVFile.WriteLine(Line);
+		Tasks.Add(Task);
+		ThreadPool.start(Task);
 	}
 
-	lcCamera* Camera = gMainWindow->GetActiveView()->mCamera;
+	ThreadPool.waitForDone();
+
+	for (int TaskIdx = 0; TaskIdx < Tasks.GetSize(); TaskIdx++)
+		POVFile.WriteBuffer(Tasks[TaskIdx]->mFile.mBuffer, (long)Tasks[TaskIdx]->mFile.GetLength());
+
+	Tasks.DeleteAll();
+
 	const lcVector3& Position = Camera->mPosition;
 	const lcVector3& Target = Camera->mTargetPosition;
 	const lcVector3& Up = Camera->mUpVector;
@@ -1536,7 +2286,7 @@ void Project::ExportPOVRay()
 
 	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
 	{
-		int Index = Library->mPieces.FindIndex(ModelParts[PartIdx].Info);
+		const lcPOVRayPiece& Piece = Pieces[PartPieces[PartIdx]];
 		int Color;
 
 		Color = ModelParts[PartIdx].ColorIndex;
@@ -1544,49 +2294,107 @@ void Project::ExportPOVRay()
 
 		const float* f = ModelParts[PartIdx].WorldMatrix;
 
-		if (PieceFlags[Index] & LGEO_PIECE_SLOPE)
+		if (Piece.Flags & LGEO_PIECE_SLOPE)
 		{
 			sprintf(Line, "merge {\n object {\n  %s%s\n  texture { %s }\n }\n"
 					" object {\n  %s_slope\n  texture { %s normal { bumps 0.3 scale 0.02 } }\n }\n"
 					" matrix <%.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f>\n}\n",
-					PieceTable + Index * LC_PIECE_NAME_LEN, Suffix, &ColorTable[Color * LC_MAX_COLOR_NAME], PieceTable + Index * LC_PIECE_NAME_LEN, &ColorTable[Color * LC_MAX_COLOR_NAME],
+					Piece.Name, Suffix, &ColorTable[Color * LC_MAX_COLOR_NAME], Piece.Name, &ColorTable[Color * LC_MAX_COLOR_NAME],
 					-f[5], -f[4], -f[6], -f[1], -f[0], -f[2], f[9], f[8], f[10], f[13] / 25.0f, f[12] / 25.0f, f[14] / 25.0f);
 		}
 		else
 		{
 			sprintf(Line, "object {\n %s%s\n texture { %s }\n matrix <%.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f, %.4f>\n}\n",
-					PieceTable + Index * LC_PIECE_NAME_LEN, Suffix, &ColorTable[Color * LC_MAX_COLOR_NAME], -f[5], -f[4], -f[6], -f[1], -f[0], -f[2], f[9], f[8], f[10], f[13] / 25.0f, f[12] / 25.0f, f[14] / 25.0f);
+					Piece.Name, Suffix, &ColorTable[Color * LC_MAX_COLOR_NAME], -f[5], -f[4], -f[6], -f[1], -f[0], -f[2], f[9], f[8], f[10], f[13] / 25.0f, f[12] / 25.0f, f[14] / 25.0f);
 		}
 
 		POVFile.WriteLine(Line);
 	}
 
-	delete[] PieceTable;
-	delete[] PieceFlags;
+	delete[] ColorTable;
 	setlocale(LC_NUMERIC, OldLocale);
 	POVFile.Close();
 
-	if (Options.Render)
+	return true;
+}
+
+// Writes the vertices and faces of a range of parts to memory, each task has its own files so they can run in parallel.
+class lcWavefrontExportTask : public QRunnable
+{
+public:
+	lcWavefrontExportTask(const lcArray<lcModelPartsEntry>& ModelParts, const lcExportMeshes& ExportMeshes, const lcArray<lcuint32>& VertexOffsets, int FirstPart, int LastPart)
+		: mModelParts(ModelParts), mExportMeshes(ExportMeshes), mVertexOffsets(VertexOffsets), mFirstPart(FirstPart), mLastPart(LastPart)
 	{
-		QStringList Arguments;
+		setAutoDelete(false);
+	}
 
-		Arguments.append(QString::fromLatin1("+I%1").arg(Options.FileName));
+	virtual void run()
+	{
+		size_t NumVertices = mVertexOffsets[mLastPart] - mVertexOffsets[mFirstPart];
 
-		if (!Options.LGEOPath.isEmpty())
+		mVertexFile.mGrowBytes = 1024 * 1024;
+		mVertexFile.GrowFile(NumVertices * 32 + (mLastPart - mFirstPart) * 3);
+		mFaceFile.mGrowBytes = 1024 * 1024;
+		mFaceFile.GrowFile(NumVertices * 40);
+
+		for (int PartIdx = mFirstPart; PartIdx < mLastPart; PartIdx++)
 		{
-			Arguments.append(QString::fromLatin1("+L%1lg/").arg(Options.LGEOPath));
-			Arguments.append(QString::fromLatin1("+L%1ar/").arg(Options.LGEOPath));
+			lcMesh* Mesh = mExportMeshes.GetMesh(mModelParts[PartIdx].Info);
+
+			if (!Mesh)
+				continue;
+
+			const lcMatrix44& ModelWorld = mModelParts[PartIdx].WorldMatrix;
+
+			for (int VertexIdx = 0; VertexIdx < Mesh->mNumVertices; VertexIdx++)
+			{
+				lcVector3 Vertex = lcMul31(Mesh->GetVertexPosition(VertexIdx), ModelWorld);
+				char Line[256];
+				char* Dest = Line;
+
+				*Dest++ = 'v';
+
+				for (int Axis = 0; Axis < 3; Axis++)
+				{
+					*Dest++ = ' ';
+					Dest += lcFormatFloat(Dest, Vertex[Axis], 2);
+				}
+
+				*Dest++ = '\n';
+				mVertexFile.WriteBuffer(Line, (long)(Dest - Line));
+			}
+
+			mVertexFile.WriteBuffer("#\n\n", 3);
 		}
 
-		QString AbsolutePath = QFileInfo(Options.FileName).absolutePath();
-		if (!AbsolutePath.isEmpty())
-			Arguments.append(QString::fromLatin1("+o%1").arg(AbsolutePath));
+		for (int PartIdx = mFirstPart; PartIdx < mLastPart; PartIdx++)
+		{
+			char Line[64];
+			int Length = sprintf(Line, "g Piece");
 
-		QProcess::execute(Options.POVRayPath, Arguments);
+			Length += lcFormatInteger(Line + Length, PartIdx, 3);
+			Line[Length++] = '\n';
+			mFaceFile.WriteBuffer(Line, Length);
+
+			lcMesh* Mesh = mExportMeshes.GetMesh(mModelParts[PartIdx].Info);
+
+			if (Mesh)
+				Mesh->ExportWavefrontIndices(mFaceFile, mModelParts[PartIdx].ColorIndex, mVertexOffsets[PartIdx]);
+		}
 	}
-}
 
-void Project::ExportWavefront(const QString& FileName)
+	lcMemFile mVertexFile;
+	lcMemFile mFaceFile;
+
+protected:
+	const lcArray<lcModelPartsEntry>& mModelParts;
+	const lcExportMeshes& mExportMeshes;
+	const lcArray<lcuint32>& mVertexOffsets;
+	int mFirstPart;
+	int mLastPart;
+};
+
+bool Project::ExportWavefront(const QString& FileName)
 {
 	lcArray<lcModelPartsEntry> ModelParts;
 
@@ -1594,28 +2402,25 @@ void Project::ExportWavefront(const QString& FileName)
 
 	if (ModelParts.IsEmpty())
 	{
-		QMessageBox::information(gMainWindow, tr("LeoCAD"), tr("Nothing to export."));
-		return;
+		lcShowExportError(tr("Nothing to export."), false);
+		return false;
 	}
 
 	QString SaveFileName = GetExportFileName(FileName, "obj", tr("Export Wavefront"), tr("Wavefront Files (*.obj);;All Files (*.*)"));
 
 	if (SaveFileName.isEmpty())
-		return;
+		return false;
 
 	lcDiskFile OBJFile;
 	char Line[1024];
 
 	if (!OBJFile.Open(SaveFileName, "wt"))
 	{
-		QMessageBox::warning(gMainWindow, tr("LeoCAD"), tr("Could not open file '%1' for writing.").arg(SaveFileName));
-		return;
+		lcShowExportError(tr("Could not open file '%1' for writing.").arg(SaveFileName), true);
+		return false;
 	}
 
 	char buf[LC_MAXPATH], *ptr;
-	lcuint32 vert = 1;
-
-	const char* OldLocale = setlocale(LC_NUMERIC, "C");
 
 	OBJFile.WriteLine("# Model exported from LeoCAD\n");
 
@@ -1641,51 +2446,67 @@ void Project::ExportWavefront(const QString& FileName)
 	OBJFile.WriteLine(Line);
 
 	FILE* mat = fopen(buf, "wt");
+
+	if (!mat)
+	{
+		lcShowExportError(tr("Could not open file '%1' for writing.").arg(QString::fromLatin1(buf)), true);
+		return false;
+	}
+
 	fputs("# Colors used by LeoCAD\n# You need to add transparency values\n#\n\n", mat);
 	for (int ColorIdx = 0; ColorIdx < gColorList.GetSize(); ColorIdx++)
 	{
 		lcColor* Color = &gColorList[ColorIdx];
-		fprintf(mat, "newmtl %s\nKd %.2f %.2f %.2f\n\n", Color->SafeName, Color->Value[0], Color->Value[1], Color->Value[2]);
+		char* Dest = Line + sprintf(Line, "newmtl %s\nKd", Color->SafeName);
+
+		for (int Channel = 0; Channel < 3; Channel++)
+		{
+			*Dest++ = ' ';
+			Dest += lcFormatFloat(Dest, Color->Value[Channel], 2);
+		}
+
+		strcpy(Dest, "\n\n");
+		fputs(Line, mat);
 	}
 	fclose(mat);
 
+	// Vertex numbers continue from the previous parts so the offsets are known before the parts are written.
+	lcExportMeshes ExportMeshes(ModelParts);
+	lcArray<lcuint32> VertexOffsets;
+	VertexOffsets.SetSize(ModelParts.GetSize() + 1);
+	VertexOffsets[0] = 1;
+
 	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
 	{
-		lcMesh* Mesh = ModelParts[PartIdx].Info->GetMesh();
-
-		if (!Mesh)
-			continue;
+		lcMesh* Mesh = ExportMeshes.GetMesh(ModelParts[PartIdx].Info);
+		VertexOffsets[PartIdx + 1] = VertexOffsets[PartIdx] + (Mesh ? Mesh->mNumVertices : 0);
+	}
 
-		const lcMatrix44& ModelWorld = ModelParts[PartIdx].WorldMatrix;
-		float* Verts = (float*)Mesh->mVertexBuffer.mData;
+	QThreadPool ThreadPool;
+	int NumTasks = lcMin(ModelParts.GetSize(), qMax(QThread::idealThreadCount(), 1) * 4);
+	lcArray<lcWavefrontExportTask*> Tasks;
 
-		for (int i = 0; i < Mesh->mNumVertices * 3; i += 3)
-		{
-			lcVector3 Vertex = lcMul31(lcVector3(Verts[i], Verts[i+1], Verts[i+2]), ModelWorld);
-			sprintf(Line, "v %.2f %.2f %.2f\n", Vertex[0], Vertex[1], Vertex[2]);
-			OBJFile.WriteLine(Line);
-		}
+	for (int TaskIdx = 0; TaskIdx < NumTasks; TaskIdx++)
+	{
+		int FirstPart = (int)((lcint64)ModelParts.GetSize() * TaskIdx / NumTasks);
+		int LastPart = (int)((lcint64)ModelParts.GetSize() * (TaskIdx + 1) / NumTasks);
+		lcWavefrontExportTask* Task = new lcWavefrontExportTask(ModelParts, ExportMeshes, VertexOffsets, FirstPart, LastPart);
 
-		OBJFile.WriteLine("#\n\n");
+		Tasks.Add(Task);
+		ThreadPool.start(Task);
 	}
 
-	for (int PartIdx = 0; PartIdx < ModelParts.GetSize(); PartIdx++)
-	{
-		PieceInfo* Info = ModelParts[PartIdx].Info;
+	ThreadPool.waitForDone();
 
-		sprintf(Line, "g Piece%.3d\n", PartIdx);
-		OBJFile.WriteLine(Line);
+	for (int TaskIdx = 0; TaskIdx < Tasks.GetSize(); TaskIdx++)
+		OBJFile.WriteBuffer(Tasks[TaskIdx]->mVertexFile.mBuffer, (long)Tasks[TaskIdx]->mVertexFile.GetLength());
 
-		lcMesh* Mesh = Info->GetMesh();
+	for (int TaskIdx = 0; TaskIdx < Tasks.GetSize(); TaskIdx++)
+		OBJFile.WriteBuffer(Tasks[TaskIdx]->mFaceFile.mBuffer, (long)Tasks[TaskIdx]->mFaceFile.GetLength());
 
-		if (Mesh)
-		{
-			Mesh->ExportWavefrontIndices(OBJFile, ModelParts[PartIdx].ColorIndex, vert);
-			vert += Mesh->mNumVertices;
-		}
-	}
+	Tasks.DeleteAll();
 
-	setlocale(LC_NUMERIC, OldLocale);
+	return true;
 }
 
 void Project::SaveImage()
@@ -64,17 +64,20 @@ public:
 	void Merge(Project* Other);
 
 	void SaveImage();
-	void Export3DStudio(const QString& FileName);
+	bool Export3DStudio(const QString& FileName);
 	void ExportBrickLink();
 	void ExportCSV();
+	bool ExportGLTF(const QString& FileName, bool Instancing);
 	void ExportHTML();
 	void ExportPOVRay();
-	void ExportWavefront(const QString& FileName);
+	bool ExportPOVRay(const QString& FileName, const QString& LGEOPath, lcCamera* Camera);
+	bool ExportWavefront(const QString& FileName);
 
 protected:
 	QString GetExportFileName(const QString& FileName, const QString& DefaultExtension, const QString& DialogTitle, const QString& DialogFilter) const;
 	void GetModelParts(lcArray<lcModelPartsEntry>& ModelParts);
-	void CreateHTMLPieceList(QTextStream& Stream, lcModel* Model, lcStep Step, bool Images, const QString& ImageExtension);
+	void CreateHTMLPieceList(QTextStream& Stream, const lcArray<lcPartsListEntry>& PartsList, const QHash<PieceInfo*, int>& LibraryIndices, bool Images, const QString& ImageExtension);
+	void CreateHTMLPartImages(const QDir& Dir, const lcArray<PieceInfo*>& Pieces, int Width, int Height, int ColorIndex, const QString& ImageExtension);
 
 	bool mModified;
 	QString mFileName;
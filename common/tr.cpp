@@ -138,9 +138,8 @@ void TiledRender::Perspective(double fovy, double aspect, double zNear, double z
 	Frustum(xmin, xmax, ymin, ymax, zNear, zFar);
 }
 
-void TiledRender::BeginTile()
+lcMatrix44 TiledRender::BeginTile()
 {
-	GLint matrixMode;
 	int tileWidth, tileHeight, border;
 	double left, right, bottom, top;
 	
@@ -149,9 +148,6 @@ void TiledRender::BeginTile()
 		m_Columns = (m_ImageWidth + m_TileWidthNB - 1) / m_TileWidthNB;
 		m_Rows = (m_ImageHeight + m_TileHeightNB - 1) / m_TileHeightNB;
 		m_CurrentTile = 0;
-		
-		// Save user's viewport, will be restored after last tile rendered
-		glGetIntegerv(GL_VIEWPORT, m_ViewportSave);
 	}
 	
 	// which tile (by row and column) we're about to render
@@ -183,12 +179,7 @@ void TiledRender::BeginTile()
 	m_CurrentTileWidth = tileWidth;
 	m_CurrentTileHeight = tileHeight;
 	
-	glViewport(0, 0, tileWidth, tileHeight);  // tile size including border
-	
-	// save current matrix mode
-	glGetIntegerv(GL_MATRIX_MODE, &matrixMode);
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
+	// the caller sets the viewport to the tile size so lcContext knows about it
 	
 	// compute projection parameters
 	left = m_Left + (m_Right - m_Left)
@@ -198,13 +189,11 @@ void TiledRender::BeginTile()
 		* (m_CurrentRow * m_TileHeightNB - border) / m_ImageHeight;
 	top = bottom + (m_Top - m_Bottom) * tileHeight / m_ImageHeight;
 	
+	// the caller loads the projection matrix of the tile
 	if (m_Perspective)
-		glFrustum(left, right, bottom, top, m_Near, m_Far);
+		return lcMatrix44Frustum(left, right, bottom, top, m_Near, m_Far);
 	else
-		glOrtho(left, right, bottom, top, m_Near, m_Far);
-	
-	// restore user's matrix mode
-	glMatrixMode((GLenum)matrixMode);
+		return lcMatrix44Ortho(left, right, bottom, top, m_Near, m_Far);
 }
 
 int TiledRender::EndTile()
@@ -257,9 +246,6 @@ int TiledRender::EndTile()
 	m_CurrentTile++;
 	if (m_CurrentTile >= m_Rows * m_Columns) 
 	{
-		// restore user's viewport
-		glViewport(m_ViewportSave[0], m_ViewportSave[1],
-			m_ViewportSave[2], m_ViewportSave[3]);
 		m_CurrentTile = -1;  // all done
 		return 0;
 	}
@@ -5,6 +5,8 @@
 #ifndef _TR_H_
 #define _TR_H_
 
+#include "lc_math.h"
+
 typedef enum {
 	TR_TILE_WIDTH = 100,
 	TR_TILE_HEIGHT,
@@ -38,7 +40,7 @@ public:
 	void Perspective(double fovy, double aspect, double zNear, double zFar );
 	int Get(TRenum param);
 	int EndTile();
-	void BeginTile();
+	lcMatrix44 BeginTile();
 
 	// Final image parameters
 	int m_ImageWidth, m_ImageHeight;
@@ -67,8 +69,6 @@ public:
 	int m_CurrentTile;
 	int m_CurrentTileWidth, m_CurrentTileHeight;
 	int m_CurrentRow, m_CurrentColumn;
-
-	GLint m_ViewportSave[4];
 };
 
 #endif // _TR_H_
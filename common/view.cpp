@@ -23,8 +23,11 @@ View::View(lcModel* Model)
 	mDragState = LC_DRAGSTATE_NONE;
 	mTrackButton = LC_TRACKBUTTON_NONE;
 	mTrackTool = LC_TRACKTOOL_NONE;
+	mFullQualityFrameTime = 0.0f;
+	mIncrementalStep = false;
+	mInsertPosition = lcMatrix44Identity();
 
-	View* ActiveView = gMainWindow->GetActiveView();
+	View* ActiveView = gMainWindow ? gMainWindow->GetActiveView() : NULL;
 	if (ActiveView)
 		SetCamera(ActiveView->mCamera, false);
 	else
@@ -156,7 +159,7 @@ lcMatrix44 View::GetProjectionMatrix() const
 	float AspectRatio = (float)mWidth / (float)mHeight;
 
 	if (mCamera->m_pTR)
-		mCamera->m_pTR->BeginTile();
+		return mCamera->m_pTR->BeginTile();
 
 	if (mCamera->IsOrtho())
 	{
@@ -256,7 +259,7 @@ lcVector3 View::GetMoveDirection(const lcVector3& Direction) const
 	return axis;
 }
 
-lcMatrix44 View::GetPieceInsertPosition() const
+lcMatrix44 View::GetPieceInsertPosition()
 {
 	PieceInfo* CurPiece = gMainWindow->mPreviewWidget->GetCurrentPiece();
 	lcPiece* HitPiece = (lcPiece*)FindObjectUnderPointer(true).Object;
@@ -287,7 +290,123 @@ lcMatrix44 View::GetPieceInsertPosition() const
 	return lcMatrix44Translation(UnprojectPoint(lcVector3((float)mInputState.x, (float)mInputState.y, 0.9f)));
 }
 
-lcObjectSection View::FindObjectUnderPointer(bool PiecesOnly) const
+static int lcPickPieceCompare(const void* Elem1, const void* Elem2)
+{
+	lcObject* Piece1 = *(lcObject**)Elem1;
+	lcObject* Piece2 = *(lcObject**)Elem2;
+
+	if (Piece1 < Piece2)
+		return -1;
+
+	return Piece1 > Piece2 ? 1 : 0;
+}
+
+// Renders the pieces into an offscreen buffer using a different color for each render mesh and returns the pieces
+// visible in the given rectangle. The rectangle is drawn to the corner of the buffer, the projection is scaled and
+// offset so the rectangle fills it. The framebuffer, viewport and projection are restored before returning.
+bool View::PickPieces(int x, int y, int Width, int Height, lcArray<lcObject*>& Pieces, float* Depth)
+{
+	if (x < 0)
+	{
+		Width += x;
+		x = 0;
+	}
+
+	if (y < 0)
+	{
+		Height += y;
+		y = 0;
+	}
+
+	Width = lcMin(Width, mWidth - x);
+	Height = lcMin(Height, mHeight - y);
+
+	if (Width <= 0 || Height <= 0)
+		return false;
+
+	MakeCurrent();
+
+	if (!mContext->BeginPickFramebuffer(Width, Height))
+		return false;
+
+	lcVector3 PickScale((float)mWidth / (float)Width, (float)mHeight / (float)Height, 1.0f);
+	lcVector3 PickCenter((2.0f * x + Width) / mWidth - 1.0f, (2.0f * y + Height) / mHeight - 1.0f, 0.0f);
+	lcMatrix44 PickMatrix = lcMul(lcMatrix44Scale(PickScale), lcMatrix44Translation(lcVector3(-PickCenter.x * PickScale.x, -PickCenter.y * PickScale.y, 0.0f)));
+
+	lcScene Scene;
+	lcMatrix44 ProjectionMatrix = lcMul(GetProjectionMatrix(), PickMatrix);
+	mModel->GetScene(Scene, mCamera, ProjectionMatrix, false, 1);
+
+	mContext->SetDefaultState();
+	mContext->SetViewport(0, 0, Width, Height);
+	mContext->SetProjectionMatrix(ProjectionMatrix);
+
+	glDisable(GL_DITHER);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// Id 0 is the background.
+	int NumOpaqueMeshes = Scene.mOpaqueMeshes.GetSize();
+	mContext->DrawPickMeshes(Scene, false, 1);
+	mContext->DrawPickMeshes(Scene, true, NumOpaqueMeshes + 1);
+	mContext->UnbindMesh();
+
+	glEnable(GL_DITHER);
+
+	lcuint8* Buffer = (lcuint8*)malloc(Width * Height * 4);
+	glReadPixels(0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, Buffer);
+
+	if (Depth)
+		glReadPixels(0, 0, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, Depth);
+
+	mContext->EndPickFramebuffer();
+
+	int NumPieces = Pieces.GetSize();
+	lcuint32 LastId = 0;
+
+	for (int PixelIdx = 0; PixelIdx < Width * Height; PixelIdx++)
+	{
+		const lcuint8* Pixel = Buffer + PixelIdx * 4;
+		lcuint32 Id = Pixel[0] | (Pixel[1] << 8) | (Pixel[2] << 16) | ((lcuint32)Pixel[3] << 24);
+
+		if (Id == 0 || Id == LastId)
+			continue;
+
+		LastId = Id;
+		int MeshIdx = Id - 1;
+		lcPiece* Piece;
+
+		if (MeshIdx < NumOpaqueMeshes)
+			Piece = Scene.mOpaqueMeshes[MeshIdx].Piece;
+		else if (MeshIdx - NumOpaqueMeshes < Scene.mTranslucentMeshes.GetSize())
+			Piece = Scene.mTranslucentMeshes[MeshIdx - NumOpaqueMeshes].Piece;
+		else
+			continue;
+
+		if (Piece)
+			Pieces.Add(Piece);
+	}
+
+	free(Buffer);
+
+	// Remove duplicates, a piece usually covers many pixels and can have more than one render mesh.
+	if (Pieces.GetSize() - NumPieces > 1)
+	{
+		qsort(&Pieces[NumPieces], Pieces.GetSize() - NumPieces, sizeof(lcObject*), lcPickPieceCompare);
+
+		int NumUnique = NumPieces + 1;
+
+		for (int PieceIdx = NumPieces + 1; PieceIdx < Pieces.GetSize(); PieceIdx++)
+			if (Pieces[PieceIdx] != Pieces[NumUnique - 1])
+				Pieces[NumUnique++] = Pieces[PieceIdx];
+
+		Pieces.SetSize(NumUnique);
+	}
+
+	return true;
+}
+
+lcObjectSection View::FindObjectUnderPointer(bool PiecesOnly)
 {
 	lcVector3 StartEnd[2] =
 	{
@@ -307,12 +426,34 @@ lcObjectSection View::FindObjectUnderPointer(bool PiecesOnly) const
 	ObjectRayTest.ObjectSection.Object = NULL;
 	ObjectRayTest.ObjectSection.Section = 0;;
 
+	if (lcGetPreferences().mIDBufferPicking)
+	{
+		lcArray<lcObject*> Pieces;
+		float Depth;
+
+		if (PickPieces(mInputState.x, mInputState.y, 1, 1, Pieces, &Depth))
+		{
+			if (!Pieces.IsEmpty())
+			{
+				lcVector3 Intersection = UnprojectPoint(lcVector3((float)mInputState.x, (float)mInputState.y, Depth));
+
+				ObjectRayTest.ObjectSection.Object = Pieces[0];
+				ObjectRayTest.Distance = lcLength(Intersection - ObjectRayTest.Start);
+			}
+
+			if (!PiecesOnly)
+				mModel->RayTestCamerasAndLights(ObjectRayTest);
+
+			return ObjectRayTest.ObjectSection;
+		}
+	}
+
 	mModel->RayTest(ObjectRayTest);
 
 	return ObjectRayTest.ObjectSection;
 }
 
-lcArray<lcObject*> View::FindObjectsInBox(float x1, float y1, float x2, float y2) const
+lcArray<lcObject*> View::FindObjectsInBox(float x1, float y1, float x2, float y2)
 {
 	float Left, Top, Bottom, Right;
 
@@ -367,6 +508,19 @@ lcArray<lcObject*> View::FindObjectsInBox(float x1, float y1, float x2, float y2
 	ObjectBoxTest.Planes[4] = lcVector4(PlaneNormals[4], -lcDot(PlaneNormals[4], Corners[0]));
 	ObjectBoxTest.Planes[5] = lcVector4(PlaneNormals[5], -lcDot(PlaneNormals[5], Corners[5]));
 
+	if (lcGetPreferences().mIDBufferPicking)
+	{
+		int x = (int)Left;
+		int y = (int)Bottom;
+
+		if (PickPieces(x, y, (int)Right - x + 1, (int)Top - y + 1, ObjectBoxTest.Objects, NULL))
+		{
+			mModel->BoxTestCamerasAndLights(ObjectBoxTest);
+
+			return ObjectBoxTest.Objects;
+		}
+	}
+
 	mModel->BoxTest(ObjectBoxTest);
 
 	return ObjectBoxTest.Objects;
@@ -376,25 +530,74 @@ void View::OnDraw()
 {
 	bool DrawInterface = mWidget != NULL;
 
-	mModel->GetScene(mScene, mCamera, DrawInterface);
+	QElapsedTimer FrameTimer;
+	FrameTimer.start();
 
-	if (DrawInterface && mTrackTool == LC_TRACKTOOL_INSERT)
-	{
-		PieceInfo* Info = gMainWindow->mPreviewWidget->GetCurrentPiece();
+	PieceInfo* InsertInfo = (DrawInterface && mTrackTool == LC_TRACKTOOL_INSERT) ? gMainWindow->mPreviewWidget->GetCurrentPiece() : NULL;
 
-		if (Info)
-			Info->AddRenderMeshes(mScene, GetPieceInsertPosition(), gMainWindow->mColorIndex, true, true);
-	}
+	if (InsertInfo)
+		mInsertPosition = GetPieceInsertPosition();
 
 	mContext->SetDefaultState();
-	mContext->SetViewport(0, 0, mWidth, mHeight);
 
-	mModel->DrawBackground(mContext);
+	// Each tile of an image drawn in tiles uses a viewport of the tile's size and draws its part of the background.
+	lcMatrix44 ProjectionMatrix = GetProjectionMatrix();
+	TiledRender* Tiles = mCamera->m_pTR;
+
+	if (Tiles)
+		mContext->SetViewport(0, 0, Tiles->m_CurrentTileWidth, Tiles->m_CurrentTileHeight);
+	else
+		mContext->SetViewport(0, 0, mWidth, mHeight);
+
+	if (!mIncrementalStep)
+	{
+		if (Tiles)
+			mModel->DrawBackground(mContext, Tiles->m_CurrentColumn * Tiles->m_TileWidthNB, Tiles->m_CurrentRow * Tiles->m_TileHeightNB, Tiles->m_ImageWidth, Tiles->m_ImageHeight);
+		else
+			mModel->DrawBackground(mContext);
+	}
 
 	const lcPreferences& Preferences = lcGetPreferences();
 	const lcModelProperties& Properties = mModel->GetProperties();
 
-	mContext->SetProjectionMatrix(GetProjectionMatrix());
+	mContext->SetProjectionMatrix(ProjectionMatrix);
+
+	lcStaticBatcher* StaticBatcher = (DrawInterface && Preferences.mStaticBatching) ? &mStaticBatcher : NULL;
+
+	if (mScene.GetStaticBatcher() != StaticBatcher)
+	{
+		mScene.SetStaticBatcher(StaticBatcher);
+		mStaticBatcher.RemoveAll();
+	}
+
+	mScene.SetOcclusionBuffer(Preferences.mOcclusionCulling ? &mOcclusionBuffer : NULL);
+
+	bool ReducedQuality = DrawInterface && Preferences.mAdaptiveQuality && mFullQualityFrameTime > LC_ADAPTIVE_QUALITY_FRAME_TIME &&
+	                      mNavigationTimer.isValid() && mNavigationTimer.elapsed() < LC_ADAPTIVE_QUALITY_IDLE_TIME;
+
+	mScene.mSortTranslucentMeshes = !ReducedQuality && !mContext->UseBlendedTransparency();
+	mScene.mDrawEdgeLines = !ReducedQuality;
+
+	QElapsedTimer SceneTimer;
+	SceneTimer.start();
+
+	mModel->UpdateScene(mScene, mCamera, ProjectionMatrix, DrawInterface, mIncrementalStep ? mModel->GetCurrentStep() : 1);
+
+	lcFrameStats& FrameStats = mContext->GetFrameStats();
+	FrameStats.SceneTime = SceneTimer.nsecsElapsed() / 1000000.0f;
+	FrameStats.SceneEndTime = mScene.mUpdateTime;
+	bool GpuTimer = DrawInterface && (Preferences.mShowFrameStats || g_App->mFrameStatsLog.IsOpen());
+
+	// The piece being inserted follows the mouse so it goes in its own scene instead of invalidating the model scene.
+	lcScene* InsertScene = NULL;
+
+	if (InsertInfo)
+	{
+		InsertScene = new lcScene();
+		InsertScene->Begin(mCamera->mWorldView, ProjectionMatrix);
+		InsertInfo->AddRenderMeshes(*InsertScene, mInsertPosition, gMainWindow->mColorIndex, true, true);
+		InsertScene->End();
+	}
 
 	if (Preferences.mLightingMode != LC_LIGHTING_FLAT)
 	{
@@ -413,6 +616,7 @@ void View::OnDraw()
 //			mLights[LightIdx]->Setup(LightIdx);
 
 		glEnable(GL_LIGHTING);
+		mContext->SetMeshLighting(true, Properties.mAmbientColor);
 	}
 	else
 	{
@@ -427,13 +631,31 @@ void View::OnDraw()
 		glFogf(GL_FOG_DENSITY, Properties.mFogDensity);
 		glFogfv(GL_FOG_COLOR, lcVector4(Properties.mFogColor, 1.0f));
 		glEnable(GL_FOG);
+		mContext->SetMeshFog(true, Properties.mFogDensity, Properties.mFogColor);
 	}
 
 	mContext->SetLineWidth(Preferences.mLineWidth);
 
 	const lcMatrix44& ViewMatrix = mCamera->mWorldView;
-	mContext->DrawOpaqueMeshes(ViewMatrix, mScene.mOpaqueMeshes);
-	mContext->DrawTranslucentMeshes(ViewMatrix, mScene.mTranslucentMeshes);
+
+	if (GpuTimer)
+		mContext->BeginGpuTimer();
+
+	mContext->DrawOpaqueMeshes(mScene);
+
+	if (InsertScene)
+		mContext->DrawOpaqueMeshes(*InsertScene);
+
+	mContext->DrawTranslucentMeshes(mScene);
+
+	if (InsertScene)
+	{
+		mContext->DrawTranslucentMeshes(*InsertScene);
+		delete InsertScene;
+	}
+
+	if (GpuTimer)
+		mContext->EndGpuTimer();
 
 	mContext->UnbindMesh(); // context remove
 
@@ -442,10 +664,14 @@ void View::OnDraw()
 		glDisable(GL_LIGHTING);
 		glDisable(GL_COLOR_MATERIAL);
 		glShadeModel(GL_FLAT);
+		mContext->SetMeshLighting(false, Properties.mAmbientColor);
 	}
 
 	if (Properties.mFogEnabled)
+	{
 		glDisable(GL_FOG);
+		mContext->SetMeshFog(false, Properties.mFogDensity, Properties.mFogColor);
+	}
 
 	if (DrawInterface)
 	{
@@ -473,6 +699,17 @@ void View::OnDraw()
 			DrawRotateViewOverlay();
 
 		DrawViewport();
+
+		g_App->mFrameStatsLog.Write(FrameStats, mWidth, mHeight);
+
+		if (ReducedQuality)
+			RedrawDelayed(LC_ADAPTIVE_QUALITY_IDLE_TIME);
+		else
+			mFullQualityFrameTime = FrameTimer.nsecsElapsed() / 1000000.0f;
+
+		// Keep drawing until the batches that changed are built again.
+		if (StaticBatcher && StaticBatcher->HasPendingBatches())
+			Redraw();
 	}
 }
 
@@ -1189,11 +1426,9 @@ void View::DrawGrid()
 				lcVector3(CurPiece->m_fDimensions[3], CurPiece->m_fDimensions[1], CurPiece->m_fDimensions[2])
 			};
 
-			lcMatrix44 WorldMatrix = GetPieceInsertPosition();
-
 			for (int i = 0; i < 8; i++)
 			{
-				lcVector3 Point = lcMul31(Points[i], WorldMatrix);
+				lcVector3 Point = lcMul31(Points[i], mInsertPosition);
 
 				if (Point[0] < BoundingBox[0]) BoundingBox[0] = Point[0];
 				if (Point[1] < BoundingBox[1]) BoundingBox[1] = Point[1];
@@ -1459,6 +1694,41 @@ void View::DrawViewport()
 		glDisable(GL_TEXTURE_2D);
 	}
 
+	if (lcGetPreferences().mShowFrameStats)
+	{
+		const lcFrameStats& FrameStats = mContext->GetFrameStats();
+		char Stats[4][256];
+
+		sprintf(Stats[0], "Meshes: %d opaque, %d translucent. Culled: %d pieces, %d models. Occluded: %d.", mScene.mOpaqueMeshes.GetSize(), mScene.mTranslucentMeshes.GetSize(), mScene.mNumCulledPieces, mScene.mNumCulledModels, mScene.mNumOccludedPieces);
+		sprintf(Stats[1], "Draw calls: %d. Sections: %d. Triangles: %d. Lines: %d.", FrameStats.NumDrawCalls, FrameStats.NumSections, FrameStats.NumTriangles, FrameStats.NumLines);
+		sprintf(Stats[2], "Binds: %d textures, %d buffers. Matrix loads: %d.", FrameStats.NumTextureBinds, FrameStats.NumBufferBinds, FrameStats.NumMatrixLoads);
+
+		if (FrameStats.GpuTime >= 0.0f)
+			sprintf(Stats[3], "Scene: %.2f ms (end %.2f ms). Opaque: %.2f ms. Translucent: %.2f ms. GPU: %.2f ms.", FrameStats.SceneTime, FrameStats.SceneEndTime, FrameStats.OpaqueTime, FrameStats.TranslucentTime, FrameStats.GpuTime);
+		else
+			sprintf(Stats[3], "Scene: %.2f ms (end %.2f ms). Opaque: %.2f ms. Translucent: %.2f ms.", FrameStats.SceneTime, FrameStats.SceneEndTime, FrameStats.OpaqueTime, FrameStats.TranslucentTime);
+
+		glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+		glEnable(GL_TEXTURE_2D);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		gTexFont.MakeCurrent();
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_BLEND);
+
+		float y = 3.0f;
+
+		for (int LineIdx = 3; LineIdx >= 0; LineIdx--)
+		{
+			int StatsWidth, StatsHeight;
+			gTexFont.GetStringDimensions(&StatsWidth, &StatsHeight, Stats[LineIdx]);
+			y += StatsHeight;
+			gTexFont.PrintText(3.0f, y, 0.0f, Stats[LineIdx]);
+		}
+
+		glDisable(GL_BLEND);
+		glDisable(GL_TEXTURE_2D);
+	}
+
 	glDepthMask(GL_TRUE);
 	glEnable(GL_DEPTH_TEST);
 }
@@ -2078,6 +2348,7 @@ void View::StopTracking(bool Accept)
 	}
 
 	mTrackButton = LC_TRACKBUTTON_NONE;
+	mNavigationTimer.invalidate();
 	UpdateTrackTool();
 	gMainWindow->UpdateAllViews();
 }
@@ -2330,6 +2601,9 @@ void View::OnMouseMove()
 
 	const float MouseSensitivity = 1.0f / (21.0f - lcGetPreferences().mMouseSensitivity);
 
+	if (mTrackTool >= LC_TRACKTOOL_ZOOM && mTrackTool <= LC_TRACKTOOL_ROLL)
+		mNavigationTimer.start();
+
 	switch (mTrackTool)
 	{
 	case LC_TRACKTOOL_NONE:
@@ -2583,5 +2857,6 @@ void View::OnMouseMove()
 
 void View::OnMouseWheel(float Direction)
 {
+	mNavigationTimer.start();
 	mModel->Zoom(mCamera, (int)((mInputState.Control ? 100 : 10) * Direction));
 }
@@ -4,6 +4,13 @@
 #include "lc_glwidget.h"
 #include "lc_model.h"
 #include "camera.h"
+#include "lc_staticbatch.h"
+#include "lc_occlusion.h"
+
+// While the camera is moving, frames are drawn without edge lines if a full quality frame took longer than this many
+// milliseconds, and a full quality frame is drawn once the camera stops for LC_ADAPTIVE_QUALITY_IDLE_TIME milliseconds.
+#define LC_ADAPTIVE_QUALITY_FRAME_TIME 30.0f
+#define LC_ADAPTIVE_QUALITY_IDLE_TIME 250
 
 enum lcTrackButton
 {
@@ -90,13 +97,20 @@ public:
 	LC_CURSOR_TYPE GetCursor() const;
 
 	lcVector3 GetMoveDirection(const lcVector3& Direction) const;
-	lcMatrix44 GetPieceInsertPosition() const;
-	lcObjectSection FindObjectUnderPointer(bool PiecesOnly) const;
-	lcArray<lcObject*> FindObjectsInBox(float x1, float y1, float x2, float y2) const;
+	lcMatrix44 GetPieceInsertPosition();
+	lcObjectSection FindObjectUnderPointer(bool PiecesOnly);
+	lcArray<lcObject*> FindObjectsInBox(float x1, float y1, float x2, float y2);
+	bool PickPieces(int x, int y, int Width, int Height, lcArray<lcObject*>& Pieces, float* Depth);
+
+	const lcScene& GetScene() const
+	{
+		return mScene;
+	}
 
 	lcModel* mModel;
 	lcCamera* mCamera;
 	QMap<lcModel*, lcCamera*> mCameras;
+	bool mIncrementalStep; // Only draws the pieces added in the current step over the previous image, without clearing it.
 
 	lcVector3 ProjectPoint(const lcVector3& Point) const
 	{
@@ -132,11 +146,16 @@ protected:
 	void StopTracking(bool Accept);
 
 	lcScene mScene;
+	lcStaticBatcher mStaticBatcher;
+	lcOcclusionBuffer mOcclusionBuffer;
+	QElapsedTimer mNavigationTimer; // Started by each mouse event that moves the camera.
+	float mFullQualityFrameTime;
 	lcDragState mDragState;
 	lcTrackButton mTrackButton;
 	lcTrackTool mTrackTool;
 	int mMouseDownX;
 	int mMouseDownY;
+	lcMatrix44 mInsertPosition; // Picked before each frame drawn with the insert tool, picking can't run in the middle of a frame.
 
 	lcVertexBuffer* mGridBuffer;
 	int mGridSettings[7];
@@ -102,6 +102,11 @@ unix:!macx {
 	!isEmpty(LDRAW_LIBRARY_PATH) {
 		DEFINES += LC_LDRAW_LIBRARY_PATH=\\\"$$LDRAW_LIBRARY_PATH\\\"
 	}
+
+	!isEmpty(HEADLESS_EGL) {
+		DEFINES += LC_HEADLESS_EGL
+		LIBS += -lEGL
+	}
 }
 
 macx {
@@ -129,17 +134,26 @@ SOURCES += common/view.cpp \
     common/minifig.cpp \
     common/light.cpp \
     common/lc_application.cpp \
+    common/lc_bvh.cpp \
     common/lc_category.cpp \
     common/lc_colors.cpp \
     common/lc_commands.cpp \
     common/lc_context.cpp \
     common/lc_file.cpp \
+    common/lc_framestats.cpp \
+    common/lc_imagewriter.cpp \
     common/lc_library.cpp \
     common/lc_mainwindow.cpp \
     common/lc_mesh.cpp \
+    common/lc_meshoptimizer.cpp \
     common/lc_model.cpp \
+    common/lc_occlusion.cpp \
+    common/lc_partthumbnailrenderer.cpp \
+    common/lc_pngwriter.cpp \
     common/lc_profile.cpp \
     common/lc_shortcuts.cpp \
+    common/lc_simd.cpp \
+    common/lc_staticbatch.cpp \
     common/lc_texture.cpp \
     common/lc_zipfile.cpp \
     common/image.cpp \
@@ -166,6 +180,7 @@ SOURCES += common/view.cpp \
     qt/lc_qpropertiestree.cpp \
     qt/lc_qcolorpicker.cpp \
     qt/lc_qglwidget.cpp \
+    qt/lc_qheadlesscontext.cpp \
     qt/lc_qcolorlist.cpp \
     qt/lc_qfinddialog.cpp \
     qt/lc_qmodellistdialog.cpp \
@@ -187,20 +202,29 @@ HEADERS += \
     common/lc_application.h \
     common/lc_array.h \
     common/lc_basewindow.h \
+    common/lc_bvh.h \
     common/lc_category.h \
     common/lc_colors.h \
     common/lc_commands.h \
     common/lc_context.h \
     common/lc_file.h \
+    common/lc_framestats.h \
     common/lc_global.h \
     common/lc_glwidget.h \
+    common/lc_imagewriter.h \
     common/lc_library.h \
     common/lc_mainwindow.h \
     common/lc_math.h \
     common/lc_mesh.h \
+    common/lc_meshoptimizer.h \
     common/lc_model.h \
+    common/lc_occlusion.h \
+    common/lc_partthumbnailrenderer.h \
+    common/lc_pngwriter.h \
     common/lc_profile.h \
     common/lc_shortcuts.h \
+    common/lc_simd.h \
+    common/lc_staticbatch.h \
     common/lc_texture.h \
     common/lc_zipfile.h \
     common/image.h \
@@ -225,6 +249,7 @@ HEADERS += \
     qt/lc_qpropertiestree.h \
     qt/lc_qcolorpicker.h \
     qt/lc_qglwidget.h \
+    qt/lc_qheadlesscontext.h \
     qt/lc_qcolorlist.h \
     qt/lc_qfinddialog.h \
     qt/lc_qmodellistdialog.h \
@@ -27,6 +27,13 @@ void lcGLWidget::Redraw()
 	Widget->mUpdateTimer.start(0);
 }
 
+void lcGLWidget::RedrawDelayed(int Milliseconds)
+{
+	lcQGLWidget* Widget = (lcQGLWidget*)mWidget;
+
+	Widget->mUpdateTimer.start(Milliseconds);
+}
+
 void* lcGLWidget::GetExtensionAddress(const char* FunctionName)
 {
 	QGLWidget* Widget = (QGLWidget*)mWidget;
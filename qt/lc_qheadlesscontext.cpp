@@ -0,0 +1,164 @@
+#include "lc_global.h"
+#include "lc_qheadlesscontext.h"
+#include "lc_mesh.h"
+
+#ifdef LC_HEADLESS_EGL
+#define MESA_EGL_NO_X11_HEADERS
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#endif
+
+lcHeadlessContext::lcHeadlessContext()
+{
+	mCreated = false;
+	mWidth = 0;
+	mHeight = 0;
+
+#ifdef LC_HEADLESS_EGL
+	mDisplay = EGL_NO_DISPLAY;
+	mGLContext = EGL_NO_CONTEXT;
+	mSurface = EGL_NO_SURFACE;
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+	mSurface = NULL;
+	mGLContext = NULL;
+#endif
+}
+
+lcHeadlessContext::~lcHeadlessContext()
+{
+	if (mCreated)
+	{
+		MakeCurrent();
+
+		delete gPlaceholderMesh;
+		gPlaceholderMesh = NULL;
+	}
+
+	// The context deletes its GL objects so it must go before the GL context.
+	if (mDeleteContext)
+	{
+		delete mContext;
+		mContext = NULL;
+	}
+
+#ifdef LC_HEADLESS_EGL
+	if (mDisplay != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+		if (mSurface != EGL_NO_SURFACE)
+			eglDestroySurface(mDisplay, mSurface);
+
+		if (mGLContext != EGL_NO_CONTEXT)
+			eglDestroyContext(mDisplay, mGLContext);
+
+		eglTerminate(mDisplay);
+	}
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+	delete mGLContext;
+	delete mSurface;
+#endif
+}
+
+bool lcHeadlessContext::Create()
+{
+#ifdef LC_HEADLESS_EGL
+	EGLDisplay Display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC GetPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (GetPlatformDisplay)
+		Display = GetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+	if (Display == EGL_NO_DISPLAY)
+		Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, NULL, NULL))
+		return false;
+
+	mDisplay = Display;
+
+	const EGLint ConfigAttributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+
+	EGLConfig Config;
+	EGLint NumConfigs = 0;
+
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(Display, ConfigAttributes, &Config, 1, &NumConfigs) || NumConfigs < 1)
+		return false;
+
+	mGLContext = eglCreateContext(Display, Config, EGL_NO_CONTEXT, NULL);
+
+	if (mGLContext == EGL_NO_CONTEXT)
+		return false;
+
+	// Images are drawn to framebuffer objects, a surface is only created for drivers without EGL_KHR_surfaceless_context.
+	if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, mGLContext))
+	{
+		const EGLint SurfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+		mSurface = eglCreatePbufferSurface(Display, Config, SurfaceAttributes);
+
+		if (mSurface == EGL_NO_SURFACE || !eglMakeCurrent(Display, mSurface, mSurface, mGLContext))
+			return false;
+	}
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+	mSurface = new QOffscreenSurface();
+	mSurface->create();
+
+	mGLContext = new QOpenGLContext();
+
+	if (!mGLContext->create() || !mGLContext->makeCurrent(mSurface))
+		return false;
+#else
+	return false;
+#endif
+
+	mCreated = true;
+
+	GL_InitializeSharedExtensions(this);
+
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(0.5f, 0.1f);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_TRUE);
+
+	gPlaceholderMesh = new lcMesh;
+	gPlaceholderMesh->CreateBox();
+
+	return true;
+}
+
+void lcHeadlessContext::MakeCurrent()
+{
+#ifdef LC_HEADLESS_EGL
+	eglMakeCurrent(mDisplay, mSurface, mSurface, mGLContext);
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+	mGLContext->makeCurrent(mSurface);
+#endif
+}
+
+void* lcHeadlessContext::GetExtensionAddress(const char* FunctionName)
+{
+#ifdef LC_HEADLESS_EGL
+	return (void*)eglGetProcAddress(FunctionName);
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+	return (void*)mGLContext->getProcAddress(FunctionName);
+#else
+	return NULL;
+#endif
+}
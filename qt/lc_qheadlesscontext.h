@@ -0,0 +1,37 @@
+#ifndef _LC_QHEADLESSCONTEXT_H_
+#define _LC_QHEADLESSCONTEXT_H_
+
+#include "lc_glwidget.h"
+
+#if !defined(LC_HEADLESS_EGL) && (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+class QOffscreenSurface;
+class QOpenGLContext;
+#endif
+
+// OpenGL context that isn't attached to a window, used to draw images from the command line without creating any
+// widgets. When built with LC_HEADLESS_EGL it's an EGL surfaceless context that doesn't need a display server.
+class lcHeadlessContext : public lcGLWidget
+{
+public:
+	lcHeadlessContext();
+	virtual ~lcHeadlessContext();
+
+	bool Create();
+
+	virtual void MakeCurrent();
+	virtual void* GetExtensionAddress(const char* FunctionName);
+
+protected:
+	bool mCreated;
+
+#ifdef LC_HEADLESS_EGL
+	void* mDisplay;
+	void* mGLContext;
+	void* mSurface;
+#elif (QT_VERSION >= QT_VERSION_CHECK(5, 1, 0))
+	QOffscreenSurface* mSurface;
+	QOpenGLContext* mGLContext;
+#endif
+};
+
+#endif // _LC_QHEADLESSCONTEXT_H_
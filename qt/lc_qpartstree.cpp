@@ -6,6 +6,7 @@
 #include "pieceinf.h"
 #include "project.h"
 #include "lc_model.h"
+#include "lc_partthumbnailrenderer.h"
 
 static int lcQPartsTreeSortFunc(PieceInfo* const& a, PieceInfo* const& b)
 {
@@ -32,9 +33,23 @@ lcQPartsTree::lcQPartsTree(QWidget* Parent)
 {
 	setDragEnabled(true);
 	setHeaderHidden(true);
-	setUniformRowHeights(true);
+	setIconSize(QSize(LC_THUMBNAIL_SIZE, LC_THUMBNAIL_SIZE));
 	connect(this, SIGNAL(itemExpanded(QTreeWidgetItem*)), this, SLOT(itemExpanded(QTreeWidgetItem*)));
 
+	QPixmap Placeholder(LC_THUMBNAIL_SIZE, LC_THUMBNAIL_SIZE);
+	Placeholder.fill(Qt::transparent);
+	mPlaceholderIcon = QIcon(Placeholder);
+
+	// Thumbnails are only requested for the visible rows after the tree has been laid out.
+	mThumbnailRenderer = new lcPartThumbnailRenderer(this);
+	mThumbnailTimer.setSingleShot(true);
+	mThumbnailTimer.setInterval(0);
+	connect(&mThumbnailTimer, SIGNAL(timeout()), this, SLOT(UpdateThumbnails()));
+	connect(mThumbnailRenderer, SIGNAL(ThumbnailsReady()), &mThumbnailTimer, SLOT(start()));
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), &mThumbnailTimer, SLOT(start()));
+	connect(this, SIGNAL(itemExpanded(QTreeWidgetItem*)), &mThumbnailTimer, SLOT(start()));
+	connect(this, SIGNAL(itemCollapsed(QTreeWidgetItem*)), &mThumbnailTimer, SLOT(start()));
+
 	updateCategories();
 }
 
@@ -74,9 +89,60 @@ bool lcQPartsTree::event(QEvent *event)
 	return QTreeWidget::event(event);
 }
 
+void lcQPartsTree::resizeEvent(QResizeEvent* Event)
+{
+	QTreeWidget::resizeEvent(Event);
+
+	mThumbnailTimer.start();
+}
+
+QTreeWidgetItem* lcQPartsTree::CreatePartItem(QTreeWidgetItem* Parent, const QString& Text, PieceInfo* Info)
+{
+	QTreeWidgetItem* Item = new QTreeWidgetItem(Parent, QStringList(Text));
+	Item->setData(0, PieceInfoRole, qVariantFromValue((void*)Info));
+	Item->setToolTip(0, QString("%1 (%2)").arg(Info->m_strDescription, Info->m_strName));
+	Item->setIcon(0, mPlaceholderIcon);
+
+	return Item;
+}
+
+void lcQPartsTree::UpdateThumbnails()
+{
+	lcArray<PieceInfo*> Pieces;
+	int ViewportHeight = viewport()->height();
+
+	for (QTreeWidgetItem* Item = itemAt(0, 0); Item; Item = itemBelow(Item))
+	{
+		if (visualItemRect(Item).top() >= ViewportHeight)
+			break;
+
+		if (Item->data(0, ThumbnailRole).toBool() || Item->parent() == mModelListItem)
+			continue;
+
+		PieceInfo* Info = (PieceInfo*)Item->data(0, PieceInfoRole).value<void*>();
+
+		if (!Info)
+			continue;
+
+		QPixmap Thumbnail = mThumbnailRenderer->GetThumbnail(Info);
+
+		if (Thumbnail.isNull())
+		{
+			Pieces.Add(Info);
+			continue;
+		}
+
+		Item->setIcon(0, QIcon(Thumbnail));
+		Item->setData(0, ThumbnailRole, QVariant(true));
+	}
+
+	mThumbnailRenderer->RequestThumbnails(Pieces);
+}
+
 void lcQPartsTree::updateCategories()
 {
 	clear();
+	mThumbnailRenderer->Clear();
 
 	for (int categoryIndex = 0; categoryIndex < gCategories.GetSize(); categoryIndex++)
 	{
@@ -125,9 +191,7 @@ void lcQPartsTree::searchParts(const QString& searchString)
 	{
 		PieceInfo* partInfo = singleParts[partIndex];
 
-		QTreeWidgetItem* partItem = new QTreeWidgetItem(mSearchResultsItem, QStringList(partInfo->m_strDescription));
-		partItem->setData(0, PieceInfoRole, qVariantFromValue((void*)partInfo));
-		partItem->setToolTip(0, QString("%1 (%2)").arg(partInfo->m_strDescription, partInfo->m_strName));
+		CreatePartItem(mSearchResultsItem, partInfo->m_strDescription, partInfo);
 	}
 
 	setCurrentItem(mSearchResultsItem);
@@ -163,9 +227,7 @@ void lcQPartsTree::itemExpanded(QTreeWidgetItem *expandedItem)
 	{
 		PieceInfo* partInfo = singleParts[partIndex];
 
-		QTreeWidgetItem* partItem = new QTreeWidgetItem(expandedItem, QStringList(partInfo->m_strDescription));
-		partItem->setData(0, PieceInfoRole, qVariantFromValue((void*)partInfo));
-		partItem->setToolTip(0, QString("%1 (%2)").arg(partInfo->m_strDescription, partInfo->m_strName));
+		QTreeWidgetItem* partItem = CreatePartItem(expandedItem, partInfo->m_strDescription, partInfo);
 
 		if (groupedParts.FindIndex(partInfo) != -1)
 		{
@@ -185,9 +247,7 @@ void lcQPartsTree::itemExpanded(QTreeWidgetItem *expandedItem)
 				if (!strncmp(patternedInfo->m_strDescription, partInfo->m_strDescription, len))
 					desc += len;
 
-				QTreeWidgetItem* patternedItem = new QTreeWidgetItem(partItem, QStringList(desc));
-				patternedItem->setData(0, PieceInfoRole, qVariantFromValue((void*)patternedInfo));
-				patternedItem->setToolTip(0, QString("%1 (%2)").arg(patternedInfo->m_strDescription, patternedInfo->m_strName));
+				CreatePartItem(partItem, desc, patternedInfo);
 			}
 		}
 	}
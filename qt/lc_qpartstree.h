@@ -3,6 +3,7 @@
 
 #include <QTreeWidget>
 class PieceInfo;
+class lcPartThumbnailRenderer;
 
 class lcQPartsTree : public QTreeWidget
 {
@@ -23,18 +24,25 @@ public:
 	{
 		PieceInfoRole = Qt::UserRole,
 		CategoryRole,
-		ExpandedOnceRole
+		ExpandedOnceRole,
+		ThumbnailRole
 	};
 
 protected:
 	bool event(QEvent *event);
+	void resizeEvent(QResizeEvent* Event);
+	QTreeWidgetItem* CreatePartItem(QTreeWidgetItem* Parent, const QString& Text, PieceInfo* Info);
 
 public slots:
 	void itemExpanded(QTreeWidgetItem *item);
+	void UpdateThumbnails();
 
 private:
 	QTreeWidgetItem* mModelListItem;
 	QTreeWidgetItem* mSearchResultsItem;
+	lcPartThumbnailRenderer* mThumbnailRenderer;
+	QTimer mThumbnailTimer;
+	QIcon mPlaceholderIcon;
 };
 
 #endif // LC_QPARTSTREE_H
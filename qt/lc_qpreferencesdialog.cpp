@@ -31,6 +31,7 @@ lcQPreferencesDialog::lcQPreferencesDialog(QWidget *parent, void *data) :
 	ui->mouseSensitivity->setValue(options->Preferences.mMouseSensitivity);
 	ui->checkForUpdates->setCurrentIndex(options->CheckForUpdates);
 	ui->fixedDirectionKeys->setChecked((options->Preferences.mFixedAxes) != 0);
+	ui->idBufferPicking->setChecked(options->Preferences.mIDBufferPicking);
 
 	ui->antiAliasing->setChecked(options->AASamples != 1);
 	if (options->AASamples == 8)
@@ -46,6 +47,13 @@ lcQPreferencesDialog::lcQPreferencesDialog(QWidget *parent, void *data) :
 	ui->gridLineSpacing->setText(QString::number(options->Preferences.mGridLineSpacing));
 	ui->axisIcon->setChecked(options->Preferences.mDrawAxes);
 	ui->enableLighting->setChecked(options->Preferences.mLightingMode != LC_LIGHTING_FLAT);
+	ui->staticBatching->setChecked(options->Preferences.mStaticBatching);
+	ui->shaderRendering->setChecked(options->Preferences.mShaderRendering);
+	ui->blendedTransparency->setChecked(options->Preferences.mBlendedTransparency);
+	ui->occlusionCulling->setChecked(options->Preferences.mOcclusionCulling);
+	ui->adaptiveQuality->setChecked(options->Preferences.mAdaptiveQuality);
+	ui->frameStats->setChecked(options->Preferences.mShowFrameStats);
+	ui->compactMeshes->setChecked(options->Preferences.mCompactMeshes);
 
 	QPixmap pix(12, 12);
 
@@ -59,6 +67,7 @@ lcQPreferencesDialog::lcQPreferencesDialog(QWidget *parent, void *data) :
 	on_edgeLines_toggled();
 	on_gridStuds_toggled();
 	on_gridLines_toggled();
+	on_shaderRendering_toggled();
 
 	updateCategories();
 	ui->categoriesTree->setCurrentItem(ui->categoriesTree->topLevelItem(0));
@@ -91,6 +100,7 @@ void lcQPreferencesDialog::accept()
 	options->Preferences.mMouseSensitivity = ui->mouseSensitivity->value();
 	options->CheckForUpdates = ui->checkForUpdates->currentIndex();
 	options->Preferences.mFixedAxes = ui->fixedDirectionKeys->isChecked();
+	options->Preferences.mIDBufferPicking = ui->idBufferPicking->isChecked();
 
 	if (!ui->antiAliasing->isChecked())
 		options->AASamples = 1;
@@ -103,6 +113,13 @@ void lcQPreferencesDialog::accept()
 
 	options->Preferences.mDrawEdgeLines = ui->edgeLines->isChecked();
 	options->Preferences.mLineWidth = ui->lineWidth->text().toFloat();
+	options->Preferences.mStaticBatching = ui->staticBatching->isChecked();
+	options->Preferences.mShaderRendering = ui->shaderRendering->isChecked();
+	options->Preferences.mBlendedTransparency = ui->blendedTransparency->isChecked();
+	options->Preferences.mOcclusionCulling = ui->occlusionCulling->isChecked();
+	options->Preferences.mAdaptiveQuality = ui->adaptiveQuality->isChecked();
+	options->Preferences.mShowFrameStats = ui->frameStats->isChecked();
+	options->Preferences.mCompactMeshes = ui->compactMeshes->isChecked();
 
 	options->Preferences.mDrawGridStuds = ui->gridStuds->isChecked();
 	options->Preferences.mDrawGridLines = ui->gridLines->isChecked();
@@ -206,6 +223,11 @@ void lcQPreferencesDialog::on_gridLines_toggled()
 	ui->gridLineColor->setEnabled(ui->gridLines->isChecked());
 }
 
+void lcQPreferencesDialog::on_shaderRendering_toggled()
+{
+	ui->blendedTransparency->setEnabled(ui->shaderRendering->isChecked());
+}
+
 void lcQPreferencesDialog::updateCategories()
 {
 	QTreeWidgetItem *categoryItem;
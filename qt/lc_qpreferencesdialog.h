@@ -36,6 +36,7 @@ public slots:
 	void on_edgeLines_toggled();
 	void on_gridStuds_toggled();
 	void on_gridLines_toggled();
+	void on_shaderRendering_toggled();
 	void updateParts();
 	void on_newCategory_clicked();
 	void on_editCategory_clicked();
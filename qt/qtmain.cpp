@@ -126,6 +126,13 @@ static void lcRegisterShellFileTypes()
 
 int main(int argc, char *argv[])
 {
+#if defined(LC_HEADLESS_EGL) && (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+	// Use a platform plugin that doesn't need a display server when drawing without windows.
+	for (int argIdx = 1; argIdx < argc; argIdx++)
+		if (!strcmp(argv[argIdx], "--headless") && qgetenv("QT_QPA_PLATFORM").isEmpty())
+			qputenv("QT_QPA_PLATFORM", "offscreen");
+#endif
+
 	QApplication app(argc, argv);
 
 	QCoreApplication::setOrganizationDomain("leocad.org");
@@ -176,7 +183,7 @@ int main(int argc, char *argv[])
 	dir.mkpath(cachePath);
 
 	if (!g_App->Initialize(argc, argv, libPath, LDrawPath, cachePath.toLocal8Bit().data()))
-		return 1;
+		return g_App->mExitCode;
 
 	gMainWindow->SetColorIndex(lcGetColorIndex(4));
 	gMainWindow->UpdateRecentFiles();